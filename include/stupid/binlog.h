@@ -0,0 +1,288 @@
+/// @file binlog.h
+/// @brief Binary deferred format logging.
+/// Instead of formatting logs, the logger stores the format string once, and then only the
+/// format string offset, the timestamp, and the raw argument bytes of every log in a memory mapped ring file.
+/// The logs are turned back into text later by the stupid_logdump tool.
+/// @author nonexistant
+
+#pragma once
+
+#include "stupid/common.h"
+#include "stupid/assert.h"
+
+#include <stdarg.h>
+
+/// First 4 bytes of a binary log file.
+#define STUPID_BINLOG_MAGIC "STBL"
+
+/// Version of the binary log file format.
+#define STUPID_BINLOG_VERSION 1
+
+/// Size of each record in a binary log file.
+#define ST_BINLOG_RECORD_SIZE 256
+
+/// Default size of the string table in a binary log file.
+#define ST_BINLOG_STRING_CAPACITY (sizeof(StKb) * 256)
+
+/// Number of different strings (format strings, function names, and filenames) a binary log can store.
+/// @note Must be a power of 2.
+#define ST_BINLOG_MAX_STRINGS 4096
+
+/// Start of a binary log file.
+typedef STUPID_ALIGN(64) struct StBinLogHeader {
+	/// Always STUPID_BINLOG_MAGIC.
+	char magic[4];
+
+	/// Always STUPID_BINLOG_VERSION.
+	u32 version;
+
+	/// Always ST_BINLOG_RECORD_SIZE.
+	u32 record_size;
+
+	/// Number of records in the ring.
+	/// @note Always a power of 2.
+	u32 record_count;
+
+	/// Offset of the string table from the start of the file.
+	u64 strings_offset;
+
+	/// Size of the string table.
+	u64 string_capacity;
+
+	/// Offset of the first record from the start of the file.
+	u64 records_offset;
+
+	/// Bytes of the string table that are used.
+	STUPID_ATOMIC u64 string_size;
+
+	/// @brief Sequence number of the next record.
+	/// The last record_count records before this one are in the ring.
+	STUPID_ATOMIC u64 next;
+
+	/// stGetTime() when the log was opened.
+	f64 start_time;
+} StBinLogHeader;
+
+/// A single log in a binary log file.
+typedef struct StBinLogRecord {
+	/// @brief Sequence number of this record + 1.
+	/// Written last, so a record that doesnt match its position in the ring is either unfinished or overwritten.
+	STUPID_ATOMIC u64 sequence;
+
+	/// stGetTime() when the log was written.
+	f64 time;
+
+	/// Offset of the format string in the string table.
+	u32 format;
+
+	/// Offset of the function name in the string table (0 if there isnt one).
+	u32 function;
+
+	/// Offset of the filename in the string table (0 if there isnt one).
+	u32 file;
+
+	/// Line number (only used if there is a filename).
+	u32 line;
+
+	/// Log level.
+	u8 level;
+
+	/// True if the arguments did not fit in the record.
+	u8 truncated;
+
+	u16 reserved;
+
+	/// Number of bytes in args.
+	u32 length;
+
+	/// @brief Raw arguments.
+	/// Integers, floats, and pointers are 8 bytes each, and strings are a u32 length followed by the characters.
+	u8 args[ST_BINLOG_RECORD_SIZE - 40];
+} StBinLogRecord;
+
+STUPID_STATIC_ASSERT(sizeof(StBinLogRecord) == ST_BINLOG_RECORD_SIZE, "StBinLogRecord is the wrong size");
+
+/// Type of argument used by a printf conversion.
+typedef enum st_binlog_arg {
+	/// Doesnt use an argument (%%).
+	ST_BINLOG_ARG_NONE,
+
+	/// Signed integer (d, i, c).
+	ST_BINLOG_ARG_INT,
+
+	/// Unsigned integer (u, o, x, X).
+	ST_BINLOG_ARG_UINT,
+
+	/// Floating point (f, F, e, E, g, G, a, A).
+	ST_BINLOG_ARG_DOUBLE,
+
+	/// String (s).
+	ST_BINLOG_ARG_STRING,
+
+	/// Pointer (p, n).
+	ST_BINLOG_ARG_POINTER,
+} st_binlog_arg;
+
+/// printf length modifiers.
+typedef enum st_binlog_length {
+	ST_BINLOG_LENGTH_NONE,
+	ST_BINLOG_LENGTH_HH,
+	ST_BINLOG_LENGTH_H,
+	ST_BINLOG_LENGTH_L,
+	ST_BINLOG_LENGTH_LL,
+	ST_BINLOG_LENGTH_LONG_DOUBLE,
+} st_binlog_length;
+
+/// A single printf conversion.
+typedef struct StBinLogSpec {
+	/// The '%' starting the conversion.
+	const char *start;
+
+	/// First character of the length modifier (or the conversion character if there isnt one).
+	const char *length_start;
+
+	/// The conversion character.
+	const char *conversion;
+
+	/// Argument type.
+	st_binlog_arg type;
+
+	/// Length modifier.
+	st_binlog_length length;
+
+	/// Number of '*' widths or precisions (each one uses an int argument before the actual argument).
+	u8 stars;
+} StBinLogSpec;
+
+/**
+ * Finds the next conversion in a printf format string.
+ * @param ppFormat Pointer to the format string (moved past the conversion).
+ * @param pSpec Where to put the conversion.
+ * @return False if there are no more conversions.
+ * @note This only needs to be good enough to know which arguments a format string uses.
+ */
+static STUPID_INLINE bool stBinLogNextSpec(const char **ppFormat, StBinLogSpec *pSpec)
+{
+	const char *p = *ppFormat;
+	while (*p && *p != '%') p++;
+	if (*p == '\0') {
+		*ppFormat = p;
+		return false;
+	}
+
+	pSpec->start  = p++;
+	pSpec->stars  = 0;
+	pSpec->length = ST_BINLOG_LENGTH_NONE;
+
+	// flags, width, and precision
+	while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0' || *p == '.' || *p == '*' || (*p >= '1' && *p <= '9')) {
+		if (*p == '*') pSpec->stars++;
+		p++;
+	}
+
+	pSpec->length_start = p;
+	switch (*p) {
+	case 'h':
+		p++;
+		if (*p == 'h') {
+			pSpec->length = ST_BINLOG_LENGTH_HH;
+			p++;
+		}
+		else pSpec->length = ST_BINLOG_LENGTH_H;
+		break;
+	case 'l':
+		p++;
+		if (*p == 'l') {
+			pSpec->length = ST_BINLOG_LENGTH_LL;
+			p++;
+		}
+		else pSpec->length = ST_BINLOG_LENGTH_L;
+		break;
+	case 'j':
+	case 'z':
+	case 't':
+		pSpec->length = ST_BINLOG_LENGTH_LL;
+		p++;
+		break;
+	case 'L':
+		pSpec->length = ST_BINLOG_LENGTH_LONG_DOUBLE;
+		p++;
+		break;
+	default:
+		break;
+	}
+
+	pSpec->conversion = p;
+	switch (*p) {
+	case 'd':
+	case 'i':
+	case 'c':
+		pSpec->type = ST_BINLOG_ARG_INT;
+		break;
+	case 'u':
+	case 'o':
+	case 'x':
+	case 'X':
+		pSpec->type = ST_BINLOG_ARG_UINT;
+		break;
+	case 'f':
+	case 'F':
+	case 'e':
+	case 'E':
+	case 'g':
+	case 'G':
+	case 'a':
+	case 'A':
+		pSpec->type = ST_BINLOG_ARG_DOUBLE;
+		break;
+	case 's':
+		pSpec->type = ST_BINLOG_ARG_STRING;
+		break;
+	case 'p':
+	case 'n':
+		pSpec->type = ST_BINLOG_ARG_POINTER;
+		break;
+	default:
+		pSpec->type = ST_BINLOG_ARG_NONE;
+		break;
+	}
+
+	// dont run past the end of a format string that ends in the middle of a conversion
+	*ppFormat = (*p) ? p + 1 : p;
+	return true;
+}
+
+/**
+ * Creates a binary log file and sends every log to it from now on.
+ * @param path Path to the log file.
+ * @param record_count Number of logs the ring can hold before overwriting old ones (rounded up to a power of 2).
+ * @return True if successful.
+ * @note Critical, fatal, and error logs are still printed as well.
+ * @see stBinLogClose
+ */
+bool stBinLogOpen(const char *path, const u32 record_count);
+
+/**
+ * Closes the binary log file.
+ * @note Logs are printed normally again afterwards.
+ */
+void stBinLogClose(void);
+
+/**
+ * Checks if a binary log file is open.
+ * @return True if logs are being sent to a binary log file.
+ */
+bool stBinLogIsOpen(void);
+
+/**
+ * Writes a log to the binary log file.
+ * @param level Log level.
+ * @param format printf format string.
+ * @param function Name of the function the log is from (can be NULL).
+ * @param file Name of the file the log is from (can be NULL).
+ * @param line Line the log is from.
+ * @param pArg printf format arguments.
+ * @return False if no binary log file is open.
+ * @note format, function, and file are only stored once, so they have to be string literals (or at least never change).
+ */
+bool stBinLogWrite(const u8 level, const char *format, const char *function, const char *file, const u32 line, va_list pArg);
@@ -5,6 +5,7 @@
 
 #include <bits/time.h>
 #include <time.h>
+#include <x86intrin.h>
 
 #define STUPID_SEC_TO_MS(t) _Generic ((t), f32: ((t) * 1000.0), f64: ((t) * 1000.0), default: ((t) * 1000))
 #define STUPID_SEC_TO_US(t) _Generic ((t), f32: ((t) * 1000.0 * 1000.0), f64: ((t) * 1000.0 * 1000.0), default: ((t) * 1000 * 1000))
@@ -34,18 +35,83 @@ typedef struct STUPID_A8 StClock {
 	f64 update_time;
 } StClock;
 
+/// Milliseconds stClockCalibrate() spends measuring the TSC frequency.
+#define ST_TSC_CALIBRATION_TIME 50
+
+/// @brief Converts TSC ticks to seconds.
+/// @note Set by stClockCalibrate().
+typedef struct StTsc {
+	/// Length of a single tick.
+	f64 seconds_per_tick;
+
+	/// Ticks per second.
+	f64 frequency;
+
+	/// TSC value when base_time was measured.
+	u64 base_ticks;
+
+	/// CLOCK_MONOTONIC time when base_ticks was read.
+	f64 base_time;
+
+	/// If the TSC is invariant and has been calibrated (otherwise stGetTime() uses clock_gettime()).
+	bool usable;
+} StTsc;
+
+/// TSC calibration used by stGetTime().
+extern StTsc st_tsc;
+
 /**
- * Gets the current time in seconds.
- * @return The absolute time in seconds.
- * @note Latency is probably around 250NS.
+ * Gets the time from the operating system.
+ * @return CLOCK_MONOTONIC in seconds.
  */
-static STUPID_UNUSED STUPID_NOINLINE f64 stGetTime(void)
+static STUPID_INLINE f64 stGetSystemTime(void)
 {
         struct timespec now = {0};
-        clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+        clock_gettime(CLOCK_MONOTONIC, &now);
         return (f64)now.tv_sec + STUPID_NS_TO_SEC((f64)now.tv_nsec);
 }
 
+/**
+ * Reads the TSC.
+ * @return Number of ticks since the cpu was reset.
+ * @note Convert differences to seconds with stTicksToSeconds().
+ */
+static STUPID_INLINE u64 stGetTicks(void)
+{
+        return __rdtsc();
+}
+
+/**
+ * Converts a number of TSC ticks to seconds.
+ * @param ticks Number of ticks.
+ * @return ticks in seconds (0 if the TSC isnt usable).
+ */
+static STUPID_INLINE f64 stTicksToSeconds(const u64 ticks)
+{
+        return (f64)ticks * st_tsc.seconds_per_tick;
+}
+
+/**
+ * Gets the current time in seconds.
+ * @return The absolute time in seconds.
+ * @note Reads the TSC (around 10NS) once stClockCalibrate() has been called on a cpu with an invariant TSC,
+ * otherwise uses clock_gettime().
+ */
+static STUPID_INLINE f64 stGetTime(void)
+{
+        if (STUPID_LIKELY(st_tsc.usable))
+                return st_tsc.base_time + (f64)(i64)(__rdtsc() - st_tsc.base_ticks) * st_tsc.seconds_per_tick;
+        return stGetSystemTime();
+}
+
+/**
+ * Calibrates the TSC against CLOCK_MONOTONIC so stGetTime() can use it.
+ * @return True if the TSC is usable.
+ * @note Blocks for ST_TSC_CALIBRATION_TIME milliseconds.
+ * @note Does nothing if the cpu doesnt have an invariant TSC (stGetTime() keeps using clock_gettime()).
+ */
+bool stClockCalibrate(void);
+
 /**
  * Gets the resolution of the system clock.
  * @return The resolution of the system clock.
@@ -53,8 +119,10 @@ static STUPID_UNUSED STUPID_NOINLINE f64 stGetTime(void)
  */
 static STUPID_INLINE u64 stGetClockResolution(void)
 {
+        if (st_tsc.usable) return STUPID_MAX((u64)STUPID_SEC_TO_NS(st_tsc.seconds_per_tick), 1);
+
         struct timespec resolution = {0};
-        if (clock_getres(CLOCK_MONOTONIC_RAW, &resolution) != 0) return STUPID_US_TO_SEC(1);
+        if (clock_getres(CLOCK_MONOTONIC, &resolution) != 0) return STUPID_US_TO_SEC(1);
         return resolution.tv_nsec + STUPID_SEC_TO_NS(resolution.tv_sec);
 }
 
@@ -72,7 +140,7 @@ static STUPID_UNUSED STUPID_NOINLINE void stSleep(const u64 ms)
         static struct timespec ts = {0};
 
 	ts.tv_sec = ms / 1000;
-	ts.tv_nsec = (ms % 1000) * 1000;
+	ts.tv_nsec = (ms % 1000) * 1000 * 1000;
 
         nanosleep(&ts, NULL);
 }
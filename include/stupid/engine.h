@@ -8,9 +8,30 @@
 #include "stupid/clock.h"
 #include "stupid/window.h"
 #include "stupid/thread.h"
+#include "stupid/replay.h"
+#include "stupid/pacer.h"
+#include "stupid/framestats.h"
+#include "stupid/pipeline.h"
 
 #include "stupid/render/render_types.h"
 
+/// @brief Most ticks stEngineNextTick() runs per frame.
+/// If the simulation is further behind than this, the rest of the ticks are dropped instead of caught up on.
+#define STUPID_ENGINE_MAX_TICKS_PER_FRAME 5
+
+/// Frames rendered while headless if StEngineConfig.headless_frames is 0.
+#define STUPID_ENGINE_HEADLESS_FRAMES 1000
+
+/// @brief Frames rendered while headless before the frame stats are reset.
+/// The first few frames include things like shader compilation that would skew the report.
+#define STUPID_ENGINE_HEADLESS_WARMUP_FRAMES 16
+
+/// Distance from the origin of the default headless camera path.
+#define STUPID_ENGINE_HEADLESS_ORBIT_RADIUS 8.0
+
+/// Longest time the main loop blocks for while suspended (so events posted by other threads arent held up forever).
+#define STUPID_ENGINE_IDLE_TIMEOUT 0.1
+
 /// Enables vsync when used with engineSetFramerate().
 #define STUPID_ENGINE_FRAMERATE_VSYNC ((f64)0.0)
 
@@ -81,6 +102,16 @@ typedef enum st_engine_state {
 	STUPID_ENGINE_STATE_STARTED
 } st_engine_state;
 
+/// Point on the camera path followed while headless.
+/// @see StEngineConfig
+typedef struct StCameraKeyframe {
+	/// Camera position.
+	StVec3 pos;
+
+	/// Point the camera is looking at.
+	StVec3 target;
+} StCameraKeyframe;
+
 /// Engine configuration.
 /// @see StEngine
 typedef struct StEngineConfig {
@@ -98,6 +129,39 @@ typedef struct StEngineConfig {
 
 	/// Framerate limit.
 	i16 max_fps;
+
+	/// Write logs from a background thread (see stLogAsyncStart()).
+	bool async_logging;
+
+	/// Path to write binary logs to (see stBinLogOpen()), or NULL to print logs normally.
+	char *binary_log;
+
+	/// Path to periodically dump frame stats to (JSON if it ends in .json, otherwise CSV), or NULL to not dump them.
+	char *frame_stats;
+
+	/// Time between frame stats dumps (ST_FRAME_STATS_DUMP_INTERVAL if 0).
+	f64 frame_stats_interval;
+
+	/// @brief Render on a separate thread while the next tick is simulated (see stEngineSubmitFrame()).
+	/// The frame callbacks run on the render thread, and the renderer shouldnt be used anywhere else
+	/// without calling stFramePipelineFlush() first (stRendererSetVsync() and window resizes are safe,
+	/// theyre applied by the render thread at the start of the next frame).
+	bool pipelined;
+
+	/// @brief Render to offscreen images (window.width by window.height) instead of a window, for benchmarks.
+	/// No window or swapchain is created, so this works without a display or gpu (like on lavapipe in a CI container).
+	/// stEngineStart() renders headless_frames frames along the camera path with one tick per frame,
+	/// and prints a timing report to stdout.
+	bool headless;
+
+	/// Frames to render while headless (STUPID_ENGINE_HEADLESS_FRAMES if 0).
+	u32 headless_frames;
+
+	/// Camera path to follow while headless (spaced evenly over the run), or NULL to orbit the origin.
+	const StCameraKeyframe *pCameraPath;
+
+	/// Number of keyframes in pCameraPath.
+	u32 camera_path_length;
 } StEngineConfig;
 
 typedef struct StEngine StEngine;
@@ -155,6 +219,15 @@ typedef bool (*StPFN_frame_start)(StEngine *pEngine, f32 delta_time);
  */
 typedef bool (*StPFN_frame_end)(StEngine *pEngine, f32 delta_time);
 
+/**
+ * Function called by stEngineStart() once per frame to fill the frame snapshot.
+ * @param pEngine Pointer to a game instance.
+ * @param pSnapshot The snapshot to fill (see stFrameSnapshotDraw() and stFrameSnapshotSetTranslation()).
+ * @param alpha How far the engine is between ticks (see stEngineGetTickAlpha()).
+ * @return True if successful.
+ */
+typedef bool (*StPFN_frame_snapshot)(StEngine *pEngine, StFrameSnapshot *pSnapshot, f64 alpha);
+
 /**
  * Function called on window resize.
  * @param pEngineState Pointer to an engine instance.
@@ -187,7 +260,12 @@ typedef void (*StPFN_mouse_move)(StEngine *pEngine, const i32 x, const i32 y);
  */
 typedef void (*StPFN_mouse_button)(StEngine *pEngine, const st_mouse_button_id button, const bool state);
 
-/// Instance of the entire engine.
+/// @brief Instance of the entire engine.
+/// callbackInit, callbackShutdown, callbackUpdate, callbackSnapshot, and the input and resize callbacks always run
+/// on the thread that called stEngineStart() (the simulation thread), since window events are polled there.
+/// callbackFramePrepare, callbackFrameStart, and callbackFrameEnd run wherever the frame is rendered,
+/// which is the render thread when config.pipelined is set (so they must not use the event system other than stEventPost()).
+/// Other listeners of the frame events always run on the simulation thread, since the events are posted while pipelined.
 /// @see StEngineState
 typedef struct StEngine {
 	/// StEngine init function.
@@ -199,25 +277,28 @@ typedef struct StEngine {
 	/// StEngine update function.
 	StPFN_update callbackUpdate;
 
-	/// StEngine frame prepare function.
+	/// StEngine frame prepare function (render thread).
 	StPFN_frame_prepare callbackFramePrepare;
 
-	/// StEngine frame start function.
+	/// StEngine frame start function (render thread).
 	StPFN_frame_start callbackFrameStart;
 
-	/// StEngine frame end function.
+	/// StEngine frame end function (render thread).
 	StPFN_frame_end callbackFrameEnd;
 
-	/// StEngine window resize function.
+	/// StEngine frame snapshot function (only used by stEngineStart(), simulation thread).
+	StPFN_frame_snapshot callbackSnapshot;
+
+	/// StEngine window resize function (simulation thread, the renderer is resized later on the render thread).
 	StPFN_resize callbackResize;
 
-	/// StEngine key press/release function.
+	/// StEngine key press/release function (simulation thread).
 	StPFN_key callbackKey;
 
-	/// StEngine mouse move function.
+	/// StEngine mouse move function (simulation thread).
 	StPFN_mouse_move callbackMouseMove;
 
-	/// StEngine mouse button press/release function.
+	/// StEngine mouse button press/release function (simulation thread).
 	StPFN_mouse_button callbackMouseButton;
 
 	/// Internal engine state.
@@ -245,20 +326,33 @@ typedef struct StEngineState {
 	/// 1 / target framerate.
 	f64 target_fps_reciprocal;
 
-	/// Average framerate over the last 3 seconds.
-	f64 average_fps;
+	/// Frame time percentiles for every phase of the main loop.
+	StFrameStats *pFrameStats;
+
+	/// @brief Frame time percentiles for the simulation thread while pipelined (NULL otherwise).
+	/// pFrameStats only has the render thread phases then.
+	StFrameStats *pSimStats;
 
-	/// Used to keep track of the average framerate.
-	StClock average_fps_timer;
+	/// Hands frame snapshots from the simulation to the renderer.
+	StFramePipeline *pPipeline;
 
-	/// Used to keep track of how many frames have passed since updating the average framerate.
-	u32 average_fps_counter;
+	/// Paces frames while fps_locked is set.
+	StFramePacer pacer;
 
 	/// @brief Used to keep track of time between ticks, and how many ticks are queued.
 	/// For example, if the time between ticks is 0.1, and tick_time is 0.2,
-	/// one tick will happen, and the timer will be reduced to 0.1.
+	/// two ticks will happen, and the timer will be reduced to 0.0.
 	f64 tick_time;
 
+	/// Number of ticks run since the last stEnginePoll().
+	u32 frame_ticks;
+
+	/// Total ticks dropped because the simulation fell too far behind.
+	u64 dropped_ticks;
+
+	/// If the update callback returned false (stops the engine).
+	bool update_failed;
+
 	/// Used to figure out how long its been between ticks.
 	StClock tick_timer;
 
@@ -269,7 +363,13 @@ typedef struct StEngineState {
 	/// @note This does not increment while the engine is suspended.
 	u64 total_frames;
 
-	/// Main window.
+	/// Total ticks run by stEngineNextTick().
+	u64 total_ticks;
+
+	/// Input recorder/player (NULL unless stEngineRecordInput() or stEngineReplayInput() was called).
+	StReplay *pReplay;
+
+	/// Main window (NULL while headless).
 	StWindow *pWindow;
 
 	/// Renderer backend instance.
@@ -284,7 +384,7 @@ typedef struct StEngineState {
 	/// If the main loop is currently running.
 	STUPID_ATOMIC bool main_loop_is_running;
 
-	/// If the engine is suspended then the main loop will be paused.
+	/// If the engine is suspended then the main loop will be paused (no ticks, and nothing is rendered).
 	STUPID_ATOMIC bool is_suspended;
 
 	/// Pretty self explanatory.
@@ -312,9 +412,15 @@ typedef struct StEngineState {
 st_engine_init_return_code stEngineInit(StEngine *pEngine);
 
 /**
- * Starts an existing engine instance.
+ * @brief Runs the main loop until the engine stops running.
+ * Every frame the window is polled, ticks are run (see stEngineNextTick()), the snapshot callback fills the frame
+ * snapshot, and it's submitted (see stEngineSubmitFrame()). Every stage is timed in the frame stats.
+ * While the window is minimized nothing is rendered, and the loop blocks on the window until the next tick (or input).
+ * While suspended ticks stop as well, and the loop blocks until theres input.
+ * While headless, this stops after StEngineConfig.headless_frames frames and prints a timing report.
  * @param pEngine Pointer to an engine instance state.
  * @return An engine start return code.
+ * @note The last frame has finished rendering when this returns, so the renderer can be used again.
  * @see stEngineStop, stEngineInit, st_engine_start_return_code
  */
 st_engine_start_return_code stEngineStart(StEngine *pEngine);
@@ -330,6 +436,56 @@ st_engine_shutdown_return_code stEngineShutdown(StEngine *pState);
 bool stEngineBeginFrame(StEngine *pEngine);
 bool stEngineEndFrame(StEngine *pEngine);
 
+/**
+ * Gets the frame snapshot to fill with the camera, transform changes, and objects to draw.
+ * @param pEngine Pointer to an engine instance.
+ * @return Pointer to the snapshot (valid until the next stEngineSubmitFrame()).
+ */
+static STUPID_INLINE StFrameSnapshot *stEngineGetSnapshot(StEngine *pEngine)
+{
+	STUPID_NC(pEngine);
+	STUPID_NC(pEngine->pState);
+	return stFramePipelineGetSnapshot(pEngine->pState->pPipeline);
+}
+
+/**
+ * @brief Renders the current frame snapshot.
+ * If the engine is pipelined, this only waits for the previous frame to finish, and hands the snapshot to the
+ * render thread, so the next tick can be simulated while this frame is rendered.
+ * Otherwise the frame is rendered right away (stEngineBeginFrame(), the draws, and stEngineEndFrame()).
+ * @param pEngine Pointer to an engine instance.
+ * @return False if rendering failed.
+ * @see stEngineGetSnapshot
+ */
+bool stEngineSubmitFrame(StEngine *pEngine);
+
+/**
+ * @brief Polls the main window for events.
+ * While replaying input, the recorded events for the current tick are fired instead.
+ * @param pEngine Pointer to an engine instance.
+ * @return False if the window was closed, or the replay finished.
+ */
+bool stEnginePoll(StEngine *pEngine);
+
+/**
+ * Records all input events from the main window to a file, until the engine shuts down.
+ * @param pEngine Pointer to an engine instance.
+ * @param path Path of the file to record to.
+ * @return True if successful.
+ * @see stEngineReplayInput
+ */
+bool stEngineRecordInput(StEngine *pEngine, const char *path);
+
+/**
+ * @brief Plays back input recorded with stEngineRecordInput().
+ * Live input is ignored, and ticks use a fixed timestep (one tick per frame) so the replay is deterministic.
+ * @param pEngine Pointer to an engine instance.
+ * @param path Path of the recorded file.
+ * @return True if successful.
+ * @see stEngineRecordInput
+ */
+bool stEngineReplayInput(StEngine *pEngine, const char *path);
+
 /**
  * Checks if an engine instance is currently running.
  * @param pEngine Pointer to an engine instance.
@@ -359,25 +515,29 @@ static STUPID_INLINE bool stEngineNextFrame(const StEngine *pEngine)
 }
 
 /**
- * Checks if the next tick should happen now.
+ * @brief Runs the next tick if its time to.
+ * Real time is added to an accumulator, and a tick is run for every tickrate in it,
+ * so call this in a loop until it returns false once per frame.
+ * While replaying input or headless, exactly one tick is run per frame instead.
  * @param pEngine Pointer to an engine instance.
- * @return True if its been at least pEngine->pState->tick_time since the last tick.
+ * @return True if a tick was run.
+ * @note At most STUPID_ENGINE_MAX_TICKS_PER_FRAME ticks are run per frame, after that the rest are dropped
+ * so a slow frame cant cause even slower frames.
+ * @see stEngineGetTickAlpha
  */
-static STUPID_INLINE bool stEngineNextTick(StEngine *pEngine)
+bool stEngineNextTick(StEngine *pEngine);
+
+/**
+ * Gets how far the engine is between the last tick and the next one.
+ * @param pEngine Pointer to an engine instance.
+ * @return 0.0 right after a tick, approaching 1.0 right before the next one.
+ * @note Use this to interpolate between the last two ticks when rendering so motion is smooth at any framerate.
+ */
+static STUPID_INLINE f64 stEngineGetTickAlpha(const StEngine *pEngine)
 {
 	STUPID_NC(pEngine);
 	STUPID_NC(pEngine->pState);
-
-	pEngine->pState->tick_time += stGetClockElapsed(&pEngine->pState->tick_timer);
-	stClockUpdate(&pEngine->pState->tick_timer);
-
-	if (pEngine->pState->tick_time >= pEngine->pState->tickrate) {
-		pEngine->pState->tick_time -= pEngine->pState->tickrate;
-		pEngine->callbackUpdate(pEngine, pEngine->pState->tick_time);
-		return true;
-	}
-	else
-		return false;
+	return STUPID_CLAMP(pEngine->pState->tick_time / pEngine->pState->tickrate, 0.0, 1.0);
 }
 
 /**
@@ -411,7 +571,7 @@ static STUPID_INLINE void stEngineSetFramerate(StEngine *pEngine, const f64 fps)
 	STUPID_NC(pEngine);
 	STUPID_NC(pEngine->pState);
 	stMutexLock(&pEngine->pState->lock);
-	if (fps == STUPID_ENGINE_FRAMERATE_VSYNC) pEngine->pState->target_fps_reciprocal = 1.0 / STUPID_MAX(stWindowGetRefreshRate(pEngine->pState->pWindow), 60.0);
+	if (fps == STUPID_ENGINE_FRAMERATE_VSYNC && pEngine->pState->pWindow) pEngine->pState->target_fps_reciprocal = 1.0 / STUPID_MAX(stWindowGetRefreshRate(pEngine->pState->pWindow), 60.0);
 	else pEngine->pState->target_fps_reciprocal = 1.0 / STUPID_MAX(fps, 60.0);
 	stMutexUnlock(&pEngine->pState->lock);
 }
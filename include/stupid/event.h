@@ -9,6 +9,14 @@
 /// Somewhat arbitrary event cap.
 #define ST_MAX_EVENTS_PER_CODE 1024
 
+/// Number of callbacks space is allocated for the first time an event code is registered.
+/// @note Doubles every time it fills up.
+#define ST_EVENT_INITIAL_CAPACITY 4
+
+/// Number of events that can be posted with stEventPost() before they have to be dispatched.
+/// @note Must be a power of 2.
+#define ST_MAX_POSTED_EVENTS 1024
+
 /// Data passed to an event callback.
 /// @see stEventFire
 typedef union StEventData {
@@ -81,7 +89,7 @@ typedef union StEventData {
 /// Pre decided event IDs.
 /// @see stEventRegister stEventUnregister stEventFire
 typedef enum st_event_code {
-	/// Tells the engine to close on the next frame.
+	/// Tells the engine to close on the next frame (data.array.i32[0] is the signal if one caused it, otherwise 0).
 	STUPID_EVENT_CODE_EXIT = 0x00,
 
 	/// Used when a key is pressed.
@@ -137,42 +145,94 @@ typedef enum st_event_code {
  */
 typedef bool (*StPFN_event)(const st_event_code code, void *sender, void *listener, const StEventData data);
 
+/// @brief Handle to a callback registered with stEventRegister().
+/// The lower 32 bits are an index into the registration table and the upper 32 bits are a generation
+/// counter, so a handle that has already been unregistered is detected instead of removing the wrong callback.
+/// @see stEventRegister, stEventUnregisterHandle
+typedef u64 StEventHandle;
+
+/// Never returned by stEventRegister().
+#define STUPID_EVENT_HANDLE_INVALID ((StEventHandle)0)
+
+/// Sender used to subscribe to an event no matter who fires it.
+/// @see stEventSubscribe
+#define STUPID_EVENT_SENDER_ANY NULL
+
 /**
- * Registers a function to be called with listener passed as an argument, every time the specified event code is fired.
+ * Registers a function to be called with listener passed as an argument, every time the specified sender fires the specified event code.
+ * @param code Event code.
+ * @param sender Only events fired by this sender call pfn (STUPID_EVENT_SENDER_ANY for all senders).
+ * @param listener Pointer passed to pfn each call.
+ * @param pfn Function called every time the specified event code is fired.
+ * @return A handle that can be passed to stEventUnregisterHandle().
+ * @see st_event_code, stEventRegister, StPFN_event
+ * @see stEventUnregisterHandle
+ */
+StEventHandle (stEventSubscribe)(const st_event_code code, const void *sender, const void *listener, const StPFN_event pfn STUPID_DBG_PROTO_PARAMS);
+
+/**
+ * Registers a function to be called with listener passed as an argument, every time the specified sender fires the specified event code.
  * @param code Event code.
+ * @param sender Only events fired by this sender call pfn (STUPID_EVENT_SENDER_ANY for all senders).
  * @param listener Pointer passed to pfn each call.
  * @param pfn Function called every time the specified event code is fired.
- * @see st_event_code, stEventUnregister, StPFN_event
- * @see stEventUnregister
+ * @return A handle that can be passed to stEventUnregisterHandle().
+ * @see st_event_code, stEventRegister, StPFN_event
+ * @see stEventUnregisterHandle
  */
-void (stEventRegister)(const st_event_code code, const void *listener, const StPFN_event pfn STUPID_DBG_PROTO_PARAMS);
+#define stEventSubscribe(code, sender, listener, pfn) (stEventSubscribe)(code, sender, listener, pfn STUPID_DBG_PARAMS)
+
+/**
+ * Registers a function to be called with listener passed as an argument, every time the specified sender fires the specified event code.
+ * @param code Event code.
+ * @param sender Only events fired by this sender call pfn (STUPID_EVENT_SENDER_ANY for all senders).
+ * @param listener Pointer passed to pfn each call.
+ * @param pfn Function called every time the specified event code is fired.
+ * @return A handle that can be passed to stEventUnregisterHandle().
+ * @see st_event_code, stEventRegister, StPFN_event
+ * @see stEventUnregisterHandle
+ * @note Does not print logs.
+ */
+#define stEventSubscribeNL(code, sender, listener, pfn) (stEventSubscribe)(code, sender, listener, pfn STUPID_DBG_PARAMS_NL)
 
 /**
  * Registers a function to be called with listener passed as an argument, every time the specified event code is fired.
  * @param code Event code.
  * @param listener Pointer passed to pfn each call.
  * @param pfn Function called every time the specified event code is fired.
- * @see st_event_code, stEventUnregister, StPFN_event
- * @see stEventUnregister
+ * @return A handle that can be passed to stEventUnregisterHandle().
+ * @see st_event_code, stEventSubscribe, StPFN_event
+ * @see stEventUnregisterHandle
  */
-#define stEventRegister(code, listener, pfn) (stEventRegister)(code, listener, pfn STUPID_DBG_PARAMS)
+#define stEventRegister(code, listener, pfn) (stEventSubscribe)(code, STUPID_EVENT_SENDER_ANY, listener, pfn STUPID_DBG_PARAMS)
 
 /**
  * Registers a function to be called with listener passed as an argument, every time the specified event code is fired.
  * @param code Event code.
  * @param listener Pointer passed to pfn each call.
  * @param pfn Function called every time the specified event code is fired.
- * @see st_event_code, stEventUnregister, StPFN_event
- * @see stEventUnregister
+ * @return A handle that can be passed to stEventUnregisterHandle().
+ * @see st_event_code, stEventSubscribe, StPFN_event
+ * @see stEventUnregisterHandle
  * @note Does not print logs.
  */
-#define stEventRegisterNL(code, listener, pfn) (stEventRegister)(code, listener, pfn STUPID_DBG_PARAMS_NL)
+#define stEventRegisterNL(code, listener, pfn) (stEventSubscribe)(code, STUPID_EVENT_SENDER_ANY, listener, pfn STUPID_DBG_PARAMS_NL)
+
+/**
+ * @brief Unregisters a callback using the handle returned by stEventRegister().
+ * @param handle Handle returned by stEventRegister().
+ * @return False if the handle was already unregistered.
+ * @note O(1), the last callback registered with the same code takes the place of the removed one.
+ * @see stEventRegister
+ */
+bool stEventUnregisterHandle(const StEventHandle handle);
 
 /**
  * @brief Unregisters a callback registered by stEventRegister that has the same code, listener, and pfn.
  * @param code Event code.
  * @param listener Pointer passed to pfn each call.
  * @param pfn Function called every time the specified event code is fired.
+ * @note This has to search for the callback, so prefer stEventUnregisterHandle().
  * @see stEventRegister
  */
 void stEventUnregister(const st_event_code code, const void *listener, const StPFN_event pfn);
@@ -185,7 +245,8 @@ void stEventUnregister(const st_event_code code, const void *listener, const StP
 void stEventUnregisterCode(const st_event_code code);
 
 /**
- * @brief Unregisters all callbacks registered by stEventRegister with the specified listener.
+ * @brief Unregisters all callbacks registered by stEventRegister with the specified code and listener.
+ * @param code Event code.
  * @param listener Specified listener.
  * @see stEventRegister
  */
@@ -194,10 +255,68 @@ void stEventUnregisterListener(const st_event_code code, const void *listener);
 /**
  * Calls all functions registered with the specified event code and passes data to each function.
  * @param code Event code.
+ * @param sender Pointer associated with the source of the event.
  * @param data Argument to pass to each function.
+ * @note Only functions subscribed to sender or STUPID_EVENT_SENDER_ANY are called.
+ * @note The event system isnt thread safe, so everything except stEventPost() has to be called from one thread
+ * (the simulation thread, other threads post their events instead).
  */
 void stEventFire(const st_event_code code, void *sender, const StEventData data);
 
+/**
+ * @brief Queues an event to be fired by the thread that calls stEventDispatchPosted().
+ * Unlike stEventFire() this never touches the registered callbacks, never allocates, and never locks,
+ * so it can be called from any thread, or from a signal handler.
+ * @param code Event code.
+ * @param sender Pointer associated with the source of the event.
+ * @param data Argument to pass to each function.
+ * @return False if the queue is full (the event is dropped).
+ * @see stEventDispatchPosted, ST_MAX_POSTED_EVENTS
+ */
+bool stEventPost(const st_event_code code, void *sender, const StEventData data);
+
+/**
+ * @brief Fires every event queued by stEventPost() in the order they were posted.
+ * @return Number of events dispatched.
+ * @note Only one thread (the main thread) should call this.
+ * @see stEventPost
+ */
+u32 stEventDispatchPosted(void);
+
+/// Statistics about events queued by stEventPost().
+/// @see stEventGetPostStats
+typedef struct StEventPostStats {
+	/// Events successfully queued.
+	u64 posted;
+
+	/// Events dropped because the queue was full.
+	u64 dropped;
+
+	/// Events fired by stEventDispatchPosted().
+	u64 dispatched;
+
+	/// Shortest time between an event being posted and dispatched in seconds.
+	f64 latency_min;
+
+	/// Longest time between an event being posted and dispatched in seconds.
+	f64 latency_max;
+
+	/// Sum of the time between each event being posted and dispatched in seconds.
+	/// @note Divide by dispatched to get the average.
+	f64 latency_total;
+} StEventPostStats;
+
+/**
+ * Gets statistics about events queued by stEventPost().
+ * @return Post/dispatch counters and post to dispatch latency.
+ */
+StEventPostStats stEventGetPostStats(void);
+
+/**
+ * Resets the statistics returned by stEventGetPostStats().
+ */
+void stEventResetPostStats(void);
+
 /**
  * Deallocates all registered events.
  */
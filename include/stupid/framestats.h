@@ -0,0 +1,257 @@
+/// @file framestats.h
+/// @brief Frame time statistics.
+/// Records how long every frame, and every phase of every frame took in log-linear (HDR) histograms,
+/// so percentiles show stutter that an average framerate hides.
+/// @author nonexistant
+
+#pragma once
+
+#include "stupid/common.h"
+#include "stupid/clock.h"
+
+#include <stdio.h>
+
+/// @brief Number of bits of precision each histogram bucket keeps.
+/// Durations are rounded to 1 / 2^ST_HISTOGRAM_SUB_BITS (about 1.5%).
+#define ST_HISTOGRAM_SUB_BITS 6
+
+/// Number of buckets for every power of 2.
+#define ST_HISTOGRAM_SUB_BUCKETS (1 << ST_HISTOGRAM_SUB_BITS)
+
+/// Durations longer than 2^ST_HISTOGRAM_MAX_BITS nanoseconds (about 68 seconds) are clamped.
+#define ST_HISTOGRAM_MAX_BITS 36
+
+/// Number of buckets in a histogram.
+#define ST_HISTOGRAM_BUCKETS ((ST_HISTOGRAM_MAX_BITS - ST_HISTOGRAM_SUB_BITS + 1) * ST_HISTOGRAM_SUB_BUCKETS)
+
+/// Default length of each frame stats interval in seconds.
+#define ST_FRAME_STATS_DUMP_INTERVAL 1.0
+
+/// Phases of a frame.
+typedef enum st_frame_phase {
+	/// Polling the window for events (stEnginePoll()).
+	ST_FRAME_PHASE_POLL,
+
+	/// The update callback (stEngineNextTick()).
+	ST_FRAME_PHASE_TICK,
+
+	/// Filling the frame snapshot (the snapshot callback in stEngineStart()).
+	ST_FRAME_PHASE_SNAPSHOT,
+
+	/// Preparing the frame (stRendererPrepareFrame() and the frame prepare callback).
+	ST_FRAME_PHASE_PREPARE,
+
+	/// Starting the frame (stRendererStartFrame() and the frame start callback).
+	ST_FRAME_PHASE_START,
+
+	/// Everything between stEngineBeginFrame() and stEngineEndFrame().
+	ST_FRAME_PHASE_DRAW,
+
+	/// Ending the frame and presenting it (stRendererEndFrame()).
+	ST_FRAME_PHASE_END,
+
+	/// Waiting for the frame pacer.
+	ST_FRAME_PHASE_WAIT,
+
+	/// The whole frame.
+	ST_FRAME_PHASE_FRAME,
+
+	ST_FRAME_PHASE_MAX
+} st_frame_phase;
+
+/// Formats frame stats can be dumped in.
+typedef enum st_frame_stats_format {
+	/// One row per phase per dump.
+	ST_FRAME_STATS_FORMAT_CSV,
+
+	/// One JSON object per line per dump.
+	ST_FRAME_STATS_FORMAT_JSON,
+} st_frame_stats_format;
+
+/// @brief Log-linear histogram of durations in nanoseconds.
+/// Durations under ST_HISTOGRAM_SUB_BUCKETS nanoseconds are exact,
+/// and every power of 2 after that is split into ST_HISTOGRAM_SUB_BUCKETS buckets.
+typedef struct StHistogram {
+	/// Number of durations recorded.
+	u64 count;
+
+	/// Sum of every duration recorded.
+	u64 total;
+
+	/// Shortest duration recorded.
+	u64 min;
+
+	/// Longest duration recorded (exact).
+	u64 max;
+
+	u32 buckets[ST_HISTOGRAM_BUCKETS];
+} StHistogram;
+
+/// Summary of a histogram in seconds.
+typedef struct StFrameStatsSummary {
+	u64 count;
+	f64 mean;
+	f64 p50;
+	f64 p95;
+	f64 p99;
+	f64 p999;
+	f64 max;
+} StFrameStatsSummary;
+
+/// Frame time statistics.
+/// @see stFrameStatsCreate
+typedef struct StFrameStats {
+	/// Every frame since the stats were created or reset.
+	StHistogram total[ST_FRAME_PHASE_MAX];
+
+	/// Every frame since the last interval ended.
+	StHistogram window[ST_FRAME_PHASE_MAX];
+
+	/// Time spent in each phase during the current frame.
+	f64 current[ST_FRAME_PHASE_MAX];
+
+	/// When each phase was started during the current frame.
+	f64 phase_start[ST_FRAME_PHASE_MAX];
+
+	/// Bitmask of the phases that ran during the current frame.
+	u32 ran;
+
+	/// When the current frame started.
+	f64 frame_start;
+
+	/// When the stats were created.
+	f64 start_time;
+
+	/// File the stats are periodically dumped to (NULL if they arent).
+	FILE *dump;
+
+	/// Format of the dump file.
+	st_frame_stats_format format;
+
+	/// Length of each interval (the stats are dumped at the end of each one).
+	f64 interval;
+
+	/// When the current interval started.
+	f64 interval_start;
+
+	/// Average framerate during the last interval.
+	f64 fps;
+} StFrameStats;
+
+/// Names of each phase (used in dumps).
+extern const char *st_frame_phase_names[ST_FRAME_PHASE_MAX];
+
+/**
+ * Records a duration in a histogram.
+ * @param pHistogram Pointer to a histogram.
+ * @param ns Duration in nanoseconds.
+ */
+void stHistogramRecord(StHistogram *pHistogram, const u64 ns);
+
+/**
+ * Gets a percentile from a histogram.
+ * @param pHistogram Pointer to a histogram.
+ * @param percentile Percentile to get (like 99.9).
+ * @return The duration in nanoseconds (0 if the histogram is empty).
+ * @note The result is the middle of the bucket the percentile falls in, so its within about 1.5% of the actual value.
+ */
+u64 stHistogramPercentile(const StHistogram *pHistogram, const f64 percentile);
+
+/**
+ * Clears a histogram.
+ * @param pHistogram Pointer to a histogram.
+ */
+void stHistogramReset(StHistogram *pHistogram);
+
+/**
+ * Creates frame stats.
+ * @return Pointer to the stats.
+ * @see stFrameStatsDestroy
+ */
+StFrameStats *stFrameStatsCreate(void);
+
+/**
+ * Destroys frame stats (and closes the dump file).
+ * @param pStats Pointer to the stats.
+ */
+void stFrameStatsDestroy(StFrameStats *pStats);
+
+/**
+ * Starts timing a phase of the current frame.
+ * @param pStats Pointer to the stats.
+ * @param phase The phase.
+ */
+static STUPID_INLINE void stFrameStatsBeginPhase(StFrameStats *pStats, const st_frame_phase phase)
+{
+	pStats->phase_start[phase] = stGetTime();
+}
+
+/**
+ * Stops timing a phase of the current frame.
+ * @param pStats Pointer to the stats.
+ * @param phase The phase.
+ * @note A phase can run more than once per frame, in which case the times are added together.
+ */
+static STUPID_INLINE void stFrameStatsEndPhase(StFrameStats *pStats, const st_frame_phase phase)
+{
+	pStats->current[phase] += stGetTime() - pStats->phase_start[phase];
+	pStats->ran |= 1 << phase;
+}
+
+/**
+ * Records the current frame, and dumps the stats if its time to.
+ * @param pStats Pointer to the stats.
+ */
+void stFrameStatsEndFrame(StFrameStats *pStats);
+
+/**
+ * Throws away the current frame (like when the engine is suspended).
+ * @param pStats Pointer to the stats.
+ */
+void stFrameStatsDiscardFrame(StFrameStats *pStats);
+
+/**
+ * Summarizes a phase.
+ * @param pStats Pointer to the stats.
+ * @param phase The phase.
+ * @return Summary of every frame since the stats were created or reset.
+ */
+StFrameStatsSummary stFrameStatsGetSummary(const StFrameStats *pStats, const st_frame_phase phase);
+
+/**
+ * Gets the average framerate.
+ * @param pStats Pointer to the stats.
+ * @return Average framerate during the last interval.
+ */
+f64 stFrameStatsGetFps(const StFrameStats *pStats);
+
+/**
+ * Clears every frame recorded so far.
+ * @param pStats Pointer to the stats.
+ */
+void stFrameStatsReset(StFrameStats *pStats);
+
+/**
+ * Starts dumping the stats to a file periodically.
+ * @param pStats Pointer to the stats.
+ * @param path Path to the file (overwritten).
+ * @param format Format to dump in.
+ * @param interval Time between dumps in seconds (each dump only covers the frames since the last one).
+ * @note The first line of a CSV dump is a header, and JSON dumps have one object per line.
+ * @return True if successful.
+ */
+bool stFrameStatsDumpTo(StFrameStats *pStats, const char *path, const st_frame_stats_format format, const f64 interval);
+
+/**
+ * Logs a summary of every phase.
+ * @param pStats Pointer to the stats.
+ */
+void stFrameStatsLog(const StFrameStats *pStats);
+
+/**
+ * Prints a table summarizing every phase (for reports that are read by people, or scripts, instead of logs).
+ * @param pStats Pointer to the stats.
+ * @param file File to print to (like stdout).
+ * @note Waits for queued logs first (stLogFlush()) so they dont end up in the middle of the table.
+ */
+void stFrameStatsPrint(const StFrameStats *pStats, FILE *file);
@@ -2,6 +2,8 @@
 
 #include "stupid/common.h"
 
+#include <stdatomic.h>
+
 // disable trace and debug logs if compiled in release mode (unless otherwise specified)
 #ifndef _DEBUG
 	#ifndef STUPID_LOG_DEBUG_ENABLED
@@ -141,6 +143,121 @@ typedef enum st_log_level {
 	ST_LOG_LEVEL_MAX
 } st_log_level;
 
+/// Subsystems that have their own runtime log level.
+typedef enum st_log_module {
+	/// Everything that isnt part of one of the other modules.
+	ST_LOG_MODULE_GENERAL,
+
+	/// Memory allocation.
+	ST_LOG_MODULE_MEMORY,
+
+	/// Threads and synchronization.
+	ST_LOG_MODULE_THREAD,
+
+	/// The renderer frontend.
+	ST_LOG_MODULE_RENDER,
+
+	/// The vulkan renderer backend.
+	ST_LOG_MODULE_VULKAN,
+
+	/// Windows and input.
+	ST_LOG_MODULE_WINDOW,
+
+	/// Events.
+	ST_LOG_MODULE_EVENT,
+
+	ST_LOG_MODULE_MAX
+} st_log_module;
+
+/// Environment variable read by stLogSetLevelsFromEnv().
+#define STUPID_LOG_ENV "STUPID_LOG"
+
+/// @brief Log level of each module + 1 (so 0 means the module doesnt log anything).
+/// Read by the log macros before any of their arguments are evaluated.
+/// @note Use stLogSetLevel() or stLogSetLevels() instead of writing to this directly.
+extern STUPID_ATOMIC u8 st_log_levels[ST_LOG_MODULE_MAX];
+
+// module used by the log macros in the current file
+// define this before including anything in a source file to use a different one
+#ifndef STUPID_LOG_MODULE
+	#define STUPID_LOG_MODULE ST_LOG_MODULE_GENERAL
+#endif
+
+/**
+ * Checks if logs with the specified level are enabled for the current module.
+ * @param level Log level.
+ * @note This is a single load and compare.
+ */
+#define STUPID_LOG_IS_ENABLED(level) ((u8)(level) < atomic_load_explicit(&st_log_levels[STUPID_LOG_MODULE], memory_order_relaxed))
+
+/// @brief Maximum length of a single formatted log (including the color codes).
+/// Longer messages are cut short and end with ST_LOG_TRUNCATED.
+#define ST_LOG_MAX_LENGTH 8192
+
+/// Written at the end of a message that was too long to fit in ST_LOG_MAX_LENGTH.
+#define ST_LOG_TRUNCATED "... (truncated)"
+
+/// @brief Maximum length of a log that can be put in the async log queue.
+/// Longer logs wait for the queue to be written and are then written directly, so the queue doesnt need 8KB per slot.
+#define ST_LOG_QUEUE_MAX_LENGTH 1024
+
+/// Number of logs the async log queue can hold.
+/// @note Must be a power of 2.
+#define ST_LOG_QUEUE_SIZE 256
+
+/// Maximum number of logs the writer thread writes with a single writev().
+#define ST_LOG_MAX_BATCH 64
+
+/// Seconds stLogFlush() waits for the writer thread before giving up.
+#define ST_LOG_FLUSH_TIMEOUT 0.5
+
+/// Seconds a log call site has to wait before it can print the same message again (when dedup is enabled).
+/// @see stLogSetDedup
+#define ST_LOG_REPEAT_INTERVAL 1.0
+
+/// @brief Rate limiting state for a single log call site.
+/// Every STUPID_LOG_* macro that can be rate limited has its own static one of these.
+/// @see stLogAt
+typedef struct StLogSite {
+	/// Hash of the last message printed from here (only kept when dedup is enabled).
+	STUPID_ATOMIC u64 hash;
+
+	/// When the last message from here was printed.
+	STUPID_ATOMIC f64 last;
+
+	/// Repeats of the last message that werent printed.
+	STUPID_ATOMIC u32 repeated;
+
+	/// Logs from here that the rate limit dropped.
+	STUPID_ATOMIC u32 dropped;
+} StLogSite;
+
+/// What to do with a log when the async log queue is full.
+typedef enum st_log_policy {
+	/// Throw the log away (the writer thread reports how many were dropped).
+	ST_LOG_POLICY_DROP,
+
+	/// Wait for the writer thread to make room.
+	ST_LOG_POLICY_BLOCK,
+
+	ST_LOG_POLICY_MAX
+} st_log_policy;
+
+/// Statistics for the async logger.
+typedef struct StLogAsyncStats {
+	/// Logs put in the queue.
+	u64 queued;
+
+	/// Logs thrown away because the queue was full.
+	u64 dropped;
+
+	/// Logs written by the writer thread.
+	u64 written;
+
+	/// Number of writev() batches the logs were written in.
+	u64 batches;
+} StLogAsyncStats;
+
 /**
  * Prints text with the specified properties.
  * @param message String to print.
@@ -159,6 +276,36 @@ int stLogCustom(const st_text_color color, const st_text_background_color backgr
  */
 void stLog(const st_log_level level, const char *message, ...) STUPID_ATTR_FORMAT(2, 3);
 
+/**
+ * Logs a message with the specified log level, unless its over the rate limit (or a repeat, if dedup is enabled).
+ * Each level has a token bucket limiting how many logs per second get printed, which is checked before the message is formatted.
+ * With dedup enabled for the level, repeats of the last message from the same call site within ST_LOG_REPEAT_INTERVAL seconds
+ * are counted instead of printed (this needs the formatted message, so its done before taking a token).
+ * The number of logs that were suppressed is printed along with the next log from the call site that gets through.
+ * @param pSite Rate limiting state for the call site.
+ * @param level The log severity.
+ * @param message String to print.
+ * @param ... printf format arguments.
+ * @note Critical and fatal logs are never limited.
+ * @see stLogSetRateLimit, stLogSetDedup
+ */
+void stLogAt(StLogSite *pSite, const st_log_level level, const char *message, ...) STUPID_ATTR_FORMAT(3, 4);
+
+/**
+ * Sets the rate limit for a log level.
+ * @param level Log level.
+ * @param rate Logs per second (0 for no limit).
+ * @param burst Logs that can be printed at once before the limit kicks in.
+ */
+void stLogSetRateLimit(const st_log_level level, const f64 rate, const f64 burst);
+
+/**
+ * Sets if repeats of the same message from a call site are counted instead of printed for a log level.
+ * @param level Log level.
+ * @param dedup If repeats should be counted (off by default).
+ */
+void stLogSetDedup(const st_log_level level, const bool dedup);
+
 /**
  * @brief Prints a trace log.
  * Prints the name of the function this was called from, the filename, the line, and the message.
@@ -170,15 +317,82 @@ void stLog(const st_log_level level, const char *message, ...) STUPID_ATTR_FORMA
  */
 void stLogTrace(const char* fn, const char *file, const int line, const char *message, ...) STUPID_ATTR_FORMAT(4, 5);
 
+/**
+ * Sets the log level of a module.
+ * @param module The module.
+ * @param level Least severe level that gets logged.
+ */
+void stLogSetLevel(const st_log_module module, const st_log_level level);
+
+/**
+ * Gets the log level of a module.
+ * @param module The module.
+ * @return Least severe level that gets logged, or ST_LOG_LEVEL_MAX if the module doesnt log anything.
+ */
+st_log_level stLogGetLevel(const st_log_module module);
+
+/**
+ * Sets the log level of modules from a string.
+ * The string is a comma separated list of either "module=level" or just "level" (which sets every module),
+ * applied in order. Levels can be names (crit, fatal, error, warn, system, info, debug, spam, trace, off) or numbers.
+ * @param levels The string (for example "warn,memory=trace,vulkan=off").
+ * @return False if any part of the string is invalid (the valid parts are still applied).
+ */
+bool stLogSetLevels(const char *levels);
+
+/**
+ * Sets the log level of modules from the STUPID_LOG_ENV environment variable.
+ * @return False if the environment variable is invalid.
+ * @see stLogSetLevels
+ */
+bool stLogSetLevelsFromEnv(void);
+
+/**
+ * Starts the async logger.
+ * Logs are formatted by the thread that logs them and put in a lock free queue,
+ * then a background thread writes them in batches so logging never waits on the terminal.
+ * @param policy What to do with logs when the queue is full.
+ * @return True if successful.
+ * @note Critical and fatal logs are flushed immediately.
+ * @see stLogAsyncStop, stLogFlush
+ */
+bool stLogAsyncStart(const st_log_policy policy);
+
+/**
+ * Writes every queued log and stops the async logger.
+ * @note Logs are written immediately again afterwards.
+ */
+void stLogAsyncStop(void);
+
+/**
+ * Waits for every log queued so far to be written.
+ * @note Gives up after ST_LOG_FLUSH_TIMEOUT seconds so a stuck writer thread cant hang the caller.
+ */
+void stLogFlush(void);
+
+/**
+ * Gets statistics for the async logger.
+ * @return The statistics.
+ */
+StLogAsyncStats stLogGetAsyncStats(void);
+
 /// This just gets rid of unused variable errors for variable arguments.
 static STUPID_INLINE void _stLoggerStopUnusedArgumentWarning(const char *message, ...) { return; }
 
+/// Logs with stLogAt() using a call site unique to wherever this is used.
+#define _STUPID_LOG_AT(level, message, ...) do {\
+	if (STUPID_LOG_IS_ENABLED(level)) {\
+		static StLogSite _st_log_site = {0};\
+		stLogAt(&_st_log_site, level, "%s(): " message, __FUNCTION__, ##__VA_ARGS__);\
+	}\
+} while (0)
+
 #ifndef STUPID_LOG_CRITICAL_DISABLED
 /**
  * print a critical error log
  * @param message printf format string
  */
-#define STUPID_LOG_CRITICAL(message, ...) stLog(ST_LOG_LEVEL_CRITICAL, "%s(): " message, __FUNCTION__, ##__VA_ARGS__)
+#define STUPID_LOG_CRITICAL(message, ...) do { if (STUPID_LOG_IS_ENABLED(ST_LOG_LEVEL_CRITICAL)) stLog(ST_LOG_LEVEL_CRITICAL, "%s(): " message, __FUNCTION__, ##__VA_ARGS__); } while (0)
 #else
 #define STUPID_LOG_CRITICAL(message, ...) _stLoggerStopUnusedArgumentWarning(message, ##__VA_ARGS__)
 #endif // STUPID_LOG_SPAM_ENABLED
@@ -188,7 +402,7 @@ static STUPID_INLINE void _stLoggerStopUnusedArgumentWarning(const char *message
  * print a fatal error log
  * @param message printf format string
  */
-#define STUPID_LOG_FATAL(message, ...) stLog(ST_LOG_LEVEL_FATAL, "%s(): " message, __FUNCTION__, ##__VA_ARGS__)
+#define STUPID_LOG_FATAL(message, ...) do { if (STUPID_LOG_IS_ENABLED(ST_LOG_LEVEL_FATAL)) stLog(ST_LOG_LEVEL_FATAL, "%s(): " message, __FUNCTION__, ##__VA_ARGS__); } while (0)
 #else
 #define STUPID_LOG_FATAL(message, ...) _stLoggerStopUnusedArgumentWarning(message, ##__VA_ARGS__)
 #endif // STUPID_LOG_FATAL_ENABLED
@@ -198,7 +412,7 @@ static STUPID_INLINE void _stLoggerStopUnusedArgumentWarning(const char *message
  * prints an error log
  * @param message printf format string
  */
-#define STUPID_LOG_ERROR(message, ...) stLog(ST_LOG_LEVEL_ERROR, "%s(): " message, __FUNCTION__, ##__VA_ARGS__)
+#define STUPID_LOG_ERROR(message, ...) _STUPID_LOG_AT(ST_LOG_LEVEL_ERROR, message, ##__VA_ARGS__)
 #else
 #define STUPID_LOG_ERROR(message, ...) _stLoggerStopUnusedArgumentWarning(message, ##__VA_ARGS__)
 #endif // STUPID_LOG_ERROR_ENABLED
@@ -208,7 +422,7 @@ static STUPID_INLINE void _stLoggerStopUnusedArgumentWarning(const char *message
  * prints a warning log
  * @param message printf format string
  */
-#define STUPID_LOG_WARN(message, ...) stLog(ST_LOG_LEVEL_WARNING, "%s(): " message, __FUNCTION__, ##__VA_ARGS__)
+#define STUPID_LOG_WARN(message, ...) _STUPID_LOG_AT(ST_LOG_LEVEL_WARNING, message, ##__VA_ARGS__)
 #else
 #define STUPID_LOG_WARN(message, ...) _stLoggerStopUnusedArgumentWarning(message, ##__VA_ARGS__)
 #endif // STUPID_LOG_WARN_ENABLED
@@ -218,7 +432,7 @@ static STUPID_INLINE void _stLoggerStopUnusedArgumentWarning(const char *message
  * prints an info log
  * @param message printf format string
  */
-#define STUPID_LOG_INFO(message, ...) stLog(ST_LOG_LEVEL_INFO, "%s(): " message, __FUNCTION__, ##__VA_ARGS__)
+#define STUPID_LOG_INFO(message, ...) _STUPID_LOG_AT(ST_LOG_LEVEL_INFO, message, ##__VA_ARGS__)
 #else
 #define STUPID_LOG_INFO(message, ...) _stLoggerStopUnusedArgumentWarning(message, ##__VA_ARGS__)
 #endif
@@ -228,7 +442,7 @@ static STUPID_INLINE void _stLoggerStopUnusedArgumentWarning(const char *message
  * prints a system log (usually for subsystem initialization)
  * @param message printf format string
  */
-#define STUPID_LOG_SYSTEM(message, ...) stLog(ST_LOG_LEVEL_SYSTEM, "%s(): " message, __FUNCTION__, ##__VA_ARGS__)
+#define STUPID_LOG_SYSTEM(message, ...) _STUPID_LOG_AT(ST_LOG_LEVEL_SYSTEM, message, ##__VA_ARGS__)
 #else
 #define STUPID_LOG_SYSTEM(message, ...) _stLoggerStopUnusedArgumentWarning(message, ##__VA_ARGS__)
 #endif
@@ -238,7 +452,7 @@ static STUPID_INLINE void _stLoggerStopUnusedArgumentWarning(const char *message
  * prints a spam log that gets overwritten by the next log
  * @param message printf format string
  */
-#define STUPID_LOG_SPAM(message, ...) stLog(ST_LOG_LEVEL_SPAM, "%s(): " message, __FUNCTION__, ##__VA_ARGS__)
+#define STUPID_LOG_SPAM(message, ...) do { if (STUPID_LOG_IS_ENABLED(ST_LOG_LEVEL_SPAM)) stLog(ST_LOG_LEVEL_SPAM, "%s(): " message, __FUNCTION__, ##__VA_ARGS__); } while (0)
 #else
 #define STUPID_LOG_SPAM(message, ...) _stLoggerStopUnusedArgumentWarning(message, ##__VA_ARGS__)
 #endif // STUPID_LOG_SPAM_ENABLED
@@ -248,7 +462,7 @@ static STUPID_INLINE void _stLoggerStopUnusedArgumentWarning(const char *message
  * prints a debug log
  * @param message printf format string
  */
-#define STUPID_LOG_DEBUG(message, ...) stLog(ST_LOG_LEVEL_DEBUG, "%s(): " message, __FUNCTION__, ##__VA_ARGS__)
+#define STUPID_LOG_DEBUG(message, ...) _STUPID_LOG_AT(ST_LOG_LEVEL_DEBUG, message, ##__VA_ARGS__)
 #else
 #define STUPID_LOG_DEBUG(message, ...) _stLoggerStopUnusedArgumentWarning(message, ##__VA_ARGS__)
 #endif // STUPID_LOG_DEBUG_ENABLED
@@ -258,8 +472,8 @@ static STUPID_INLINE void _stLoggerStopUnusedArgumentWarning(const char *message
  * prints a trace log (usually for things like memory allocation)
  * @param message printf format string
  */
-#define STUPID_LOG_TRACE(message, ...) STUPID_DBG(stLog(ST_LOG_LEVEL_TRACE, "%s(): " message, __FUNCTION__, ##__VA_ARGS__))
-#define STUPID_LOG_TRACEFN(message, ...) STUPID_DBG_SHOULD_LOG(stLogTrace(__FUNCTION__, STUPID_DBG_PARAM_FILE, STUPID_DBG_PARAM_LINE, message, ##__VA_ARGS__))
+#define STUPID_LOG_TRACE(message, ...) STUPID_DBG(do { if (STUPID_LOG_IS_ENABLED(ST_LOG_LEVEL_TRACE)) stLog(ST_LOG_LEVEL_TRACE, "%s(): " message, __FUNCTION__, ##__VA_ARGS__); } while (0))
+#define STUPID_LOG_TRACEFN(message, ...) STUPID_DBG_SHOULD_LOG(if (STUPID_LOG_IS_ENABLED(ST_LOG_LEVEL_TRACE)) stLogTrace(__FUNCTION__, STUPID_DBG_PARAM_FILE, STUPID_DBG_PARAM_LINE, message, ##__VA_ARGS__))
 #else
 #define STUPID_LOG_TRACE(message, ...) _stLoggerStopUnusedArgumentWarning(message, ##__VA_ARGS__)
 #define STUPID_LOG_TRACEFN(message, ...) _stLoggerStopUnusedArgumentWarning(message, ##__VA_ARGS__)
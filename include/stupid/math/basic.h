@@ -4,6 +4,9 @@
 #include "stupid/common.h"
 #include "stupid/math/constants.h"
 
+// intrinsics instead of asm for the same reason as in math/exp.h (so theyre VEX encoded with -mavx)
+#include <immintrin.h>
+
 /**
  * Checks if an f64 is signed.
  * @param x A number.
@@ -50,35 +53,23 @@ static STUPID_INLINE int stSignbitf(const f32 x)
 
 /**
  * @brief Makes a number positive.
- * Unfortunately, a simple bitwise & cant be done here because of those pesky xmm registers.
+ * Clears the sign bit with andnpd.
  * @param x A number.
  * @return |x|
- * @note From https://git.musl-libc.org/cgit/musl/tree/src/math/x86_64/fabs.c.
  */
 static STUPID_INLINE f64 stFabs(f64 x)
 {
-	f64 t;
-	__asm__ ("pcmpeqd %0, %0" : "=x"(t));          // t = ~0
-	__asm__ ("psrlq   $1, %0" : "+x"(t));          // t >>= 1
-	__asm__ ("andps   %1, %0" : "+x"(x) : "x"(t)); // x &= t
-	return x;
-
+	return _mm_cvtsd_f64(_mm_andnot_pd(_mm_set_sd(-0.0), _mm_set_sd(x)));
 }
 
 /**
- * f32 abs implementation stolen from musl libc.
- * Unfortunately, a simple bitwise & cant be done here because of those pesky xmm registers.
+ * f32 abs implementation (same as stFabs()).
  * @param x A number.
  * @return |x|
- * @note From https://git.musl-libc.org/cgit/musl/tree/src/math/x86_64/fabsf.c.
  */
 static STUPID_INLINE f32 stFabsf(f32 x)
 {
-	f32 t;
-	__asm__ ("pcmpeqd %0, %0" : "=x"(t));          // t = ~0
-	__asm__ ("psrld   $1, %0" : "+x"(t));          // t >>= 1
-	__asm__ ("andps   %1, %0" : "+x"(x) : "x"(t)); // x &= t
-	return x;
+	return _mm_cvtss_f32(_mm_andnot_ps(_mm_set_ss(-0.0f), _mm_set_ss(x)));
 }
 
 /**
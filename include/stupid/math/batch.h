@@ -0,0 +1,712 @@
+/// @file batch.h
+/// @brief Math over thousands of vectors or matrices at a time.
+/// Everything here works on streams (structures of arrays), so each AVX2 iteration handles 8 elements
+/// with plain loads instead of gathering them out of StVec3s.
+/// @author nonexistant
+
+#pragma once
+
+#include "stupid/common.h"
+#include "stupid/assert.h"
+#include "stupid/math/linear.h"
+#include "stupid/math/quat.h"
+#include "stupid/math/bounds.h"
+
+#include <immintrin.h>
+
+/// Number of elements handled per iteration.
+#define ST_BATCH_WIDTH 8
+
+/// Checks if a stream array can be used with the batch functions.
+#define ST_BATCH_IS_ALIGNED(p) ((((usize)(p)) & 31) == 0)
+
+/// @brief StVec3s stored as a structure of arrays.
+/// Each array has to be aligned to 32 bytes (stMemAlloc() always is).
+typedef struct StVec3Stream {
+	f32 *x;
+	f32 *y;
+	f32 *z;
+} StVec3Stream;
+
+/// @brief StMat4s stored as a structure of arrays.
+/// m[i][j] is element [i][j] of every matrix, and each array has to be aligned to 32 bytes.
+typedef struct StMat4Stream {
+	f32 *m[4][4];
+} StMat4Stream;
+
+/// @brief StQuats stored as a structure of arrays.
+/// Each array has to be aligned to 32 bytes.
+typedef struct StQuatStream {
+	f32 *w;
+	f32 *x;
+	f32 *y;
+	f32 *z;
+} StQuatStream;
+
+/// @brief StSpheres stored as a structure of arrays.
+/// Each array has to be aligned to 32 bytes.
+typedef struct StSphereStream {
+	f32 *x;
+	f32 *y;
+	f32 *z;
+	f32 *radius;
+} StSphereStream;
+
+/// @brief StAabbs stored as a structure of arrays.
+/// Each array has to be aligned to 32 bytes.
+typedef struct StAabbStream {
+	StVec3Stream min;
+	StVec3Stream max;
+} StAabbStream;
+
+/**
+ * Gets a vector from a stream.
+ * @param stream The stream.
+ * @param index Index of the vector.
+ * @return The vector.
+ */
+static STUPID_INLINE StVec3 stVec3StreamGet(const StVec3Stream stream, const usize index)
+{
+	return STVEC3(stream.x[index], stream.y[index], stream.z[index]);
+}
+
+/**
+ * Puts a vector in a stream.
+ * @param stream The stream.
+ * @param index Index of the vector.
+ * @param vec The vector.
+ */
+static STUPID_INLINE void stVec3StreamSet(const StVec3Stream stream, const usize index, const StVec3 vec)
+{
+	stream.x[index] = vec.x;
+	stream.y[index] = vec.y;
+	stream.z[index] = vec.z;
+}
+
+/**
+ * Gets a matrix from a stream.
+ * @param stream The stream.
+ * @param index Index of the matrix.
+ * @return The matrix.
+ */
+static STUPID_INLINE StMat4 stMat4StreamGet(const StMat4Stream stream, const usize index)
+{
+	StMat4 mat;
+	for (int i = 0; i < 4; i++)
+		for (int j = 0; j < 4; j++)
+			mat.m[i][j] = stream.m[i][j][index];
+	return mat;
+}
+
+/**
+ * Puts a matrix in a stream.
+ * @param stream The stream.
+ * @param index Index of the matrix.
+ * @param mat The matrix.
+ */
+static STUPID_INLINE void stMat4StreamSet(const StMat4Stream stream, const usize index, const StMat4 mat)
+{
+	for (int i = 0; i < 4; i++)
+		for (int j = 0; j < 4; j++)
+			stream.m[i][j][index] = mat.m[i][j];
+}
+
+/**
+ * Gets a quaternion from a stream.
+ * @param stream The stream.
+ * @param index Index of the quaternion.
+ * @return The quaternion.
+ */
+static STUPID_INLINE StQuat stQuatStreamGet(const StQuatStream stream, const usize index)
+{
+	return STQUAT(stream.w[index], stream.x[index], stream.y[index], stream.z[index]);
+}
+
+/**
+ * Puts a quaternion in a stream.
+ * @param stream The stream.
+ * @param index Index of the quaternion.
+ * @param quat The quaternion.
+ */
+static STUPID_INLINE void stQuatStreamSet(const StQuatStream stream, const usize index, const StQuat quat)
+{
+	stream.w[index] = quat.w;
+	stream.x[index] = quat.x;
+	stream.y[index] = quat.y;
+	stream.z[index] = quat.z;
+}
+
+/**
+ * Gets a mask for the lanes that are left at the end of a stream.
+ * @param remaining Number of elements left.
+ * @return Mask with the first min(remaining, 8) lanes set.
+ */
+static STUPID_INLINE __m256i stBatchMask(const usize remaining)
+{
+	return _mm256_cmpgt_epi32(_mm256_set1_epi32((i32)STUPID_MIN(remaining, ST_BATCH_WIDTH)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+/**
+ * Loads 8 elements from a stream array (or whatever is left at the end).
+ * @param p Pointer to the first element (aligned to 32 bytes).
+ * @param remaining Number of elements left in the array.
+ * @return The elements (lanes past the end are 0).
+ */
+static STUPID_INLINE __m256 stBatchLoad(const f32 *p, const usize remaining)
+{
+	if (remaining >= ST_BATCH_WIDTH) return _mm256_load_ps(p);
+	return _mm256_maskload_ps(p, stBatchMask(remaining));
+}
+
+/**
+ * Stores 8 elements in a stream array (or whatever is left at the end).
+ * @param p Pointer to the first element (aligned to 32 bytes).
+ * @param x The elements.
+ * @param remaining Number of elements left in the array.
+ * @note Nothing past the end of the array is written to.
+ */
+static STUPID_INLINE void stBatchStore(f32 *p, const __m256 x, const usize remaining)
+{
+	if (remaining >= ST_BATCH_WIDTH) _mm256_store_ps(p, x);
+	else _mm256_maskstore_ps(p, stBatchMask(remaining), x);
+}
+
+/**
+ * Transforms points by a matrix (like stVec4MulMat() with w = 1).
+ * @param mat The matrix.
+ * @param in Points to transform.
+ * @param out Where to put the transformed points (can be the same as in).
+ * @param count Number of points.
+ * @note Theres no perspective divide, so this is for model and view matrices.
+ */
+static STUPID_INLINE void stVec3BatchTransform(const StMat4 mat, const StVec3Stream in, const StVec3Stream out, const usize count)
+{
+	STUPID_ASSERT(ST_BATCH_IS_ALIGNED(in.x) && ST_BATCH_IS_ALIGNED(in.y) && ST_BATCH_IS_ALIGNED(in.z), "unaligned input stream");
+	STUPID_ASSERT(ST_BATCH_IS_ALIGNED(out.x) && ST_BATCH_IS_ALIGNED(out.y) && ST_BATCH_IS_ALIGNED(out.z), "unaligned output stream");
+
+	// every element of the top 3 rows in every lane
+	__m256 m[3][4];
+	for (int i = 0; i < 3; i++)
+		for (int j = 0; j < 4; j++)
+			m[i][j] = _mm256_set1_ps(mat.m[i][j]);
+
+	for (usize i = 0; i < count; i += ST_BATCH_WIDTH) {
+		const usize remaining = count - i;
+		const __m256 x = stBatchLoad(in.x + i, remaining);
+		const __m256 y = stBatchLoad(in.y + i, remaining);
+		const __m256 z = stBatchLoad(in.z + i, remaining);
+
+		stBatchStore(out.x + i, _mm256_fmadd_ps(m[0][0], x, _mm256_fmadd_ps(m[0][1], y, _mm256_fmadd_ps(m[0][2], z, m[0][3]))), remaining);
+		stBatchStore(out.y + i, _mm256_fmadd_ps(m[1][0], x, _mm256_fmadd_ps(m[1][1], y, _mm256_fmadd_ps(m[1][2], z, m[1][3]))), remaining);
+		stBatchStore(out.z + i, _mm256_fmadd_ps(m[2][0], x, _mm256_fmadd_ps(m[2][1], y, _mm256_fmadd_ps(m[2][2], z, m[2][3]))), remaining);
+	}
+}
+
+/**
+ * Normalizes vectors.
+ * @param in Vectors to normalize.
+ * @param out Where to put the normalized vectors (can be the same as in).
+ * @param count Number of vectors.
+ * @note Uses rsqrt with a newton step, which is within a couple ULP of stVec3Normalize().
+ * @note Zero length vectors come out as NaN, same as stVec3Normalize().
+ */
+static STUPID_INLINE void stVec3BatchNormalize(const StVec3Stream in, const StVec3Stream out, const usize count)
+{
+	STUPID_ASSERT(ST_BATCH_IS_ALIGNED(in.x) && ST_BATCH_IS_ALIGNED(in.y) && ST_BATCH_IS_ALIGNED(in.z), "unaligned input stream");
+	STUPID_ASSERT(ST_BATCH_IS_ALIGNED(out.x) && ST_BATCH_IS_ALIGNED(out.y) && ST_BATCH_IS_ALIGNED(out.z), "unaligned output stream");
+
+	const __m256 half  = _mm256_set1_ps(0.5f);
+	const __m256 three = _mm256_set1_ps(3.0f);
+
+	for (usize i = 0; i < count; i += ST_BATCH_WIDTH) {
+		const usize remaining = count - i;
+		const __m256 x = stBatchLoad(in.x + i, remaining);
+		const __m256 y = stBatchLoad(in.y + i, remaining);
+		const __m256 z = stBatchLoad(in.z + i, remaining);
+
+		const __m256 length2 = _mm256_fmadd_ps(x, x, _mm256_fmadd_ps(y, y, _mm256_mul_ps(z, z)));
+
+		// rsqrt is only good to 12 bits, one newton step (r * (3 - l * r * r) / 2) gets it to about 23
+		__m256 r = _mm256_rsqrt_ps(length2);
+		r = _mm256_mul_ps(_mm256_mul_ps(half, r), _mm256_fnmadd_ps(_mm256_mul_ps(length2, r), r, three));
+
+		stBatchStore(out.x + i, _mm256_mul_ps(x, r), remaining);
+		stBatchStore(out.y + i, _mm256_mul_ps(y, r), remaining);
+		stBatchStore(out.z + i, _mm256_mul_ps(z, r), remaining);
+	}
+}
+
+/**
+ * Multiplies 8 matrices (or whatever is left at the end) for stMat4BatchMul().
+ * @param n Index of the first matrix.
+ * @param remaining Number of matrices left.
+ */
+static STUPID_INLINE void stMat4BatchMulBlock(const StMat4Stream x, const StMat4Stream y, const StMat4Stream out, const usize n,
+                                              const usize remaining)
+{
+	// one row of out at a time with y loaded as its used, so theres only ever 9 registers live instead of spilling
+	// (each row of x is read before that row of out is written, which is why out can be x but not y)
+	for (int i = 0; i < 4; i++) {
+		const __m256 a0 = stBatchLoad(x.m[i][0] + n, remaining);
+		const __m256 a1 = stBatchLoad(x.m[i][1] + n, remaining);
+		const __m256 a2 = stBatchLoad(x.m[i][2] + n, remaining);
+		const __m256 a3 = stBatchLoad(x.m[i][3] + n, remaining);
+
+		for (int j = 0; j < 4; j++) {
+			__m256 r = _mm256_mul_ps(a0, stBatchLoad(y.m[0][j] + n, remaining));
+			r = _mm256_fmadd_ps(a1, stBatchLoad(y.m[1][j] + n, remaining), r);
+			r = _mm256_fmadd_ps(a2, stBatchLoad(y.m[2][j] + n, remaining), r);
+			r = _mm256_fmadd_ps(a3, stBatchLoad(y.m[3][j] + n, remaining), r);
+			stBatchStore(out.m[i][j] + n, r, remaining);
+		}
+	}
+}
+
+/**
+ * Multiplies matrices (like stMat4Mul()).
+ * @param x First matrices.
+ * @param y Second matrices.
+ * @param out Where to put x[i] * y[i] (can be the same as x, but not y).
+ * @param count Number of matrices.
+ * @note This isnt faster than stMat4Mul() over an array of StMat4s (it goes through 48 streams at once,
+ * which is more than the cache can prefetch), so its only for matrices that are already in streams.
+ */
+static STUPID_INLINE void stMat4BatchMul(const StMat4Stream x, const StMat4Stream y, const StMat4Stream out, const usize count)
+{
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) {
+			STUPID_ASSERT(ST_BATCH_IS_ALIGNED(x.m[i][j]) && ST_BATCH_IS_ALIGNED(y.m[i][j]), "unaligned input stream");
+			STUPID_ASSERT(ST_BATCH_IS_ALIGNED(out.m[i][j]), "unaligned output stream");
+		}
+	}
+	STUPID_ASSERT(out.m[0][0] != y.m[0][0], "out cant be the same as y");
+
+	// the full blocks dont need masks, so theyre kept out of the loop
+	usize n = 0;
+	for (; n + ST_BATCH_WIDTH <= count; n += ST_BATCH_WIDTH)
+		stMat4BatchMulBlock(x, y, out, n, ST_BATCH_WIDTH);
+	if (n < count) stMat4BatchMulBlock(x, y, out, n, count - n);
+}
+
+/**
+ * Gets x * p - y * q for 8 elements at a time (a 2x2 determinant).
+ * @return x * p - y * q
+ */
+static STUPID_INLINE __m256 stBatchDiffOfProducts(const __m256 x, const __m256 p, const __m256 y, const __m256 q)
+{
+	return _mm256_fmsub_ps(x, p, _mm256_mul_ps(y, q));
+}
+
+/**
+ * Gets an element of 8 inverses (for stMat4BatchInverse()).
+ * @param inv 1 / determinant.
+ * @return (x * p - y * q + z * r) * inv
+ */
+static STUPID_INLINE __m256 stBatchCofactor(const __m256 x, const __m256 p, const __m256 y, const __m256 q, const __m256 z,
+                                            const __m256 r, const __m256 inv)
+{
+	return _mm256_mul_ps(_mm256_fmadd_ps(z, r, stBatchDiffOfProducts(x, p, y, q)), inv);
+}
+
+/**
+ * Inverts matrices (like stMat4Inverse()).
+ * @param in Matrices to invert.
+ * @param out Where to put the inverses (can be the same as in).
+ * @param count Number of matrices.
+ * @note Singular matrices come out as infinities and NaNs.
+ */
+static STUPID_INLINE void stMat4BatchInverse(const StMat4Stream in, const StMat4Stream out, const usize count)
+{
+	for (usize n = 0; n < count; n += ST_BATCH_WIDTH) {
+		const usize remaining = count - n;
+
+		__m256 a[4][4];
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 4; j++)
+				a[i][j] = stBatchLoad(in.m[i][j] + n, remaining);
+
+		// 2x2 determinants of the top two rows (s) and bottom two rows (c), which every cofactor is built from
+		const __m256 s0 = stBatchDiffOfProducts(a[0][0], a[1][1], a[1][0], a[0][1]);
+		const __m256 s1 = stBatchDiffOfProducts(a[0][0], a[1][2], a[1][0], a[0][2]);
+		const __m256 s2 = stBatchDiffOfProducts(a[0][0], a[1][3], a[1][0], a[0][3]);
+		const __m256 s3 = stBatchDiffOfProducts(a[0][1], a[1][2], a[1][1], a[0][2]);
+		const __m256 s4 = stBatchDiffOfProducts(a[0][1], a[1][3], a[1][1], a[0][3]);
+		const __m256 s5 = stBatchDiffOfProducts(a[0][2], a[1][3], a[1][2], a[0][3]);
+		const __m256 c0 = stBatchDiffOfProducts(a[2][0], a[3][1], a[3][0], a[2][1]);
+		const __m256 c1 = stBatchDiffOfProducts(a[2][0], a[3][2], a[3][0], a[2][2]);
+		const __m256 c2 = stBatchDiffOfProducts(a[2][0], a[3][3], a[3][0], a[2][3]);
+		const __m256 c3 = stBatchDiffOfProducts(a[2][1], a[3][2], a[3][1], a[2][2]);
+		const __m256 c4 = stBatchDiffOfProducts(a[2][1], a[3][3], a[3][1], a[2][3]);
+		const __m256 c5 = stBatchDiffOfProducts(a[2][2], a[3][3], a[3][2], a[2][3]);
+
+		__m256 det = _mm256_mul_ps(s0, c5);
+		det = _mm256_fnmadd_ps(s1, c4, det);
+		det = _mm256_fmadd_ps(s2, c3, det);
+		det = _mm256_fmadd_ps(s3, c2, det);
+		det = _mm256_fnmadd_ps(s4, c1, det);
+		det = _mm256_fmadd_ps(s5, c0, det);
+		const __m256 inv = _mm256_div_ps(_mm256_set1_ps(1.0f), det);
+
+		// every element is x * p - y * q + z * r, divided by the determinant
+		stBatchStore(out.m[0][0] + n, stBatchCofactor(a[1][1], c5, a[1][2], c4, a[1][3], c3, inv), remaining);
+		stBatchStore(out.m[0][1] + n, stBatchCofactor(a[0][2], c4, a[0][1], c5, a[0][3], _mm256_xor_ps(c3, _mm256_set1_ps(-0.0f)), inv), remaining);
+		stBatchStore(out.m[0][2] + n, stBatchCofactor(a[3][1], s5, a[3][2], s4, a[3][3], s3, inv), remaining);
+		stBatchStore(out.m[0][3] + n, stBatchCofactor(a[2][2], s4, a[2][1], s5, a[2][3], _mm256_xor_ps(s3, _mm256_set1_ps(-0.0f)), inv), remaining);
+
+		stBatchStore(out.m[1][0] + n, stBatchCofactor(a[1][2], c2, a[1][0], c5, a[1][3], _mm256_xor_ps(c1, _mm256_set1_ps(-0.0f)), inv), remaining);
+		stBatchStore(out.m[1][1] + n, stBatchCofactor(a[0][0], c5, a[0][2], c2, a[0][3], c1, inv), remaining);
+		stBatchStore(out.m[1][2] + n, stBatchCofactor(a[3][2], s2, a[3][0], s5, a[3][3], _mm256_xor_ps(s1, _mm256_set1_ps(-0.0f)), inv), remaining);
+		stBatchStore(out.m[1][3] + n, stBatchCofactor(a[2][0], s5, a[2][2], s2, a[2][3], s1, inv), remaining);
+
+		stBatchStore(out.m[2][0] + n, stBatchCofactor(a[1][0], c4, a[1][1], c2, a[1][3], c0, inv), remaining);
+		stBatchStore(out.m[2][1] + n, stBatchCofactor(a[0][1], c2, a[0][0], c4, a[0][3], _mm256_xor_ps(c0, _mm256_set1_ps(-0.0f)), inv), remaining);
+		stBatchStore(out.m[2][2] + n, stBatchCofactor(a[3][0], s4, a[3][1], s2, a[3][3], s0, inv), remaining);
+		stBatchStore(out.m[2][3] + n, stBatchCofactor(a[2][1], s2, a[2][0], s4, a[2][3], _mm256_xor_ps(s0, _mm256_set1_ps(-0.0f)), inv), remaining);
+
+		stBatchStore(out.m[3][0] + n, stBatchCofactor(a[1][1], c1, a[1][0], c3, a[1][2], _mm256_xor_ps(c0, _mm256_set1_ps(-0.0f)), inv), remaining);
+		stBatchStore(out.m[3][1] + n, stBatchCofactor(a[0][0], c3, a[0][1], c1, a[0][2], c0, inv), remaining);
+		stBatchStore(out.m[3][2] + n, stBatchCofactor(a[3][1], s1, a[3][0], s3, a[3][2], _mm256_xor_ps(s0, _mm256_set1_ps(-0.0f)), inv), remaining);
+		stBatchStore(out.m[3][3] + n, stBatchCofactor(a[2][0], s3, a[2][1], s1, a[2][2], s0, inv), remaining);
+	}
+}
+
+/**
+ * Gets the inverse transposes of the top left 3x3 of 8 matrices (for the batch inverses).
+ * @param a The top 3 rows of the matrices.
+ * @param res Where to put the inverse transposes.
+ */
+static STUPID_INLINE void stMat3BatchInverseTranspose8(const __m256 a[3][4], __m256 res[3][3])
+{
+	// rows of the inverse transpose are the cross products of the rows, over the determinant
+	for (int i = 0; i < 3; i++) {
+		const int j = (i + 1) % 3, k = (i + 2) % 3;
+		res[i][0] = _mm256_fmsub_ps(a[j][1], a[k][2], _mm256_mul_ps(a[j][2], a[k][1]));
+		res[i][1] = _mm256_fmsub_ps(a[j][2], a[k][0], _mm256_mul_ps(a[j][0], a[k][2]));
+		res[i][2] = _mm256_fmsub_ps(a[j][0], a[k][1], _mm256_mul_ps(a[j][1], a[k][0]));
+	}
+
+	const __m256 det = _mm256_fmadd_ps(a[0][0], res[0][0], _mm256_fmadd_ps(a[0][1], res[0][1], _mm256_mul_ps(a[0][2], res[0][2])));
+	const __m256 inv = _mm256_div_ps(_mm256_set1_ps(1.0f), det);
+	for (int i = 0; i < 3; i++)
+		for (int j = 0; j < 3; j++)
+			res[i][j] = _mm256_mul_ps(res[i][j], inv);
+}
+
+/**
+ * Inverts affine matrices (like stMat4InverseAffine()).
+ * @param in Matrices to invert (the last row is ignored).
+ * @param out Where to put the inverses (can be the same as in).
+ * @param count Number of matrices.
+ */
+static STUPID_INLINE void stMat4BatchInverseAffine(const StMat4Stream in, const StMat4Stream out, const usize count)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one  = _mm256_set1_ps(1.0f);
+
+	for (usize n = 0; n < count; n += ST_BATCH_WIDTH) {
+		const usize remaining = count - n;
+
+		__m256 a[3][4];
+		for (int i = 0; i < 3; i++)
+			for (int j = 0; j < 4; j++)
+				a[i][j] = stBatchLoad(in.m[i][j] + n, remaining);
+
+		__m256 it[3][3];
+		stMat3BatchInverseTranspose8(a, it);
+
+		// inverse(3x3) is it transposed, and the translation is -inverse(3x3) * translation
+		for (int i = 0; i < 3; i++) {
+			const __m256 t = _mm256_fmadd_ps(it[0][i], a[0][3], _mm256_fmadd_ps(it[1][i], a[1][3], _mm256_mul_ps(it[2][i], a[2][3])));
+			for (int j = 0; j < 3; j++)
+				stBatchStore(out.m[i][j] + n, it[j][i], remaining);
+			stBatchStore(out.m[i][3] + n, _mm256_sub_ps(zero, t), remaining);
+		}
+
+		stBatchStore(out.m[3][0] + n, zero, remaining);
+		stBatchStore(out.m[3][1] + n, zero, remaining);
+		stBatchStore(out.m[3][2] + n, zero, remaining);
+		stBatchStore(out.m[3][3] + n, one, remaining);
+	}
+}
+
+/**
+ * Gets the normal matrices of matrices (like stMat4InverseTranspose3x3()).
+ * @param in The matrices (only the top left 3x3 is used).
+ * @param out Where to put the normal matrices (can be the same as in).
+ * @param count Number of matrices.
+ */
+static STUPID_INLINE void stMat4BatchInverseTranspose3x3(const StMat4Stream in, const StMat4Stream out, const usize count)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one  = _mm256_set1_ps(1.0f);
+
+	for (usize n = 0; n < count; n += ST_BATCH_WIDTH) {
+		const usize remaining = count - n;
+
+		// the last column isnt used, so its not loaded
+		__m256 a[3][4];
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++)
+				a[i][j] = stBatchLoad(in.m[i][j] + n, remaining);
+			a[i][3] = zero;
+		}
+
+		__m256 it[3][3];
+		stMat3BatchInverseTranspose8(a, it);
+
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++)
+				stBatchStore(out.m[i][j] + n, it[i][j], remaining);
+			stBatchStore(out.m[i][3] + n, zero, remaining);
+		}
+
+		stBatchStore(out.m[3][0] + n, zero, remaining);
+		stBatchStore(out.m[3][1] + n, zero, remaining);
+		stBatchStore(out.m[3][2] + n, zero, remaining);
+		stBatchStore(out.m[3][3] + n, one, remaining);
+	}
+}
+
+/**
+ * Normalizes 8 quaternions.
+ * @param w W of each quaternion.
+ * @param x X of each quaternion.
+ * @param y Y of each quaternion.
+ * @param z Z of each quaternion.
+ * @note Same precision as stVec3BatchNormalize().
+ */
+static STUPID_INLINE void stQuatBatchNormalize8(__m256 *w, __m256 *x, __m256 *y, __m256 *z)
+{
+	const __m256 length2 = _mm256_fmadd_ps(*w, *w, _mm256_fmadd_ps(*x, *x, _mm256_fmadd_ps(*y, *y, _mm256_mul_ps(*z, *z))));
+
+	__m256 r = _mm256_rsqrt_ps(length2);
+	r = _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), r), _mm256_fnmadd_ps(_mm256_mul_ps(length2, r), r, _mm256_set1_ps(3.0f)));
+
+	*w = _mm256_mul_ps(*w, r);
+	*x = _mm256_mul_ps(*x, r);
+	*y = _mm256_mul_ps(*y, r);
+	*z = _mm256_mul_ps(*z, r);
+}
+
+/**
+ * Multiplies quaternions (like stQuatMul()).
+ * @param x First quaternions.
+ * @param y Second quaternions.
+ * @param out Where to put x[i] * y[i] (can be the same as x or y).
+ * @param count Number of quaternions.
+ */
+static STUPID_INLINE void stQuatBatchMul(const StQuatStream x, const StQuatStream y, const StQuatStream out, const usize count)
+{
+	for (usize i = 0; i < count; i += ST_BATCH_WIDTH) {
+		const usize remaining = count - i;
+		const __m256 aw = stBatchLoad(x.w + i, remaining), ax = stBatchLoad(x.x + i, remaining);
+		const __m256 ay = stBatchLoad(x.y + i, remaining), az = stBatchLoad(x.z + i, remaining);
+		const __m256 bw = stBatchLoad(y.w + i, remaining), bx = stBatchLoad(y.x + i, remaining);
+		const __m256 by = stBatchLoad(y.y + i, remaining), bz = stBatchLoad(y.z + i, remaining);
+
+		const __m256 w = _mm256_fnmadd_ps(az, bz, _mm256_fnmadd_ps(ay, by, _mm256_fmsub_ps(aw, bw, _mm256_mul_ps(ax, bx))));
+		const __m256 qx = _mm256_fnmadd_ps(az, by, _mm256_fmadd_ps(ay, bz, _mm256_fmadd_ps(aw, bx, _mm256_mul_ps(ax, bw))));
+		const __m256 qy = _mm256_fmadd_ps(az, bx, _mm256_fmadd_ps(ay, bw, _mm256_fmsub_ps(aw, by, _mm256_mul_ps(ax, bz))));
+		const __m256 qz = _mm256_fmadd_ps(az, bw, _mm256_fnmadd_ps(ay, bx, _mm256_fmadd_ps(aw, bz, _mm256_mul_ps(ax, by))));
+
+		stBatchStore(out.w + i, w, remaining);
+		stBatchStore(out.x + i, qx, remaining);
+		stBatchStore(out.y + i, qy, remaining);
+		stBatchStore(out.z + i, qz, remaining);
+	}
+}
+
+/**
+ * Normalizes quaternions.
+ * @param in Quaternions to normalize.
+ * @param out Where to put the normalized quaternions (can be the same as in).
+ * @param count Number of quaternions.
+ */
+static STUPID_INLINE void stQuatBatchNormalize(const StQuatStream in, const StQuatStream out, const usize count)
+{
+	for (usize i = 0; i < count; i += ST_BATCH_WIDTH) {
+		const usize remaining = count - i;
+		__m256 w = stBatchLoad(in.w + i, remaining), x = stBatchLoad(in.x + i, remaining);
+		__m256 y = stBatchLoad(in.y + i, remaining), z = stBatchLoad(in.z + i, remaining);
+
+		stQuatBatchNormalize8(&w, &x, &y, &z);
+
+		stBatchStore(out.w + i, w, remaining);
+		stBatchStore(out.x + i, x, remaining);
+		stBatchStore(out.y + i, y, remaining);
+		stBatchStore(out.z + i, z, remaining);
+	}
+}
+
+/**
+ * Interpolates between quaternions (like stQuatNlerp()).
+ * @param x First quaternions.
+ * @param y Second quaternions.
+ * @param t How far to go from each x to each y (0 to 1).
+ * @param out Where to put the interpolated quaternions (can be the same as x or y).
+ * @param count Number of quaternions.
+ * @note Good for interpolating every object between ticks.
+ */
+static STUPID_INLINE void stQuatBatchNlerp(const StQuatStream x, const StQuatStream y, const f32 t, const StQuatStream out, const usize count)
+{
+	const __m256 vt   = _mm256_set1_ps(t);
+	const __m256 sign = _mm256_set1_ps(-0.0f);
+
+	for (usize i = 0; i < count; i += ST_BATCH_WIDTH) {
+		const usize remaining = count - i;
+		const __m256 aw = stBatchLoad(x.w + i, remaining), ax = stBatchLoad(x.x + i, remaining);
+		const __m256 ay = stBatchLoad(x.y + i, remaining), az = stBatchLoad(x.z + i, remaining);
+		__m256 bw = stBatchLoad(y.w + i, remaining), bx = stBatchLoad(y.x + i, remaining);
+		__m256 by = stBatchLoad(y.y + i, remaining), bz = stBatchLoad(y.z + i, remaining);
+
+		// flip y wherever the dot product is negative (the sign bit of the dot product is exactly the bit to flip)
+		const __m256 dot  = _mm256_fmadd_ps(aw, bw, _mm256_fmadd_ps(ax, bx, _mm256_fmadd_ps(ay, by, _mm256_mul_ps(az, bz))));
+		const __m256 flip = _mm256_and_ps(dot, sign);
+		bw = _mm256_xor_ps(bw, flip);
+		bx = _mm256_xor_ps(bx, flip);
+		by = _mm256_xor_ps(by, flip);
+		bz = _mm256_xor_ps(bz, flip);
+
+		__m256 w  = _mm256_fmadd_ps(vt, _mm256_sub_ps(bw, aw), aw);
+		__m256 qx = _mm256_fmadd_ps(vt, _mm256_sub_ps(bx, ax), ax);
+		__m256 qy = _mm256_fmadd_ps(vt, _mm256_sub_ps(by, ay), ay);
+		__m256 qz = _mm256_fmadd_ps(vt, _mm256_sub_ps(bz, az), az);
+		stQuatBatchNormalize8(&w, &qx, &qy, &qz);
+
+		stBatchStore(out.w + i, w, remaining);
+		stBatchStore(out.x + i, qx, remaining);
+		stBatchStore(out.y + i, qy, remaining);
+		stBatchStore(out.z + i, qz, remaining);
+	}
+}
+
+/**
+ * Creates rotation matrices from quaternions (like stQuatToMat4()).
+ * @param in The quaternions (normalized).
+ * @param out Where to put the matrices.
+ * @param count Number of quaternions.
+ */
+static STUPID_INLINE void stQuatBatchToMat4(const StQuatStream in, const StMat4Stream out, const usize count)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one  = _mm256_set1_ps(1.0f);
+
+	for (usize i = 0; i < count; i += ST_BATCH_WIDTH) {
+		const usize remaining = count - i;
+		const __m256 w = stBatchLoad(in.w + i, remaining), x = stBatchLoad(in.x + i, remaining);
+		const __m256 y = stBatchLoad(in.y + i, remaining), z = stBatchLoad(in.z + i, remaining);
+
+		const __m256 x2 = _mm256_add_ps(x, x), y2 = _mm256_add_ps(y, y), z2 = _mm256_add_ps(z, z);
+		const __m256 xx = _mm256_mul_ps(x, x2), yy = _mm256_mul_ps(y, y2), zz = _mm256_mul_ps(z, z2);
+		const __m256 xy = _mm256_mul_ps(x, y2), xz = _mm256_mul_ps(x, z2), yz = _mm256_mul_ps(y, z2);
+		const __m256 wx = _mm256_mul_ps(w, x2), wy = _mm256_mul_ps(w, y2), wz = _mm256_mul_ps(w, z2);
+
+		stBatchStore(out.m[0][0] + i, _mm256_sub_ps(one, _mm256_add_ps(yy, zz)), remaining);
+		stBatchStore(out.m[0][1] + i, _mm256_sub_ps(xy, wz), remaining);
+		stBatchStore(out.m[0][2] + i, _mm256_add_ps(xz, wy), remaining);
+		stBatchStore(out.m[0][3] + i, zero, remaining);
+
+		stBatchStore(out.m[1][0] + i, _mm256_add_ps(xy, wz), remaining);
+		stBatchStore(out.m[1][1] + i, _mm256_sub_ps(one, _mm256_add_ps(xx, zz)), remaining);
+		stBatchStore(out.m[1][2] + i, _mm256_sub_ps(yz, wx), remaining);
+		stBatchStore(out.m[1][3] + i, zero, remaining);
+
+		stBatchStore(out.m[2][0] + i, _mm256_sub_ps(xz, wy), remaining);
+		stBatchStore(out.m[2][1] + i, _mm256_add_ps(yz, wx), remaining);
+		stBatchStore(out.m[2][2] + i, _mm256_sub_ps(one, _mm256_add_ps(xx, yy)), remaining);
+		stBatchStore(out.m[2][3] + i, zero, remaining);
+
+		stBatchStore(out.m[3][0] + i, zero, remaining);
+		stBatchStore(out.m[3][1] + i, zero, remaining);
+		stBatchStore(out.m[3][2] + i, zero, remaining);
+		stBatchStore(out.m[3][3] + i, one, remaining);
+	}
+}
+
+/**
+ * Gets a bitmask of the lanes that are left at the end of a stream.
+ * @param remaining Number of elements left.
+ * @return Mask with the first min(remaining, 8) bits set.
+ */
+static STUPID_INLINE u8 stBatchBitmask(const usize remaining)
+{
+	return (remaining >= ST_BATCH_WIDTH) ? 0xff : (u8)((1u << remaining) - 1);
+}
+
+/**
+ * Checks which spheres are inside a frustum (like stFrustumTestSphere()).
+ * @param frustum The frustum.
+ * @param spheres The spheres.
+ * @param pVisible Where to put a bit for each sphere, set if its inside ((count + 7) / 8 bytes, sphere i is bit i % 8 of byte i / 8).
+ * @param count Number of spheres.
+ * @return Number of spheres inside.
+ */
+static STUPID_INLINE usize stFrustumBatchTestSphere(const StFrustum frustum, const StSphereStream spheres, u8 *pVisible, const usize count)
+{
+	STUPID_ASSERT(ST_BATCH_IS_ALIGNED(spheres.x) && ST_BATCH_IS_ALIGNED(spheres.y) && ST_BATCH_IS_ALIGNED(spheres.z), "unaligned sphere stream");
+	STUPID_ASSERT(ST_BATCH_IS_ALIGNED(spheres.radius), "unaligned sphere stream");
+
+	usize visible = 0;
+	for (usize i = 0; i < count; i += ST_BATCH_WIDTH) {
+		const usize remaining = count - i;
+		const __m256 x = stBatchLoad(spheres.x + i, remaining);
+		const __m256 y = stBatchLoad(spheres.y + i, remaining);
+		const __m256 z = stBatchLoad(spheres.z + i, remaining);
+		const __m256 r = _mm256_xor_ps(stBatchLoad(spheres.radius + i, remaining), _mm256_set1_ps(-0.0f));
+
+		// not less than instead of greater or equal so NaNs pass, same as stFrustumTestSphere()
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < ST_FRUSTUM_PLANE_MAX; p++) {
+			const StPlane plane = frustum.planes[p];
+			const __m256 d = _mm256_fmadd_ps(_mm256_set1_ps(plane.normal.x), x,
+			                 _mm256_fmadd_ps(_mm256_set1_ps(plane.normal.y), y,
+			                 _mm256_fmadd_ps(_mm256_set1_ps(plane.normal.z), z, _mm256_set1_ps(plane.d))));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, r, _CMP_NLT_UQ));
+		}
+
+		const u8 mask = (u8)_mm256_movemask_ps(inside) & stBatchBitmask(remaining);
+		pVisible[i / ST_BATCH_WIDTH] = mask;
+		visible += __builtin_popcount(mask);
+	}
+	return visible;
+}
+
+/**
+ * Checks which boxes are inside a frustum (like stFrustumTestAabb()).
+ * @param frustum The frustum.
+ * @param boxes The boxes.
+ * @param pVisible Where to put a bit for each box, set if its inside ((count + 7) / 8 bytes, box i is bit i % 8 of byte i / 8).
+ * @param count Number of boxes.
+ * @return Number of boxes inside.
+ */
+static STUPID_INLINE usize stFrustumBatchTestAabb(const StFrustum frustum, const StAabbStream boxes, u8 *pVisible, const usize count)
+{
+	STUPID_ASSERT(ST_BATCH_IS_ALIGNED(boxes.min.x) && ST_BATCH_IS_ALIGNED(boxes.min.y) && ST_BATCH_IS_ALIGNED(boxes.min.z), "unaligned box stream");
+	STUPID_ASSERT(ST_BATCH_IS_ALIGNED(boxes.max.x) && ST_BATCH_IS_ALIGNED(boxes.max.y) && ST_BATCH_IS_ALIGNED(boxes.max.z), "unaligned box stream");
+
+	usize visible = 0;
+	for (usize i = 0; i < count; i += ST_BATCH_WIDTH) {
+		const usize remaining = count - i;
+		const __m256 min[3] = {stBatchLoad(boxes.min.x + i, remaining), stBatchLoad(boxes.min.y + i, remaining), stBatchLoad(boxes.min.z + i, remaining)};
+		const __m256 max[3] = {stBatchLoad(boxes.max.x + i, remaining), stBatchLoad(boxes.max.y + i, remaining), stBatchLoad(boxes.max.z + i, remaining)};
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < ST_FRUSTUM_PLANE_MAX; p++) {
+			const StPlane plane = frustum.planes[p];
+
+			// the corner furthest in front of the plane is the same for every box, so no blending
+			const __m256 cx = (plane.normal.x >= 0.0f) ? max[0] : min[0];
+			const __m256 cy = (plane.normal.y >= 0.0f) ? max[1] : min[1];
+			const __m256 cz = (plane.normal.z >= 0.0f) ? max[2] : min[2];
+			const __m256 d = _mm256_fmadd_ps(_mm256_set1_ps(plane.normal.x), cx,
+			                 _mm256_fmadd_ps(_mm256_set1_ps(plane.normal.y), cy,
+			                 _mm256_fmadd_ps(_mm256_set1_ps(plane.normal.z), cz, _mm256_set1_ps(plane.d))));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_NLT_UQ));
+		}
+
+		const u8 mask = (u8)_mm256_movemask_ps(inside) & stBatchBitmask(remaining);
+		pVisible[i / ST_BATCH_WIDTH] = mask;
+		visible += __builtin_popcount(mask);
+	}
+	return visible;
+}
@@ -0,0 +1,219 @@
+/// @file bounds.h
+/// @brief Bounding volumes, planes, and frustums.
+/// Planes are stored as {normal, d}, and a point p is in front of one if dot(normal, p) + d >= 0.
+/// Frustum planes all face inward, so a point is inside a frustum if its in front of all 6.
+/// @author nonexistant
+
+#pragma once
+
+#include "stupid/common.h"
+#include "stupid/math/basic.h"
+#include "stupid/math/linear.h"
+
+/// Axis aligned bounding box.
+typedef struct StAabb {
+	StVec3 min;
+	StVec3 max;
+} StAabb;
+
+/// Bounding sphere (the same layout as a vec4 in a shader).
+typedef union StSphere {
+	struct {
+		StVec3 center;
+		f32 radius;
+	};
+
+	StVec4 vec;
+} StSphere;
+
+/// Plane, the points p where dot(normal, p) + d is 0.
+typedef union StPlane {
+	struct {
+		StVec3 normal;
+		f32 d;
+	};
+
+	StVec4 vec;
+} StPlane;
+
+/// Planes of a frustum.
+typedef enum st_frustum_plane {
+	ST_FRUSTUM_PLANE_LEFT,
+	ST_FRUSTUM_PLANE_RIGHT,
+	ST_FRUSTUM_PLANE_BOTTOM,
+	ST_FRUSTUM_PLANE_TOP,
+	ST_FRUSTUM_PLANE_NEAR,
+	ST_FRUSTUM_PLANE_FAR,
+
+	ST_FRUSTUM_PLANE_MAX
+} st_frustum_plane;
+
+/// The volume a camera can see.
+/// @see stFrustumFromMat4
+typedef struct StFrustum {
+	/// Normalized planes facing inward.
+	StPlane planes[ST_FRUSTUM_PLANE_MAX];
+} StFrustum;
+
+#define STSPHERE(x, y, z, radius) ((StSphere){.vec = STVEC4((x), (y), (z), (radius))})
+
+/**
+ * Creates the smallest box containing some points.
+ * @param pPoints The points.
+ * @param count Number of points (a box at 0 with no size if its 0).
+ * @return The box.
+ */
+static STUPID_INLINE StAabb stAabbFromPoints(const StVec3 *pPoints, const usize count)
+{
+	if (count == 0) return (StAabb){0};
+
+	StAabb aabb = {pPoints[0], pPoints[0]};
+	for (usize i = 1; i < count; i++) {
+		for (int j = 0; j < 3; j++) {
+			aabb.min.v[j] = STUPID_MIN(aabb.min.v[j], pPoints[i].v[j]);
+			aabb.max.v[j] = STUPID_MAX(aabb.max.v[j], pPoints[i].v[j]);
+		}
+	}
+	return aabb;
+}
+
+/**
+ * Gets the center of a box.
+ * @param aabb The box.
+ * @return (min + max) / 2
+ */
+static STUPID_INLINE StVec3 stAabbCenter(const StAabb aabb)
+{
+	return stVec3Scale(stVec3Add(aabb.min, aabb.max), 0.5f);
+}
+
+/**
+ * Gets how far a box goes from its center on each axis.
+ * @param aabb The box.
+ * @return (max - min) / 2
+ */
+static STUPID_INLINE StVec3 stAabbExtents(const StAabb aabb)
+{
+	return stVec3Scale(stVec3Sub(aabb.max, aabb.min), 0.5f);
+}
+
+/**
+ * Transforms a box, and makes a new axis aligned one around it.
+ * @param aabb The box.
+ * @param mat Transform (like a model matrix, theres no perspective divide).
+ * @return A box containing the transformed one.
+ */
+static STUPID_INLINE StAabb stAabbTransform(const StAabb aabb, const StMat4 mat)
+{
+	const StVec3 center  = stAabbCenter(aabb);
+	const StVec3 extents = stAabbExtents(aabb);
+
+	// the new extents on each axis are the extents projected onto that row of the matrix (arvo)
+	StAabb res;
+	for (int i = 0; i < 3; i++) {
+		const f32 c = mat.m[i][0] * center.x + mat.m[i][1] * center.y + mat.m[i][2] * center.z + mat.m[i][3];
+		const f32 e = stFabsf(mat.m[i][0]) * extents.x + stFabsf(mat.m[i][1]) * extents.y + stFabsf(mat.m[i][2]) * extents.z;
+		res.min.v[i] = c - e;
+		res.max.v[i] = c + e;
+	}
+	return res;
+}
+
+/**
+ * Creates a sphere around a box.
+ * @param aabb The box.
+ * @return The sphere (centered on the box, with the corners on its surface).
+ */
+static STUPID_INLINE StSphere stSphereFromAabb(const StAabb aabb)
+{
+	StSphere sphere;
+	sphere.center = stAabbCenter(aabb);
+	sphere.radius = stVec3Hypot(stAabbExtents(aabb));
+	return sphere;
+}
+
+/**
+ * Normalizes a plane (so stPlaneDistance() gives actual distances).
+ * @param plane The plane.
+ * @return The plane with a normal of length 1.
+ */
+static STUPID_INLINE StPlane stPlaneNormalize(StPlane plane)
+{
+	const f32 inv = 1.0f / stVec3Hypot(plane.normal);
+	plane.vec = stVec4Scale(plane.vec, inv);
+	return plane;
+}
+
+/**
+ * Gets how far in front of a plane a point is.
+ * @param plane The plane (normalized).
+ * @param point The point.
+ * @return dot(normal, point) + d (negative if the point is behind the plane).
+ * @note Uses the same fused multiply adds as the batch tests, so they always agree.
+ */
+static STUPID_INLINE f32 stPlaneDistance(const StPlane plane, const StVec3 point)
+{
+	return __builtin_fmaf(plane.normal.x, point.x, __builtin_fmaf(plane.normal.y, point.y, __builtin_fmaf(plane.normal.z, point.z, plane.d)));
+}
+
+/**
+ * @brief Gets the frustum a view projection matrix sees.
+ * Each plane is a sum or difference of the last row of the matrix and one of the others (gribb and hartmann),
+ * with depth going from 0 to 1 like stMat4Perspective() and vulkan.
+ * @param mat View projection matrix (like stMat4Mul(projection, view)).
+ * @return The frustum.
+ */
+static STUPID_INLINE StFrustum stFrustumFromMat4(const StMat4 mat)
+{
+	const __m128 r0 = _mm_loadu_ps(mat.m[0]);
+	const __m128 r1 = _mm_loadu_ps(mat.m[1]);
+	const __m128 r2 = _mm_loadu_ps(mat.m[2]);
+	const __m128 r3 = _mm_loadu_ps(mat.m[3]);
+
+	StFrustum frustum;
+	_mm_storeu_ps(frustum.planes[ST_FRUSTUM_PLANE_LEFT].vec.v, _mm_add_ps(r3, r0));
+	_mm_storeu_ps(frustum.planes[ST_FRUSTUM_PLANE_RIGHT].vec.v, _mm_sub_ps(r3, r0));
+	_mm_storeu_ps(frustum.planes[ST_FRUSTUM_PLANE_BOTTOM].vec.v, _mm_add_ps(r3, r1));
+	_mm_storeu_ps(frustum.planes[ST_FRUSTUM_PLANE_TOP].vec.v, _mm_sub_ps(r3, r1));
+	_mm_storeu_ps(frustum.planes[ST_FRUSTUM_PLANE_NEAR].vec.v, r2);
+	_mm_storeu_ps(frustum.planes[ST_FRUSTUM_PLANE_FAR].vec.v, _mm_sub_ps(r3, r2));
+
+	for (int i = 0; i < ST_FRUSTUM_PLANE_MAX; i++)
+		frustum.planes[i] = stPlaneNormalize(frustum.planes[i]);
+	return frustum;
+}
+
+/**
+ * Checks if any part of a sphere is inside a frustum.
+ * @param frustum The frustum.
+ * @param sphere The sphere.
+ * @return False if the sphere is completely behind any of the planes.
+ * @note Spheres near the corners can be outside but still pass, which is fine for culling.
+ */
+static STUPID_INLINE bool stFrustumTestSphere(const StFrustum frustum, const StSphere sphere)
+{
+	for (int i = 0; i < ST_FRUSTUM_PLANE_MAX; i++)
+		if (stPlaneDistance(frustum.planes[i], sphere.center) < -sphere.radius) return false;
+	return true;
+}
+
+/**
+ * Checks if any part of a box is inside a frustum.
+ * @param frustum The frustum.
+ * @param aabb The box.
+ * @return False if the box is completely behind any of the planes.
+ * @note Boxes near the corners can be outside but still pass, which is fine for culling.
+ */
+static STUPID_INLINE bool stFrustumTestAabb(const StFrustum frustum, const StAabb aabb)
+{
+	for (int i = 0; i < ST_FRUSTUM_PLANE_MAX; i++) {
+		const StPlane plane = frustum.planes[i];
+
+		// the corner furthest in front of the plane
+		const StVec3 corner = STVEC3(plane.normal.x >= 0.0f ? aabb.max.x : aabb.min.x,
+		                             plane.normal.y >= 0.0f ? aabb.max.y : aabb.min.y,
+		                             plane.normal.z >= 0.0f ? aabb.max.z : aabb.min.z);
+		if (stPlaneDistance(plane, corner) < 0.0f) return false;
+	}
+	return true;
+}
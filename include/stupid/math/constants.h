@@ -14,7 +14,7 @@
 /// @brief Number of radians in a circle.
 /// I would have called this "C" but i dont get to decide.
 /// @note Very useful.
-#define STUPID_MATH_TAU 6.28318630717908647711
+#define STUPID_MATH_TAU 6.28318530717958647692
 
 /// Tau / 2.
 /// @note Sorta useless.
@@ -3,6 +3,10 @@
 
 #include "stupid/common.h"
 
+// everything here uses intrinsics instead of inline asm so the compiler VEX encodes it with -mavx
+// (legacy SSE instructions after AVX code cause a transition stall)
+#include <immintrin.h>
+
 /**
  * @brief Single asm instruction sqrt implementation for f64s.
  * Finds the number that when squared produces x.
@@ -11,8 +15,7 @@
  */
 static STUPID_INLINE f64 stSqrt(f64 x)
 {
-        __asm__("sqrtsd %0, %0" : "+x"(x));
-        return x;
+        return _mm_cvtsd_f64(_mm_sqrt_sd(_mm_setzero_pd(), _mm_set_sd(x)));
 }
 
 /**
@@ -23,8 +26,7 @@ static STUPID_INLINE f64 stSqrt(f64 x)
  */
 static STUPID_INLINE f32 stSqrtf(f32 x)
 {
-        __asm__("sqrtss %0, %0" : "+x"(x));
-        return x;
+        return _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(x)));
 }
 
 /**
@@ -32,11 +34,11 @@ static STUPID_INLINE f32 stSqrtf(f32 x)
  * Finds the inverse of the number that when squared produces x.
  * @param x A positive number.
  * @return 1 / sqrt(x)
+ * @note rsqrtss is only precise to 1.5 * 2^-12 (about 11 bits).
  */
 static STUPID_INLINE f32 stISqrt(f32 x)
 {
-        __asm__("rsqrtss %0, %0" : "+x"(x));
-        return x;
+        return _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
 }
 
 #define stSqrt(x) _Generic((x),\
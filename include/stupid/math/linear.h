@@ -391,9 +391,9 @@ static STUPID_INLINE StVec2 stVec2ScaleInv(const StVec2 vec, const f32 scale)
  */
 static STUPID_INLINE f32 stVec4Sum(StVec4 vec)
 {
-	__m128 tmp = _mm_add_ps(*(__m128*)&vec, *(__m128*)&vec);
-	__m128 res = _mm_add_ss(tmp, _mm_shuffle_ps(tmp, tmp, 1));
-	return _mm_extract_ps(res, 0);
+	const __m128 v   = _mm_loadu_ps(vec.v);
+	const __m128 tmp = _mm_add_ps(v, _mm_movehl_ps(v, v));
+	return _mm_cvtss_f32(_mm_add_ss(tmp, _mm_movehdup_ps(tmp)));
 }
 
 /**
@@ -753,6 +753,7 @@ static STUPID_INLINE StMat2 stMat2Scale(StMat2 mat, const f32 x)
  */
 static STUPID_INLINE StMat4 stMat4Transpose(const StMat4 mat)
 {
+	// the compiler already turns this into shuffles, and the intrinsics version was slower
 	StMat4 res;
 	for (int i = 0; i < 4; i++)
 		for (int j = 0; j < 4; j++)
@@ -800,6 +801,7 @@ static STUPID_INLINE StMat2 stMat2Transpose(const StMat2 mat)
  */
 static STUPID_INLINE StMat4 stMat4Mul(const StMat4 x, const StMat4 y)
 {
+	// gcc vectorizes this loop, which was faster than the broadcast and fma version
 	StMat4 res;
 	for (int i = 0; i < 4; i++)
 		for (int j = 0; j < 4; j++)
@@ -989,39 +991,220 @@ static STUPID_INLINE f32 stMat3Det(const StMat3 mat)
  */
 static inline f32 stMat4Det(const StMat4 mat)
 {
-	const f32 x = stMat3Det((StMat3){
-		.m = {
-			{mat.m[1][1], mat.m[1][2], mat.m[1][3]},
-			{mat.m[2][1], mat.m[2][2], mat.m[2][3]},
-			{mat.m[3][1], mat.m[3][2], mat.m[3][3]}
-		}
-	});
+	const __m256 ab = _mm256_loadu_ps(mat.m[0]);
+	const __m256 cd = _mm256_loadu_ps(mat.m[2]);
 
-	const f32 y = stMat3Det((StMat3){
-		.m = {
-			{mat.m[1][0], mat.m[1][2], mat.m[1][3]},
-			{mat.m[2][0], mat.m[2][2], mat.m[2][3]},
-			{mat.m[3][0], mat.m[3][2], mat.m[3][3]}
-		}
-	});
+	// rows {0, 2} and {1, 3}, so the top and bottom halves are done at the same time
+	const __m256 x = _mm256_permute2f128_ps(ab, cd, 0x20);
+	const __m256 y = _mm256_permute2f128_ps(ab, cd, 0x31);
 
-	const f32 z = stMat3Det((StMat3){
-		.m = {
-			{mat.m[1][0], mat.m[1][1], mat.m[1][3]},
-			{mat.m[2][0], mat.m[2][1], mat.m[2][3]},
-			{mat.m[3][0], mat.m[3][1], mat.m[3][3]}
-		}
-	});
+	// 2x2 determinants of the columns {01, 02, 03, 12} and {13, 23, 13, 23} (top two rows in the low half, bottom two in the high half)
+	const __m256 p0 = _mm256_fmsub_ps(_mm256_permute_ps(x, _MM_SHUFFLE(1, 0, 0, 0)), _mm256_permute_ps(y, _MM_SHUFFLE(2, 3, 2, 1)),
+	                                  _mm256_mul_ps(_mm256_permute_ps(y, _MM_SHUFFLE(1, 0, 0, 0)), _mm256_permute_ps(x, _MM_SHUFFLE(2, 3, 2, 1))));
+	const __m256 p1 = _mm256_fmsub_ps(_mm256_permute_ps(x, _MM_SHUFFLE(2, 1, 2, 1)), _mm256_permute_ps(y, _MM_SHUFFLE(3, 3, 3, 3)),
+	                                  _mm256_mul_ps(_mm256_permute_ps(y, _MM_SHUFFLE(2, 1, 2, 1)), _mm256_permute_ps(x, _MM_SHUFFLE(3, 3, 3, 3))));
 
-	const f32 w = stMat3Det((StMat3){
-		.m = {
-			{mat.m[1][0], mat.m[1][1], mat.m[1][2]},
-			{mat.m[2][0], mat.m[2][1], mat.m[2][2]},
-			{mat.m[3][0], mat.m[3][1], mat.m[3][2]}
-		}
-	});
+	const __m128 s0 = _mm256_castps256_ps128(p0), t0 = _mm256_extractf128_ps(p0, 1);
+	const __m128 s1 = _mm256_castps256_ps128(p1), t1 = _mm256_extractf128_ps(p1, 1);
+
+	// laplace expansion over the pairs (01 * 23 - 02 * 13 + 03 * 12 + 12 * 03 - 13 * 02 + 23 * 01)
+	// (the last two pairs are in s1 twice, so theyre halved)
+	__m128 sum = _mm_mul_ps(s0, _mm_xor_ps(_mm_shuffle_ps(t1, t0, _MM_SHUFFLE(2, 3, 0, 1)), _mm_setr_ps(0.0f, -0.0f, 0.0f, 0.0f)));
+	sum = _mm_fmadd_ps(s1, _mm_mul_ps(_mm_shuffle_ps(t0, t0, _MM_SHUFFLE(0, 1, 0, 1)), _mm_setr_ps(-0.5f, 0.5f, -0.5f, 0.5f)), sum);
+
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+	return _mm_cvtss_f32(sum);
+}
+
+/**
+ * Multiplies 2x2 matrices packed as {m00, m01, m10, m11} (for stMat4Inverse()).
+ * @param x First matrix.
+ * @param y Second matrix.
+ * @return x * y
+ */
+static STUPID_INLINE __m128 stMat2MulPacked(const __m128 x, const __m128 y)
+{
+	return _mm_fmadd_ps(x, _mm_permute_ps(y, _MM_SHUFFLE(3, 0, 3, 0)),
+	                    _mm_mul_ps(_mm_permute_ps(x, _MM_SHUFFLE(2, 3, 0, 1)), _mm_permute_ps(y, _MM_SHUFFLE(1, 2, 1, 2))));
+}
+
+/**
+ * Multiplies the adjugate of a packed 2x2 matrix by another (for stMat4Inverse()).
+ * @param x First matrix.
+ * @param y Second matrix.
+ * @return adj(x) * y
+ */
+static STUPID_INLINE __m128 stMat2AdjMulPacked(const __m128 x, const __m128 y)
+{
+	return _mm_fmsub_ps(_mm_permute_ps(x, _MM_SHUFFLE(0, 0, 3, 3)), y,
+	                    _mm_mul_ps(_mm_permute_ps(x, _MM_SHUFFLE(2, 2, 1, 1)), _mm_permute_ps(y, _MM_SHUFFLE(1, 0, 3, 2))));
+}
+
+/**
+ * Multiplies a packed 2x2 matrix by the adjugate of another (for stMat4Inverse()).
+ * @param x First matrix.
+ * @param y Second matrix.
+ * @return x * adj(y)
+ */
+static STUPID_INLINE __m128 stMat2MulAdjPacked(const __m128 x, const __m128 y)
+{
+	return _mm_fmsub_ps(x, _mm_permute_ps(y, _MM_SHUFFLE(0, 3, 0, 3)),
+	                    _mm_mul_ps(_mm_permute_ps(x, _MM_SHUFFLE(2, 3, 0, 1)), _mm_permute_ps(y, _MM_SHUFFLE(1, 2, 1, 2))));
+}
+
+/**
+ * Inverts a StMat4.
+ * @param mat Matrix to invert.
+ * @return The matrix that undoes mat (mat * inverse is the identity).
+ * @note Singular matrices (stMat4Det() of 0) come out as infinities and NaNs.
+ * @note Use stMat4InverseAffine() for model and view matrices, its about 1.5x as fast.
+ */
+static STUPID_INLINE StMat4 stMat4Inverse(const StMat4 mat)
+{
+	const __m128 r0 = _mm_loadu_ps(mat.m[0]);
+	const __m128 r1 = _mm_loadu_ps(mat.m[1]);
+	const __m128 r2 = _mm_loadu_ps(mat.m[2]);
+	const __m128 r3 = _mm_loadu_ps(mat.m[3]);
+
+	// split into 2x2 blocks | A B |
+	//                       | C D |
+	const __m128 a = _mm_movelh_ps(r0, r1);
+	const __m128 b = _mm_movehl_ps(r1, r0);
+	const __m128 c = _mm_movelh_ps(r2, r3);
+	const __m128 d = _mm_movehl_ps(r3, r2);
+
+	// {det(A), det(B), det(C), det(D)}
+	const __m128 dets = _mm_fmsub_ps(_mm_shuffle_ps(r0, r2, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(r1, r3, _MM_SHUFFLE(3, 1, 3, 1)),
+	                                 _mm_mul_ps(_mm_shuffle_ps(r0, r2, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_ps(r1, r3, _MM_SHUFFLE(2, 0, 2, 0))));
+	const __m128 det_a = _mm_permute_ps(dets, _MM_SHUFFLE(0, 0, 0, 0));
+	const __m128 det_b = _mm_permute_ps(dets, _MM_SHUFFLE(1, 1, 1, 1));
+	const __m128 det_c = _mm_permute_ps(dets, _MM_SHUFFLE(2, 2, 2, 2));
+	const __m128 det_d = _mm_permute_ps(dets, _MM_SHUFFLE(3, 3, 3, 3));
+
+	// the inverse is the blocks | X Y | / det, with each of them built from 2x2 products instead of 3x3 cofactors
+	//                           | Z W |
+	const __m128 ab = stMat2AdjMulPacked(a, b);
+	const __m128 dc = stMat2AdjMulPacked(d, c);
+	__m128 x = _mm_fmsub_ps(det_d, a, stMat2MulPacked(b, dc));
+	__m128 w = _mm_fmsub_ps(det_a, d, stMat2MulPacked(c, ab));
+	__m128 y = _mm_fmsub_ps(det_b, c, stMat2MulAdjPacked(d, ab));
+	__m128 z = _mm_fmsub_ps(det_c, b, stMat2MulAdjPacked(a, dc));
+
+	// det = det(A) * det(D) + det(B) * det(C) - trace(adj(A) * B * adj(D) * C)
+	__m128 trace = _mm_mul_ps(ab, _mm_permute_ps(dc, _MM_SHUFFLE(3, 1, 2, 0)));
+	trace = _mm_hadd_ps(trace, trace);
+	trace = _mm_hadd_ps(trace, trace);
+	const __m128 det = _mm_sub_ps(_mm_fmadd_ps(det_a, det_d, _mm_mul_ps(det_b, det_c)), trace);
+
+	// the signs of the adjugate go in with the division
+	const __m128 inv = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det);
+	x = _mm_mul_ps(x, inv);
+	y = _mm_mul_ps(y, inv);
+	z = _mm_mul_ps(z, inv);
+	w = _mm_mul_ps(w, inv);
+
+	// the adjugate swaps the diagonals of each block, which is done while putting them back into rows
+	StMat4 res;
+	_mm_storeu_ps(res.m[0], _mm_shuffle_ps(x, y, _MM_SHUFFLE(1, 3, 1, 3)));
+	_mm_storeu_ps(res.m[1], _mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 2, 0, 2)));
+	_mm_storeu_ps(res.m[2], _mm_shuffle_ps(z, w, _MM_SHUFFLE(1, 3, 1, 3)));
+	_mm_storeu_ps(res.m[3], _mm_shuffle_ps(z, w, _MM_SHUFFLE(0, 2, 0, 2)));
+	return res;
+}
+
+/**
+ * Gets the cross product of the first 3 elements of 2 SSE vectors.
+ * @param x First vector.
+ * @param y Second vector.
+ * @return {cross(x, y), 0} (the last element is only 0 if its 0 in x or y).
+ */
+static STUPID_INLINE __m128 stVec3CrossPacked(const __m128 x, const __m128 y)
+{
+	// (x * y.yzx - x.yzx * y).yzx only needs 3 shuffles instead of 4
+	const __m128 res = _mm_fmsub_ps(x, _mm_permute_ps(y, _MM_SHUFFLE(3, 0, 2, 1)), _mm_mul_ps(_mm_permute_ps(x, _MM_SHUFFLE(3, 0, 2, 1)), y));
+	return _mm_permute_ps(res, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+/**
+ * Inverts the top left 3x3 of a StMat4, and transposes it.
+ * @param r0 First row of the matrix.
+ * @param r1 Second row of the matrix.
+ * @param r2 Third row of the matrix.
+ * @param pRows Where to put the rows of the inverse transpose (the last element of each is 0).
+ */
+static STUPID_INLINE void stMat3InverseTransposePacked(__m128 r0, __m128 r1, __m128 r2, __m128 pRows[3])
+{
+	// the fused multiply in stVec3CrossPacked() leaves rounding error in the last element instead of 0,
+	// so the translations have to be taken out first or they end up in the determinant
+	r0 = _mm_blend_ps(r0, _mm_setzero_ps(), 0x8);
+	r1 = _mm_blend_ps(r1, _mm_setzero_ps(), 0x8);
+	r2 = _mm_blend_ps(r2, _mm_setzero_ps(), 0x8);
+
+	// rows of the inverse transpose are the cross products of the rows, over the determinant
+	const __m128 c0 = stVec3CrossPacked(r1, r2);
+	const __m128 c1 = stVec3CrossPacked(r2, r0);
+	const __m128 c2 = stVec3CrossPacked(r0, r1);
+
+	__m128 det = _mm_mul_ps(r0, c0);
+	det = _mm_add_ps(det, _mm_movehl_ps(det, det));
+	det = _mm_add_ss(det, _mm_movehdup_ps(det));
+	const __m128 inv = _mm_div_ps(_mm_set1_ps(1.0f), _mm_permute_ps(det, _MM_SHUFFLE(0, 0, 0, 0)));
+
+	pRows[0] = _mm_mul_ps(c0, inv);
+	pRows[1] = _mm_mul_ps(c1, inv);
+	pRows[2] = _mm_mul_ps(c2, inv);
+}
+
+/**
+ * Inverts an affine StMat4 (rotation, scale, shear and translation, with a last row of {0, 0, 0, 1}).
+ * @param mat Matrix to invert (like a model or view matrix).
+ * @return The matrix that undoes mat.
+ * @note The last row of mat is ignored, so this is wrong for projection matrices (use stMat4Inverse()).
+ */
+static STUPID_INLINE StMat4 stMat4InverseAffine(const StMat4 mat)
+{
+	const __m128 r0 = _mm_loadu_ps(mat.m[0]);
+	const __m128 r1 = _mm_loadu_ps(mat.m[1]);
+	const __m128 r2 = _mm_loadu_ps(mat.m[2]);
+
+	// the columns of the inverse of the top left 3x3 (its the transpose of the inverse transpose)
+	__m128 c[3];
+	stMat3InverseTransposePacked(r0, r1, r2, c);
+
+	// the inverse translation is -inverse(3x3) * translation
+	__m128 t = _mm_mul_ps(c[0], _mm_permute_ps(r0, _MM_SHUFFLE(3, 3, 3, 3)));
+	t = _mm_fmadd_ps(c[1], _mm_permute_ps(r1, _MM_SHUFFLE(3, 3, 3, 3)), t);
+	t = _mm_fmadd_ps(c[2], _mm_permute_ps(r2, _MM_SHUFFLE(3, 3, 3, 3)), t);
+	t = _mm_xor_ps(t, _mm_set1_ps(-0.0f));
+
+	_MM_TRANSPOSE4_PS(c[0], c[1], c[2], t);
+
+	StMat4 res;
+	_mm_storeu_ps(res.m[0], c[0]);
+	_mm_storeu_ps(res.m[1], c[1]);
+	_mm_storeu_ps(res.m[2], c[2]);
+	_mm_storeu_ps(res.m[3], _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f));
+	return res;
+}
+
+/**
+ * Gets the normal matrix of a StMat4 (the inverse transpose of its top left 3x3).
+ * @param mat Matrix to get the normal matrix of (like a model matrix).
+ * @return The inverse transpose in the top left 3x3, and the identity everywhere else.
+ * @note Normals transformed by this have to be normalized again if mat has any scale in it.
+ */
+static STUPID_INLINE StMat4 stMat4InverseTranspose3x3(const StMat4 mat)
+{
+	__m128 rows[3];
+	stMat3InverseTransposePacked(_mm_loadu_ps(mat.m[0]), _mm_loadu_ps(mat.m[1]), _mm_loadu_ps(mat.m[2]), rows);
 
-	return (mat.m[0][0] * x) - (mat.m[0][1] * y) + (mat.m[0][2] * z) - (mat.m[0][3] * w);
+	StMat4 res;
+	_mm_storeu_ps(res.m[0], rows[0]);
+	_mm_storeu_ps(res.m[1], rows[1]);
+	_mm_storeu_ps(res.m[2], rows[2]);
+	_mm_storeu_ps(res.m[3], _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f));
+	return res;
 }
 
 /**
@@ -1060,40 +1243,52 @@ static STUPID_INLINE StMat4 stMat4Orthographic(const f32 left, const f32 right,
  */
 static STUPID_INLINE StMat4 stMat4Perspective(const f32 fov, const f32 aspect_ratio, const f32 near, const f32 far)
 {
-	StMat4 mat = stMat4Zero();
-	const f32 scale = stTan(fov * 0.5f);
+	const f32 scale = 1.0f / (f32)stTan(fov * 0.5f);
+	const f32 depth = far / (far - near);
 
-	mat.m[0][0] = 1.0f / (aspect_ratio * scale);
-	mat.m[1][1] = -(1.0f / scale);
-	mat.m[2][2] = far / (far - near);
-	mat.m[2][3] = -((far * near) / (far - near));
-	mat.m[3][2] = 1.0f;
+	// each row is written whole instead of zeroing the matrix first
+	StMat4 mat;
+	_mm_storeu_ps(mat.m[0], _mm_setr_ps(scale / aspect_ratio, 0.0f, 0.0f, 0.0f));
+	_mm_storeu_ps(mat.m[1], _mm_setr_ps(0.0f, -scale, 0.0f, 0.0f));
+	_mm_storeu_ps(mat.m[2], _mm_setr_ps(0.0f, 0.0f, depth, -(near * depth)));
+	_mm_storeu_ps(mat.m[3], _mm_setr_ps(0.0f, 0.0f, 1.0f, 0.0f));
 
 	return mat;
 }
 
+/**
+ * Creates a view matrix looking from one point at another.
+ * @param pos Where to look from.
+ * @param target What to look at.
+ * @param up Which way is up.
+ * @return A view matrix.
+ */
 static STUPID_INLINE StMat4 stMat4LookAt(StVec3 pos, const StVec3 target, const StVec3 up)
 {
-	const StVec3 f = stVec3Normalize(stVec3Sub(target, pos));
-	const StVec3 r = stVec3Normalize(stVec3Cross(up, f));
-	const StVec3 u = stVec3Normalize(stVec3Cross(f, r));
+	// w is 0 so it stays out of the dot products
+	const __m128 p = _mm_setr_ps(pos.x, pos.y, pos.z, 0.0f);
+	const __m128 t = _mm_setr_ps(target.x, target.y, target.z, 0.0f);
+	const __m128 v = _mm_setr_ps(up.x, up.y, up.z, 0.0f);
 
-	StMat4 mat = stMat4Ident();
+	__m128 f = _mm_sub_ps(t, p);
+	f = _mm_div_ps(f, _mm_sqrt_ps(_mm_dp_ps(f, f, 0x7F)));
 
-	mat.m[0][0] = r.x;
-	mat.m[0][1] = r.y;
-	mat.m[0][2] = r.z;
-	mat.m[0][3] = -(stVec3Dot(r, pos));
+	// cross(x, y) = (x * y.yzx - x.yzx * y).yzx
+	const __m128 f_yzx = _mm_shuffle_ps(f, f, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 r = _mm_fmsub_ps(v, f_yzx, _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 0, 2, 1)), f));
+	r = _mm_shuffle_ps(r, r, _MM_SHUFFLE(3, 0, 2, 1));
+	r = _mm_div_ps(r, _mm_sqrt_ps(_mm_dp_ps(r, r, 0x7F)));
 
-	mat.m[1][0] = u.x;
-	mat.m[1][1] = u.y;
-	mat.m[1][2] = u.z;
-	mat.m[1][3] = -(stVec3Dot(u, pos));
+	__m128 u = _mm_fmsub_ps(f, _mm_shuffle_ps(r, r, _MM_SHUFFLE(3, 0, 2, 1)), _mm_mul_ps(f_yzx, r));
+	u = _mm_shuffle_ps(u, u, _MM_SHUFFLE(3, 0, 2, 1));
+	u = _mm_div_ps(u, _mm_sqrt_ps(_mm_dp_ps(u, u, 0x7F)));
 
-	mat.m[2][0] = f.x;
-	mat.m[2][1] = f.y;
-	mat.m[2][2] = f.z;
-	mat.m[2][3] = -(stVec3Dot(f, pos));
+	// the dot product with pos only goes in w
+	StMat4 mat;
+	_mm_storeu_ps(mat.m[0], _mm_sub_ps(r, _mm_dp_ps(r, p, 0x78)));
+	_mm_storeu_ps(mat.m[1], _mm_sub_ps(u, _mm_dp_ps(u, p, 0x78)));
+	_mm_storeu_ps(mat.m[2], _mm_sub_ps(f, _mm_dp_ps(f, p, 0x78)));
+	_mm_storeu_ps(mat.m[3], _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f));
 
 	return mat;
 }
@@ -1333,10 +1528,17 @@ static STUPID_INLINE StMat4 stMat4Translate(StMat4 mat, const f32 x, const f32 y
 /// @note res and vec cannot overlap.
 static STUPID_INLINE StVec4 stVec4MulMat(const StVec4 vec, const StMat4 mat)
 {
-	StVec4 res = stVec4Zero();
-	for (int i = 0; i < 4; i++)
-		for (int j = 0; j < 4; j++)
-			res.v[i] += mat.m[i][j] * vec.v[j];
+	// each element is the dot product of a row and vec
+	const __m256 v  = _mm256_broadcast_ps((const __m128 *)vec.v);
+	const __m256 lo = _mm256_mul_ps(_mm256_loadu_ps(mat.m[0]), v);
+	const __m256 hi = _mm256_mul_ps(_mm256_loadu_ps(mat.m[2]), v);
+
+	// {0, 2, 0, 2} in the low half and {1, 3, 1, 3} in the high half
+	__m256 sum = _mm256_hadd_ps(lo, hi);
+	sum = _mm256_hadd_ps(sum, sum);
+
+	StVec4 res;
+	_mm_storeu_ps(res.v, _mm_unpacklo_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1)));
 	return res;
 }
 
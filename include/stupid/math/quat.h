@@ -0,0 +1,197 @@
+/// @file quat.h
+/// @brief Quaternions.
+/// Quaternions are stored as {w, x, y, z}, and rotate vectors the same way the matrices from stQuatToMat4() do
+/// (with the vector on the right, like stVec4MulMat()).
+/// @author nonexistant
+
+#pragma once
+
+#include "stupid/common.h"
+#include "stupid/math/linear.h"
+#include "stupid/math/sin.h"
+#include "stupid/math/exp.h"
+
+#include <immintrin.h>
+
+/// Past this dot product stQuatSlerp() falls back to stQuatNlerp() (the angle is too small to divide by its sine).
+#define ST_QUAT_SLERP_THRESHOLD 0.9995f
+
+#define STQUAT(w, x, y, z) ((StQuat){.q = {(w), (x), (y), (z)}})
+
+/**
+ * Returns a quaternion that doesnt rotate anything.
+ * @return {1, 0, 0, 0}
+ */
+static STUPID_INLINE StQuat stQuatIdent(void)
+{
+	return STQUAT(1.0f, 0.0f, 0.0f, 0.0f);
+}
+
+/**
+ * Gets the dot product of 2 quaternions.
+ * @param x First quaternion.
+ * @param y Second quaternion.
+ * @return x.w * y.w + x.x * y.x + x.y * y.y + x.z * y.z
+ */
+static STUPID_INLINE f32 stQuatDot(const StQuat x, const StQuat y)
+{
+	const __m128 m   = _mm_mul_ps(_mm_loadu_ps(x.q), _mm_loadu_ps(y.q));
+	const __m128 tmp = _mm_add_ps(m, _mm_movehl_ps(m, m));
+	return _mm_cvtss_f32(_mm_add_ss(tmp, _mm_movehdup_ps(tmp)));
+}
+
+/**
+ * Multiplies 2 quaternions (the hamilton product).
+ * @param x First quaternion.
+ * @param y Second quaternion.
+ * @return x * y (rotates by y, then by x)
+ */
+static STUPID_INLINE StQuat stQuatMul(const StQuat x, const StQuat y)
+{
+	// hand written SSE was slower than this (gcc vectorizes it fine, and across calls in loops too), use stQuatBatchMul() for lots of them
+	return STQUAT(x.w * y.w - x.x * y.x - x.y * y.y - x.z * y.z,
+	              x.w * y.x + x.x * y.w + x.y * y.z - x.z * y.y,
+	              x.w * y.y - x.x * y.z + x.y * y.w + x.z * y.x,
+	              x.w * y.z + x.x * y.y - x.y * y.x + x.z * y.w);
+}
+
+/**
+ * Inverts a quaternion.
+ * @param quat The quaternion.
+ * @return A quaternion that undoes quat (the same as stQuatConjugate() if quat is normalized).
+ */
+static STUPID_INLINE StQuat stQuatInverse(const StQuat quat)
+{
+	const f32 inv = 1.0f / stQuatDot(quat, quat);
+	return STQUAT(quat.w * inv, -quat.x * inv, -quat.y * inv, -quat.z * inv);
+}
+
+/**
+ * Creates a quaternion that rotates around an axis.
+ * @param axis Axis to rotate around (doesnt have to be normalized).
+ * @param angle Angle to rotate by in radians.
+ * @return The quaternion (stQuatIdent() if axis is 0).
+ */
+static STUPID_INLINE StQuat stQuatFromAxisAngle(const StVec3 axis, const f32 angle)
+{
+	const f32 magnitude = stVec3Hypot(axis);
+	if (magnitude < 0.0000001f)
+		return stQuatIdent();
+
+	const f32 s = stSin(angle * 0.5f) / magnitude;
+	return STQUAT(stCos(angle * 0.5f), axis.x * s, axis.y * s, axis.z * s);
+}
+
+/**
+ * Creates a quaternion from euler angles.
+ * @param angles Angles to rotate around the x, y, and z axes in radians.
+ * @return The quaternion.
+ * @note Rotates around x first, then y, then z (the same as the euler angles objects used to be rotated by).
+ */
+static STUPID_INLINE StQuat stQuatFromEuler(const StVec3 angles)
+{
+	const f32 cx = stCos(angles.x * 0.5f), sx = stSin(angles.x * 0.5f);
+	const f32 cy = stCos(angles.y * 0.5f), sy = stSin(angles.y * 0.5f);
+	const f32 cz = stCos(angles.z * 0.5f), sz = stSin(angles.z * 0.5f);
+
+	return STQUAT(cz * cy * cx + sz * sy * sx,
+	              cz * cy * sx - sz * sy * cx,
+	              cz * sy * cx + sz * cy * sx,
+	              sz * cy * cx - cz * sy * sx);
+}
+
+/**
+ * Creates a rotation matrix from a quaternion.
+ * @param quat The quaternion (normalized).
+ * @return The matrix.
+ */
+static STUPID_INLINE StMat3 stQuatToMat3(const StQuat quat)
+{
+	const f32 x2 = quat.x + quat.x, y2 = quat.y + quat.y, z2 = quat.z + quat.z;
+	const f32 xx = quat.x * x2, yy = quat.y * y2, zz = quat.z * z2;
+	const f32 xy = quat.x * y2, xz = quat.x * z2, yz = quat.y * z2;
+	const f32 wx = quat.w * x2, wy = quat.w * y2, wz = quat.w * z2;
+
+	StMat3 mat;
+	mat.m[0][0] = 1.0f - (yy + zz);
+	mat.m[0][1] = xy - wz;
+	mat.m[0][2] = xz + wy;
+
+	mat.m[1][0] = xy + wz;
+	mat.m[1][1] = 1.0f - (xx + zz);
+	mat.m[1][2] = yz - wx;
+
+	mat.m[2][0] = xz - wy;
+	mat.m[2][1] = yz + wx;
+	mat.m[2][2] = 1.0f - (xx + yy);
+	return mat;
+}
+
+/**
+ * Creates a rotation matrix from a quaternion.
+ * @param quat The quaternion (normalized).
+ * @return The matrix.
+ */
+static STUPID_INLINE StMat4 stQuatToMat4(const StQuat quat)
+{
+	const StMat3 rot = stQuatToMat3(quat);
+
+	StMat4 mat;
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++)
+			mat.m[i][j] = rot.m[i][j];
+		mat.m[i][3] = 0.0f;
+	}
+	_mm_storeu_ps(mat.m[3], _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f));
+	return mat;
+}
+
+/**
+ * Interpolates between 2 quaternions, and normalizes the result.
+ * @param x First quaternion.
+ * @param y Second quaternion.
+ * @param t How far to go from x to y (0 to 1).
+ * @return The interpolated quaternion.
+ * @note Much cheaper than stQuatSlerp(), but the speed isnt constant (which doesnt matter for small steps like between ticks).
+ */
+static STUPID_INLINE StQuat stQuatNlerp(const StQuat x, const StQuat y, const f32 t)
+{
+	const __m128 a = _mm_loadu_ps(x.q);
+	__m128 b = _mm_loadu_ps(y.q);
+
+	// q and -q are the same rotation, so take the short way around
+	if (stQuatDot(x, y) < 0.0f) b = _mm_xor_ps(b, _mm_set1_ps(-0.0f));
+
+	StQuat res;
+	_mm_storeu_ps(res.q, _mm_fmadd_ps(_mm_set1_ps(t), _mm_sub_ps(b, a), a));
+	return stQuatNormalize(res);
+}
+
+/**
+ * Spherically interpolates between 2 quaternions.
+ * @param x First quaternion (normalized).
+ * @param y Second quaternion (normalized).
+ * @param t How far to go from x to y (0 to 1).
+ * @return The interpolated quaternion.
+ */
+static STUPID_INLINE StQuat stQuatSlerp(const StQuat x, StQuat y, const f32 t)
+{
+	f32 cos = stQuatDot(x, y);
+	if (cos < 0.0f) {
+		cos = -cos;
+		y   = STQUAT(-y.w, -y.x, -y.y, -y.z);
+	}
+
+	if (cos > ST_QUAT_SLERP_THRESHOLD)
+		return stQuatNlerp(x, y, t);
+
+	const f32 theta = stAcos(cos);
+	const f32 inv   = 1.0f / stSin(theta);
+	const __m128 wx = _mm_set1_ps(stSin((1.0f - t) * theta) * inv);
+	const __m128 wy = _mm_set1_ps(stSin(t * theta) * inv);
+
+	// normalized since stAcos() and stSin() are approximations
+	StQuat res;
+	_mm_storeu_ps(res.q, _mm_fmadd_ps(wx, _mm_loadu_ps(x.q), _mm_mul_ps(wy, _mm_loadu_ps(y.q))));
+	return stQuatNormalize(res);
+}
@@ -1,8 +1,312 @@
+/// @file sin.h
+/// @brief Trig functions.
+/// Everything here is a minimax polynomial (coefficients from cephes), so nothing touches memory besides the constants,
+/// and every function has an 8 wide AVX2 version (the ones ending in V) that gives the same results.
+/// @note Define STUPID_MATH_LOOKUP before including this to also get the old lookup table versions (stSinLookup() and co).
+/// @author nonexistant
+
 #pragma once
 
 #include "stupid/common.h"
 #include "stupid/assert.h"
 #include "stupid/math/constants.h"
+
+#include <immintrin.h>
+
+/// @brief Pi / 2 split in 3 so x - k * pi / 2 can be done without losing precision.
+/// The first 2 parts have few enough bits that multiplying them by k is exact for |k| < 2^15.
+#define ST_TRIG_PIO2_1 1.5703125f
+#define ST_TRIG_PIO2_2 4.837512969970703125e-4f
+#define ST_TRIG_PIO2_3 7.54978995489188216e-8f
+
+/// Largest |x| the range reduction in stSinCos() stays precise for (past this the error grows with |x|).
+#define ST_TRIG_MAX_PRECISE 8192.0f
+
+// sin(r) on [-pi / 4, pi / 4]
+#define ST_TRIG_SIN_1 -1.6666654611e-1f
+#define ST_TRIG_SIN_2  8.3321608736e-3f
+#define ST_TRIG_SIN_3 -1.9515295891e-4f
+
+// cos(r) on [-pi / 4, pi / 4]
+#define ST_TRIG_COS_1  4.166664568298827e-2f
+#define ST_TRIG_COS_2 -1.388731625493765e-3f
+#define ST_TRIG_COS_3  2.443315711809948e-5f
+
+// atan(t) on [-(sqrt(2) - 1), sqrt(2) - 1]
+#define ST_TRIG_ATAN_1 -3.33329491539e-1f
+#define ST_TRIG_ATAN_2  1.99777106478e-1f
+#define ST_TRIG_ATAN_3 -1.38776856032e-1f
+#define ST_TRIG_ATAN_4  8.05374449538e-2f
+
+// asin(x) on [-0.5, 0.5]
+#define ST_TRIG_ASIN_1 1.6666752422e-1f
+#define ST_TRIG_ASIN_2 7.4953002686e-2f
+#define ST_TRIG_ASIN_3 4.5470025998e-2f
+#define ST_TRIG_ASIN_4 2.4181311049e-2f
+#define ST_TRIG_ASIN_5 4.2163199048e-2f
+
+/**
+ * Gets the sine and cosine of an angle.
+ * @param x The angle in radians.
+ * @param pSin Where to put sin(x).
+ * @param pCos Where to put cos(x).
+ * @note Max error is 2 ULP for |x| < tau, and the absolute error stays under 1e-7 up to ST_TRIG_MAX_PRECISE.
+ */
+static STUPID_INLINE void stSinCos(const f32 x, f32 *pSin, f32 *pCos)
+{
+	// x = k * pi / 2 + r, the quadrant (k & 3) decides which polynomial goes where
+	const i32 k  = _mm_cvtss_si32(_mm_set_ss(x * (f32)(1.0 / STUPID_MATH_TAUd4)));
+	const f32 kf = (f32)k;
+	const f32 r  = ((x - kf * ST_TRIG_PIO2_1) - kf * ST_TRIG_PIO2_2) - kf * ST_TRIG_PIO2_3;
+	const f32 z  = r * r;
+
+	const f32 s = r + r * z * (ST_TRIG_SIN_1 + z * (ST_TRIG_SIN_2 + z * ST_TRIG_SIN_3));
+	const f32 c = 1.0f - 0.5f * z + z * z * (ST_TRIG_COS_1 + z * (ST_TRIG_COS_2 + z * ST_TRIG_COS_3));
+
+	// odd quadrants swap sin and cos, and the signs come from the quadrant bits (same as stSinCosV())
+	const bool swap = k & 1;
+	union {f32 f; u32 i;} sin = {swap ? c : s}, cos = {swap ? s : c};
+	sin.i ^= (u32)(k & 2) << 30;
+	cos.i ^= (u32)((k + 1) & 2) << 30;
+
+	*pSin = sin.f;
+	*pCos = cos.f;
+}
+
+/**
+ * Gets the sine of an angle.
+ * @param x The angle in radians.
+ * @return sin(x)
+ * @note Same precision as stSinCos().
+ */
+static STUPID_INLINE f32 stSin(const f32 x)
+{
+	f32 s, c;
+	stSinCos(x, &s, &c);
+	return s;
+}
+
+/**
+ * Gets the cosine of an angle.
+ * @param x The angle in radians.
+ * @return cos(x)
+ * @note Same precision as stSinCos().
+ */
+static STUPID_INLINE f32 stCos(const f32 x)
+{
+	f32 s, c;
+	stSinCos(x, &s, &c);
+	return c;
+}
+
+/**
+ * Gets the tangent of an angle.
+ * @param x The angle in radians.
+ * @return tan(x)
+ * @note Max error is 4 ULP for |x| < tau.
+ */
+static STUPID_INLINE f32 stTan(const f32 x)
+{
+	f32 s, c;
+	stSinCos(x, &s, &c);
+	return s / c;
+}
+
+/**
+ * Inverse tangent of a number from 0 to 1.
+ * @param t The number.
+ * @return atan(t)
+ */
+static STUPID_INLINE f32 stAtanUnit(f32 t)
+{
+	// atan(t) = pi / 4 + atan((t - 1) / (t + 1)), which gets t down to where the polynomial is precise
+	f32 offset = 0.0f;
+	if (t > (f32)(STUPID_SQRT2 - 1.0)) {
+		offset = (f32)STUPID_MATH_TAUd8;
+		t      = (t - 1.0f) / (t + 1.0f);
+	}
+
+	const f32 z = t * t;
+	return offset + t + t * z * (ST_TRIG_ATAN_1 + z * (ST_TRIG_ATAN_2 + z * (ST_TRIG_ATAN_3 + z * ST_TRIG_ATAN_4)));
+}
+
+/**
+ * Gets the angle of a point from the x axis.
+ * @param y Y of the point.
+ * @param x X of the point.
+ * @return atan2(y, x) (-pi to pi, 0 if the point is 0, 0).
+ * @note Max error is 3 ULP.
+ */
+static STUPID_INLINE f32 stAtan2(const f32 y, const f32 x)
+{
+	const f32 ax = (x < 0.0f) ? -x : x;
+	const f32 ay = (y < 0.0f) ? -y : y;
+	const f32 hi = STUPID_MAX(ax, ay);
+	if (hi == 0.0f) return 0.0f;
+
+	f32 a = stAtanUnit(STUPID_MIN(ax, ay) / hi);
+	if (ay > ax)   a = (f32)STUPID_MATH_TAUd4 - a;
+	if (x < 0.0f)  a = (f32)STUPID_MATH_TAUd2 - a;
+	return (y < 0.0f) ? -a : a;
+}
+
+/**
+ * Gets the inverse tangent of a number.
+ * @param x The number.
+ * @return atan(x)
+ * @note Max error is 3 ULP.
+ */
+static STUPID_INLINE f32 stAtan(const f32 x)
+{
+	return stAtan2(x, 1.0f);
+}
+
+/**
+ * Inverse sine of a number from 0 to 0.5.
+ * @param x The number.
+ * @return asin(x)
+ */
+static STUPID_INLINE f32 stAsinHalf(const f32 x)
+{
+	const f32 z = x * x;
+	return x + x * z * (ST_TRIG_ASIN_1 + z * (ST_TRIG_ASIN_2 + z * (ST_TRIG_ASIN_3 + z * (ST_TRIG_ASIN_4 + z * ST_TRIG_ASIN_5))));
+}
+
+/**
+ * Gets the inverse cosine of a number.
+ * @param x A number from -1 to 1 (clamped).
+ * @return acos(x) (0 to pi)
+ * @note Max error is 2 ULP.
+ */
+static STUPID_INLINE f32 stAcos(f32 x)
+{
+	x = STUPID_CLAMP(x, -1.0f, 1.0f);
+	const f32 ax  = (x < 0.0f) ? -x : x;
+	const bool big = ax > 0.5f;
+
+	// acos(x) = 2 * asin(sqrt((1 - |x|) / 2)) keeps the polynomial input under 0.5 near the ends
+	// (everything is computed either way so the compiler can use selects instead of unpredictable branches)
+	const f32 root = _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(0.5f * (1.0f - ax))));
+	const f32 p    = stAsinHalf(big ? root : x);
+	const f32 ends = (x < 0.0f) ? (f32)STUPID_MATH_TAUd2 - 2.0f * p : 2.0f * p;
+	return big ? ends : (f32)STUPID_MATH_TAUd4 - p;
+}
+
+/**
+ * Gets the inverse sine of a number.
+ * @param x A number from -1 to 1 (clamped).
+ * @return asin(x) (-pi / 2 to pi / 2)
+ * @note Max error is 3 ULP.
+ */
+static STUPID_INLINE f32 stAsin(f32 x)
+{
+	x = STUPID_CLAMP(x, -1.0f, 1.0f);
+
+	const f32 ax = (x < 0.0f) ? -x : x;
+	f32 a;
+	if (ax > 0.5f) a = (f32)STUPID_MATH_TAUd4 - 2.0f * stAsinHalf(_mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(0.5f * (1.0f - ax)))));
+	else a = stAsinHalf(ax);
+	return (x < 0.0f) ? -a : a;
+}
+
+/**
+ * Gets the sine and cosine of 8 angles (like stSinCos()).
+ * @param x The angles in radians.
+ * @param pSin Where to put the sines.
+ * @param pCos Where to put the cosines.
+ */
+static STUPID_INLINE void stSinCosV(const __m256 x, __m256 *pSin, __m256 *pCos)
+{
+	const __m256i k  = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps((f32)(1.0 / STUPID_MATH_TAUd4))));
+	const __m256  kf = _mm256_cvtepi32_ps(k);
+
+	__m256 r = _mm256_fnmadd_ps(kf, _mm256_set1_ps(ST_TRIG_PIO2_1), x);
+	r = _mm256_fnmadd_ps(kf, _mm256_set1_ps(ST_TRIG_PIO2_2), r);
+	r = _mm256_fnmadd_ps(kf, _mm256_set1_ps(ST_TRIG_PIO2_3), r);
+	const __m256 z = _mm256_mul_ps(r, r);
+
+	__m256 s = _mm256_fmadd_ps(z, _mm256_set1_ps(ST_TRIG_SIN_3), _mm256_set1_ps(ST_TRIG_SIN_2));
+	s = _mm256_fmadd_ps(z, s, _mm256_set1_ps(ST_TRIG_SIN_1));
+	s = _mm256_fmadd_ps(_mm256_mul_ps(r, z), s, r);
+
+	__m256 c = _mm256_fmadd_ps(z, _mm256_set1_ps(ST_TRIG_COS_3), _mm256_set1_ps(ST_TRIG_COS_2));
+	c = _mm256_fmadd_ps(z, c, _mm256_set1_ps(ST_TRIG_COS_1));
+	c = _mm256_fmadd_ps(_mm256_mul_ps(z, z), c, _mm256_fnmadd_ps(_mm256_set1_ps(0.5f), z, _mm256_set1_ps(1.0f)));
+
+	// odd quadrants swap sin and cos, and the sign bits come straight from the quadrant bits
+	const __m256 swap     = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(k, _mm256_set1_epi32(1)), _mm256_set1_epi32(1)));
+	const __m256 sin_sign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(k, _mm256_set1_epi32(2)), 30));
+	const __m256 cos_sign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(k, _mm256_set1_epi32(1)), _mm256_set1_epi32(2)), 30));
+
+	*pSin = _mm256_xor_ps(_mm256_blendv_ps(s, c, swap), sin_sign);
+	*pCos = _mm256_xor_ps(_mm256_blendv_ps(c, s, swap), cos_sign);
+}
+
+/**
+ * Gets the angles of 8 points from the x axis (like stAtan2()).
+ * @param y Y of each point.
+ * @param x X of each point.
+ * @return atan2(y, x) for each point.
+ */
+static STUPID_INLINE __m256 stAtan2V(const __m256 y, const __m256 x)
+{
+	const __m256 sign = _mm256_set1_ps(-0.0f);
+	const __m256 ax   = _mm256_andnot_ps(sign, x);
+	const __m256 ay   = _mm256_andnot_ps(sign, y);
+	const __m256 hi   = _mm256_max_ps(ax, ay);
+	const __m256 lo   = _mm256_min_ps(ax, ay);
+
+	// 0 / 0 would be NaN, and atan2(0, 0) is 0
+	__m256 t = _mm256_div_ps(lo, hi);
+	t = _mm256_and_ps(t, _mm256_cmp_ps(hi, _mm256_setzero_ps(), _CMP_NEQ_OQ));
+
+	const __m256 big = _mm256_cmp_ps(t, _mm256_set1_ps((f32)(STUPID_SQRT2 - 1.0)), _CMP_GT_OQ);
+	t = _mm256_blendv_ps(t, _mm256_div_ps(_mm256_sub_ps(t, _mm256_set1_ps(1.0f)), _mm256_add_ps(t, _mm256_set1_ps(1.0f))), big);
+	const __m256 offset = _mm256_and_ps(big, _mm256_set1_ps((f32)STUPID_MATH_TAUd8));
+
+	const __m256 z = _mm256_mul_ps(t, t);
+	__m256 a = _mm256_fmadd_ps(z, _mm256_set1_ps(ST_TRIG_ATAN_4), _mm256_set1_ps(ST_TRIG_ATAN_3));
+	a = _mm256_fmadd_ps(z, a, _mm256_set1_ps(ST_TRIG_ATAN_2));
+	a = _mm256_fmadd_ps(z, a, _mm256_set1_ps(ST_TRIG_ATAN_1));
+	a = _mm256_add_ps(offset, _mm256_fmadd_ps(_mm256_mul_ps(t, z), a, t));
+
+	a = _mm256_blendv_ps(a, _mm256_sub_ps(_mm256_set1_ps((f32)STUPID_MATH_TAUd4), a), _mm256_cmp_ps(ay, ax, _CMP_GT_OQ));
+	a = _mm256_blendv_ps(a, _mm256_sub_ps(_mm256_set1_ps((f32)STUPID_MATH_TAUd2), a), _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LT_OQ));
+	return _mm256_blendv_ps(a, _mm256_xor_ps(a, sign), _mm256_cmp_ps(y, _mm256_setzero_ps(), _CMP_LT_OQ));
+}
+
+/**
+ * Gets the inverse cosines of 8 numbers (like stAcos()).
+ * @param x Numbers from -1 to 1 (clamped).
+ * @return acos(x) for each number.
+ */
+static STUPID_INLINE __m256 stAcosV(__m256 x)
+{
+	const __m256 one  = _mm256_set1_ps(1.0f);
+	const __m256 half = _mm256_set1_ps(0.5f);
+	x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-1.0f)), one);
+
+	const __m256 ax  = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x);
+	const __m256 big = _mm256_cmp_ps(ax, half, _CMP_GT_OQ);
+
+	// same as stAcos(), asin of sqrt((1 - |x|) / 2) near the ends, and asin(x) in the middle
+	const __m256 u = _mm256_blendv_ps(x, _mm256_sqrt_ps(_mm256_mul_ps(half, _mm256_sub_ps(one, ax))), big);
+	const __m256 z = _mm256_mul_ps(u, u);
+
+	__m256 p = _mm256_fmadd_ps(z, _mm256_set1_ps(ST_TRIG_ASIN_5), _mm256_set1_ps(ST_TRIG_ASIN_4));
+	p = _mm256_fmadd_ps(z, p, _mm256_set1_ps(ST_TRIG_ASIN_3));
+	p = _mm256_fmadd_ps(z, p, _mm256_set1_ps(ST_TRIG_ASIN_2));
+	p = _mm256_fmadd_ps(z, p, _mm256_set1_ps(ST_TRIG_ASIN_1));
+	p = _mm256_fmadd_ps(_mm256_mul_ps(u, z), p, u);
+
+	const __m256 ends = _mm256_add_ps(p, p);
+	const __m256 neg  = _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LT_OQ);
+	const __m256 res  = _mm256_blendv_ps(ends, _mm256_sub_ps(_mm256_set1_ps((f32)STUPID_MATH_TAUd2), ends), neg);
+	return _mm256_blendv_ps(_mm256_sub_ps(_mm256_set1_ps((f32)STUPID_MATH_TAUd4), p), res, big);
+}
+
+#ifdef STUPID_MATH_LOOKUP
+
 #include "stupid/math/lookup/lookup_sine.h"
 #include "stupid/math/lookup/lookup_arccos.h"
 
@@ -11,7 +315,7 @@
  * @note Precise to ~0.0001.
  * @return ~sin(x)
  */
-static STUPID_INLINE f32 stSin(const f32 x)
+static STUPID_INLINE f32 stSinLookup(const f32 x)
 {
 	STUPID_STATIC_ASSERT(STUPID_IS_POWER2(STUPID_LOOKUP_SINEWAVE_SIZE), "sinewave lookup table size is not a power of 2");
 	i32 index = ((f32)STUPID_LOOKUP_SINEWAVE_SIZE * x / (STUPID_MATH_TAU / 4.0));
@@ -36,7 +340,7 @@ static STUPID_INLINE f32 stSin(const f32 x)
  * @note Precise to ~0.0001.
  * @return ~cos(x)
  */
-static STUPID_INLINE f32 stCos(const f32 x)
+static STUPID_INLINE f32 stCosLookup(const f32 x)
 {
 	STUPID_STATIC_ASSERT(STUPID_IS_POWER2(STUPID_LOOKUP_SINEWAVE_SIZE), "sinewave lookup table size is not a power of 2");
 	i32 index = ((f32)STUPID_LOOKUP_SINEWAVE_SIZE * x / (STUPID_MATH_TAU / 4.0));
@@ -61,7 +365,7 @@ static STUPID_INLINE f32 stCos(const f32 x)
  * @note Precise to ~0.0001.
  * @return ~tan(x)
  */
-static STUPID_INLINE f64 stTan(const f64 x)
+static STUPID_INLINE f64 stTanLookup(const f64 x)
 {
 	STUPID_STATIC_ASSERT(STUPID_IS_POWER2(STUPID_LOOKUP_SINEWAVE_SIZE), "sinewave lookup table size is not a power of 2");
 	u16 index = (u16)((f32)STUPID_LOOKUP_SINEWAVE_SIZE * x / (STUPID_MATH_TAU / 4.0));
@@ -86,7 +390,7 @@ static STUPID_INLINE f64 stTan(const f64 x)
  * @note Precise to ~0.0001.
  * @return ~acos(x)
  */
-static STUPID_INLINE f32 stAcos(const f32 x)
+static STUPID_INLINE f32 stAcosLookup(const f32 x)
 {
 	STUPID_STATIC_ASSERT(STUPID_IS_POWER2(STUPID_LOOKUP_ARCCOS_SIZE), "arccos lookup table size is not a power of 2");
 	if (STUPID_UNLIKELY(x >= 1.0))
@@ -94,38 +398,11 @@ static STUPID_INLINE f32 stAcos(const f32 x)
 	else if (STUPID_UNLIKELY(x <= -1.0))
 		return STUPID_LOOKUP_ARCCOS[STUPID_LOOKUP_ARCCOS_SIZE - 1];
 
-	u16 index = (u16)((f32)STUPID_LOOKUP_ARCCOS_SIZE * x) & (STUPID_LOOKUP_ARCCOS_SIZE - 1);
-	return STUPID_LOOKUP_ARCCOS[index];
-}
-
-/**
- * Inverse sinewave approximation (LUT).
- * @note Precise to ~0.0001.
- * @return ~asin(x)
- */
-#define stAsin(x) (-stAcos(x) + STUPID_MATH_TAUd2)
-
-/**
- * Inverse tangent approximation.
- * @note Precise to ~0.00005.
- * return ~atan(x)
- */
-static STUPID_INLINE f32 stAtan(const f32 x)
-{
-	const f32 a[3] = { 0.994766756708199f, -0.28543851807526100f, 0.0760699247645105f };
-	const f32 xx = x * x;
-	return ((a[2] * xx + a[1]) * xx + a[0]) * x;
-}
-
-/**
- * Inverse tangent approximation.
- * @note Precise to ~0.00005.
- * return ~atan2(x, y)
- */
-static STUPID_INLINE f32 stAtan2(const f32 x, const f32 y)
-{
-	if (x > 0.0) return stAtan(y / x);
-	else if (x < 0.0) return stAtan(y / -x);
-	else return 0.0;
+	// the table goes from -1 to 1 (not 0 to 1), so interpolate between the 2 closest entries
+	const f32 position = (x + 1.0f) * 0.5f * (f32)(STUPID_LOOKUP_ARCCOS_SIZE - 1);
+	const u16 index    = (u16)position;
+	const f32 t        = position - (f32)index;
+	return STUPID_LOOKUP_ARCCOS[index] + (STUPID_LOOKUP_ARCCOS[index + 1] - STUPID_LOOKUP_ARCCOS[index]) * t;
 }
 
+#endif
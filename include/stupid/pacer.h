@@ -0,0 +1,98 @@
+/// @file pacer.h
+/// @brief Frame pacing.
+/// Sleeps until an absolute deadline with clock_nanosleep(TIMER_ABSTIME), then spins for the last bit,
+/// so the framerate cap is hit exactly instead of drifting like a relative sleep does.
+/// @author nonexistant
+
+#pragma once
+
+#include "stupid/common.h"
+
+/// Least amount of time the pacer spins before a deadline.
+#define ST_PACER_MIN_SPIN 0.00002
+
+/// Most amount of time the pacer spins before a deadline.
+#define ST_PACER_MAX_SPIN 0.002
+
+/// Oversleep the spin margin is calibrated to is multiplied by this to leave some headroom.
+#define ST_PACER_SPIN_HEADROOM 1.25
+
+/// @brief If the pacer falls behind by more than this many frames, it starts over from the current time.
+/// Otherwise missed frames are caught up on so the average framerate stays exact.
+#define ST_PACER_MAX_BEHIND 2.0
+
+/// Paces frames to a fixed period.
+/// @see stFramePacerWait
+typedef struct StFramePacer {
+	/// Absolute time (CLOCK_MONOTONIC) the next frame should start at.
+	f64 deadline;
+
+	/// How long before the deadline the pacer stops sleeping and starts spinning.
+	f64 spin;
+
+	/// Worst recent oversleep (decays every frame).
+	f64 oversleep;
+
+	/// Number of frames paced.
+	u64 frames;
+
+	/// Number of times the deadline had already passed when stFramePacerWait() was called.
+	u64 missed;
+
+	/// Number of times the pacer fell too far behind and started over.
+	u64 resyncs;
+
+	f64 jitter_min;
+	f64 jitter_max;
+	f64 jitter_total;
+	f64 jitter_squared_total;
+} StFramePacer;
+
+/// Jitter statistics for a frame pacer.
+/// @note Jitter is how late a frame started compared to its deadline.
+typedef struct StFramePacerStats {
+	/// Number of frames paced.
+	u64 frames;
+
+	/// Number of frames that started after their deadline because the previous frame took too long.
+	u64 missed;
+
+	/// Number of times the pacer fell too far behind and started over.
+	u64 resyncs;
+
+	f64 jitter_min;
+	f64 jitter_max;
+	f64 jitter_mean;
+	f64 jitter_stddev;
+
+	/// Current spin margin.
+	f64 spin;
+} StFramePacerStats;
+
+/**
+ * Initializes a frame pacer.
+ * @param pPacer Pointer to a frame pacer.
+ */
+void stFramePacerInit(StFramePacer *pPacer);
+
+/**
+ * Waits for the next frame deadline.
+ * @param pPacer Pointer to a frame pacer.
+ * @param period Time between frames.
+ * @return How late the frame started compared to its deadline.
+ * @note Deadlines are advanced by exactly period every frame, so sleep error never accumulates.
+ */
+f64 stFramePacerWait(StFramePacer *pPacer, const f64 period);
+
+/**
+ * Gets jitter statistics for a frame pacer.
+ * @param pPacer Pointer to a frame pacer.
+ * @return The statistics.
+ */
+StFramePacerStats stFramePacerGetStats(const StFramePacer *pPacer);
+
+/**
+ * Resets the jitter statistics of a frame pacer.
+ * @param pPacer Pointer to a frame pacer.
+ */
+void stFramePacerResetStats(StFramePacer *pPacer);
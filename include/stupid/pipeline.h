@@ -0,0 +1,206 @@
+/// @file pipeline.h
+/// @brief Pipelined rendering.
+/// The simulation fills a frame snapshot (camera, transform changes, and objects to draw), and hands it off
+/// to a render thread at a sync point, then starts on the next tick while the render thread records and submits
+/// the frame. There are two snapshots, so the simulation never writes to the one being rendered.
+/// @author nonexistant
+
+#pragma once
+
+#include "stupid/common.h"
+#include "stupid/render/render_types.h"
+
+#include <pthread.h>
+
+/// Most transform changes a snapshot can hold.
+#define ST_PIPELINE_MAX_UPDATES STUPID_RENDERER_MAX_OBJECTS
+
+/// Most objects a snapshot can draw.
+#define ST_PIPELINE_MAX_DRAWS STUPID_RENDERER_MAX_OBJECTS
+
+/// Parts of an object transform.
+typedef enum st_transform_slot {
+	ST_TRANSFORM_SLOT_TRANSLATION,
+	ST_TRANSFORM_SLOT_ROTATION,
+	ST_TRANSFORM_SLOT_SCALE,
+} st_transform_slot;
+
+/// A change to an object transform.
+typedef struct StTransformUpdate {
+	/// Index in the renderer transformation buffer.
+	usize index;
+
+	/// Part of the transform to change.
+	st_transform_slot slot;
+
+	/// New value.
+	union {
+		/// New translation or scale.
+		StVec3 vec;
+
+		/// New rotation.
+		StQuat quat;
+	};
+} StTransformUpdate;
+
+/// Everything the renderer needs from the simulation to render a frame.
+typedef struct StFrameSnapshot {
+	/// Camera to render from.
+	StCamera camera;
+
+	/// How far the simulation was between ticks (see stEngineGetTickAlpha()).
+	f64 tick_alpha;
+
+	/// Number of ticks the simulation had run.
+	u64 tick;
+
+	/// Number of transform changes.
+	u32 update_count;
+
+	/// Number of objects to draw.
+	u32 draw_count;
+
+	/// Transform changes in the order they were made.
+	StTransformUpdate updates[ST_PIPELINE_MAX_UPDATES];
+
+	/// Objects to draw.
+	StObject draws[ST_PIPELINE_MAX_DRAWS];
+} StFrameSnapshot;
+
+/**
+ * Function that renders a snapshot.
+ * @param pUser User pointer passed to stFramePipelineCreate().
+ * @param pSnapshot The snapshot.
+ * @return True if successful.
+ */
+typedef bool (*StPFN_pipeline_render)(void *pUser, StFrameSnapshot *pSnapshot);
+
+/// Hands snapshots from the simulation to the renderer.
+/// @see stFramePipelineCreate
+typedef struct StFramePipeline {
+	/// The snapshot being filled by the simulation, and the one being rendered.
+	StFrameSnapshot *pSnapshots[2];
+
+	/// Index of the snapshot the simulation is filling.
+	u32 write;
+
+	/// Renders a snapshot.
+	StPFN_pipeline_render render;
+
+	/// Passed to render.
+	void *pUser;
+
+	/// Render thread (only used if threaded is set).
+	pthread_t thread;
+
+	/// Protects pending, running, and failed.
+	pthread_mutex_t lock;
+
+	/// Signaled when a snapshot is submitted, or finished rendering.
+	pthread_cond_t cond;
+
+	/// If a snapshot has been submitted and hasnt finished rendering.
+	bool pending;
+
+	/// If the render thread should keep running.
+	bool running;
+
+	/// If rendering a snapshot failed.
+	bool failed;
+
+	/// If snapshots are rendered on a separate thread (otherwise they are rendered by stFramePipelineSubmit()).
+	bool threaded;
+
+	/// Total time the simulation spent waiting for the render thread.
+	f64 wait_time;
+
+	/// Number of snapshots submitted.
+	u64 submitted;
+} StFramePipeline;
+
+/**
+ * Creates a frame pipeline.
+ * @param threaded True to render on a separate thread, false to render in stFramePipelineSubmit().
+ * @param render Function that renders a snapshot.
+ * @param pUser Passed to render.
+ * @param camera Starting camera.
+ * @return Pointer to the pipeline (NULL if the render thread couldnt be created).
+ * @see stFramePipelineDestroy
+ */
+StFramePipeline *stFramePipelineCreate(const bool threaded, StPFN_pipeline_render render, void *pUser, const StCamera camera);
+
+/**
+ * Waits for the last snapshot to finish rendering, and destroys a frame pipeline.
+ * @param pPipeline Pointer to a pipeline.
+ */
+void stFramePipelineDestroy(StFramePipeline *pPipeline);
+
+/**
+ * Gets the snapshot the simulation should fill.
+ * @param pPipeline Pointer to a pipeline.
+ * @return Pointer to the snapshot (valid until the next stFramePipelineSubmit()).
+ */
+static STUPID_INLINE StFrameSnapshot *stFramePipelineGetSnapshot(StFramePipeline *pPipeline)
+{
+	return pPipeline->pSnapshots[pPipeline->write];
+}
+
+/**
+ * @brief Hands the current snapshot to the renderer.
+ * Waits for the previous snapshot to finish rendering first, so the simulation is at most one frame ahead.
+ * The camera carries over to the next snapshot, but transform changes and draws dont.
+ * @param pPipeline Pointer to a pipeline.
+ * @return False if rendering the previous snapshot failed (or this one if the pipeline isnt threaded).
+ */
+bool stFramePipelineSubmit(StFramePipeline *pPipeline);
+
+/**
+ * Waits for the last submitted snapshot to finish rendering.
+ * @param pPipeline Pointer to a pipeline.
+ * @return False if rendering it failed.
+ * @note Call this before using the renderer directly from the simulation thread.
+ */
+bool stFramePipelineFlush(StFramePipeline *pPipeline);
+
+/**
+ * Changes the translation of an object in a snapshot.
+ * @param pSnapshot Pointer to a snapshot.
+ * @param pObject The object.
+ * @param translation New translation.
+ * @return False if the snapshot is full.
+ */
+bool stFrameSnapshotSetTranslation(StFrameSnapshot *pSnapshot, const StObject *pObject, const StVec3 translation);
+
+/**
+ * Changes the rotation of an object in a snapshot.
+ * @param pSnapshot Pointer to a snapshot.
+ * @param pObject The object.
+ * @param rotation New rotation (normalized, see stQuatFromAxisAngle() and stQuatFromEuler()).
+ * @return False if the snapshot is full.
+ */
+bool stFrameSnapshotSetRotation(StFrameSnapshot *pSnapshot, const StObject *pObject, const StQuat rotation);
+
+/**
+ * Changes the scale of an object in a snapshot.
+ * @param pSnapshot Pointer to a snapshot.
+ * @param pObject The object.
+ * @param scale New scale.
+ * @return False if the snapshot is full.
+ */
+bool stFrameSnapshotSetScale(StFrameSnapshot *pSnapshot, const StObject *pObject, const StVec3 scale);
+
+/**
+ * Adds objects to draw to a snapshot.
+ * @param pSnapshot Pointer to a snapshot.
+ * @param count Number of objects.
+ * @param pObjects The objects.
+ * @return False if they didnt all fit.
+ */
+bool stFrameSnapshotDraw(StFrameSnapshot *pSnapshot, const u32 count, const StObject *pObjects);
+
+/**
+ * Copies the camera and transform changes from a snapshot to a renderer.
+ * @param pSnapshot Pointer to a snapshot.
+ * @param pRenderer Pointer to a renderer.
+ */
+void stFrameSnapshotApply(const StFrameSnapshot *pSnapshot, StRenderer *pRenderer);
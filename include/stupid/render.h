@@ -10,12 +10,13 @@
 /**
  * Initializes a renderer backend.
  * @param backend Which backend to initialize.
+ * @param headless True if the backend will only be used by headless renderers (see stRendererCreateHeadless()).
  * @return The requested renderer backend.
  * @note Dont create more than one vulkan backend instance.
  * @note At the moment, only vulkan is available.
  * @see stRendererBackendShutdown
  */
-void *stRendererBackendInitialize(const st_renderer_backend backend);
+void *stRendererBackendInitialize(const st_renderer_backend backend, const bool headless);
 
 /**
  * Shuts down a renderer backend.
@@ -32,6 +33,17 @@ void stRendererBackendShutdown(void *pBackend);
  */
 StRenderer *stRendererCreate(void *pBackend, StWindow *pWindow);
 
+/**
+ * @brief Creates a renderer instance that renders to offscreen images instead of a window.
+ * No window or swapchain is needed, so this works without a display (like on lavapipe in a CI container).
+ * @param pBackend A headless backend created with stRendererInitializeBackend()
+ * @param width Width to render at.
+ * @param height Height to render at.
+ * @return A new renderer instance which must be destroyed with stRendererDestroy().
+ * @see stRendererCreate, stRendererDestroy
+ */
+StRenderer *stRendererCreateHeadless(void *pBackend, const u32 width, const u32 height);
+
 /**
  * Destroys a renderer instance.
  * @param pRenderer Pointer to a renderer instance created with stRendererCreate().
@@ -107,6 +119,7 @@ void stRendererFlushMap(StRenderer *pRenderer, StRendererBuffer *pBuffer);
  * @param width New width.
  * @param height New height.
  * @return True if successful.
+ * @note This has to be called from the thread that renders, window resize events are applied by stRendererPrepareFrame().
  * @see Renderer
  */
 bool stRendererResize(StRenderer *pRenderer, const i32 width, const i32 height);
@@ -115,6 +128,8 @@ bool stRendererResize(StRenderer *pRenderer, const i32 width, const i32 height);
  * Prepares the next frame.
  * @param pRenderer Pointer to a renderer instance created with stRendererCreate().
  * @param delta_time Time since the last frame.
+ * @return False if the frame cant be rendered (a failed resize is tried again next frame).
+ * @note Applies window resizes and stRendererSetVsync() calls made since the last frame.
  * @see stRendererStartFrame
  */
 bool stRendererPrepareFrame(StRenderer *pRenderer, f32 delta_time);
@@ -168,9 +183,17 @@ bool stRendererClear(StRenderer *pRenderer);
  * Enables or disables vsync for a renderer instance.
  * @param pRenderer Pointer to a renderer instance created with stRendererCreate().
  * @param state True to enable vsync, false to disable it.
+ * @note This can be called from any thread, the change is applied by the next stRendererPrepareFrame().
  */
 void stRendererSetVsync(StRenderer *pRenderer, const bool state);
 
+/**
+ * Gets the vsync state of a renderer instance.
+ * @param pRenderer Pointer to a renderer instance created with stRendererCreate().
+ * @return True if vsync is enabled (or will be by the next frame).
+ */
+bool stRendererGetVsync(StRenderer *pRenderer);
+
 /**
  * Gets a pointer to the renderers internal variables (such as width height and vsync).
  * @param pRenderer Pointer to a renderer instance created with stRendererCreate().
@@ -189,6 +212,16 @@ StRendererValues *stRendererGetRendererValues(StRenderer *pRenderer);
  */
 bool stRendererLoadObject(StRenderer *pRenderer, const char *path, StObject *pObject);
 
+/**
+ * Creates another instance of a loaded object (drawn with the same geometry, but with its own transform).
+ * @param pRenderer Pointer to a renderer instance created with stRendererCreate().
+ * @param pObject Object loaded with stRendererLoadObject().
+ * @param pInstance Output StObject.
+ * @return False if there are already STUPID_RENDERER_MAX_OBJECTS objects.
+ * @note Instances dont need to be unloaded (only the object they came from does).
+ */
+bool stRendererInstanceObject(StRenderer *pRenderer, const StObject *pObject, StObject *pInstance);
+
 /**
  * Unloads an OBJ file.
  * @param pRenderer Pointer to a renderer instance created with stRendererCreate().
@@ -199,10 +232,12 @@ bool stRendererLoadObject(StRenderer *pRenderer, const char *path, StObject *pOb
 void stRendererUnloadObject(StRenderer *pRenderer, StObject *pObject);
 
 /**
- * Draws an object to the screen.
+ * Draws objects to the screen.
  * @param pRenderer Pointer to a renderer instance created with stRendererCreate().
- * @param pObject Object to draw.
+ * @param count Number of objects (at most STUPID_RENDERER_MAX_OBJECTS).
+ * @param pObjects Objects to draw.
  * @return True if successful.
+ * @note All the objects are drawn with a single indirect draw, so the cost of recording them doesnt depend on how many there are.
  * @see stRendererLoadObject.
  */
 bool stRendererDrawObjects(StRenderer *pRenderer, const usize count, StObject *pObjects);
@@ -227,8 +262,9 @@ static STUPID_INLINE StCamera stRendererCameraCreate(const StVec3 position, cons
 
 	StVec3 d = stVec3Normalize(stVec3Sub(camera.target, camera.pos));
 
-	camera.yaw   = stAtan2(d.y, d.x);
-	camera.pitch = stAtan2(d.z, stSqrt(d.x * d.x + d.y * d.y));
+	// the inverse of the direction stRendererCameraRotate() builds from yaw and pitch
+	camera.yaw   = stAtan2(-d.x, -d.z);
+	camera.pitch = stAtan2(d.y, stSqrt(d.x * d.x + d.z * d.z));
 	camera.roll  = 0.0;
 
 	StVec3 world_up = STVEC3(0.0, -1.0, 0.0);
@@ -303,21 +339,21 @@ static STUPID_INLINE StCamera stRendererCameraMoveRelative(StCamera camera, StVe
 static STUPID_INLINE void stRendererSetObjectTranslation(StRenderer *pRenderer, StObject *pObject, StVec3 position)
 {
 	STUPID_NC(pRenderer->transformations.map);
-	StVec3 *map = pRenderer->transformations.map;
-	map[pObject->transformation_index * 3] = position;
+	StTransform *map = pRenderer->transformations.map;
+	map[pObject->transformation_index].translation = position;
 }
 
-static STUPID_INLINE void stRendererSetObjectRotation(StRenderer *pRenderer, StObject *pObject, StVec3 rotation)
+static STUPID_INLINE void stRendererSetObjectRotation(StRenderer *pRenderer, StObject *pObject, StQuat rotation)
 {
 	STUPID_NC(pRenderer->transformations.map);
-	StVec3 *map = pRenderer->transformations.map;
-	map[pObject->transformation_index * 3 + 1] = rotation;
+	StTransform *map = pRenderer->transformations.map;
+	map[pObject->transformation_index].rotation = rotation;
 }
 
 static STUPID_INLINE void stRendererSetObjectScale(StRenderer *pRenderer, StObject *pObject, StVec3 scale)
 {
 	STUPID_NC(pRenderer->transformations.map);
-	StVec3 *map = pRenderer->transformations.map;
-	map[pObject->transformation_index * 3 + 2] = scale;
+	StTransform *map = pRenderer->transformations.map;
+	map[pObject->transformation_index].scale = scale;
 }
 
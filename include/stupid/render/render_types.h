@@ -1,14 +1,24 @@
 #pragma once
 
 #include "stupid/common.h"
+#include "stupid/assert.h"
 #include "stupid/thread.h"
 #include "stupid/window.h"
+#include "stupid/event.h"
 #include "stupid/math/linear.h"
+#include "stupid/math/quat.h"
+#include "stupid/math/bounds.h"
 
-#define STUPID_RENDERER_MAX_OBJECTS (64 * 64)
+#define STUPID_RENDERER_MAX_OBJECTS (128 * 128)
 #define STUPID_RENDERER_OBJECT_POSITION_BUFFER_SIZE (256 * 1024 * 1024)
 #define STUPID_RENDERER_OBJECT_INDEX_BUFFER_SIZE (256 * 1024 * 1024)
 
+/// Most frames that can be recorded at once (one per swapchain image), each has its own indirect draws.
+#define STUPID_RENDERER_MAX_FRAMES_IN_FLIGHT 4
+
+/// Most stRendererDrawObjects() calls in a frame (each one gets its own visible object counter).
+#define STUPID_RENDERER_MAX_DRAW_CALLS 64
+
 /// Color values.
 typedef struct StColor {
         /// Red.
@@ -69,6 +79,19 @@ typedef struct StRendererBuffer {
 	void *map;
 } StRendererBuffer;
 
+/// @brief Where an object is, how its rotated, and how big it is.
+/// This is exactly how transforms are laid out in the renderer transformation buffer (and in the compute shader).
+typedef struct StTransform {
+	StVec3 translation;
+
+	/// Rotation (normalized).
+	StQuat rotation;
+
+	StVec3 scale;
+} StTransform;
+
+STUPID_STATIC_ASSERT(sizeof(StTransform) == 10 * sizeof(f32), "StTransform has padding the compute shader doesnt");
+
 /// 3D Object.
 typedef struct StObject {
 	usize position_offset;
@@ -76,8 +99,75 @@ typedef struct StObject {
 	usize index_offset;
 	usize index_count;
 	usize transformation_index;
+
+	/// Sphere around the object before its transformed (used for culling).
+	StSphere bounds;
 } StObject;
 
+/// Indirect draw command (the same layout as VkDrawIndirectCommand).
+typedef struct StDrawCommand {
+	u32 vertex_count;
+	u32 instance_count;
+	u32 first_vertex;
+	u32 first_instance;
+} StDrawCommand;
+
+/// @brief What the vertex shader needs to know about an indirect draw.
+/// There is one of these for every StDrawCommand, and the shader finds it with gl_DrawID.
+typedef struct StDrawData {
+	/// Device address of the object positions.
+	u64 positions;
+
+	/// Device address of the object indices.
+	u64 indices;
+
+	/// Index of the object model matrix (the same as its transformation index).
+	u32 model;
+
+	u32 pad;
+} StDrawData;
+
+STUPID_STATIC_ASSERT(sizeof(StDrawData) == 24, "StDrawData has padding the vertex shader doesnt");
+
+/// @brief What the culling pass needs to know about an object.
+/// The cpu writes one of these for every object drawn, and the culling pass turns the visible ones into
+/// a StDrawCommand and a StDrawData (every object drawn in a frame is culled by the same dispatch).
+typedef struct StCullObject {
+	/// Sphere around the object before its transformed.
+	StSphere bounds;
+
+	/// Device address of the object positions.
+	u64 positions;
+
+	/// Device address of the object indices.
+	u64 indices;
+
+	/// Index of the object model matrix (the same as its transformation index).
+	u32 model;
+
+	/// Number of vertices to draw.
+	u32 index_count;
+
+	/// Which draw call this frame the object is from (the index of its visible object counter).
+	u32 draw_call;
+
+	/// Index of the first draw command of that draw call this frame.
+	u32 first;
+} StCullObject;
+
+STUPID_STATIC_ASSERT(sizeof(StCullObject) == 48, "StCullObject has padding the culling shader doesnt");
+
+/// @brief Size of the culling dispatch of a frame.
+/// The start is a VkDispatchIndirectCommand, so the objects drawn during the frame can be culled
+/// by a dispatch recorded before rendering starts.
+typedef struct StCullDispatch {
+	/// Number of workgroups.
+	u32 x, y, z;
+
+	/// Number of objects to cull.
+	u32 object_count;
+} StCullDispatch;
+
 /// Possible states of a StRenderer.
 /// @see StRenderer
 typedef enum st_renderer_state {
@@ -136,7 +226,10 @@ typedef enum st_renderer_buffer_flags {
 	ST_RENDERER_BUFFER_USAGE_CPU_ACCESS_FAST = 1 << 5,
 
         /// Allows the buffer to be the source of memory transfers.
-	ST_RENDERER_BUFFER_USAGE_TRANSFER_SOURCE = 1 << 6
+	ST_RENDERER_BUFFER_USAGE_TRANSFER_SOURCE = 1 << 6,
+
+	/// Allows the buffer to hold indirect draw commands.
+	ST_RENDERER_BUFFER_USAGE_INDIRECT = 1 << 7
 } st_renderer_buffer_flags;
 
 /// VRAM buffer types.
@@ -183,12 +276,14 @@ typedef enum st_renderer_buffer_type {
 /**
  * Initializes a renderer instance.
  * @param pBackend Pointer to a renderer backend.
- * @param pWindow Window to render to.
+ * @param pWindow Window to render to (NULL to render offscreen).
+ * @param width Width to render at offscreen (only used if pWindow is NULL).
+ * @param height Height to render at offscreen (only used if pWindow is NULL).
  * @return A renderer instance.
  * @note A renderer instance relies on a renderer backend, and must be destroyed before the backend.
  * @see StRenderer
  */
-typedef void *(*StPFN_renderer_init)(void *pBackend, StWindow *pWindow);
+typedef void *(*StPFN_renderer_init)(void *pBackend, StWindow *pWindow, const u32 width, const u32 height);
 
 /**
  * Destroys a renderer instance.
@@ -278,24 +373,47 @@ typedef void (*StPFN_renderer_draw_rect)(void *pContext, const u32 x, const u32
 typedef void (*StPFN_renderer_set_vsync)(void *pContext, const bool state);
 
 /**
- * Enables or disables vsync for a renderer instance.
+ * Culls objects against the camera frustum, and draws the visible ones with one indirect draw.
  * @param pContext Pointer to a renderer instance.
- * @param pObject The object to draw.
+ * @param view_projection View projection matrix.
+ * @param object_count Number of objects.
+ * @param pPositionBuffer Buffer the object positions are in.
+ * @param pIndexBuffer Buffer the object indices are in.
+ * @param pModelBuffer Model matrix buffer.
+ * @param pDrawCommandBuffer Buffer the culling pass writes the draw commands to (a StDrawCommand each).
+ * @param pDrawDataBuffer Buffer the culling pass writes the draw data to (a StDrawData each).
+ * @param pCullObjectBuffer Buffer to write the objects to cull to (a StCullObject each, mapped).
+ * @param pDrawCountBuffer Buffer the culling pass counts the visible objects in (a u32 for each draw call, mapped).
+ * @param pObjects The objects to draw.
+ * @note The culling happens in the pass recorded by StPFN_renderer_cull_objects, this only adds the objects to it.
  * @see StRenderer StObject
  */
-typedef void (*StPFN_renderer_draw_objects)(void *pContext, const StMat4 view_projection, const usize object_count, StRendererBuffer *pPositionBuffer, StRendererBuffer *pIndexBuffer, StRendererBuffer *pModelBuffer, StObject *pObjects);
+typedef void (*StPFN_renderer_draw_objects)(void *pContext, const StMat4 view_projection, const usize object_count, StRendererBuffer *pPositionBuffer, StRendererBuffer *pIndexBuffer, StRendererBuffer *pModelBuffer, StRendererBuffer *pDrawCommandBuffer, StRendererBuffer *pDrawDataBuffer, StRendererBuffer *pCullObjectBuffer, StRendererBuffer *pDrawCountBuffer, StObject *pObjects);
 
 /**
  * Prepares the model matrices for the current frame.
  * @param pContext Pointer to a renderer instance.
  * @param model_count Number of model matrices to prepare.
  * @param pModelBuffer Output model matrix buffer.
- * @param pTransformationBuffer Properties for each object (StVec3 location, StVec3 rotation, StVec3 scale).
+ * @param pTransformationBuffer Properties for each object (a StTransform each).
  * @note Optimally, this is done with a compute shader.
  * @see StRenderer StObject StMat4
  */
 typedef void (*StPFN_renderer_prepare_model_matrices)(void *pContext, const usize model_count, StRendererBuffer *pModelBuffer, StRendererBuffer *pTransformationBuffer);
 
+/**
+ * Records the culling pass for every object drawn in the current frame (before rendering starts).
+ * @param pContext Pointer to a renderer instance.
+ * @param view_projection View projection matrix (the frustum is made from this).
+ * @param pModelBuffer Model matrix buffer.
+ * @param pDrawCommandBuffer Buffer the culling pass writes the draw commands to.
+ * @param pDrawDataBuffer Buffer the culling pass writes the draw data to.
+ * @param pCullObjectBuffer Buffer the objects to cull are written to as theyre drawn.
+ * @param pDrawCountBuffer Buffer with the visible object counters and the StCullDispatch of each frame (mapped).
+ * @see StPFN_renderer_draw_objects
+ */
+typedef void (*StPFN_renderer_cull_objects)(void *pContext, const StMat4 view_projection, StRendererBuffer *pModelBuffer, StRendererBuffer *pDrawCommandBuffer, StRendererBuffer *pDrawDataBuffer, StRendererBuffer *pCullObjectBuffer, StRendererBuffer *pDrawCountBuffer);
+
 /// Variables found in all renderer backends.
 typedef struct StRendererValues {
 	/// Renderer camera.
@@ -360,11 +478,27 @@ typedef struct StRenderer {
         /// Model matrix prepare function.
         StPFN_renderer_prepare_model_matrices PFNPrepareModelMatrices;
 
+	/// Culling pass function.
+	StPFN_renderer_cull_objects PFNCullObjects;
+
 	StRendererBuffer positions;
 	StRendererBuffer indices;
 	StRendererBuffer models;
 	StRendererBuffer transformations;
 
+	/// Indirect draw commands of the visible objects (STUPID_RENDERER_MAX_OBJECTS for each frame in flight).
+	StRendererBuffer draw_commands;
+
+	/// Data for each indirect draw command.
+	StRendererBuffer draw_data;
+
+	/// Objects to cull (a StCullObject for each one drawn, laid out like draw_commands).
+	StRendererBuffer cull_objects;
+
+	/// @brief Number of visible objects for each draw call (STUPID_RENDERER_MAX_DRAW_CALLS u32s for each frame in flight),
+	/// followed by a StCullDispatch for each frame in flight.
+	StRendererBuffer draw_counts;
+
 	usize position_count;
 
 	usize positions_end;
@@ -385,7 +519,20 @@ typedef struct StRenderer {
         /// Current state.
         st_renderer_state state;
 
+	/// Camera matrix for the current frame (made by stRendererPrepareFrame(), and used to cull and draw every object).
 	StMat4 view_projection;
+
+	/// Handle for the window resize callback.
+	StEventHandle resize_event;
+
+	/// Set when theres a resize or vsync change waiting for the next stRendererPrepareFrame() (protected by lock).
+	bool resize_pending, vsync_pending;
+
+	/// Size from the last window resize event.
+	i32 pending_width, pending_height;
+
+	/// Vsync state from the last stRendererSetVsync() call.
+	bool pending_vsync;
 } StRenderer;
 
 /// Information for a frame.
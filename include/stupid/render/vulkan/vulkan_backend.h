@@ -4,10 +4,12 @@
 
 /**
  * @brief Initializes the vulkan rendering backend.
+ * @param headless True to skip the window surface and swapchain extensions, and present queue
+ * (so it works without a display, like on lavapipe in a container).
  * @note Dont create more than one vulkan backend.
  * @return A new vulkan backend if successful, NULL otherwise.
  */
-StRendererVulkanBackend *stRendererVulkanBackendInit(void);
+StRendererVulkanBackend *stRendererVulkanBackendInit(const bool headless);
 
 /**
  * kills the vulkan rendering backend
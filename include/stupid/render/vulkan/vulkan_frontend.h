@@ -7,10 +7,13 @@
 /**
  * Shuts down a vulkan frontend instnace.
  * @param pBackend Pointer to a vulkan backend.
- * @param pWindow Pointer to a window this vulkan frontend instance will be bound to.
+ * @param pWindow Pointer to a window this vulkan frontend instance will be bound to (NULL to render to offscreen images).
+ * @param offscreen_width Width of the offscreen images (only used if pWindow is NULL).
+ * @param offscreen_height Height of the offscreen images (only used if pWindow is NULL).
  * @return A new vulkan frontend instance.
+ * @note Rendering without a window requires a headless backend (see stRendererVulkanBackendInit()).
  */
-StRendererVulkanContext *stRendererVulkanFrontendInit(StRendererVulkanBackend *pBackend, StWindow *pWindow);
+StRendererVulkanContext *stRendererVulkanFrontendInit(StRendererVulkanBackend *pBackend, StWindow *pWindow, const u32 offscreen_width, const u32 offscreen_height);
 
 /**
  * Shuts down a vulkan frontend instnace.
@@ -96,11 +99,31 @@ void stRendererVulkanFrontendSetVsync(StRendererVulkanContext *pContext, const b
 void stRendererVulkanFrontendPrepareModelMatrices(StRendererVulkanContext *pContext, usize model_count, StRendererBuffer *pModelBuffer, StRendererBuffer *pTransformationBuffer);
 
 /**
- * Draws an object.
+ * Records one culling pass for every object drawn this frame (the dispatch size is filled in as objects are drawn).
  * @param pContext Pointer to a vulkan renderer instance.
- * @param pObject Object to draw.
- * @param mvp Model-view-projection matrix.
- * @param rotation Rotation and translation to apply to the object.
+ * @param view_projection View projection matrix (the frustum is made from this).
+ * @param pModelBuffer Buffer with the model and normal matrices of every object.
+ * @param pDrawCommandBuffer Buffer the culling pass writes the draw commands to.
+ * @param pDrawDataBuffer Buffer the culling pass writes the per draw data to.
+ * @param pCullObjectBuffer Mapped buffer the objects to cull are written to.
+ * @param pDrawCountBuffer Mapped buffer with the visible object counters and the dispatch size.
+ * @note This has to be recorded after the model matrices and before rendering starts.
  */
-void stRendererVulkanFrontendDrawObjects(StRendererVulkanContext *pContext, const StMat4 view_projection, const usize object_count, StRendererBuffer *pPositionBuffer, StRendererBuffer *pIndexBuffer, StRendererBuffer *pModelBuffer, StObject *pObjects);
+void stRendererVulkanFrontendCullObjects(StRendererVulkanContext *pContext, const StMat4 view_projection, StRendererBuffer *pModelBuffer, StRendererBuffer *pDrawCommandBuffer, StRendererBuffer *pDrawDataBuffer, StRendererBuffer *pCullObjectBuffer, StRendererBuffer *pDrawCountBuffer);
+
+/**
+ * Adds objects to the culling pass of this frame, and draws the visible ones with a single indirect draw.
+ * @param pContext Pointer to a vulkan renderer instance.
+ * @param view_projection View projection matrix.
+ * @param object_count Number of objects (at most STUPID_RENDERER_MAX_OBJECTS).
+ * @param pPositionBuffer Buffer with the vertex positions of every object.
+ * @param pIndexBuffer Buffer with the indices of every object.
+ * @param pModelBuffer Buffer with the model and normal matrices of every object.
+ * @param pDrawCommandBuffer Buffer the culling pass writes the draw commands to.
+ * @param pDrawDataBuffer Buffer the culling pass writes the per draw data to.
+ * @param pCullObjectBuffer Mapped buffer the objects to cull are written to.
+ * @param pDrawCountBuffer Mapped buffer the culling pass counts the visible objects in.
+ * @param pObjects Objects to draw.
+ */
+void stRendererVulkanFrontendDrawObjects(StRendererVulkanContext *pContext, const StMat4 view_projection, const usize object_count, StRendererBuffer *pPositionBuffer, StRendererBuffer *pIndexBuffer, StRendererBuffer *pModelBuffer, StRendererBuffer *pDrawCommandBuffer, StRendererBuffer *pDrawDataBuffer, StRendererBuffer *pCullObjectBuffer, StRendererBuffer *pDrawCountBuffer, StObject *pObjects);
 
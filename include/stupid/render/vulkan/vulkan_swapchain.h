@@ -3,6 +3,9 @@
 #include "stupid/common.h"
 #include "stupid/render/vulkan/vulkan_types.h"
 
+/// Number of images used in place of a swapchain when rendering offscreen.
+#define ST_RENDERER_VULKAN_OFFSCREEN_IMAGE_COUNT 3
+
 /**
  * Creates a vulkan swapchain.
  * @param pBackend Pointer to a vulkan renderer backend.
@@ -13,6 +16,17 @@
  */
 bool stRendererVulkanSwapchainCreate(StRendererVulkanBackend *pBackend, VkSurfaceKHR surface, VkPresentModeKHR mode, const u32 width, const u32 height, StRendererVulkanSwapchain *pSwapchain);
 
+/**
+ * @brief Creates offscreen images in place of a swapchain (for headless rendering).
+ * The images are used in order, and never presented.
+ * @param pBackend Pointer to a vulkan renderer backend.
+ * @param width Width of the images.
+ * @param height Height of the images.
+ * @param pSwapchain Output swapchain.
+ * @return True if successful.
+ */
+bool stRendererVulkanSwapchainCreateOffscreen(StRendererVulkanBackend *pBackend, const u32 width, const u32 height, StRendererVulkanSwapchain *pSwapchain);
+
 /**
  * Destroys a vulkan swapchain.
  * @param pBackend Pointer to a vulkan renderer backend.
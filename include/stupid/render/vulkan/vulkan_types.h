@@ -138,6 +138,10 @@ typedef struct StRendererVulkanSwapchain {
 	/// whether the swapchain is currently being recreated
 	STUPID_ATOMIC bool is_recreating;
 
+	/// @brief Whether the images are offscreen instead of from a window surface (headless rendering).
+	/// Offscreen images are never presented, and are left in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL so they can be read back.
+	bool offscreen;
+
 	/// number of vulkan images to buffer when drawing (i.e. 2 would be double buffering)
 	u32 image_count;
 
@@ -324,6 +328,9 @@ typedef struct StRendererVulkanBackend {
 	/// Required vulkan device extensions.
 	const char **required_device_extensions;
 
+	/// Whether the backend was created without window surface support (see stRendererVulkanBackendInit()).
+	bool headless;
+
 #ifdef _DEBUG
 	/// vulkan validation layer logger.
 	/// @note Debug only.
@@ -415,6 +422,9 @@ typedef struct STUPID_A32 StRendererVulkanContext {
 	/// @note Used to run compute shaders.
 	StRendererVulkanPipeline compute_pipeline;
 
+	/// Culls objects against the camera frustum (before they are drawn).
+	StRendererVulkanPipeline cull_pipeline;
+
 	/// @brief These are used to wait for a CPU resource to be released.
 	/// These are used specifically for CPU to GPU operations.
 	/// @note There should be swapchain.image_count of these.
@@ -458,6 +468,12 @@ typedef struct STUPID_A32 StRendererVulkanContext {
 	/// @see image_index
 	u32 current_frame;
 
+	/// Number of objects drawn so far this frame (each draw writes its commands after the last ones).
+	usize draw_count;
+
+	/// Number of stRendererVulkanFrontendDrawObjects() calls so far this frame (each has its own visible object counter).
+	u32 draw_call_count;
+
 	/// whether the swapchain is currently being recreated or not
 	bool recreating_swapchain;
 
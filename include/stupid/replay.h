@@ -0,0 +1,140 @@
+/// @file replay.h
+/// @brief Input recording and playback.
+/// Records the events fired by stWindowPoll() along with the tick they happened on,
+/// so the same input can be played back later with a fixed timestep.
+/// @author nonexistant
+
+#pragma once
+
+#include "stupid/common.h"
+#include "stupid/event.h"
+#include "stupid/window.h"
+
+#include <stdio.h>
+
+/// First 4 bytes of a replay file.
+#define STUPID_REPLAY_MAGIC "STRP"
+
+/// @brief Version of the replay file format.
+/// Bump this whenever the layout of the header or the records changes.
+#define STUPID_REPLAY_VERSION 1
+
+/// @brief Size of the header in a replay file.
+/// magic (4 bytes), version (u16), tps (u16), record_size (u32).
+#define STUPID_REPLAY_HEADER_SIZE 12
+
+/// @brief Size of a record in a replay file (written by this version).
+/// tick (u32), code (u16), reserved (u16), data (4 x u32).
+#define STUPID_REPLAY_RECORD_SIZE 24
+
+/// What a replay is currently doing.
+/// @see StReplay
+typedef enum st_replay_mode {
+	/// Not recording or playing.
+	ST_REPLAY_MODE_NONE,
+
+	/// Writing events to a file.
+	ST_REPLAY_MODE_RECORD,
+
+	/// Reading events from a file.
+	ST_REPLAY_MODE_PLAY,
+} st_replay_mode;
+
+/// @brief Start of a replay file.
+/// Written field by field in little endian (STUPID_REPLAY_HEADER_SIZE bytes), not as the struct itself.
+typedef struct StReplayHeader {
+	/// Always STUPID_REPLAY_MAGIC.
+	char magic[4];
+
+	/// Always STUPID_REPLAY_VERSION.
+	u16 version;
+
+	/// Ticks per second the input was recorded at.
+	u16 tps;
+
+	/// Size of each record in the file (at least STUPID_REPLAY_RECORD_SIZE, anything after that is skipped).
+	u32 record_size;
+} StReplayHeader;
+
+/// @brief A single recorded event.
+/// Written field by field in little endian (STUPID_REPLAY_RECORD_SIZE bytes), not as the struct itself.
+typedef struct StReplayRecord {
+	/// Tick the event was fired on.
+	u32 tick;
+
+	/// Event code.
+	u16 code;
+
+	u16 reserved;
+
+	/// @brief Event data.
+	/// Only data.array.u32 is stored (every recorded event only uses 32 bit fields).
+	StEventData data;
+} StReplayRecord;
+
+/// Input recorder/player.
+/// @see stReplayRecord, stReplayPlay
+typedef struct StReplay {
+	/// Replay file.
+	FILE *file;
+
+	/// Window events are recorded from or played back to.
+	StWindow *pWindow;
+
+	/// @brief Current tick.
+	/// Read when recording, and used to decide which events to play back when playing.
+	const u64 *pTick;
+
+	/// Callbacks used to record events.
+	StEventHandle handles[8];
+
+	/// Next record to be played back.
+	StReplayRecord next;
+
+	/// If next has been read and not played yet.
+	bool has_next;
+
+	/// Number of events recorded or played back.
+	u64 count;
+
+	/// Ticks per second the input was recorded at.
+	u16 tps;
+
+	/// Size of each record in the file.
+	u32 record_size;
+
+	/// What the replay is doing.
+	st_replay_mode mode;
+} StReplay;
+
+/**
+ * Starts recording all input events fired by a window.
+ * @param pWindow Pointer to a window created with stWindowCreate().
+ * @param path Path of the file to record to.
+ * @param tps Ticks per second of the engine.
+ * @param pTick Pointer to the current tick.
+ * @return A new replay which must be stopped with stReplayStop(), or NULL on failure.
+ */
+StReplay *stReplayRecord(StWindow *pWindow, const char *path, const u16 tps, const u64 *pTick);
+
+/**
+ * Opens a file recorded with stReplayRecord() for playback.
+ * @param pWindow Pointer to a window created with stWindowCreate().
+ * @param path Path of the recorded file.
+ * @param pTick Pointer to the current tick.
+ * @return A new replay which must be stopped with stReplayStop(), or NULL on failure.
+ */
+StReplay *stReplayPlay(StWindow *pWindow, const char *path, const u64 *pTick);
+
+/**
+ * Fires every recorded event up to and including the current tick.
+ * @param pReplay Pointer to a replay created with stReplayPlay().
+ * @return False once every recorded event has been played back.
+ */
+bool stReplayUpdate(StReplay *pReplay);
+
+/**
+ * Stops recording or playback, and closes the file.
+ * @param pReplay Pointer to a replay created with stReplayRecord() or stReplayPlay().
+ */
+void stReplayStop(StReplay *pReplay);
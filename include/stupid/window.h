@@ -180,6 +180,11 @@ typedef struct StWindow {
 
 	/// Whether the cursor is captured.
 	bool captured;
+
+	/// @brief State of each key.
+	/// Updated from the key events fired by stWindowPoll() (or stWindowSetKeyState() when replaying input),
+	/// so stWindowIsKeyPressed() always agrees with the events listeners have seen.
+	bool keys[ST_KEY_MAX];
 } StWindow;
 
 /**
@@ -251,6 +256,17 @@ bool stWindowIsFullscreen(StWindow *pWindow);
  */
 bool stWindowPoll(StWindow *pWindow);
 
+/**
+ * @brief Blocks until a window has events, or the timeout runs out.
+ * Waits on the X11 connection instead of spinning, so it uses no CPU while nothing is happening.
+ * @param pWindow Pointer to a window created with stWindowCreate().
+ * @param timeout Longest time to wait in seconds.
+ * @return True if there are events to poll.
+ * @note A signal can wake this up early (in which case it returns false).
+ * @see stWindowPoll
+ */
+bool stWindowWait(StWindow *pWindow, const f64 timeout);
+
 /**
  * Gets the required vulkan instance extensions for a window.
  * @return stMemAlloc() array of required vulkan instance extensions.
@@ -331,6 +347,15 @@ void stWindowSetCaptureCursor(StWindow *pWindow, const bool state);
  */
 bool stWindowIsKeyPressed(StWindow *pWindow, st_key_id key);
 
+/**
+ * Sets the state of a key without it actually being pressed.
+ * @param pWindow Pointer to a window created with stWindowCreate().
+ * @param key Key to set the state of.
+ * @param state True if the key is pressed.
+ * @note Used to replay recorded input.
+ */
+void stWindowSetKeyState(StWindow *pWindow, st_key_id key, const bool state);
+
 /**
  * Moves the cursor to the center of the window.
  * @param pWindow Pointer to a window created with stWindowCreate().
@@ -24,10 +24,8 @@ layout(push_constant) uniform PushConstants {
 	layout(row_major) mat4 view_projection;
 	vec4 pos;
 	vec4 target;
-	Positions positions;
-	IndexBuffer indices;
+	uvec2 draws; // only used by the vertex shader
 	MatrixBuffer models;
-	uint id;
 } pc;
 
 layout(location = 0) in vec4 inColor;
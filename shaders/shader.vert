@@ -2,6 +2,7 @@
 
 #extension GL_EXT_buffer_reference : require
 #extension GL_EXT_scalar_block_layout : enable
+#extension GL_ARB_shader_draw_parameters : require
 
 struct Index {
 	uint vertex;
@@ -21,32 +22,42 @@ layout(buffer_reference, scalar, std430) readonly buffer MatrixBuffer {
 	layout(row_major) mat4 data[];
 };
 
+// one for every indirect draw (StDrawData)
+struct Draw {
+	Positions positions;
+	IndexBuffer indices;
+	uint model;
+	uint pad;
+};
+
+layout(buffer_reference, scalar, std430) readonly buffer DrawBuffer {
+	Draw data[];
+};
+
 layout(push_constant) uniform PushConstants {
 	layout(row_major) mat4 view_projection;
 	vec4 pos;
 	vec4 target;
-	Positions positions;
-	IndexBuffer indices;
+	DrawBuffer draws;
 	MatrixBuffer models;
-	uint id;
 } pc;
 
 layout(location = 0) out vec4 outColor;
 layout(location = 1) out vec3 outNormal;
 layout(location = 2) out vec3 pos;
 
-vec3 getVertex(Index index)
+vec3 getVertex(Positions positions, Index index)
 {
-    return vec3(pc.positions.v[index.vertex][0],
-	            pc.positions.v[index.vertex][1],
-	            pc.positions.v[index.vertex][2]);
+    return vec3(positions.v[index.vertex][0],
+	            positions.v[index.vertex][1],
+	            positions.v[index.vertex][2]);
 }
 
-vec3 getNormal(Index index)
+vec3 getNormal(Positions positions, Index index)
 {
-	return vec3(pc.positions.v[index.normal][0],
-	            pc.positions.v[index.normal][1],
-	            pc.positions.v[index.normal][2]);
+	return vec3(positions.v[index.normal][0],
+	            positions.v[index.normal][1],
+	            positions.v[index.normal][2]);
 }
 
 vec4 colors[] = {
@@ -57,11 +68,12 @@ vec4 colors[] = {
 
 void main(void)
 {
-	Index index = pc.indices.data[gl_VertexIndex];
+	Draw draw = pc.draws.data[gl_DrawIDARB];
+	Index index = draw.indices.data[gl_VertexIndex];
 
-	vec4 vertex = vec4(getVertex(index), 1.0);
-	vertex = pc.models.data[pc.id * 2] * vertex;
-	outNormal = normalize((pc.models.data[pc.id * 2 + 1] * vec4(getNormal(index), 1.0)).xyz);
+	vec4 vertex = vec4(getVertex(draw.positions, index), 1.0);
+	vertex = pc.models.data[draw.model * 2] * vertex;
+	outNormal = normalize((pc.models.data[draw.model * 2 + 1] * vec4(getNormal(draw.positions, index), 1.0)).xyz);
 
 	pos = vertex.xyz;
 	gl_Position = pc.view_projection * vertex;
@@ -0,0 +1,305 @@
+/// @file binlog.c
+/// @brief Binary deferred format logging.
+/// @author nonexistant
+
+#include "stupid/binlog.h"
+#include "stupid/assert.h"
+#include "stupid/clock.h"
+#include "stupid/logger.h"
+#include "stupid/memory.h"
+
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/// A string that has been copied to the string table.
+typedef struct StBinLogString {
+	/// Address of the string (0 if this entry is unused).
+	STUPID_ATOMIC uintptr_t key;
+
+	/// Offset of the string in the string table (0 while its being copied, UINT32_MAX if it didnt fit).
+	STUPID_ATOMIC u32 offset;
+} StBinLogString;
+
+STUPID_STATIC_ASSERT(STUPID_IS_POWER2(ST_BINLOG_MAX_STRINGS), "ST_BINLOG_MAX_STRINGS is not a power of 2");
+
+/// The open binary log.
+static struct {
+	/// Start of the mapped file.
+	StBinLogHeader *pHeader;
+
+	/// String table.
+	char *strings;
+
+	/// Record ring.
+	StBinLogRecord *records;
+
+	/// Size of the mapped file.
+	usize size;
+
+	/// File descriptor of the log file.
+	int fd;
+
+	/// Strings already in the string table by address, so each one is only copied once.
+	StBinLogString table[ST_BINLOG_MAX_STRINGS];
+
+	/// Number of threads currently writing a record.
+	STUPID_ATOMIC u32 writers;
+
+	/// If logs should be written to the file.
+	STUPID_ATOMIC bool open;
+} binlog = {0};
+
+/**
+ * Gets the offset of a string in the string table, and adds it if it isnt there yet.
+ * @param str The string.
+ * @return Offset of the string in the string table, or 0 if its NULL or there was no room for it.
+ */
+static u32 binLogIntern(const char *str)
+{
+	if (str == NULL) return 0;
+
+	const uintptr_t key = (uintptr_t)str;
+
+	// fibonacci hash of the address
+	u32 index = (u32)(((u64)key * 11400714819323198485llu) >> 32) & (ST_BINLOG_MAX_STRINGS - 1);
+	for (u32 i = 0; i < ST_BINLOG_MAX_STRINGS; i++, index = (index + 1) & (ST_BINLOG_MAX_STRINGS - 1)) {
+		StBinLogString *pEntry = &binlog.table[index];
+		uintptr_t current = atomic_load_explicit(&pEntry->key, memory_order_acquire);
+
+		// claim the entry and copy the string to the string table
+		if (current == 0 && atomic_compare_exchange_strong(&pEntry->key, &current, key)) {
+			u64 length = 0;
+			while (str[length]) length++;
+			length++;
+
+			const u64 offset = atomic_fetch_add(&binlog.pHeader->string_size, length);
+			if (offset + length > binlog.pHeader->string_capacity) {
+				atomic_store_explicit(&pEntry->offset, UINT32_MAX, memory_order_release);
+				return 0;
+			}
+
+			stMemcpy(binlog.strings + offset, str, length);
+			atomic_store_explicit(&pEntry->offset, (u32)offset, memory_order_release);
+			return (u32)offset;
+		}
+
+		if (current == key) {
+			// another thread might still be copying it
+			u32 offset;
+			while ((offset = atomic_load_explicit(&pEntry->offset, memory_order_acquire)) == 0);
+			return (offset == UINT32_MAX) ? 0 : offset;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Appends raw bytes to the arguments of a record.
+ * @param pRecord The record.
+ * @param data Bytes to append.
+ * @param size Number of bytes.
+ * @return False if there wasnt enough room.
+ */
+static STUPID_INLINE bool binLogPush(StBinLogRecord *pRecord, const void *data, const u32 size)
+{
+	if (pRecord->length + size > sizeof(pRecord->args)) return false;
+	stMemcpy(pRecord->args + pRecord->length, data, size);
+	pRecord->length += size;
+	return true;
+}
+
+/**
+ * Stores the arguments used by a format string in a record.
+ * @param pRecord The record.
+ * @param format printf format string.
+ * @param pArg printf format arguments.
+ * @note Sets pRecord->truncated if they dont all fit.
+ */
+static void binLogEncode(StBinLogRecord *pRecord, const char *format, va_list pArg)
+{
+	StBinLogSpec spec;
+	bool fits = true;
+	while (fits && stBinLogNextSpec(&format, &spec)) {
+		for (u8 i = 0; i < spec.stars; i++) {
+			const i64 star = va_arg(pArg, int);
+			fits = fits && binLogPush(pRecord, &star, sizeof(star));
+		}
+
+		switch (spec.type) {
+		case ST_BINLOG_ARG_NONE:
+			break;
+
+		case ST_BINLOG_ARG_INT: {
+			const i64 value = (spec.length == ST_BINLOG_LENGTH_L || spec.length == ST_BINLOG_LENGTH_LL) ?
+			                  va_arg(pArg, long long) :
+			                  va_arg(pArg, int);
+			fits = fits && binLogPush(pRecord, &value, sizeof(value));
+			break;
+		}
+
+		case ST_BINLOG_ARG_UINT: {
+			const u64 value = (spec.length == ST_BINLOG_LENGTH_L || spec.length == ST_BINLOG_LENGTH_LL) ?
+			                  va_arg(pArg, unsigned long long) :
+			                  va_arg(pArg, unsigned int);
+			fits = fits && binLogPush(pRecord, &value, sizeof(value));
+			break;
+		}
+
+		case ST_BINLOG_ARG_DOUBLE: {
+			const f64 value = (spec.length == ST_BINLOG_LENGTH_LONG_DOUBLE) ?
+			                  (f64)va_arg(pArg, long double) :
+			                  va_arg(pArg, double);
+			fits = fits && binLogPush(pRecord, &value, sizeof(value));
+			break;
+		}
+
+		case ST_BINLOG_ARG_STRING: {
+			const char *str = va_arg(pArg, const char *);
+			if (str == NULL) str = "(null)";
+
+			// store as much of the string as fits
+			u32 room = 0;
+			if (pRecord->length + sizeof(u32) <= sizeof(pRecord->args))
+				room = sizeof(pRecord->args) - pRecord->length - sizeof(u32);
+			u32 length = 0;
+			while (str[length] && length < room) length++;
+			fits = binLogPush(pRecord, &length, sizeof(length)) && binLogPush(pRecord, str, length) && str[length] == '\0';
+			break;
+		}
+
+		case ST_BINLOG_ARG_POINTER: {
+			const u64 value = (uintptr_t)va_arg(pArg, void *);
+			fits = fits && binLogPush(pRecord, &value, sizeof(value));
+			break;
+		}
+		}
+	}
+
+	pRecord->truncated = !fits;
+}
+
+bool stBinLogOpen(const char *path, const u32 record_count)
+{
+	STUPID_NC(path);
+
+	if (atomic_load(&binlog.open)) {
+		STUPID_LOG_ERROR("a binary log is already open");
+		return false;
+	}
+
+	u32 count = 1;
+	while (count < record_count) count <<= 1;
+
+	const u64 records_offset = sizeof(StBinLogHeader) + ST_BINLOG_STRING_CAPACITY;
+	const usize size = records_offset + (usize)count * sizeof(StBinLogRecord);
+
+	const int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		STUPID_LOG_ERROR("failed to open %s", path);
+		return false;
+	}
+
+	if (ftruncate(fd, size) != 0) {
+		STUPID_LOG_ERROR("failed to resize %s to %lu bytes", path, size);
+		close(fd);
+		return false;
+	}
+
+	// mapped shared so whatever was logged is still in the file if the program crashes
+	void *pMap = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (pMap == MAP_FAILED) {
+		STUPID_LOG_ERROR("failed to map %s", path);
+		close(fd);
+		return false;
+	}
+
+	binlog.pHeader = pMap;
+	binlog.strings = (char *)pMap + sizeof(StBinLogHeader);
+	binlog.records = (StBinLogRecord *)((u8 *)pMap + records_offset);
+	binlog.size    = size;
+	binlog.fd      = fd;
+	stMemset(binlog.table, 0, sizeof(binlog.table));
+
+	StBinLogHeader *pHeader = binlog.pHeader;
+	stMemcpy(pHeader->magic, STUPID_BINLOG_MAGIC, sizeof(pHeader->magic));
+	pHeader->version         = STUPID_BINLOG_VERSION;
+	pHeader->record_size     = sizeof(StBinLogRecord);
+	pHeader->record_count    = count;
+	pHeader->strings_offset  = sizeof(StBinLogHeader);
+	pHeader->string_capacity = ST_BINLOG_STRING_CAPACITY;
+	pHeader->records_offset  = records_offset;
+	pHeader->start_time      = stGetTime();
+
+	// offset 0 means no string
+	atomic_store(&pHeader->string_size, 1);
+	atomic_store(&pHeader->next, 0);
+
+	atomic_store(&binlog.open, true);
+
+	STUPID_LOG_SYSTEM("binary log opened at %s (%u records)", path, count);
+
+	return true;
+}
+
+void stBinLogClose(void)
+{
+	if (!atomic_load(&binlog.open)) return;
+
+	// wait for records that are still being written
+	atomic_store(&binlog.open, false);
+	while (atomic_load(&binlog.writers) != 0)
+		stSleepu(1);
+
+	const u64 total = atomic_load(&binlog.pHeader->next);
+
+	msync(binlog.pHeader, binlog.size, MS_SYNC);
+	munmap(binlog.pHeader, binlog.size);
+	close(binlog.fd);
+
+	binlog.pHeader = NULL;
+	binlog.strings = NULL;
+	binlog.records = NULL;
+
+	STUPID_LOG_SYSTEM("binary log closed after %lu records", total);
+}
+
+bool stBinLogIsOpen(void)
+{
+	return atomic_load_explicit(&binlog.open, memory_order_relaxed);
+}
+
+bool stBinLogWrite(const u8 level, const char *format, const char *function, const char *file, const u32 line, va_list pArg)
+{
+	// checked twice so logging doesnt touch a shared counter when theres no binary log
+	if (!atomic_load_explicit(&binlog.open, memory_order_relaxed)) return false;
+
+	atomic_fetch_add(&binlog.writers, 1);
+	if (!atomic_load(&binlog.open)) {
+		atomic_fetch_sub(&binlog.writers, 1);
+		return false;
+	}
+
+	StBinLogHeader *pHeader = binlog.pHeader;
+	const u64 sequence = atomic_fetch_add_explicit(&pHeader->next, 1, memory_order_relaxed);
+	StBinLogRecord *pRecord = &binlog.records[sequence & (pHeader->record_count - 1)];
+
+	// mark the record as unfinished while its being written
+	atomic_store_explicit(&pRecord->sequence, 0, memory_order_relaxed);
+
+	pRecord->time     = stGetTime();
+	pRecord->format   = binLogIntern(format);
+	pRecord->function = binLogIntern(function);
+	pRecord->file     = binLogIntern(file);
+	pRecord->line     = line;
+	pRecord->level    = level;
+	pRecord->length   = 0;
+	binLogEncode(pRecord, format, pArg);
+
+	atomic_store_explicit(&pRecord->sequence, sequence + 1, memory_order_release);
+
+	atomic_fetch_sub(&binlog.writers, 1);
+	return true;
+}
@@ -0,0 +1,76 @@
+/// @file clock.c
+/// @brief TSC calibration.
+/// @author nonexistant
+
+#include "stupid/clock.h"
+
+#include <cpuid.h>
+
+StTsc st_tsc = {0};
+
+/**
+ * Checks if the TSC ticks at a constant rate regardless of power states and frequency changes.
+ * @return True if the TSC is invariant.
+ */
+static bool clockTscIsInvariant(void)
+{
+	u32 eax = 0, ebx = 0, ecx = 0, edx = 0;
+	if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 || eax < 0x80000007) return false;
+	if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0) return false;
+
+	// advanced power management information, EDX bit 8
+	return (edx & (1 << 8)) != 0;
+}
+
+/**
+ * Reads the TSC and CLOCK_MONOTONIC at (almost) the same time.
+ * @param pTicks Where to put the TSC value.
+ * @return CLOCK_MONOTONIC in seconds.
+ * @note Takes the sample with the smallest number of ticks around clock_gettime(), so interrupts dont throw off the calibration.
+ */
+static f64 clockSample(u64 *pTicks)
+{
+	u64 best = UINT64_MAX;
+	f64 time = 0.0;
+
+	for (u8 i = 0; i < 8; i++) {
+		const u64 before = __rdtsc();
+		const f64 now    = stGetSystemTime();
+		const u64 after  = __rdtsc();
+
+		if (after - before < best) {
+			best    = after - before;
+			time    = now;
+			*pTicks = before + (after - before) / 2;
+		}
+	}
+
+	return time;
+}
+
+bool stClockCalibrate(void)
+{
+	st_tsc.usable = false;
+
+	if (!clockTscIsInvariant()) return false;
+
+	u64 start_ticks = 0, end_ticks = 0;
+	const f64 start = clockSample(&start_ticks);
+	stSleep(ST_TSC_CALIBRATION_TIME);
+	const f64 end = clockSample(&end_ticks);
+
+	if (end <= start || end_ticks <= start_ticks) return false;
+
+	const f64 frequency = (f64)(end_ticks - start_ticks) / (end - start);
+
+	// nothing made in the last 20 years runs outside of this
+	if (frequency < 100000000.0 || frequency > 10000000000.0) return false;
+
+	st_tsc.frequency        = frequency;
+	st_tsc.seconds_per_tick = 1.0 / frequency;
+	st_tsc.base_ticks       = end_ticks;
+	st_tsc.base_time        = end;
+	st_tsc.usable           = true;
+
+	return true;
+}
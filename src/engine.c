@@ -9,6 +9,7 @@
 #include "stupid/engine.h"
 #include "stupid/clock.h"
 #include "stupid/logger.h"
+#include "stupid/binlog.h"
 #include "stupid/event.h"
 #include "stupid/clock.h"
 #include "stupid/window.h"
@@ -19,10 +20,14 @@
 
 #include "stupid/render/render_types.h"
 
+#include "stupid/math/constants.h"
+
 #include <signal.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
-static bool signal_sent = false;
+static volatile sig_atomic_t signal_sent = false;
 
 /**
  * Function for shutting down all currently active subsystems.
@@ -37,45 +42,87 @@ static void shutdownAll(StEngine *pEngine)
 
 	pEngine->pState->state = STUPID_ENGINE_STATE_UNINITIALIZED;
 
+	// the render thread has to finish before the renderer goes away
+	if (pEngine->pState->pPipeline)
+		stFramePipelineDestroy(pEngine->pState->pPipeline);
+
 	// kill the renderer if needed
 	if (pEngine->pState->pRenderer) {
 		stRendererDestroy(pEngine->pState->pRenderer);
 		stRendererBackendShutdown(pEngine->pState->pRendererBackend);
 	}
 
-	stWindowDestroy(pEngine->pState->pWindow);
+	if (pEngine->pState->pReplay)
+		stReplayStop(pEngine->pState->pReplay);
+
+	if (pEngine->pState->pWindow)
+		stWindowDestroy(pEngine->pState->pWindow);
 	stEventDealloc();
 
+	if (pEngine->pState->pFrameStats)
+		stFrameStatsDestroy(pEngine->pState->pFrameStats);
+	if (pEngine->pState->pSimStats)
+		stFrameStatsDestroy(pEngine->pState->pSimStats);
+
 	stMemDeallocNL(pEngine->pState);
+
+	if (pEngine->config.binary_log) stBinLogClose();
+
+	if (pEngine->config.async_logging) {
+		stLogAsyncStop();
+		const StLogAsyncStats stats = stLogGetAsyncStats();
+		STUPID_LOG_DEBUG("async logger: %lu queued %lu dropped %lu written in %lu batches", stats.queued, stats.dropped, stats.written, stats.batches);
+	}
+}
+
+/**
+ * Gets the name of a signal the engine handles.
+ * @param sig The signal.
+ * @return Name of the signal (like "SIGINT").
+ */
+static const char *signalName(const int sig)
+{
+	switch (sig) {
+	case SIGINT:  return "SIGINT";
+	case SIGABRT: return "SIGABRT";
+	case SIGTERM: return "SIGTERM";
+	case SIGHUP:  return "SIGHUP";
+	default:      return "unknown signal";
+	}
+}
+
+/**
+ * Writes a message to stderr and exits immediately (for fatal signals).
+ * @param message The message (including the linebreak).
+ * @note Only uses write() and _exit() so its async signal safe. Logging isnt (it formats, and takes locks),
+ * and neither are stEventFire() or exit() (the listeners and atexit handlers could do anything).
+ */
+static void signalFatal(const char *message)
+{
+	STUPID_UNUSED const ssize_t res = write(STDERR_FILENO, message, strlen(message));
+	_exit(1);
 }
 
 /**
  * Handles signals like SIGINT.
  * @param sig Signal sent.
+ * @note Recoverable signals are posted with stEventPost() (with the signal in data.array.i32[0]) so the listeners run,
+ * and the signal gets logged, on the main thread instead of inside the signal handler.
+ * Fatal signals cant wait for the main thread, so they just write a message and exit (STUPID_EVENT_CODE_FATAL_ERROR isnt fired).
  */
 static void signalHandler(const int sig)
 {
 	signal_sent = true;
 
+	StEventData data = {0};
+	data.array.i32[0] = sig;
+
 	switch (sig) {
 	case SIGINT:
-		STUPID_LOG_INFO("received SIGINT");
-		stEventFire(STUPID_EVENT_CODE_EXIT, NULL, (StEventData){0});
-		break;
-
 	case SIGABRT:
-		STUPID_LOG_INFO("received SIGABRT");
-		stEventFire(STUPID_EVENT_CODE_EXIT, NULL, (StEventData){0});
-		break;
-
 	case SIGTERM:
-		STUPID_LOG_INFO("received SIGTERM");
-		stEventFire(STUPID_EVENT_CODE_EXIT, NULL, (StEventData){0});
-		break;
-
 	case SIGHUP:
-		STUPID_LOG_INFO("received SIGHUP");
-		stEventFire(STUPID_EVENT_CODE_EXIT, NULL, (StEventData){0});
+		stEventPost(STUPID_EVENT_CODE_EXIT, NULL, data);
 		break;
 
 	// in case you want to catch SIGILL for some reason
@@ -87,23 +134,17 @@ static void signalHandler(const int sig)
 	//        break;
 
 	case SIGFPE:
-		STUPID_LOG_CRITICAL("received SIGFPE");
-		STUPID_LOG_CRITICAL("the engine divided by 0 or something (you should probably compile the engine with -O3 -ffast-math)");
-		stEventFire(STUPID_EVENT_CODE_FATAL_ERROR, NULL, (StEventData){0});
-		exit(1);
+		signalFatal("received SIGFPE\n"
+		            "the engine divided by 0 or something (you should probably compile the engine with -O3 -ffast-math)\n");
 		break;
 
 	case SIGSEGV:
-		STUPID_LOG_CRITICAL("received SIGSEGV");
-		STUPID_LOG_CRITICAL("it would seem that the code in this engine is horrible and needs to be fixed");
-		stEventFire(STUPID_EVENT_CODE_FATAL_ERROR, NULL, (StEventData){0});
-		exit(1);
+		signalFatal("received SIGSEGV\n"
+		            "it would seem that the code in this engine is horrible and needs to be fixed\n");
 		break;
 
 	default:
-		STUPID_LOG_CRITICAL("received unknown signal %d", sig);
-		stEventFire(STUPID_EVENT_CODE_FATAL_ERROR, NULL, (StEventData){0});
-		exit(1);
+		signalFatal("received unknown signal\n");
 		break;
 	}
 }
@@ -111,7 +152,7 @@ static void signalHandler(const int sig)
 /**
  * Handles most important events.
  * @param code Type of event.
- * @param sender The thing that sent this event (used to make sure something like a window resize doesnt happen to all windows).
+ * @param sender The thing that sent this event (input events are only subscribed to from the main window).
  * @param listener The event listener (basically used to avoid static global variables).
  * @param data The data being sent in the event.
  * @return True if successful.
@@ -139,6 +180,7 @@ static bool eventHandler(const st_event_code code, void *sender, void *listener,
 		break;
 
 	case STUPID_EVENT_CODE_EXIT:
+		if (data.array.i32[0] != 0) STUPID_LOG_INFO("received %s", signalName(data.array.i32[0]));
 		STUPID_LOG_INFO("quit signal received prepare to die");
 		pEngine->pState->is_running = false;
 		return true;
@@ -157,39 +199,25 @@ static bool eventHandler(const st_event_code code, void *sender, void *listener,
 		break;
 
 	case STUPID_EVENT_CODE_KEY_RELEASED:
-		if (sender != pEngine->pState->pWindow) return false;
 		if (!pEngine->pState->is_suspended)
 			pEngine->callbackKey(pEngine, data.key, false);
 		break;
 
 	case STUPID_EVENT_CODE_BUTTON_PRESSED:
-		if (sender != pEngine->pState->pWindow) return false;
 		if (!pEngine->pState->is_suspended)
 			pEngine->callbackMouseButton(pEngine, data.mouse.button, true);
 		break;
 
 	case STUPID_EVENT_CODE_MOUSE_MOVED:
-		if (sender != pEngine->pState->pWindow) return false;
 		if (!pEngine->pState->is_suspended)
 			pEngine->callbackMouseMove(pEngine, data.mouse.x, data.mouse.y);
 		break;
 
 	case STUPID_EVENT_CODE_BUTTON_RELEASED:
-		if (sender != pEngine->pState->pWindow) return false;
 		if (!pEngine->pState->is_suspended)
 			pEngine->callbackMouseButton(pEngine, data.mouse.button, false);
 		break;
 
-	case STUPID_EVENT_CODE_FRAME_PREPARE:
-		if (!pEngine->pState->is_suspended)
-			pEngine->callbackFramePrepare(pEngine, data.delta);
-		break;
-
-	case STUPID_EVENT_CODE_FRAME_START:
-		if (!pEngine->pState->is_suspended)
-			pEngine->callbackFrameStart(pEngine, data.delta);
-		break;
-
 	case STUPID_EVENT_CODE_FRAME_END:
 		if (!pEngine->pState->is_suspended)
 			pEngine->callbackFrameEnd(pEngine, data.delta);
@@ -201,6 +229,138 @@ static bool eventHandler(const st_event_code code, void *sender, void *listener,
 	return false;
 }
 
+/**
+ * Gets the frame stats the simulation thread should use.
+ * @param pState Pointer to an engine state.
+ * @return pSimStats while pipelined, otherwise pFrameStats.
+ */
+static STUPID_INLINE StFrameStats *engineSimStats(StEngineState *pState)
+{
+	return (pState->pSimStats) ? pState->pSimStats : pState->pFrameStats;
+}
+
+/**
+ * Tells everything listening that a frame is being prepared or started.
+ * @param pEngine Pointer to an engine instance.
+ * @param code STUPID_EVENT_CODE_FRAME_PREPARE or STUPID_EVENT_CODE_FRAME_START.
+ * @param data The event data (with the frame delta).
+ * @note The engine callbacks are called directly since they use the renderer mid-frame.
+ * The event system can only be used from the simulation thread, so while pipelined the event is posted instead
+ * (its listeners run on the simulation thread the next time posted events are dispatched).
+ */
+static void engineFrameEvent(StEngine *pEngine, const st_event_code code, const StEventData data)
+{
+	if (code == STUPID_EVENT_CODE_FRAME_PREPARE) pEngine->callbackFramePrepare(pEngine, data.delta);
+	else pEngine->callbackFrameStart(pEngine, data.delta);
+
+	if (pEngine->pState->pSimStats) stEventPost(code, pEngine, data);
+	else stEventFire(code, pEngine, data);
+}
+
+/**
+ * Renders a frame snapshot (on the render thread while pipelined).
+ * @param pUser Pointer to an engine instance.
+ * @param pSnapshot The snapshot.
+ * @return True if successful.
+ */
+static bool engineRenderSnapshot(void *pUser, StFrameSnapshot *pSnapshot)
+{
+	StEngine *pEngine = pUser;
+
+	stFrameSnapshotApply(pSnapshot, pEngine->pState->pRenderer);
+	if (!stEngineBeginFrame(pEngine)) return false;
+	if (pSnapshot->draw_count && !pEngine->pState->is_suspended)
+		stRendererDrawObjects(pEngine->pState->pRenderer, pSnapshot->draw_count, pSnapshot->draws);
+	return stEngineEndFrame(pEngine);
+}
+
+/**
+ * Blocks until theres input, or the timeout runs out (for when nothing is being rendered).
+ * @param pEngine Pointer to an engine instance.
+ * @param timeout Longest time to wait in seconds.
+ * @return False if rendering the last frame failed.
+ */
+static bool engineIdle(StEngine *pEngine, const f64 timeout)
+{
+	StEngineState *pState = pEngine->pState;
+
+	// the render thread owns the frame stats and the frame clock, so it has to finish first
+	if (!stFramePipelineFlush(pState->pPipeline)) return false;
+
+	// posted events are normally dispatched every frame
+	stEventDispatchPosted();
+
+	if (timeout > 0.0) {
+		if (pState->pWindow) stWindowWait(pState->pWindow, timeout);
+		else stSleepu((u64)STUPID_SEC_TO_US(timeout));
+	}
+
+	// time spent idle isnt part of any frame
+	stFrameStatsDiscardFrame(pState->pFrameStats);
+	if (pState->pSimStats) stFrameStatsDiscardFrame(pState->pSimStats);
+	stClockUpdate(&pState->clock);
+
+	return true;
+}
+
+/**
+ * Gets the camera for a point on the headless camera path.
+ * @param pEngine Pointer to an engine instance.
+ * @param camera Camera to take the field of view and clipping planes from.
+ * @param t How far along the path (0.0 to 1.0).
+ * @return The camera.
+ */
+static StCamera engineCameraPath(const StEngine *pEngine, const StCamera camera, const f64 t)
+{
+	const StCameraKeyframe *pPath = pEngine->config.pCameraPath;
+	const u32 length = pEngine->config.camera_path_length;
+
+	StVec3 pos = {0}, target = {0};
+	if (pPath == NULL || length == 0) {
+		// one lap around the origin
+		const f64 angle = t * STUPID_MATH_TAU;
+		pos = STVEC3(stSin(angle) * STUPID_ENGINE_HEADLESS_ORBIT_RADIUS, 0.0, stCos(angle) * STUPID_ENGINE_HEADLESS_ORBIT_RADIUS);
+	}
+	else if (length == 1) {
+		pos    = pPath[0].pos;
+		target = pPath[0].target;
+	}
+	else {
+		// straight lines between keyframes
+		const f64 x = STUPID_CLAMP(t, 0.0, 1.0) * (f64)(length - 1);
+		const u32 i = STUPID_MIN((u32)x, length - 2);
+		const f32 f = (f32)(x - (f64)i);
+		pos    = stVec3Add(pPath[i].pos, stVec3Scale(stVec3Sub(pPath[i + 1].pos, pPath[i].pos), f));
+		target = stVec3Add(pPath[i].target, stVec3Scale(stVec3Sub(pPath[i + 1].target, pPath[i].target), f));
+	}
+
+	return stRendererCameraCreate(pos, target, camera.fov, camera.near, camera.far);
+}
+
+/**
+ * Prints the headless timing report to stdout.
+ * @param pEngine Pointer to an engine instance.
+ * @param frames Frames timed (not including the warmup).
+ * @param time Time taken to render them.
+ */
+static void engineHeadlessReport(const StEngine *pEngine, const u64 frames, const f64 time)
+{
+	const StRendererValues *rvals = stRendererGetRendererValues(pEngine->pState->pRenderer);
+
+	// the async logger writes with write(2), so anything it still has queued would end up in the middle of the report
+	stLogFlush();
+
+	printf("headless: %lu frames at %ux%u in %.3lfs (%.2lf fps)%s\n", frames, rvals->width, rvals->height, time,
+	       (time > 0.0) ? (f64)frames / time : 0.0, (pEngine->config.pipelined) ? " pipelined" : "");
+	if (pEngine->pState->pSimStats) {
+		printf("render thread:\n");
+		stFrameStatsPrint(pEngine->pState->pFrameStats, stdout);
+		printf("simulation thread:\n");
+		stFrameStatsPrint(pEngine->pState->pSimStats, stdout);
+	}
+	else stFrameStatsPrint(pEngine->pState->pFrameStats, stdout);
+}
+
 /// Default empty function for pEngine->callbackInitialize.
 static bool placeholderInitCallback(StEngine *a) { return true; }
 
@@ -219,6 +379,9 @@ static bool placeholderFrameStartCallback(StEngine *a, f32 b) { return true; }
 /// Default empty function for pEngine->callbackFrameEnd.
 static bool placeholderFrameEndCallback(StEngine *a, f32 b) { return true; }
 
+/// Default empty function for pEngine->callbackSnapshot.
+static bool placeholderSnapshotCallback(StEngine *a, StFrameSnapshot *b, f64 c) { return true; }
+
 /// Default empty function for pEngine->callbackResize.
 static void placeholderResizeCallback(StEngine *a, i32 b, i32 c, i32 d, i32 e) { return; }
 
@@ -242,16 +405,28 @@ st_engine_init_return_code stEngineInit(StEngine *pEngine)
 		}
 	}
 
+	// switch stGetTime() to the TSC before anything is timed
+	stClockCalibrate();
+
 	// stack allocated clock so engine alloction time can be included in startup time
 	StClock clock = {0};
 	stClockStart(&clock);
 
+	// STUPID_LOG=warn,memory=trace etc
+	stLogSetLevelsFromEnv();
+
+	// dont let logging stall the main loop on terminal io
+	if (pEngine->config.async_logging) stLogAsyncStart(ST_LOG_POLICY_DROP);
+	if (pEngine->config.binary_log) stBinLogOpen(pEngine->config.binary_log, 1 << 16);
+
 	StEngineState *pEngineState = stMemAllocNL(StEngineState, 1);
 
 	pEngineState->state = STUPID_ENGINE_STATE_UNINITIALIZED;
 	pEngineState->clock = clock;
 
 	STUPID_LOG_SYSTEM("engine started at %lf", pEngineState->clock.start_time);
+	if (st_tsc.usable) STUPID_LOG_SYSTEM("using the TSC as the clock (%.3lfGHz)", st_tsc.frequency / 1000000000.0);
+	else STUPID_LOG_WARN("no invariant TSC, using clock_gettime() as the clock");
 
 #ifdef _DEBUG
 	STUPID_LOG_CRITICAL("test log %lf", 1.2345);
@@ -293,6 +468,10 @@ st_engine_init_return_code stEngineInit(StEngine *pEngine)
 		STUPID_LOG_WARN("frame end function not set");
 		pEngine->callbackFrameEnd = placeholderFrameEndCallback;
 	}
+	if (!pEngine->callbackSnapshot) {
+		STUPID_LOG_WARN("frame snapshot function not set");
+		pEngine->callbackSnapshot = placeholderSnapshotCallback;
+	}
 	if (!pEngine->callbackResize) {
 		STUPID_LOG_WARN("resize function not set");
 		pEngine->callbackResize = placeholderResizeCallback;
@@ -319,40 +498,51 @@ st_engine_init_return_code stEngineInit(StEngine *pEngine)
 	signal(SIGFPE,  signalHandler);
 	signal(SIGSEGV, signalHandler);
 	signal(SIGTERM, signalHandler);
+	signal(SIGHUP,  signalHandler);
 
 	pEngineState->target_fps = (f64)pEngine->config.max_fps;
 
 	stEventRegister(STUPID_EVENT_CODE_FATAL_ERROR,     pEngine, eventHandler);
 	stEventRegister(STUPID_EVENT_CODE_EXIT,            pEngine, eventHandler);
-	stEventRegister(STUPID_EVENT_CODE_WINDOW_RESIZED,  pEngine, eventHandler);
 	stEventRegister(STUPID_EVENT_CODE_FPS_CHANGE,      pEngine, eventHandler);
-	stEventRegister(STUPID_EVENT_CODE_KEY_PRESSED,     pEngine, eventHandler);
-	stEventRegister(STUPID_EVENT_CODE_KEY_RELEASED,    pEngine, eventHandler);
-	stEventRegister(STUPID_EVENT_CODE_MOUSE_MOVED,     pEngine, eventHandler);
-	stEventRegister(STUPID_EVENT_CODE_BUTTON_PRESSED,  pEngine, eventHandler);
-	stEventRegister(STUPID_EVENT_CODE_BUTTON_RELEASED, pEngine, eventHandler);
-	stEventRegister(STUPID_EVENT_CODE_FRAME_PREPARE,   pEngine, eventHandler);
-	stEventRegister(STUPID_EVENT_CODE_FRAME_START,     pEngine, eventHandler);
 	stEventRegister(STUPID_EVENT_CODE_FRAME_END,       pEngine, eventHandler);
 
 	pEngine->config.window.width = STUPID_CLAMP(pEngine->config.window.width, STUPID_WINDOW_MIN_WIDTH, STUPID_WINDOW_MAX_WIDTH);
 	pEngine->config.window.height = STUPID_CLAMP(pEngine->config.window.height, STUPID_WINDOW_MIN_HEIGHT, STUPID_WINDOW_MAX_HEIGHT);
-	pEngineState->pWindow = stWindowCreate(pEngine->config.window.width,
-			                       pEngine->config.window.height,
-			                       pEngine->config.name,
-			                       pEngine->config.window.flags);
 
-	if (pEngineState->pWindow == NULL) {
-		STUPID_LOG_FATAL("failed to create window");
-		shutdownAll(pEngine);
-		return STUPID_ENGINE_INIT_WINDOW_FAILED;
+	const bool headless = pEngine->config.headless;
+	if (headless) {
+		if (pEngine->config.headless_frames == 0) pEngine->config.headless_frames = STUPID_ENGINE_HEADLESS_FRAMES;
+		STUPID_LOG_SYSTEM("running headless at %dx%d for %u frames", pEngine->config.window.width, pEngine->config.window.height, pEngine->config.headless_frames);
+	}
+	else {
+		pEngineState->pWindow = stWindowCreate(pEngine->config.window.width,
+				                       pEngine->config.window.height,
+				                       pEngine->config.name,
+				                       pEngine->config.window.flags);
+
+		if (pEngineState->pWindow == NULL) {
+			STUPID_LOG_FATAL("failed to create window");
+			shutdownAll(pEngine);
+			return STUPID_ENGINE_INIT_WINDOW_FAILED;
+		}
+
+		// input events are only wanted from the main window
+		stEventSubscribe(STUPID_EVENT_CODE_WINDOW_RESIZED,  pEngineState->pWindow, pEngine, eventHandler);
+		stEventSubscribe(STUPID_EVENT_CODE_KEY_PRESSED,     pEngineState->pWindow, pEngine, eventHandler);
+		stEventSubscribe(STUPID_EVENT_CODE_KEY_RELEASED,    pEngineState->pWindow, pEngine, eventHandler);
+		stEventSubscribe(STUPID_EVENT_CODE_MOUSE_MOVED,     pEngineState->pWindow, pEngine, eventHandler);
+		stEventSubscribe(STUPID_EVENT_CODE_BUTTON_PRESSED,  pEngineState->pWindow, pEngine, eventHandler);
+		stEventSubscribe(STUPID_EVENT_CODE_BUTTON_RELEASED, pEngineState->pWindow, pEngine, eventHandler);
 	}
-	if ((pEngineState->pRendererBackend = stRendererBackendInitialize(ST_RENDERER_BACKEND_VULKAN)) == NULL) {
+	if ((pEngineState->pRendererBackend = stRendererBackendInitialize(ST_RENDERER_BACKEND_VULKAN, headless)) == NULL) {
 		STUPID_LOG_FATAL("failed to initialize the stupid renderer backend");
 		shutdownAll(pEngine);
 		return STUPID_ENGINE_INIT_RENDERER_FAILED;
 	}
-	if ((pEngineState->pRenderer = stRendererCreate(pEngineState->pRendererBackend, pEngineState->pWindow)) == NULL) {
+	if (headless) pEngineState->pRenderer = stRendererCreateHeadless(pEngineState->pRendererBackend, pEngine->config.window.width, pEngine->config.window.height);
+	else pEngineState->pRenderer = stRendererCreate(pEngineState->pRendererBackend, pEngineState->pWindow);
+	if (pEngineState->pRenderer == NULL) {
 		STUPID_LOG_FATAL("failed to initialize the stupid renderer");
 		shutdownAll(pEngine);
 		return STUPID_ENGINE_INIT_RENDERER_FAILED;
@@ -374,43 +564,173 @@ st_engine_init_return_code stEngineInit(StEngine *pEngine)
 	stClockStart(&pEngine->pState->tick_timer);
 	pEngine->pState->tickrate = 1.0 / (f64)pEngine->pState->tps;
 
-	stClockStart(&pEngine->pState->average_fps_timer);
+	stFramePacerInit(&pEngine->pState->pacer);
+
+	pEngine->pState->pFrameStats = stFrameStatsCreate();
+	if (pEngine->config.pipelined)
+		pEngine->pState->pSimStats = stFrameStatsCreate();
+
+	pEngine->pState->pPipeline = stFramePipelineCreate(pEngine->config.pipelined, engineRenderSnapshot, pEngine,
+	                                                   stRendererGetRendererValues(pEngine->pState->pRenderer)->camera);
+	if (pEngine->pState->pPipeline == NULL) {
+		STUPID_LOG_FATAL("failed to create the frame pipeline");
+		shutdownAll(pEngine);
+		return STUPID_ENGINE_INIT_RENDERER_FAILED;
+	}
+	if (pEngine->config.frame_stats) {
+		const char *path = pEngine->config.frame_stats;
+		const usize length = strlen(path);
+		const bool json = length >= 5 && strcmp(path + length - 5, ".json") == 0;
+		stFrameStatsDumpTo(pEngine->pState->pFrameStats, path, json ? ST_FRAME_STATS_FORMAT_JSON : ST_FRAME_STATS_FORMAT_CSV, pEngine->config.frame_stats_interval);
+	}
 
 	return STUPID_ENGINE_INIT_SUCCESS;
 }
 
+st_engine_start_return_code stEngineStart(StEngine *pEngine)
+{
+	STUPID_NC(pEngine);
+
+	if (pEngine->pState == NULL || pEngine->pState->state == STUPID_ENGINE_STATE_UNINITIALIZED) {
+		STUPID_LOG_ERROR("stEngineStart() called before stEngineInit()");
+		return STUPID_ENGINE_START_BEFORE_INIT;
+	}
+	if (pEngine->pState->state == STUPID_ENGINE_STATE_STARTED) {
+		STUPID_LOG_ERROR("stEngineStart() called twice");
+		return STUPID_ENGINE_START_CALLED_TWICE;
+	}
+
+	StEngineState *pState = pEngine->pState;
+	pState->state                = STUPID_ENGINE_STATE_STARTED;
+	pState->is_running           = true;
+	pState->main_loop_is_running = true;
+	pState->update_failed        = false;
+
+	const bool headless = pEngine->config.headless;
+	const u64 frames    = (headless) ? STUPID_MAX(pEngine->config.headless_frames, STUPID_ENGINE_HEADLESS_WARMUP_FRAMES + 1) : 0;
+	u64 frame           = 0;
+	f64 timed_start     = stGetTime();
+
+	st_engine_start_return_code res = STUPID_ENGINE_START_SUCCESS;
+	while (stEngineIsRunning(pEngine)) {
+		if (!stEnginePoll(pEngine)) break;
+
+		// the main loop is paused while suspended, so block until theres input instead of spinning
+		if (pState->is_suspended) {
+			if (!engineIdle(pEngine, STUPID_ENGINE_IDLE_TIMEOUT)) {
+				res = STUPID_ENGINE_START_MAIN_LOOP_FAILED;
+				break;
+			}
+
+			// or the simulation would try to catch up on the whole time its been suspended
+			stClockUpdate(&pState->tick_timer);
+			continue;
+		}
+
+		while (stEngineNextTick(pEngine));
+		if (pState->update_failed) {
+			res = STUPID_ENGINE_START_PFN_UPDATE_FAILED;
+			break;
+		}
+
+		// nothing can be seen while minimized, so only the simulation keeps going
+		// (the loop blocks between ticks, and input like the window being restored wakes it up early)
+		pState->is_minimized = pState->pWindow && stWindowIsMinimized(pState->pWindow);
+		if (pState->is_minimized) {
+			if (!engineIdle(pEngine, pState->tickrate - pState->tick_time)) {
+				res = STUPID_ENGINE_START_MAIN_LOOP_FAILED;
+				break;
+			}
+			continue;
+		}
+
+		StFrameStats *pStats = engineSimStats(pState);
+		StFrameSnapshot *pSnapshot = stEngineGetSnapshot(pEngine);
+		stFrameStatsBeginPhase(pStats, ST_FRAME_PHASE_SNAPSHOT);
+		const bool filled = pEngine->callbackSnapshot(pEngine, pSnapshot, stEngineGetTickAlpha(pEngine));
+		if (headless) pSnapshot->camera = engineCameraPath(pEngine, pSnapshot->camera, (f64)frame / (f64)(frames - 1));
+		stFrameStatsEndPhase(pStats, ST_FRAME_PHASE_SNAPSHOT);
+		if (!filled) {
+			STUPID_LOG_ERROR("frame snapshot function failed");
+			res = STUPID_ENGINE_START_PFN_RENDER_FAILED;
+			break;
+		}
+
+		// renders the frame, or hands it to the render thread while pipelined
+		if (!stEngineSubmitFrame(pEngine)) {
+			STUPID_LOG_ERROR("failed to render frame %lu", pState->total_frames);
+			res = STUPID_ENGINE_START_MAIN_LOOP_FAILED;
+			break;
+		}
+
+		if (!headless) continue;
+
+		frame++;
+		if (frame == STUPID_ENGINE_HEADLESS_WARMUP_FRAMES) {
+			// the render thread writes to the frame stats, so it has to finish first
+			stFramePipelineFlush(pState->pPipeline);
+			stFrameStatsReset(pState->pFrameStats);
+			if (pState->pSimStats) stFrameStatsReset(pState->pSimStats);
+			timed_start = stGetTime();
+		}
+		else if (frame >= frames) break;
+	}
+
+	// let the last frame finish so the renderer can be used again
+	if (!stFramePipelineFlush(pState->pPipeline) && res == STUPID_ENGINE_START_SUCCESS)
+		res = STUPID_ENGINE_START_MAIN_LOOP_FAILED;
+
+	if (headless && frame > STUPID_ENGINE_HEADLESS_WARMUP_FRAMES)
+		engineHeadlessReport(pEngine, frame - STUPID_ENGINE_HEADLESS_WARMUP_FRAMES, stGetTime() - timed_start);
+
+	pState->is_running           = false;
+	pState->main_loop_is_running = false;
+	pState->state                = STUPID_ENGINE_STATE_INITIALIZED;
+
+	return res;
+}
+
 bool stEngineBeginFrame(StEngine *pEngine)
 {
 	STUPID_NC(pEngine);
 	STUPID_NC(pEngine->pState);
 	
+	// fire anything posted by other threads (or signal handlers) since the last frame
+	// (on the simulation thread in stEngineSubmitFrame() while pipelined)
+	if (!pEngine->pState->pSimStats) stEventDispatchPosted();
+
 	const f32 delta = stGetClockElapsed(&pEngine->pState->clock);
 	StRendererPacket packet = {0};
 	packet.delta = delta;
 
-	// TODO: fix fps lock not working correctly
-	// for example if the fps lock is set to 255 the engine will run at ~252 fps
-	if (pEngine->pState->fps_locked && delta < pEngine->pState->target_fps_reciprocal)
-		stSleepu(STUPID_SEC_TO_US(pEngine->pState->target_fps_reciprocal - delta));
+	StFrameStats *pStats = pEngine->pState->pFrameStats;
 
-#define ALPHA 0.1
-#define WAIT 1.0
-	pEngine->pState->average_fps_counter += 1;
-	if (stGetClockElapsed(&pEngine->pState->average_fps_timer) >= WAIT) {
-		pEngine->pState->average_fps = ALPHA * pEngine->pState->average_fps + (WAIT - ALPHA) * (f64)pEngine->pState->average_fps_counter;
-		stClockUpdate(&pEngine->pState->average_fps_timer);
-		pEngine->pState->average_fps_counter = 0;
+	// wait for the next frame deadline (this also measures how late each frame starts)
+	// (headless runs are benchmarks, so they go as fast as possible)
+	if (pEngine->pState->fps_locked && !pEngine->config.headless) {
+		stFrameStatsBeginPhase(pStats, ST_FRAME_PHASE_WAIT);
+		stFramePacerWait(&pEngine->pState->pacer, pEngine->pState->target_fps_reciprocal);
+		stFrameStatsEndPhase(pStats, ST_FRAME_PHASE_WAIT);
 	}
 
 	stClockUpdate(&pEngine->pState->clock);
 
 	if (pEngine->pState->is_suspended) return true;
-	if (!stRendererPrepareFrame(pEngine->pState->pRenderer, packet.delta)) return false;
 	StEventData data = {0};
 	data.delta = delta;
-	stEventFire(STUPID_EVENT_CODE_FRAME_PREPARE, pEngine, data);
+
+	stFrameStatsBeginPhase(pStats, ST_FRAME_PHASE_PREPARE);
+	if (!stRendererPrepareFrame(pEngine->pState->pRenderer, packet.delta)) return false;
+	engineFrameEvent(pEngine, STUPID_EVENT_CODE_FRAME_PREPARE, data);
+	stFrameStatsEndPhase(pStats, ST_FRAME_PHASE_PREPARE);
+
+	stFrameStatsBeginPhase(pStats, ST_FRAME_PHASE_START);
 	if (!stRendererStartFrame(pEngine->pState->pRenderer, packet.delta)) return false;
-	stEventFire(STUPID_EVENT_CODE_FRAME_START, pEngine, data);
+	engineFrameEvent(pEngine, STUPID_EVENT_CODE_FRAME_START, data);
+	stFrameStatsEndPhase(pStats, ST_FRAME_PHASE_START);
+
+	// whatever the caller does before stEngineEndFrame()
+	stFrameStatsBeginPhase(pStats, ST_FRAME_PHASE_DRAW);
 
 	return true;
 }
@@ -420,10 +740,156 @@ bool stEngineEndFrame(StEngine *pEngine)
 	STUPID_NC(pEngine);
 	STUPID_NC(pEngine->pState);
 
-	if (pEngine->pState->is_suspended) return true;
+	StFrameStats *pStats = pEngine->pState->pFrameStats;
+
+	if (pEngine->pState->is_suspended) {
+		stFrameStatsDiscardFrame(pStats);
+		return true;
+	}
+	stFrameStatsEndPhase(pStats, ST_FRAME_PHASE_DRAW);
+
+	stFrameStatsBeginPhase(pStats, ST_FRAME_PHASE_END);
 	if (!stRendererEndFrame(pEngine->pState->pRenderer, stGetClockElapsed(&pEngine->pState->clock))) return false;
+	stFrameStatsEndPhase(pStats, ST_FRAME_PHASE_END);
+
 	pEngine->pState->total_frames++;
+	stFrameStatsEndFrame(pStats);
+
+	return true;
+}
+
+bool stEngineNextTick(StEngine *pEngine)
+{
+	STUPID_NC(pEngine);
+	STUPID_NC(pEngine->pState);
+
+	StEngineState *pState = pEngine->pState;
+
+	// replays and headless runs use a fixed timestep of one tick per frame so they run the same way every time
+	if ((pState->pReplay && pState->pReplay->mode == ST_REPLAY_MODE_PLAY) || pEngine->config.headless) {
+		if (pState->frame_ticks == 0) pState->tick_time += pState->tickrate;
+	}
+	else
+		pState->tick_time += stGetClockElapsed(&pState->tick_timer);
+	stClockUpdate(&pState->tick_timer);
+
+	if (pState->tick_time < pState->tickrate) return false;
+
+	// spiral of death guard (catching up on every tick after a slow frame would just make the next frame slower)
+	if (pState->frame_ticks >= STUPID_ENGINE_MAX_TICKS_PER_FRAME) {
+		const u64 dropped = (u64)(pState->tick_time / pState->tickrate);
+		pState->tick_time -= (f64)dropped * pState->tickrate;
+		pState->dropped_ticks += dropped;
+		STUPID_LOG_WARN("simulation fell behind, dropped %lu ticks (%lu total)", dropped, pState->dropped_ticks);
+		return false;
+	}
 
+	pState->tick_time -= pState->tickrate;
+	pState->frame_ticks++;
+
+	StFrameStats *pStats = engineSimStats(pState);
+	stFrameStatsBeginPhase(pStats, ST_FRAME_PHASE_TICK);
+	const bool res = pEngine->callbackUpdate(pEngine, pState->tickrate);
+	stFrameStatsEndPhase(pStats, ST_FRAME_PHASE_TICK);
+
+	if (!res) {
+		STUPID_LOG_ERROR("update function failed on tick %lu", pState->total_ticks);
+		pState->update_failed = true;
+		pState->is_running    = false;
+		return false;
+	}
+
+	pState->total_ticks++;
+	return true;
+}
+
+bool stEnginePoll(StEngine *pEngine)
+{
+	STUPID_NC(pEngine);
+	STUPID_NC(pEngine->pState);
+
+	// start of a new frame as far as the simulation is concerned
+	pEngine->pState->frame_ticks = 0;
+
+	StReplay *pReplay = pEngine->pState->pReplay;
+	if (pReplay && pReplay->mode == ST_REPLAY_MODE_PLAY)
+		return stReplayUpdate(pReplay);
+
+	// theres nothing to poll without a window
+	if (pEngine->pState->pWindow == NULL) return true;
+
+	StFrameStats *pStats = engineSimStats(pEngine->pState);
+	stFrameStatsBeginPhase(pStats, ST_FRAME_PHASE_POLL);
+	const bool res = stWindowPoll(pEngine->pState->pWindow);
+	stFrameStatsEndPhase(pStats, ST_FRAME_PHASE_POLL);
+	return res;
+}
+
+bool stEngineSubmitFrame(StEngine *pEngine)
+{
+	STUPID_NC(pEngine);
+	STUPID_NC(pEngine->pState);
+
+	StEngineState *pState = pEngine->pState;
+	StFrameSnapshot *pSnapshot = stFramePipelineGetSnapshot(pState->pPipeline);
+	pSnapshot->tick_alpha = stEngineGetTickAlpha(pEngine);
+	pSnapshot->tick       = pState->total_ticks;
+
+	if (!pState->pSimStats) return stFramePipelineSubmit(pState->pPipeline);
+
+	stEventDispatchPosted();
+
+	// time spent waiting for the render thread
+	stFrameStatsBeginPhase(pState->pSimStats, ST_FRAME_PHASE_WAIT);
+	const bool res = stFramePipelineSubmit(pState->pPipeline);
+	stFrameStatsEndPhase(pState->pSimStats, ST_FRAME_PHASE_WAIT);
+	stFrameStatsEndFrame(pState->pSimStats);
+
+	return res;
+}
+
+bool stEngineRecordInput(StEngine *pEngine, const char *path)
+{
+	STUPID_NC(pEngine);
+	STUPID_NC(pEngine->pState);
+
+	if (pEngine->pState->pWindow == NULL) {
+		STUPID_LOG_ERROR("theres no input while headless");
+		return false;
+	}
+	if (pEngine->pState->pReplay) {
+		STUPID_LOG_ERROR("already recording or replaying input");
+		return false;
+	}
+
+	pEngine->pState->pReplay = stReplayRecord(pEngine->pState->pWindow, path, pEngine->pState->tps, &pEngine->pState->total_ticks);
+	return pEngine->pState->pReplay != NULL;
+}
+
+bool stEngineReplayInput(StEngine *pEngine, const char *path)
+{
+	STUPID_NC(pEngine);
+	STUPID_NC(pEngine->pState);
+
+	if (pEngine->pState->pWindow == NULL) {
+		STUPID_LOG_ERROR("theres no input while headless");
+		return false;
+	}
+	if (pEngine->pState->pReplay) {
+		STUPID_LOG_ERROR("already recording or replaying input");
+		return false;
+	}
+
+	StReplay *pReplay = stReplayPlay(pEngine->pState->pWindow, path, &pEngine->pState->total_ticks);
+	if (pReplay == NULL) return false;
+
+	if (pReplay->tps != pEngine->pState->tps) {
+		STUPID_LOG_WARN("input was recorded at %u ticks per second (currently %u)", pReplay->tps, pEngine->pState->tps);
+		pEngine->pState->tps = pReplay->tps;
+		pEngine->pState->tickrate = 1.0 / (f64)pEngine->pState->tps;
+	}
+
+	pEngine->pState->pReplay = pReplay;
 	return true;
 }
 
@@ -434,7 +900,29 @@ st_engine_shutdown_return_code stEngineShutdown(StEngine *pEngine)
 	if (pEngine->pState->state == STUPID_ENGINE_STATE_UNINITIALIZED)
 		return STUPID_ENGINE_SHUTDOWN_BEFORE_INIT;
 
+	// wait for the render thread before reading anything it writes
+	stFramePipelineFlush(pEngine->pState->pPipeline);
+
 	STUPID_LOG_INFO("total frames: %lu", pEngine->pState->total_frames);
+	if (pEngine->pState->dropped_ticks)
+		STUPID_LOG_WARN("%lu of %lu ticks dropped", pEngine->pState->dropped_ticks, pEngine->pState->dropped_ticks + pEngine->pState->total_ticks);
+	stFrameStatsLog(pEngine->pState->pFrameStats);
+	if (pEngine->pState->pSimStats) {
+		STUPID_LOG_INFO("simulation thread:");
+		stFrameStatsLog(pEngine->pState->pSimStats);
+	}
+
+	const StEventPostStats post_stats = stEventGetPostStats();
+	if (post_stats.dispatched)
+		STUPID_LOG_DEBUG("posted events: %lu dispatched %lu dropped, latency min %lfs avg %lfs max %lfs",
+		                 post_stats.dispatched, post_stats.dropped, post_stats.latency_min,
+		                 post_stats.latency_total / (f64)post_stats.dispatched, post_stats.latency_max);
+
+	const StFramePacerStats pacer_stats = stFramePacerGetStats(&pEngine->pState->pacer);
+	if (pacer_stats.frames)
+		STUPID_LOG_DEBUG("frame pacing: %lu frames %lu missed %lu resyncs, jitter min %lfs avg %lfs max %lfs stddev %lfs",
+		                 pacer_stats.frames, pacer_stats.missed, pacer_stats.resyncs, pacer_stats.jitter_min,
+		                 pacer_stats.jitter_mean, pacer_stats.jitter_max, pacer_stats.jitter_stddev);
 
 	const f64 time = pEngine->pState->clock.update_time;
 
@@ -1,27 +1,368 @@
+#define STUPID_LOG_MODULE ST_LOG_MODULE_EVENT
+
 #include "stupid/event.h"
 #include "stupid/assert.h"
 #include "stupid/logger.h"
 #include "stupid/memory.h"
+#include "stupid/clock.h"
+
+#include <stdatomic.h>
 
+/// A registered callback.
+/// @note Kept as small as possible since stEventFire() walks these.
 typedef struct StEvent {
 	StPFN_event pfn;
 	const void *listener;
 } StEvent;
 
-static StEvent *events[ST_MAX_STUPID_EVENT_CODES] = {0};
+/// Callbacks registered for one event code and one sender.
+typedef struct StEventGroup {
+	/// Sender the callbacks want events from (STUPID_EVENT_SENDER_ANY for all of them).
+	const void *sender;
+
+	/// Registered callbacks.
+	StEvent *events;
+
+	/// Handle table slot of each callback in events (same layout as events).
+	u32 *handles;
+} StEventGroup;
+
+/// Entry in the handle table.
+typedef struct StEventSlot {
+	/// Generation of the handle the slot was last given out with (from event_generation).
+	u32 generation;
+
+	/// Event code the callback was registered with.
+	u16 code;
+
+	/// Group the callback is in.
+	u16 group;
+
+	/// Position of the callback in its group while used, otherwise the next free slot.
+	u32 index;
+
+	/// @brief If the slot currently refers to a registered callback.
+	/// Cleared as soon as the callback is unregistered, but while firing the slot is only reused once
+	/// the callback has been taken out of its group (so renumbering the group cant touch a reused slot).
+	bool used;
+} StEventSlot;
+
+/// @brief Registered callbacks for each event code grouped by sender.
+/// The first group of each code is always the STUPID_EVENT_SENDER_ANY group, and the rest are sorted by sender
+/// (so stEventFire() can binary search for them).
+static StEventGroup *events[ST_MAX_STUPID_EVENT_CODES] = {0};
+
+/// Number of stEventFire() calls currently running (callbacks can fire events too).
+static u32 event_fire_depth = 0;
+
+/// If a callback was unregistered while firing, and still has to be taken out of its group.
+static bool event_removal_pending = false;
+
+/// Bumped every time groups are added or removed (so stEventFire() knows when to look its group up again).
+static u32 event_groups_version = 0;
+
+/// Handle table for every registered callback.
+static StEventSlot *event_slots = NULL;
+
+/// First unused slot in event_slots.
+static u32 event_free_slot = UINT32_MAX;
+
+/// @brief Generation of the last handle given out.
+/// Global instead of kept in each slot so it survives stEventDealloc() freeing event_slots
+/// (otherwise handles from before it would be valid again once their slot is reused).
+static u32 event_generation = 0;
+
+/// An event waiting in the post queue.
+typedef struct StPostedEvent {
+	/// @brief Sequence number of this slot minus its index.
+	/// The index is subtracted so a zerofilled queue is already valid, which means it never needs to be initialized.
+	/// Equal to the queue position when the slot is free, and the queue position + 1 once its been written.
+	STUPID_ATOMIC usize sequence;
+
+	/// Time the event was posted.
+	f64 time;
+
+	st_event_code code;
+	void *sender;
+	StEventData data;
+} StPostedEvent;
+
+STUPID_STATIC_ASSERT(STUPID_IS_POWER2(ST_MAX_POSTED_EVENTS), "ST_MAX_POSTED_EVENTS is not a power of 2");
+
+/// @brief Bounded multi producer single consumer event queue.
+/// Producers claim a slot by bumping head, and publish it by bumping the slot sequence,
+/// so nothing here can block or allocate (which makes it safe to use in signal handlers).
+static struct {
+	STUPID_ALIGN(64) STUPID_ATOMIC usize head;
+	STUPID_ALIGN(64) usize tail;
+	STUPID_ALIGN(64) StPostedEvent slots[ST_MAX_POSTED_EVENTS];
+	STUPID_ATOMIC u64 posted;
+	STUPID_ATOMIC u64 dropped;
+	u64 dispatched;
+	f64 latency_min;
+	f64 latency_max;
+	f64 latency_total;
+} post_queue = {0};
+
+/// Gets the sequence number of the slot at the specified position in the post queue.
+static STUPID_INLINE usize postedEventSequence(const usize pos)
+{
+	const usize index = pos & (ST_MAX_POSTED_EVENTS - 1);
+	return atomic_load_explicit(&post_queue.slots[index].sequence, memory_order_acquire) + index;
+}
+
+/// Sets the sequence number of the slot at the specified position in the post queue.
+static STUPID_INLINE void postedEventSetSequence(const usize pos, const usize sequence)
+{
+	const usize index = pos & (ST_MAX_POSTED_EVENTS - 1);
+	atomic_store_explicit(&post_queue.slots[index].sequence, sequence - index, memory_order_release);
+}
+
+/**
+ * Gets an unused slot in the handle table.
+ * @param code Event code the slot is for.
+ * @param group Group the callback is in.
+ * @param index Position of the callback in its group.
+ * @return Index of the slot.
+ */
+static u32 eventSlotAlloc(const st_event_code code, const u16 group, const u32 index)
+{
+	if (event_slots == NULL)
+		event_slots = stMemAllocNL(StEventSlot, ST_EVENT_INITIAL_CAPACITY * 4);
+
+	u32 slot = event_free_slot;
+	if (slot != UINT32_MAX) {
+		event_free_slot = event_slots[slot].index;
+	}
+	else {
+		slot = stMemLength(event_slots);
+		if (slot == stMemCapacity(event_slots))
+			stMemResizeNL(event_slots, stMemCapacity(event_slots) * 2);
+		stMemSetLength(event_slots, slot + 1);
+	}
+
+	StEventSlot *pSlot = &event_slots[slot];
+	if (++event_generation == 0) event_generation = 1;
+	pSlot->generation = event_generation;
+	pSlot->code  = code;
+	pSlot->group = group;
+	pSlot->used  = true;
+	pSlot->index = index;
+
+	return slot;
+}
+
+/**
+ * Returns a slot to the handle table.
+ * @param slot Index of the slot.
+ */
+static void eventSlotFree(const u32 slot)
+{
+	event_slots[slot].used  = false;
+	event_slots[slot].index = event_free_slot;
+	event_free_slot = slot;
+}
+
+/**
+ * Finds where the group for a sender is, or would go.
+ * @param code Event code (with at least the STUPID_EVENT_SENDER_ANY group).
+ * @param sender Sender to look for (not STUPID_EVENT_SENDER_ANY).
+ * @return Index of the first sender specific group whose sender isnt below sender.
+ */
+static STUPID_INLINE u32 eventLowerBound(const st_event_code code, const void *sender)
+{
+	u32 low = 1, high = stMemLength(events[code]);
+	while (low < high) {
+		const u32 mid = low + (high - low) / 2;
+		if ((uintptr_t)events[code][mid].sender < (uintptr_t)sender) low = mid + 1;
+		else high = mid;
+	}
+	return low;
+}
+
+/**
+ * Finds the group of callbacks for the specified sender.
+ * @param code Event code.
+ * @param sender Sender to look for.
+ * @return Index of the group, or -1 if nothing has subscribed to that sender.
+ */
+static STUPID_INLINE i32 eventFindGroup(const st_event_code code, const void *sender)
+{
+	if (events[code] == NULL) return -1;
+	if (sender == STUPID_EVENT_SENDER_ANY) return 0;
+
+	const u32 group = eventLowerBound(code, sender);
+	if (group < stMemLength(events[code]) && events[code][group].sender == sender) return group;
+	return -1;
+}
+
+/**
+ * Points the handle table slots of every callback in a group at the groups current index.
+ * @param code Event code.
+ * @param group The group.
+ */
+static void eventRenumberGroup(const st_event_code code, const u32 group)
+{
+	const StEventGroup *pGroup = &events[code][group];
+	for (u32 i = 0; i < stMemLength(pGroup->handles); i++)
+		event_slots[pGroup->handles[i]].group = group;
+}
+
+/**
+ * Removes a sender specific group (once it has no callbacks left).
+ * @param code Event code.
+ * @param group The group (not 0).
+ */
+static void eventRemoveGroup(const st_event_code code, const u32 group)
+{
+	StEventGroup *pGroup = &events[code][group];
+	stMemDeallocNL(pGroup->events);
+	stMemDeallocNL(pGroup->handles);
+
+	// shifted down (instead of swapped) to keep the groups sorted
+	const u32 count = stMemLength(events[code]);
+	stMemMove(&events[code][group], &events[code][group + 1], (count - group - 1) * sizeof(StEventGroup));
+	stMemSetLength(events[code], count - 1);
+	event_groups_version++;
+
+	for (u32 g = group; g < count - 1; g++)
+		eventRenumberGroup(code, g);
+}
+
+/**
+ * Takes a callback out of its group by moving the last callback in the group into its place.
+ * @param code Event code.
+ * @param group Group the callback is in.
+ * @param index Position of the callback in its group.
+ * @note Frees its handle table slot.
+ */
+static void eventCompact(const st_event_code code, const u32 group, const u32 index)
+{
+	StEventGroup *pGroup = &events[code][group];
+	const u32 last = stMemLength(pGroup->events) - 1;
+
+	eventSlotFree(pGroup->handles[index]);
+
+	if (index != last) {
+		pGroup->events[index] = pGroup->events[last];
+		pGroup->handles[index] = pGroup->handles[last];
+		event_slots[pGroup->handles[index]].index = index;
+	}
+
+	stMemSetLength(pGroup->events, last);
+	stMemSetLength(pGroup->handles, last);
+
+	if (last == 0 && group != 0)
+		eventRemoveGroup(code, group);
+}
+
+/**
+ * Unregisters a callback.
+ * @param code Event code.
+ * @param group Group the callback is in.
+ * @param index Position of the callback in its group.
+ * @note While an event is being fired the callback is only cleared, and taken out once stEventFire() returns,
+ * so nothing moves under the loop calling the callbacks (callbacks often unregister themselves).
+ */
+static void eventRemove(const st_event_code code, const u16 group, const u32 index)
+{
+	StEventGroup *pGroup = &events[code][group];
+
+	if (event_fire_depth > 0) {
+		// the slot stays allocated (so it cant be reused) until eventRemovePending() takes the callback out
+		event_slots[pGroup->handles[index]].used = false;
+		pGroup->events[index].pfn = NULL;
+		event_removal_pending = true;
+		return;
+	}
+
+	eventCompact(code, group, index);
+}
+
+/**
+ * Takes out every callback that was unregistered while firing.
+ */
+static void eventRemovePending(void)
+{
+	for (u32 code = 0; code < ST_MAX_STUPID_EVENT_CODES; code++) {
+		if (events[code] == NULL) continue;
+
+		// walk backwards so removing a group or a callback only moves ones that have already been checked
+		for (u32 g = stMemLength(events[code]); g-- > 0;) {
+			for (u32 i = stMemLength(events[code][g].events); i-- > 0;) {
+				if (events[code][g].events[i].pfn == NULL)
+					eventCompact(code, g, i);
+			}
+		}
+	}
 
-void (stEventRegister)(const st_event_code code, const void *listener, const StPFN_event pfn STUPID_DBG_PROTO_PARAMS)
+	event_removal_pending = false;
+}
+
+StEventHandle (stEventSubscribe)(const st_event_code code, const void *sender, const void *listener, const StPFN_event pfn STUPID_DBG_PROTO_PARAMS)
 {
 	STUPID_ASSERT(code < ST_MAX_STUPID_EVENT_CODES, "event code out of bounds");
 	STUPID_NC(pfn);
 
-	if (events[code] == NULL)
-		events[code] = stMemAlloc(StEvent, ST_MAX_EVENTS_PER_CODE);
+	if (events[code] == NULL) {
+		events[code] = stMemAllocNL(StEventGroup, ST_EVENT_INITIAL_CAPACITY);
+		stMemSetLength(events[code], 1);
+		events[code][0].sender  = STUPID_EVENT_SENDER_ANY;
+		events[code][0].events  = stMemAllocNL(StEvent, ST_EVENT_INITIAL_CAPACITY);
+		events[code][0].handles = stMemAllocNL(u32, ST_EVENT_INITIAL_CAPACITY);
+	}
+
+	i32 group = eventFindGroup(code, sender);
+	if (group < 0) {
+		StEventGroup new_group = {
+			.sender  = sender,
+			.events  = stMemAllocNL(StEvent, ST_EVENT_INITIAL_CAPACITY),
+			.handles = stMemAllocNL(u32, ST_EVENT_INITIAL_CAPACITY)
+		};
+		group = eventLowerBound(code, sender);
+		STUPID_ASSERT(stMemLength(events[code]) <= UINT16_MAX, "too many senders subscribed to for one event code");
+		stMemInsertNL(events[code], group, new_group);
+		event_groups_version++;
+
+		// the groups after it moved up one
+		for (u32 g = group + 1; g < stMemLength(events[code]); g++)
+			eventRenumberGroup(code, g);
+	}
+
+	StEventGroup *pGroup = &events[code][group];
+
+	const u32 index = stMemLength(pGroup->events);
+	STUPID_ASSERT(index < ST_MAX_EVENTS_PER_CODE, "too many callbacks registered for one event code");
+
+	if (index == stMemCapacity(pGroup->events)) {
+		stMemResizeNL(pGroup->events, index * 2);
+		stMemResizeNL(pGroup->handles, index * 2);
+	}
+
+	const u32 slot = eventSlotAlloc(code, group, index);
+
+	pGroup->events[index] = (StEvent){.pfn = pfn, .listener = listener};
+	pGroup->handles[index] = slot;
+	stMemSetLength(pGroup->events, index + 1);
+	stMemSetLength(pGroup->handles, index + 1);
 
-	StEvent e = {.pfn = pfn, .listener = listener};
-	stMemAppend(events[code], e);
+	STUPID_LOG_TRACEFN("registered event: code %d sender %p listener %p", code, sender, listener);
 
-	STUPID_LOG_TRACEFN("registered event: code %d listener %p", code, listener);
+	return ((StEventHandle)event_slots[slot].generation << 32) | slot;
+}
+
+bool stEventUnregisterHandle(const StEventHandle handle)
+{
+	const u32 slot = (u32)handle;
+	const u32 generation = (u32)(handle >> 32);
+
+	if (event_slots == NULL || slot >= stMemLength(event_slots)) return false;
+
+	const StEventSlot *pSlot = &event_slots[slot];
+	if (!pSlot->used || pSlot->generation != generation) return false;
+
+	eventRemove(pSlot->code, pSlot->group, pSlot->index);
+	return true;
 }
 
 void stEventUnregister(const st_event_code code, const void *listener, const StPFN_event pfn)
@@ -31,10 +372,13 @@ void stEventUnregister(const st_event_code code, const void *listener, const StP
 
 	if (events[code] == NULL) return;
 
-	for (int i = 0; i < ST_MAX_STUPID_EVENT_CODES; i++) {
-		if (events[code][i].listener == listener && events[code][i].pfn == pfn) {
-			stMemRemove(events[code], i, NULL);
-			break;
+	for (u32 g = 0; g < stMemLength(events[code]); g++) {
+		const StEventGroup *pGroup = &events[code][g];
+		for (u32 i = 0; i < stMemLength(pGroup->events); i++) {
+			if (pGroup->events[i].listener == listener && pGroup->events[i].pfn == pfn) {
+				eventRemove(code, g, i);
+				return;
+			}
 		}
 	}
 }
@@ -43,18 +387,32 @@ void stEventUnregisterCode(const st_event_code code)
 {
 	STUPID_ASSERT(code < ST_MAX_STUPID_EVENT_CODES, "event code out of bounds");
 	if (events[code] == NULL) return;
-	stMemDealloc(events[code]);
+
+	for (u32 g = 0; g < stMemLength(events[code]); g++) {
+		StEventGroup *pGroup = &events[code][g];
+		for (u32 i = 0; i < stMemLength(pGroup->events); i++)
+			eventSlotFree(pGroup->handles[i]);
+
+		stMemDeallocNL(pGroup->events);
+		stMemDeallocNL(pGroup->handles);
+	}
+
+	stMemDeallocNL(events[code]);
+	event_groups_version++;
 }
 
 void stEventUnregisterListener(const st_event_code code, const void *listener)
 {
+	STUPID_ASSERT(code < ST_MAX_STUPID_EVENT_CODES, "event code out of bounds");
 	if (listener == NULL) return;
 	if (events[code] == NULL) return;
 
-	for (int i = 0; i < ST_MAX_STUPID_EVENT_CODES; i++) {
-		if (events[code][i].listener == listener) {
-			stMemRemove(events[code], i, NULL);
-			break;
+	// walk backwards so swap removal (and removing empty groups) only moves things that have already been checked
+	for (u32 g = stMemLength(events[code]); g-- > 0;) {
+		for (u32 i = stMemLength(events[code][g].events); i-- > 0;) {
+			const StEvent e = events[code][g].events[i];
+			if (e.pfn != NULL && e.listener == listener)
+				eventRemove(code, g, i);
 		}
 	}
 }
@@ -63,7 +421,115 @@ void stEventDealloc(void)
 {
 	for (int i = 0; i < ST_MAX_STUPID_EVENT_CODES; i++) {
 		if (events[i] != NULL)
-			stMemDealloc(events[i]);
+			stEventUnregisterCode(i);
+	}
+
+	if (event_slots != NULL)
+		stMemDealloc(event_slots);
+	event_free_slot = UINT32_MAX;
+}
+
+bool stEventPost(const st_event_code code, void *sender, const StEventData data)
+{
+	if (STUPID_UNLIKELY(code >= ST_MAX_STUPID_EVENT_CODES)) return false;
+
+	usize pos = atomic_load_explicit(&post_queue.head, memory_order_relaxed);
+
+	while (true) {
+		const intptr_t diff = (intptr_t)postedEventSequence(pos) - (intptr_t)pos;
+
+		if (diff == 0) {
+			if (atomic_compare_exchange_weak_explicit(&post_queue.head, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed))
+				break;
+		}
+		else if (diff < 0) {
+			// the consumer hasnt caught up yet
+			atomic_fetch_add_explicit(&post_queue.dropped, 1, memory_order_relaxed);
+			return false;
+		}
+		else pos = atomic_load_explicit(&post_queue.head, memory_order_relaxed);
+	}
+
+	StPostedEvent *slot = &post_queue.slots[pos & (ST_MAX_POSTED_EVENTS - 1)];
+	slot->time   = stGetTime();
+	slot->code   = code;
+	slot->sender = sender;
+	slot->data   = data;
+	postedEventSetSequence(pos, pos + 1);
+	atomic_fetch_add_explicit(&post_queue.posted, 1, memory_order_relaxed);
+
+	return true;
+}
+
+u32 stEventDispatchPosted(void)
+{
+	u32 count = 0;
+	while (postedEventSequence(post_queue.tail) == post_queue.tail + 1) {
+		const StPostedEvent *slot = &post_queue.slots[post_queue.tail & (ST_MAX_POSTED_EVENTS - 1)];
+
+		// copy the event out so the slot can be reused by producers while its being fired
+		const st_event_code code = slot->code;
+		void *sender = slot->sender;
+		const StEventData data = slot->data;
+		const f64 latency = stGetTime() - slot->time;
+
+		postedEventSetSequence(post_queue.tail, post_queue.tail + ST_MAX_POSTED_EVENTS);
+		post_queue.tail++;
+
+		post_queue.latency_total += latency;
+		post_queue.latency_min = (post_queue.dispatched) ? STUPID_MIN(post_queue.latency_min, latency) : latency;
+		post_queue.latency_max = STUPID_MAX(post_queue.latency_max, latency);
+		post_queue.dispatched++;
+
+		stEventFire(code, sender, data);
+		count++;
+	}
+
+	return count;
+}
+
+StEventPostStats stEventGetPostStats(void)
+{
+	StEventPostStats stats = {0};
+	stats.posted        = atomic_load(&post_queue.posted);
+	stats.dropped       = atomic_load(&post_queue.dropped);
+	stats.dispatched    = post_queue.dispatched;
+	stats.latency_min   = post_queue.latency_min;
+	stats.latency_max   = post_queue.latency_max;
+	stats.latency_total = post_queue.latency_total;
+	return stats;
+}
+
+void stEventResetPostStats(void)
+{
+	atomic_store(&post_queue.posted, 0);
+	atomic_store(&post_queue.dropped, 0);
+	post_queue.dispatched    = 0;
+	post_queue.latency_min   = 0.0;
+	post_queue.latency_max   = 0.0;
+	post_queue.latency_total = 0.0;
+}
+
+/**
+ * Calls every callback in a group.
+ * @param code Event code.
+ * @param group_sender Sender of the group to call (STUPID_EVENT_SENDER_ANY for the wildcard group).
+ * @param sender Pointer associated with the source of the event.
+ * @param data Argument to pass to each function.
+ */
+static STUPID_INLINE void eventFireGroup(const st_event_code code, const void *group_sender, void *sender, const StEventData data)
+{
+	// the group is looked up again whenever a callback adds or removes groups, since that can move it
+	i32 group = eventFindGroup(code, group_sender);
+	for (u32 i = 0; group >= 0 && i < stMemLength(events[code][group].events); i++) {
+		const StEvent e = events[code][group].events[i];
+
+		// unregistered earlier in this fire
+		if (e.pfn == NULL) continue;
+
+		const u32 version = event_groups_version;
+		e.pfn(code, sender, (void *)e.listener, data);
+		if (version != event_groups_version) group = eventFindGroup(code, group_sender);
 	}
 }
 
@@ -72,9 +538,14 @@ void stEventFire(const st_event_code code, void *sender, const StEventData data)
 	STUPID_ASSERT(code < ST_MAX_STUPID_EVENT_CODES, "event code out of bounds");
 
 	if (events[code] == NULL) return;
-	for (int i = 0; i < stMemLength(events[code]); i++) {
-		STUPID_NC(events[code][i].pfn);
-		events[code][i].pfn(code, sender, (void *)events[code][i].listener, data);
-	}
-}
 
+	event_fire_depth++;
+
+	eventFireGroup(code, STUPID_EVENT_SENDER_ANY, sender, data);
+	if (sender != STUPID_EVENT_SENDER_ANY)
+		eventFireGroup(code, sender, sender, data);
+
+	event_fire_depth--;
+	if (event_fire_depth == 0 && event_removal_pending)
+		eventRemovePending();
+}
@@ -0,0 +1,282 @@
+/// @file framestats.c
+/// @brief Frame time statistics.
+/// @author nonexistant
+
+#include "stupid/framestats.h"
+#include "stupid/assert.h"
+#include "stupid/logger.h"
+#include "stupid/memory.h"
+
+const char *st_frame_phase_names[ST_FRAME_PHASE_MAX] = {
+	"poll",
+	"tick",
+	"snapshot",
+	"prepare",
+	"start",
+	"draw",
+	"end",
+	"wait",
+	"frame",
+};
+
+/**
+ * Gets the bucket a duration goes in.
+ * @param ns Duration in nanoseconds.
+ * @return Index of the bucket.
+ */
+static STUPID_INLINE u32 histogramIndex(u64 ns)
+{
+	ns = STUPID_MIN(ns, (1llu << ST_HISTOGRAM_MAX_BITS) - 1);
+	if (ns < ST_HISTOGRAM_SUB_BUCKETS) return (u32)ns;
+
+	// keep the top ST_HISTOGRAM_SUB_BITS + 1 bits
+	const u32 exponent = 63 - __builtin_clzll(ns);
+	const u32 shift    = exponent - ST_HISTOGRAM_SUB_BITS;
+	return (shift + 1) * ST_HISTOGRAM_SUB_BUCKETS + (u32)((ns >> shift) - ST_HISTOGRAM_SUB_BUCKETS);
+}
+
+/**
+ * Gets the middle of a bucket.
+ * @param index Index of the bucket.
+ * @return Duration in nanoseconds.
+ */
+static STUPID_INLINE u64 histogramValue(const u32 index)
+{
+	if (index < ST_HISTOGRAM_SUB_BUCKETS) return index;
+
+	const u32 shift = index / ST_HISTOGRAM_SUB_BUCKETS - 1;
+	const u64 lower = (u64)(index % ST_HISTOGRAM_SUB_BUCKETS + ST_HISTOGRAM_SUB_BUCKETS) << shift;
+	return lower + ((1llu << shift) >> 1);
+}
+
+void stHistogramRecord(StHistogram *pHistogram, const u64 ns)
+{
+	STUPID_NC(pHistogram);
+
+	pHistogram->buckets[histogramIndex(ns)]++;
+	pHistogram->min    = (pHistogram->count == 0) ? ns : STUPID_MIN(pHistogram->min, ns);
+	pHistogram->max    = STUPID_MAX(pHistogram->max, ns);
+	pHistogram->total += ns;
+	pHistogram->count++;
+}
+
+u64 stHistogramPercentile(const StHistogram *pHistogram, const f64 percentile)
+{
+	STUPID_NC(pHistogram);
+
+	if (pHistogram->count == 0) return 0;
+
+	// number of durations at or below the percentile
+	u64 target = (u64)(percentile / 100.0 * (f64)pHistogram->count + 0.999999);
+	target = STUPID_CLAMP(target, 1, pHistogram->count);
+
+	u64 seen = 0;
+	for (u32 i = 0; i < ST_HISTOGRAM_BUCKETS; i++) {
+		seen += pHistogram->buckets[i];
+		if (seen >= target)
+			return STUPID_CLAMP(histogramValue(i), pHistogram->min, pHistogram->max);
+	}
+
+	return pHistogram->max;
+}
+
+void stHistogramReset(StHistogram *pHistogram)
+{
+	STUPID_NC(pHistogram);
+	stMemset(pHistogram, 0, sizeof(*pHistogram));
+}
+
+/**
+ * Summarizes a histogram.
+ * @param pHistogram Pointer to a histogram.
+ * @return Summary in seconds.
+ */
+static StFrameStatsSummary frameStatsSummarize(const StHistogram *pHistogram)
+{
+	StFrameStatsSummary summary = {0};
+	summary.count = pHistogram->count;
+	if (pHistogram->count == 0) return summary;
+
+	summary.mean = STUPID_NS_TO_SEC((f64)pHistogram->total / (f64)pHistogram->count);
+	summary.p50  = STUPID_NS_TO_SEC((f64)stHistogramPercentile(pHistogram, 50.0));
+	summary.p95  = STUPID_NS_TO_SEC((f64)stHistogramPercentile(pHistogram, 95.0));
+	summary.p99  = STUPID_NS_TO_SEC((f64)stHistogramPercentile(pHistogram, 99.0));
+	summary.p999 = STUPID_NS_TO_SEC((f64)stHistogramPercentile(pHistogram, 99.9));
+	summary.max  = STUPID_NS_TO_SEC((f64)pHistogram->max);
+	return summary;
+}
+
+/**
+ * Writes the stats for the current interval to the dump file.
+ * @param pStats Pointer to the stats.
+ * @param time Time since the stats were created.
+ */
+static void frameStatsDump(StFrameStats *pStats, const f64 time)
+{
+	FILE *file = pStats->dump;
+
+	if (pStats->format == ST_FRAME_STATS_FORMAT_JSON)
+		fprintf(file, "{\"time\":%.3lf,\"fps\":%.2lf", time, pStats->fps);
+
+	for (u32 i = 0; i < ST_FRAME_PHASE_MAX; i++) {
+		const StFrameStatsSummary s = frameStatsSummarize(&pStats->window[i]);
+
+		// milliseconds are easier to read on a dashboard
+		if (pStats->format == ST_FRAME_STATS_FORMAT_JSON)
+			fprintf(file, ",\"%s\":{\"count\":%lu,\"mean\":%.4lf,\"p50\":%.4lf,\"p95\":%.4lf,\"p99\":%.4lf,\"p999\":%.4lf,\"max\":%.4lf}",
+			        st_frame_phase_names[i], s.count, STUPID_SEC_TO_MS(s.mean), STUPID_SEC_TO_MS(s.p50), STUPID_SEC_TO_MS(s.p95),
+			        STUPID_SEC_TO_MS(s.p99), STUPID_SEC_TO_MS(s.p999), STUPID_SEC_TO_MS(s.max));
+		else
+			fprintf(file, "%.3lf,%s,%lu,%.4lf,%.4lf,%.4lf,%.4lf,%.4lf,%.4lf\n",
+			        time, st_frame_phase_names[i], s.count, STUPID_SEC_TO_MS(s.mean), STUPID_SEC_TO_MS(s.p50), STUPID_SEC_TO_MS(s.p95),
+			        STUPID_SEC_TO_MS(s.p99), STUPID_SEC_TO_MS(s.p999), STUPID_SEC_TO_MS(s.max));
+	}
+
+	if (pStats->format == ST_FRAME_STATS_FORMAT_JSON)
+		fprintf(file, "}\n");
+
+	// so a dashboard tailing the file sees every interval as soon as it ends
+	fflush(file);
+}
+
+StFrameStats *stFrameStatsCreate(void)
+{
+	StFrameStats *pStats = stMemAlloc(StFrameStats, 1);
+	pStats->interval       = ST_FRAME_STATS_DUMP_INTERVAL;
+	pStats->start_time     = stGetTime();
+	pStats->frame_start    = pStats->start_time;
+	pStats->interval_start = pStats->start_time;
+	return pStats;
+}
+
+void stFrameStatsDestroy(StFrameStats *pStats)
+{
+	STUPID_NC(pStats);
+
+	if (pStats->dump) fclose(pStats->dump);
+	stMemDealloc(pStats);
+}
+
+void stFrameStatsEndFrame(StFrameStats *pStats)
+{
+	STUPID_NC(pStats);
+
+	const f64 now = stGetTime();
+	pStats->current[ST_FRAME_PHASE_FRAME] = now - pStats->frame_start;
+	pStats->ran |= 1 << ST_FRAME_PHASE_FRAME;
+
+	// phases that didnt run this frame (like ticks) would drag the percentiles down if they were recorded as 0
+	for (u32 i = 0; i < ST_FRAME_PHASE_MAX; i++) {
+		if ((pStats->ran & (1 << i)) == 0) continue;
+
+		const u64 ns = (u64)STUPID_SEC_TO_NS(STUPID_MAX(pStats->current[i], 0.0));
+		stHistogramRecord(&pStats->total[i], ns);
+		stHistogramRecord(&pStats->window[i], ns);
+	}
+
+	stFrameStatsDiscardFrame(pStats);
+	pStats->frame_start = now;
+
+	const f64 elapsed = now - pStats->interval_start;
+	if (elapsed >= pStats->interval) {
+		pStats->fps = (f64)pStats->window[ST_FRAME_PHASE_FRAME].count / elapsed;
+		if (pStats->dump) frameStatsDump(pStats, now - pStats->start_time);
+
+		for (u32 i = 0; i < ST_FRAME_PHASE_MAX; i++)
+			stHistogramReset(&pStats->window[i]);
+		pStats->interval_start = now;
+	}
+}
+
+void stFrameStatsDiscardFrame(StFrameStats *pStats)
+{
+	STUPID_NC(pStats);
+
+	stMemset(pStats->current, 0, sizeof(pStats->current));
+	pStats->ran         = 0;
+	pStats->frame_start = stGetTime();
+}
+
+StFrameStatsSummary stFrameStatsGetSummary(const StFrameStats *pStats, const st_frame_phase phase)
+{
+	STUPID_NC(pStats);
+	STUPID_ASSERT(phase < ST_FRAME_PHASE_MAX, "invalid frame phase");
+
+	return frameStatsSummarize(&pStats->total[phase]);
+}
+
+f64 stFrameStatsGetFps(const StFrameStats *pStats)
+{
+	STUPID_NC(pStats);
+	return pStats->fps;
+}
+
+void stFrameStatsReset(StFrameStats *pStats)
+{
+	STUPID_NC(pStats);
+
+	for (u32 i = 0; i < ST_FRAME_PHASE_MAX; i++) {
+		stHistogramReset(&pStats->total[i]);
+		stHistogramReset(&pStats->window[i]);
+	}
+	stFrameStatsDiscardFrame(pStats);
+	pStats->interval_start = pStats->frame_start;
+}
+
+bool stFrameStatsDumpTo(StFrameStats *pStats, const char *path, const st_frame_stats_format format, const f64 interval)
+{
+	STUPID_NC(pStats);
+	STUPID_NC(path);
+
+	FILE *file = fopen(path, "w");
+	if (file == NULL) {
+		STUPID_LOG_ERROR("failed to open %s", path);
+		return false;
+	}
+
+	if (pStats->dump) fclose(pStats->dump);
+	pStats->dump     = file;
+	pStats->format   = format;
+	pStats->interval = (interval > 0.0) ? interval : ST_FRAME_STATS_DUMP_INTERVAL;
+
+	if (format == ST_FRAME_STATS_FORMAT_CSV)
+		fprintf(file, "time,phase,count,mean_ms,p50_ms,p95_ms,p99_ms,p999_ms,max_ms\n");
+
+	STUPID_LOG_SYSTEM("dumping frame stats to %s every %.2lfs", path, pStats->interval);
+	return true;
+}
+
+void stFrameStatsLog(const StFrameStats *pStats)
+{
+	STUPID_NC(pStats);
+
+	STUPID_LOG_INFO("framerate: %.2lf", pStats->fps);
+	for (u32 i = 0; i < ST_FRAME_PHASE_MAX; i++) {
+		const StFrameStatsSummary s = stFrameStatsGetSummary(pStats, i);
+		if (s.count == 0) continue;
+
+		STUPID_LOG_INFO("%-8s %8lu samples, mean %7.3lfms p50 %7.3lfms p95 %7.3lfms p99 %7.3lfms p99.9 %7.3lfms max %7.3lfms",
+		                st_frame_phase_names[i], s.count, STUPID_SEC_TO_MS(s.mean), STUPID_SEC_TO_MS(s.p50), STUPID_SEC_TO_MS(s.p95),
+		                STUPID_SEC_TO_MS(s.p99), STUPID_SEC_TO_MS(s.p999), STUPID_SEC_TO_MS(s.max));
+	}
+}
+
+void stFrameStatsPrint(const StFrameStats *pStats, FILE *file)
+{
+	STUPID_NC(pStats);
+	STUPID_NC(file);
+
+	// queued logs are written with write(2), so they have to be out before this goes through file
+	stLogFlush();
+
+	fprintf(file, "%-8s %8s %10s %10s %10s %10s %10s %10s\n", "phase", "count", "mean_ms", "p50_ms", "p95_ms", "p99_ms", "p999_ms", "max_ms");
+	for (u32 i = 0; i < ST_FRAME_PHASE_MAX; i++) {
+		const StFrameStatsSummary s = stFrameStatsGetSummary(pStats, i);
+		if (s.count == 0) continue;
+
+		fprintf(file, "%-8s %8lu %10.4lf %10.4lf %10.4lf %10.4lf %10.4lf %10.4lf\n",
+		        st_frame_phase_names[i], s.count, STUPID_SEC_TO_MS(s.mean), STUPID_SEC_TO_MS(s.p50), STUPID_SEC_TO_MS(s.p95),
+		        STUPID_SEC_TO_MS(s.p99), STUPID_SEC_TO_MS(s.p999), STUPID_SEC_TO_MS(s.max));
+	}
+	fflush(file);
+}
@@ -1,22 +1,141 @@
 #include "stupid/logger.h"
+#include "stupid/binlog.h"
 #include "stupid/thread.h"
 
+#include <errno.h>
+#include <pthread.h>
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+STUPID_ATOMIC u8 st_log_levels[ST_LOG_MODULE_MAX] = {
+	[0 ... ST_LOG_MODULE_MAX - 1] = ST_LOG_LEVEL_MAX,
+};
+
+/// Names of each module used by stLogSetLevels().
+static const char *log_module_names[ST_LOG_MODULE_MAX] = {
+	"general",
+	"memory",
+	"thread",
+	"render",
+	"vulkan",
+	"window",
+	"event",
+};
+
+/// Names of each log level used by stLogSetLevels().
+static const char *log_level_names[ST_LOG_LEVEL_MAX] = {
+	"crit",
+	"fatal",
+	"error",
+	"warn",
+	"system",
+	"info",
+	"debug",
+	"spam",
+	"trace",
+};
+
+/// Token bucket limiting how many logs of one level get printed.
+typedef struct StLogBucket {
+	/// Tokens added per second (0 for no limit).
+	f64 rate;
+
+	/// Maximum number of tokens.
+	f64 burst;
+
+	/// Tokens left (each printed log takes one).
+	f64 tokens;
+
+	/// When tokens was last refilled.
+	f64 last;
+} StLogBucket;
+
+/// Rate limit for each log level.
+/// @note Critical and fatal logs are never limited, and spam and trace logs arent limited by default.
+static StLogBucket log_buckets[ST_LOG_LEVEL_MAX] = {
+	[ST_LOG_LEVEL_ERROR]   = {20.0,  100.0, 100.0, 0.0},
+	[ST_LOG_LEVEL_WARNING] = {20.0,  100.0, 100.0, 0.0},
+	[ST_LOG_LEVEL_SYSTEM]  = {50.0,  200.0, 200.0, 0.0},
+	[ST_LOG_LEVEL_INFO]    = {50.0,  200.0, 200.0, 0.0},
+	[ST_LOG_LEVEL_DEBUG]   = {100.0, 500.0, 500.0, 0.0},
+};
+
+/// If repeats of the same message from a call site are counted instead of printed, for each log level.
+/// @note Off by default because it costs formatting and hashing every log, even the ones that end up being dropped.
+static STUPID_ATOMIC bool log_dedup[ST_LOG_LEVEL_MAX] = {0};
+
+/// Protects log_buckets.
+static StMutex limit_lock = {0};
 
 /// Used to make sure only one log is printed at a time.
 static StMutex logger_lock = {0};
 
-/// Buffer used for storing log messages.
-/// @note This is statically allocated to avoid a stupid logger init function.
-static char log_buffer[sizeof(StKb) * 8] = {0};
-
-/// Used to prevent infinite recursion when logging an error with the logger.
-static bool failed_to_print = false;
+/// Buffer used for formatting log messages.
+/// @note This is thread local so threads never wait on each other to format a log.
+static _Thread_local char log_buffer[ST_LOG_MAX_LENGTH];
 
 /// Used to replace replacable spam logs.
 static bool last_log_is_replaceable = false;
 
+/// Written before a log that replaces a replaceable log.
+static const char clear_line[] = "\033[2K\r";
+
+/// A log waiting in the async log queue.
+typedef struct StLogSlot {
+	/// @brief Sequence number of this slot minus its index.
+	/// Equal to the queue position when the slot is free, and the queue position + 1 once its been written.
+	/// @note Works the same way as the event post queue.
+	STUPID_ATOMIC usize sequence;
+
+	/// File descriptor to write to.
+	int fd;
+
+	/// If the next log should replace this one.
+	bool replaceable;
+
+	/// Length of text.
+	u32 length;
+
+	/// The formatted log.
+	char text[ST_LOG_QUEUE_MAX_LENGTH];
+} StLogSlot;
+
+STUPID_STATIC_ASSERT(STUPID_IS_POWER2(ST_LOG_QUEUE_SIZE), "ST_LOG_QUEUE_SIZE is not a power of 2");
+
+/// @brief Bounded multi producer single consumer log queue.
+/// Logging threads claim a slot by bumping head, and the writer thread frees them by bumping tail.
+static struct {
+	STUPID_ALIGN(64) STUPID_ATOMIC usize head;
+	STUPID_ALIGN(64) STUPID_ATOMIC usize tail;
+	STUPID_ALIGN(64) StLogSlot slots[ST_LOG_QUEUE_SIZE];
+
+	/// The writer thread.
+	pthread_t writer;
+
+	/// Number of threads currently putting a log in the queue.
+	STUPID_ATOMIC u32 producers;
+
+	/// If logs should be put in the queue.
+	STUPID_ATOMIC bool enabled;
+
+	/// If the writer thread should keep running.
+	STUPID_ATOMIC bool running;
+
+	/// If the last log written by the writer thread was replaceable.
+	bool replaceable;
+
+	st_log_policy policy;
+
+	STUPID_ATOMIC u64 queued;
+	STUPID_ATOMIC u64 dropped;
+	STUPID_ATOMIC u64 written;
+	STUPID_ATOMIC u64 batches;
+} log_queue = {0};
+
 /// ANSI text colors.
 static const char colors[ST_TEXT_COLOR_MAX] = {
 	'7', // white
@@ -51,6 +170,282 @@ static const char *bright_background_colors[ST_TEXT_BACKGROUND_MAX] = {
 	";106", // cyan
 };
 
+/// strings at the start of different log levels
+static const char *log_level_strings[] = {
+	"\033[35;1;4;107m[CRIT]:   ",
+	"\033[93;1;41m[FATAL]:   \033[0;93;41;4m",
+	"\033[91;1m[ERROR]:  \033[0;31m",
+	"\033[33;1m[WARN]:   \033[0;33;3m",
+	"\033[96;1m[SYSTEM]: \033[0;96;3m",
+	"\033[92;1m[INFO]:   \033[0;32m",
+	"\033[34;1m[DEBUG]:  \033[0;34m",
+	"\033[2;1m[SPAM]:   \033[0;2m",
+	"\033[2;1m[TRACE]:  \033[0;2;3m"
+};
+
+/// Gets the sequence number of the slot at the specified position in the log queue.
+static STUPID_INLINE usize logSlotSequence(const usize pos)
+{
+	const usize index = pos & (ST_LOG_QUEUE_SIZE - 1);
+	return atomic_load_explicit(&log_queue.slots[index].sequence, memory_order_acquire) + index;
+}
+
+/// Sets the sequence number of the slot at the specified position in the log queue.
+static STUPID_INLINE void logSetSlotSequence(const usize pos, const usize sequence)
+{
+	const usize index = pos & (ST_LOG_QUEUE_SIZE - 1);
+	atomic_store_explicit(&log_queue.slots[index].sequence, sequence - index, memory_order_release);
+}
+
+/**
+ * Writes all of the specified buffers to a file descriptor.
+ * @param fd File descriptor to write to.
+ * @param iov Buffers to write (modified if the write is partial).
+ * @param count Number of buffers.
+ */
+static void logWritev(const int fd, struct iovec *iov, int count)
+{
+	while (count > 0) {
+		ssize_t written = writev(fd, iov, count);
+		if (written < 0) {
+			if (errno == EINTR) continue;
+			return;
+		}
+
+		// skip whatever was fully written and write the rest of a partially written buffer next time
+		while (count > 0 && (usize)written >= iov->iov_len) {
+			written -= iov->iov_len;
+			iov++;
+			count--;
+		}
+		if (count > 0) {
+			iov->iov_base = (u8 *)iov->iov_base + written;
+			iov->iov_len -= written;
+		}
+	}
+}
+
+/**
+ * Writes a log directly once everything queued before it has been written.
+ * @param fd File descriptor to write to.
+ * @param text The formatted log.
+ * @param length Length of text.
+ * @note The caller must not be counted in log_queue.producers.
+ */
+static void logWriteAfterQueue(const int fd, const char *text, const u32 length)
+{
+	stLogFlush();
+	struct iovec iov = {(void *)text, length};
+	logWritev(fd, &iov, 1);
+}
+
+/**
+ * Puts a log in the async log queue.
+ * @param fd File descriptor to write to.
+ * @param text The formatted log.
+ * @param length Length of text.
+ * @param replaceable If the next log should replace this one.
+ * @param level Level of the log (critical and fatal logs are never dropped, even with ST_LOG_POLICY_DROP).
+ * @return False if the async logger is not running (the log has to be written immediately instead).
+ */
+static bool logEnqueue(const int fd, const char *text, const u32 length, const bool replaceable, const st_log_level level)
+{
+	// stLogAsyncStop() waits for this to reach 0 before stopping the writer thread
+	atomic_fetch_add(&log_queue.producers, 1);
+	if (!atomic_load(&log_queue.enabled)) {
+		atomic_fetch_sub(&log_queue.producers, 1);
+		return false;
+	}
+
+	// too long for a slot
+	if (length > ST_LOG_QUEUE_MAX_LENGTH) {
+		atomic_fetch_sub(&log_queue.producers, 1);
+		logWriteAfterQueue(fd, text, length);
+		return true;
+	}
+
+	usize pos = atomic_load_explicit(&log_queue.head, memory_order_relaxed);
+	while (true) {
+		const intptr_t diff = (intptr_t)logSlotSequence(pos) - (intptr_t)pos;
+		if (diff == 0) {
+			if (atomic_compare_exchange_weak_explicit(&log_queue.head, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed))
+				break;
+		}
+		// the queue is full
+		else if (diff < 0) {
+			// the program is probably about to die, so let the writer catch up and write it from here
+			if (level <= ST_LOG_LEVEL_FATAL) {
+				atomic_fetch_sub(&log_queue.producers, 1);
+				logWriteAfterQueue(fd, text, length);
+				return true;
+			}
+			if (log_queue.policy == ST_LOG_POLICY_DROP) {
+				atomic_fetch_add_explicit(&log_queue.dropped, 1, memory_order_relaxed);
+				atomic_fetch_sub(&log_queue.producers, 1);
+				return true;
+			}
+			stSleepu(1);
+			pos = atomic_load_explicit(&log_queue.head, memory_order_relaxed);
+		}
+		else pos = atomic_load_explicit(&log_queue.head, memory_order_relaxed);
+	}
+
+	StLogSlot *slot = &log_queue.slots[pos & (ST_LOG_QUEUE_SIZE - 1)];
+	slot->fd          = fd;
+	slot->replaceable = replaceable;
+	slot->length      = length;
+	stMemcpy(slot->text, text, length);
+	logSetSlotSequence(pos, pos + 1);
+
+	atomic_fetch_add_explicit(&log_queue.queued, 1, memory_order_relaxed);
+	atomic_fetch_sub(&log_queue.producers, 1);
+	return true;
+}
+
+/**
+ * Writes up to ST_LOG_MAX_BATCH queued logs.
+ * @return Number of logs written.
+ * @note Consecutive logs going to the same file descriptor are written with a single writev().
+ */
+static u32 logDrain(void)
+{
+	// each log may need clear_line before it
+	struct iovec iov[ST_LOG_MAX_BATCH * 2];
+	int iov_count = 0;
+	int fd = -1;
+
+	const usize start = atomic_load_explicit(&log_queue.tail, memory_order_relaxed);
+	usize pos = start;
+	while (pos - start < ST_LOG_MAX_BATCH && logSlotSequence(pos) == pos + 1) {
+		StLogSlot *slot = &log_queue.slots[pos & (ST_LOG_QUEUE_SIZE - 1)];
+
+		if (slot->fd != fd && iov_count > 0) {
+			logWritev(fd, iov, iov_count);
+			atomic_fetch_add_explicit(&log_queue.batches, 1, memory_order_relaxed);
+			iov_count = 0;
+		}
+		fd = slot->fd;
+
+		if (log_queue.replaceable)
+			iov[iov_count++] = (struct iovec){(void *)clear_line, sizeof(clear_line) - 1};
+		iov[iov_count++] = (struct iovec){slot->text, slot->length};
+		log_queue.replaceable = slot->replaceable;
+		pos++;
+	}
+
+	if (iov_count > 0) {
+		logWritev(fd, iov, iov_count);
+		atomic_fetch_add_explicit(&log_queue.batches, 1, memory_order_relaxed);
+	}
+
+	// the slots can only be reused once writev() is done with them
+	for (usize i = start; i < pos; i++)
+		logSetSlotSequence(i, i + ST_LOG_QUEUE_SIZE);
+	atomic_store_explicit(&log_queue.tail, pos, memory_order_release);
+	atomic_fetch_add_explicit(&log_queue.written, pos - start, memory_order_relaxed);
+
+	return (u32)(pos - start);
+}
+
+/**
+ * Writes queued logs until the async logger is stopped.
+ * @param arg Unused.
+ */
+static void *logWriter(STUPID_UNUSED void *arg)
+{
+	u64 reported = 0;
+	f64 last_report = 0.0;
+	while (true) {
+		const bool running = atomic_load(&log_queue.running);
+		const u32 count = logDrain();
+
+		// let whoever is reading the logs know that some of them are missing (at most once a second)
+		const u64 dropped = atomic_load_explicit(&log_queue.dropped, memory_order_relaxed);
+		if (dropped != reported && (!running || stGetTime() - last_report >= 1.0)) {
+			last_report = stGetTime();
+			char note[128];
+			const int length = snprintf(note, sizeof(note), "%s%lu logs dropped\033[0m\n", log_level_strings[ST_LOG_LEVEL_WARNING], dropped - reported);
+			logWritev(STDERR_FILENO, &(struct iovec){note, (usize)length}, 1);
+			reported = dropped;
+		}
+
+		if (count == 0) {
+			if (!running) break;
+			stSleepu(100);
+		}
+	}
+
+	return NULL;
+}
+
+/// Makes sure queued logs are not lost when the program exits without calling stLogAsyncStop().
+static void logAsyncExit(void)
+{
+	stLogFlush();
+}
+
+/**
+ * Writes a formatted log, or puts it in the async log queue if the async logger is running.
+ * @param fd File descriptor to write to (STDOUT_FILENO or STDERR_FILENO).
+ * @param text The formatted log.
+ * @param length Length of text.
+ * @param replaceable If the next log should replace this one.
+ * @param flush If the stream should be flushed immediately.
+ * @param level Level of the log.
+ */
+static void logWrite(const int fd, const char *text, const u32 length, const bool replaceable, const bool flush, const st_log_level level)
+{
+	if (logEnqueue(fd, text, length, replaceable, level)) return;
+
+	FILE *f = (fd == STDERR_FILENO) ? stderr : stdout;
+
+	stMutexLock(&logger_lock);
+
+	// replace the last message if its replacable
+	if (last_log_is_replaceable) fputs(clear_line, f);
+
+	fwrite(text, 1, length, f);
+	if (flush) fflush(f);
+	last_log_is_replaceable = replaceable;
+
+	stMutexUnlock(&logger_lock);
+}
+
+/**
+ * Appends a string to a log being formatted in log_buffer.
+ * @param length Current length of the log.
+ * @param str String to append.
+ * @param reserve Number of characters to leave room for at the end of the buffer.
+ * @return The new length of the log.
+ */
+static u32 logAppend(u32 length, const char *str, const u32 reserve)
+{
+	while (*str && length < sizeof(log_buffer) - reserve)
+		log_buffer[length++] = *str++;
+	return length;
+}
+
+/**
+ * Appends a printf formatted message to a log being formatted in log_buffer.
+ * @param length Current length of the log.
+ * @param message printf format string.
+ * @param pArg printf format arguments.
+ * @param reserve Number of characters to leave room for at the end of the buffer.
+ * @return The new length of the log.
+ */
+static u32 logAppendFormat(u32 length, const char *message, va_list pArg, const u32 reserve)
+{
+	const usize room = sizeof(log_buffer) - reserve - length;
+	const int b = vsnprintf(log_buffer + length, room, message, pArg);
+	if (b < 0) return length;
+	if ((usize)b < room) return length + (u32)b;
+
+	// make it obvious the message was cut short
+	const u32 end = length + (u32)room - 1;
+	if (room > sizeof(ST_LOG_TRUNCATED)) stMemcpy(log_buffer + end - (sizeof(ST_LOG_TRUNCATED) - 1), ST_LOG_TRUNCATED, sizeof(ST_LOG_TRUNCATED) - 1);
+	return end;
+}
+
 int stLogCustom(const st_text_color color, const st_text_background_color background_color, const st_text_property properties, const char *message, ...)
 {
 	if ((u32)color >= (u32)ST_TEXT_COLOR_MAX) {
@@ -73,34 +468,22 @@ int stLogCustom(const st_text_color color, const st_text_background_color backgr
 		return -1;
 	}
 
-	// output stream
-	FILE *f;
-
-	// use stderr if specified
-	if ((u32)properties & (u32)ST_TEXT_PROPERTY_ERR) f = stderr;
-	else f = stdout;
+	// output stream (use stderr if specified)
+	const int fd = ((u32)properties & (u32)ST_TEXT_PROPERTY_ERR) ? STDERR_FILENO : STDOUT_FILENO;
 
-	if (last_log_is_replaceable) fputs("\033[2K\r", f);
+	// room for the reset code and the linebreak
+	const u32 reserve = 8;
 
-	// log that buf is no longer NULL if loggerInit() was called later than it should be
-	if (failed_to_print) {
-		failed_to_print = false;
-		fputs("\033[94;1;4mlog buffer is no longer NULL\033[0m\n", stderr);
-	}
-
-	// lock the mutex to prevent multiple logs being printed at once
-	stMutexLock(&logger_lock);
-
-	// variadic arguments
+	u32 length = 0;
 	va_list pArg;
-	va_start(pArg, message);
-	vsnprintf(log_buffer, 1024, message, pArg);
-	va_end(pArg);
 
-	// use fputs if the text is plain
+	// just print the message if the text is plain
 	if ((u32)color == 0 && (u32)background_color == 0 && (u32)properties == 0) {
-		stMutexUnlock(&logger_lock);
-		return fputs(log_buffer, f);
+		va_start(pArg, message);
+		length = logAppendFormat(length, message, pArg, reserve);
+		va_end(pArg);
+		logWrite(fd, log_buffer, length, false, false, ST_LOG_LEVEL_INFO);
+		return (int)length;
 	}
 
 	// extra properties for the text (like italic or bold)
@@ -133,55 +516,115 @@ int stLogCustom(const st_text_color color, const st_text_background_color backgr
 		*property_str_ptr++ = '4';
 	}
 
-	int b = 0;
+	// print bright text with a bright background if requested
+	const char *background = ((u32)properties & (u32)ST_TEXT_PROPERTY_BRIGHT_BACKGROUND) ?
+	                         bright_background_colors[(u32)background_color] :
+	                         background_colors[(u32)background_color];
+
+	// print bright text if requested, otherwise print with normal brightness
+	length = snprintf(log_buffer, sizeof(log_buffer) - reserve, "\033[%c%c%s%sm",
+	                  ((u32)properties & (u32)ST_TEXT_PROPERTY_BRIGHT) ? '9' : '3',
+	                  colors[(u32)color], property_str, background);
 
-	// print bright text if requested
-	if ((u32)properties & (u32)ST_TEXT_PROPERTY_BRIGHT) {
-		// print bright text with a bright background if requested
-		if ((u32)properties & (u32)ST_TEXT_PROPERTY_BRIGHT_BACKGROUND)
-			b = fprintf(f, "\033[9%c%s%sm%s\033[0m", colors[(u32)color], property_str, bright_background_colors[(u32)background_color], log_buffer);
+	va_start(pArg, message);
+	length = logAppendFormat(length, message, pArg, reserve);
+	va_end(pArg);
+	length = logAppend(length, "\033[0m", 0);
 
-		else
-			b = fprintf(f, "\033[9%c%s%sm%s\033[0m", colors[(u32)color], property_str, background_colors[(u32)background_color], log_buffer);
+	bool replaceable = false;
+	if ((u32)properties & (u32)ST_TEXT_PROPERTY_LINEBREAK) log_buffer[length++] = '\n';
+	if ((u32)properties & (u32)ST_TEXT_PROPERTY_BACKSPACE) {
+		replaceable = true;
+		log_buffer[length++] = '\r';
 	}
 
-	// otherwise print with normal brightness
-	else {
-		// print normal text with a bright background if requested
-		if ((u32)properties & (u32)ST_TEXT_PROPERTY_BRIGHT_BACKGROUND)
-			b = fprintf(f, "\033[3%c%s%sm%s\033[0m", colors[(u32)color], property_str, bright_background_colors[(u32)background_color], log_buffer);
+	logWrite(fd, log_buffer, length, replaceable, (u32)properties & (u32)ST_TEXT_PROPERTY_FLUSH, ST_LOG_LEVEL_INFO);
+
+	return (int)length;
+}
 
-		else
-			b = fprintf(f, "\033[3%c%s%sm%s\033[0m", colors[(u32)color], property_str, background_colors[(u32)background_color], log_buffer);
+/**
+ * Hashes a log message so repeats can be detected.
+ * @param text The message.
+ * @param length Length of text.
+ * @return FNV-1a hash of text.
+ */
+static u64 logHash(const char *text, const u32 length)
+{
+	u64 hash = 14695981039346656037llu;
+	for (u32 i = 0; i < length; i++) {
+		hash ^= (u8)text[i];
+		hash *= 1099511628211llu;
 	}
+	return hash;
+}
 
-	if ((u32)properties & (u32)ST_TEXT_PROPERTY_FLUSH) fflush(f);
-	if ((u32)properties & (u32)ST_TEXT_PROPERTY_LINEBREAK) fputc('\n', f);
-	if ((u32)properties & (u32)ST_TEXT_PROPERTY_BACKSPACE) {
-		last_log_is_replaceable = true;
-		fputc('\r', f);
+/**
+ * Takes a token from the bucket for a log level.
+ * @param level Log level.
+ * @param now Current time.
+ * @return False if the bucket is empty.
+ */
+static bool logTakeToken(const st_log_level level, const f64 now)
+{
+	StLogBucket *pBucket = &log_buckets[level];
+
+	stMutexLock(&limit_lock);
+
+	bool res = true;
+	if (pBucket->rate > 0.0) {
+		// refill for however long its been since the last log
+		pBucket->tokens = STUPID_MIN(pBucket->tokens + (now - pBucket->last) * pBucket->rate, pBucket->burst);
+		pBucket->last = now;
+
+		if (pBucket->tokens >= 1.0) pBucket->tokens -= 1.0;
+		else res = false;
 	}
-	else last_log_is_replaceable = false;
 
-	stMutexUnlock(&logger_lock);
+	stMutexUnlock(&limit_lock);
 
-	return b;
+	return res;
 }
 
-/// strings at the start of different log levels
-static const char *log_level_strings[] = {
-	"\033[35;1;4;107m[CRIT]:   ",
-	"\033[93;1;41m[FATAL]:   \033[0;93;41;4m",
-	"\033[91;1m[ERROR]:  \033[0;31m",
-	"\033[33;1m[WARN]:   \033[0;33;3m",
-	"\033[96;1m[SYSTEM]: \033[0;96;3m",
-	"\033[92;1m[INFO]:   \033[0;32m",
-	"\033[34;1m[DEBUG]:  \033[0;34m",
-	"\033[2;1m[SPAM]:   \033[0;2m",
-	"\033[2;1m[TRACE]:  \033[0;2;3m"
-};
+/**
+ * Takes a token for a log from a call site.
+ * @param pSite The call site.
+ * @param level Log level.
+ * @param now Current time.
+ * @return False if the rate limit dropped the log (it gets counted in the site).
+ */
+static bool logSiteTakeToken(StLogSite *pSite, const st_log_level level, const f64 now)
+{
+	if (logTakeToken(level, now)) return true;
+	atomic_fetch_add_explicit(&pSite->dropped, 1, memory_order_relaxed);
+	return false;
+}
 
-void stLog(const st_log_level level, const char *message, ...)
+/**
+ * Checks if a log is a repeat of the last message printed from its call site.
+ * @param pSite The call site.
+ * @param hash Hash of the log message.
+ * @param now Current time.
+ * @return True if the log is a repeat (it gets counted in the site).
+ */
+static bool logSiteRepeat(StLogSite *pSite, const u64 hash, const f64 now)
+{
+	if (hash != atomic_load_explicit(&pSite->hash, memory_order_relaxed) ||
+	    now - atomic_load_explicit(&pSite->last, memory_order_relaxed) >= ST_LOG_REPEAT_INTERVAL)
+		return false;
+
+	atomic_fetch_add_explicit(&pSite->repeated, 1, memory_order_relaxed);
+	return true;
+}
+
+/**
+ * Logs a message with the specified log level.
+ * @param pSite Call site used for rate limiting (NULL to never limit the log).
+ * @param level The log severity.
+ * @param message printf format string.
+ * @param pArg printf format arguments.
+ */
+static void logLevel(StLogSite *pSite, const st_log_level level, const char *message, va_list pArg)
 {
 	if ((u32)level >= ST_LOG_LEVEL_MAX) {
 		STUPID_LOG_ERROR("invalid log level %u", (u32)level);
@@ -193,39 +636,105 @@ void stLog(const st_log_level level, const char *message, ...)
 		return;
 	}
 
+	// store the log without formatting it if theres a binary log (errors still get printed too)
+	va_list pBinArg;
+	va_copy(pBinArg, pArg);
+	const bool stored = stBinLogWrite(level, message, NULL, NULL, 0, pBinArg);
+	va_end(pBinArg);
+	if (stored && level > ST_LOG_LEVEL_ERROR) return;
+
+	// output stream
+	const int fd = (level == ST_LOG_LEVEL_CRITICAL || level == ST_LOG_LEVEL_FATAL || level == ST_LOG_LEVEL_ERROR) ? STDERR_FILENO : STDOUT_FILENO;
+
+	// room for the reset code and the linebreak
+	const u32 reserve = 8;
+
+	// critical and fatal logs are never limited
+	const bool limited = pSite && level > ST_LOG_LEVEL_FATAL;
+	const bool dedup = limited && atomic_load_explicit(&log_dedup[level], memory_order_relaxed);
+	const f64 now = (limited) ? stGetTime() : 0.0;
+
+	// without dedup the rate limit doesnt need the message, so check it before spending any time formatting
+	if (limited && !dedup && !logSiteTakeToken(pSite, level, now)) return;
+
 	// variadic arguments
-	stMutexLock(&logger_lock);
+	const u32 prefix = logAppend(0, log_level_strings[level], reserve);
+	u32 length = logAppendFormat(prefix, message, pArg, reserve);
+
+	if (limited) {
+		// repeats dont take a token, so they cant use up the rate limit for everything else
+		if (dedup) {
+			const u64 hash = logHash(log_buffer + prefix, length - prefix);
+			if (logSiteRepeat(pSite, hash, now) || !logSiteTakeToken(pSite, level, now)) return;
+			atomic_store_explicit(&pSite->hash, hash, memory_order_relaxed);
+			atomic_store_explicit(&pSite->last, now, memory_order_relaxed);
+		}
+
+		// summarize whatever was suppressed before the new log
+		const u32 repeated = atomic_exchange_explicit(&pSite->repeated, 0, memory_order_relaxed);
+		const u32 dropped  = atomic_exchange_explicit(&pSite->dropped, 0, memory_order_relaxed);
+		if (repeated || dropped) {
+			char summary[256];
+			u32 b = snprintf(summary, sizeof(summary), "%s", log_level_strings[level]);
+			if (repeated)
+				b += snprintf(summary + b, sizeof(summary) - b, "last message repeated %u times%s", repeated, (dropped) ? ", " : "");
+			if (dropped)
+				b += snprintf(summary + b, sizeof(summary) - b, "%u logs dropped by the rate limit", dropped);
+			b += snprintf(summary + b, sizeof(summary) - b, "\033[0m\n");
+			logWrite(fd, summary, STUPID_MIN(b, (u32)sizeof(summary) - 1), false, false, level);
+		}
+	}
+
+	length = logAppend(length, "\033[0m", 0);
+
+	// insert a \r at the end if required
+	const bool replaceable = (level == ST_LOG_LEVEL_SPAM);
+	log_buffer[length++] = (replaceable) ? '\r' : '\n';
+
+	logWrite(fd, log_buffer, length, replaceable, replaceable, level);
+
+	// make sure fatal errors actually get printed before the program dies
+	if (level <= ST_LOG_LEVEL_FATAL) stLogFlush();
+}
+
+void stLog(const st_log_level level, const char *message, ...)
+{
 	va_list pArg;
 	va_start(pArg, message);
-	vsnprintf(log_buffer, 1024, message, pArg);
+	logLevel(NULL, level, message, pArg);
 	va_end(pArg);
+}
 
-	// output stream
-	FILE *f;
-
-	if (level == ST_LOG_LEVEL_CRITICAL || level == ST_LOG_LEVEL_FATAL || level == ST_LOG_LEVEL_ERROR)
-		f = stderr;
-	else
-		f = stdout;
+void stLogAt(StLogSite *pSite, const st_log_level level, const char *message, ...)
+{
+	va_list pArg;
+	va_start(pArg, message);
+	logLevel(pSite, level, message, pArg);
+	va_end(pArg);
+}
 
-	// replace the last message if its replacable
-	if (last_log_is_replaceable) {
-		fputs("\033[2K\r", f);
-		last_log_is_replaceable = false;
+void stLogSetRateLimit(const st_log_level level, const f64 rate, const f64 burst)
+{
+	if ((u32)level >= ST_LOG_LEVEL_MAX) {
+		STUPID_LOG_ERROR("invalid log level %u", (u32)level);
+		return;
 	}
 
-	fprintf(f, "%s%s\033[0m", log_level_strings[level], log_buffer);
+	stMutexLock(&limit_lock);
+	log_buckets[level].rate   = rate;
+	log_buckets[level].burst  = burst;
+	log_buckets[level].tokens = burst;
+	stMutexUnlock(&limit_lock);
+}
 
-	// insert a \r at the end if required
-	if (level == ST_LOG_LEVEL_SPAM) {
-		putchar('\r');
-		last_log_is_replaceable = true;
-		fflush(stdout);
+void stLogSetDedup(const st_log_level level, const bool dedup)
+{
+	if ((u32)level >= ST_LOG_LEVEL_MAX) {
+		STUPID_LOG_ERROR("invalid log level %u", (u32)level);
+		return;
 	}
-	else
-		fputc('\n', f);
 
-	stMutexUnlock(&logger_lock);
+	atomic_store_explicit(&log_dedup[level], dedup, memory_order_relaxed);
 }
 
 void stLogTrace(const char *fn, const char *file, const int line, const char *message, ...)
@@ -235,15 +744,210 @@ void stLogTrace(const char *fn, const char *file, const int line, const char *me
 		return;
 	}
 
-	stMutexLock(&logger_lock);
+	// the binary log is the whole point of keeping trace logs enabled, so dont bother formatting them
 	va_list pArg;
 	va_start(pArg, message);
-	vsnprintf(log_buffer, 1024, message, pArg);
+	const bool stored = stBinLogWrite(ST_LOG_LEVEL_TRACE, message, fn, file, line, pArg);
 	va_end(pArg);
+	if (stored) return;
 
-	printf("\033[2;1m[TRACE]:  \033[0;2;3m%s(): %s %s:%d\033[0m\n", fn, log_buffer, file, line);
+	// room for the location, the reset code and the linebreak
+	const u32 reserve = 256;
 
-	stMutexUnlock(&logger_lock);
+	u32 length = snprintf(log_buffer, sizeof(log_buffer) - reserve, "\033[2;1m[TRACE]:  \033[0;2;3m%s(): ", fn);
+	va_start(pArg, message);
+	length = logAppendFormat(length, message, pArg, reserve);
+	va_end(pArg);
+	length += snprintf(log_buffer + length, sizeof(log_buffer) - length, " %s:%d\033[0m\n", file, line);
+	length = STUPID_MIN(length, (u32)sizeof(log_buffer) - 1);
+
+	logWrite(STDOUT_FILENO, log_buffer, length, false, false, ST_LOG_LEVEL_TRACE);
+}
+
+void stLogSetLevel(const st_log_module module, const st_log_level level)
+{
+	if ((u32)module >= ST_LOG_MODULE_MAX || (u32)level >= ST_LOG_LEVEL_MAX) {
+		STUPID_LOG_ERROR("invalid log module %u or level %u", (u32)module, (u32)level);
+		return;
+	}
+
+	atomic_store_explicit(&st_log_levels[module], (u8)level + 1, memory_order_relaxed);
+}
+
+st_log_level stLogGetLevel(const st_log_module module)
+{
+	if ((u32)module >= ST_LOG_MODULE_MAX) {
+		STUPID_LOG_ERROR("invalid log module %u", (u32)module);
+		return ST_LOG_LEVEL_MAX;
+	}
+
+	const u8 level = atomic_load_explicit(&st_log_levels[module], memory_order_relaxed);
+	return (level == 0) ? ST_LOG_LEVEL_MAX : (st_log_level)(level - 1);
+}
+
+/**
+ * Finds a name in a list of names.
+ * @param str Name to look for (not null terminated).
+ * @param length Length of str.
+ * @param names List of names.
+ * @param count Number of names.
+ * @return Index of the name, or count if it isnt in the list.
+ */
+static u32 logFindName(const char *str, const usize length, const char **names, const u32 count)
+{
+	for (u32 i = 0; i < count; i++) {
+		usize j = 0;
+		while (j < length && names[i][j] == str[j]) j++;
+		if (j == length && names[i][j] == '\0') return i;
+	}
+	return count;
+}
+
+/**
+ * Parses a log level for stLogSetLevels().
+ * @param str The level (not null terminated).
+ * @param length Length of str.
+ * @return The level + 1 (0 for off), or -1 if its invalid.
+ */
+static i32 logParseLevel(const char *str, const usize length)
+{
+	if (length == 3 && str[0] == 'o' && str[1] == 'f' && str[2] == 'f') return 0;
+
+	// numbers work too
+	if (length > 0 && str[0] >= '0' && str[0] <= '9') {
+		i32 level = 0;
+		for (usize i = 0; i < length; i++) {
+			if (str[i] < '0' || str[i] > '9') return -1;
+			level = level * 10 + (str[i] - '0');
+			if (level >= ST_LOG_LEVEL_MAX) return -1;
+		}
+		return level + 1;
+	}
+
+	const u32 level = logFindName(str, length, log_level_names, ST_LOG_LEVEL_MAX);
+	return (level == ST_LOG_LEVEL_MAX) ? -1 : (i32)level + 1;
+}
+
+bool stLogSetLevels(const char *levels)
+{
+	STUPID_NC(levels);
+
+	bool valid = true;
+	const char *item = levels;
+	while (*item) {
+		const char *end = item;
+		while (*end && *end != ',') end++;
+
+		const char *equals = item;
+		while (equals < end && *equals != '=') equals++;
+
+		// "level" sets every module, "module=level" only sets one
+		const char *level_str = (equals < end) ? equals + 1 : item;
+		const i32 level = logParseLevel(level_str, end - level_str);
+		const u32 module = (equals < end) ? logFindName(item, equals - item, log_module_names, ST_LOG_MODULE_MAX) : ST_LOG_MODULE_MAX;
+
+		if (level < 0 || (equals < end && module == ST_LOG_MODULE_MAX)) {
+			STUPID_LOG_WARN("invalid log level '%.*s'", (int)(end - item), item);
+			valid = false;
+		}
+		else if (equals < end) {
+			atomic_store_explicit(&st_log_levels[module], (u8)level, memory_order_relaxed);
+		}
+		else {
+			for (u32 i = 0; i < ST_LOG_MODULE_MAX; i++)
+				atomic_store_explicit(&st_log_levels[i], (u8)level, memory_order_relaxed);
+		}
+
+		item = (*end) ? end + 1 : end;
+	}
+
+	return valid;
+}
+
+bool stLogSetLevelsFromEnv(void)
+{
+	const char *levels = getenv(STUPID_LOG_ENV);
+	if (levels == NULL) return true;
+	return stLogSetLevels(levels);
+}
+
+bool stLogAsyncStart(const st_log_policy policy)
+{
+	if ((u32)policy >= ST_LOG_POLICY_MAX) {
+		STUPID_LOG_ERROR("invalid log policy %u", (u32)policy);
+		return false;
+	}
+
+	if (atomic_load(&log_queue.running)) {
+		STUPID_LOG_ERROR("the async logger is already running");
+		return false;
+	}
+
+	log_queue.policy      = policy;
+	log_queue.replaceable = last_log_is_replaceable;
+
+	// anything still in the stdio buffers has to come out before the writer thread starts writing
+	fflush(stdout);
+	fflush(stderr);
+
+	atomic_store(&log_queue.running, true);
+	if (pthread_create(&log_queue.writer, NULL, logWriter, NULL) != 0) {
+		atomic_store(&log_queue.running, false);
+		STUPID_LOG_ERROR("failed to create the log writer thread");
+		return false;
+	}
+
+	static bool registered = false;
+	if (!registered) {
+		atexit(logAsyncExit);
+		registered = true;
+	}
+
+	atomic_store(&log_queue.enabled, true);
+
+	return true;
+}
+
+void stLogAsyncStop(void)
+{
+	if (!atomic_load(&log_queue.running)) return;
+
+	// new logs are written immediately from here on, so only the ones already being queued need to be waited for
+	atomic_store(&log_queue.enabled, false);
+	while (atomic_load(&log_queue.producers) != 0)
+		stSleepu(1);
+
+	// the writer thread writes everything left in the queue before exiting
+	atomic_store(&log_queue.running, false);
+	pthread_join(log_queue.writer, NULL);
+
+	last_log_is_replaceable = log_queue.replaceable;
+}
+
+void stLogFlush(void)
+{
+	if (!atomic_load(&log_queue.running)) {
+		fflush(stdout);
+		fflush(stderr);
+		return;
+	}
+
+	const usize target = atomic_load(&log_queue.head);
+	const f64 start = stGetTime();
+	while (atomic_load_explicit(&log_queue.tail, memory_order_acquire) < target) {
+		if (stGetTime() - start >= ST_LOG_FLUSH_TIMEOUT) break;
+		stSleepu(10);
+	}
+}
+
+StLogAsyncStats stLogGetAsyncStats(void)
+{
+	StLogAsyncStats stats = {0};
+	stats.queued  = atomic_load(&log_queue.queued);
+	stats.dropped = atomic_load(&log_queue.dropped);
+	stats.written = atomic_load(&log_queue.written);
+	stats.batches = atomic_load(&log_queue.batches);
+	return stats;
 }
 
 void waitForInput(void)
@@ -1,3 +1,5 @@
+#define STUPID_LOG_MODULE ST_LOG_MODULE_MEMORY
+
 #include <stdlib.h>
 #define MALLOC_IMPL  malloc
 #define ALIGNED_IMPL aligned_alloc
@@ -171,8 +173,9 @@ void (stMemInsert)(void **array, const usize position, const void *data STUPID_D
 
 	StMemory *mem = ST_MEMORY_CAST(*array);
 
+	// the function (not the macro, which would append a pointer to data)
 	if (position == mem->length) {
-		stMemAppend(array, data);
+		(stMemAppend)(array, data);
 		return;
 	}
 
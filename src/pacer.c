@@ -0,0 +1,123 @@
+/// @file pacer.c
+/// @brief Frame pacing.
+/// @author nonexistant
+
+#include "stupid/pacer.h"
+#include "stupid/assert.h"
+#include "stupid/clock.h"
+#include "stupid/math/constants.h"
+#include "stupid/math/exp.h"
+
+#include <errno.h>
+#include <immintrin.h>
+
+/**
+ * Sleeps until an absolute time.
+ * @param time Time to wake up at (CLOCK_MONOTONIC).
+ */
+static void pacerSleepUntil(const f64 time)
+{
+	struct timespec ts = {0};
+	ts.tv_sec  = (time_t)time;
+	ts.tv_nsec = (long)((time - (f64)ts.tv_sec) * 1000000000.0);
+	if (ts.tv_nsec >= 1000000000) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+
+	// restart if a signal interrupts the sleep (the deadline is absolute so nothing needs to be recalculated)
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+}
+
+void stFramePacerInit(StFramePacer *pPacer)
+{
+	STUPID_NC(pPacer);
+
+	pPacer->deadline  = 0.0;
+	pPacer->spin      = ST_PACER_MAX_SPIN;
+	pPacer->oversleep = ST_PACER_MAX_SPIN;
+	stFramePacerResetStats(pPacer);
+}
+
+f64 stFramePacerWait(StFramePacer *pPacer, const f64 period)
+{
+	STUPID_NC(pPacer);
+
+	f64 now = stGetSystemTime();
+
+	// first frame
+	if (pPacer->deadline == 0.0) pPacer->deadline = now;
+
+	if (now >= pPacer->deadline) {
+		pPacer->missed += (pPacer->frames > 0);
+
+		// start over instead of rushing through a bunch of frames after a long hitch
+		if (now - pPacer->deadline > period * ST_PACER_MAX_BEHIND) {
+			pPacer->deadline = now;
+			pPacer->resyncs++;
+		}
+	}
+	else {
+		// sleep until a bit before the deadline
+		const f64 wake = pPacer->deadline - pPacer->spin;
+		if (wake > now) {
+			pacerSleepUntil(wake);
+			now = stGetSystemTime();
+
+			// calibrate the spin margin to the worst recent oversleep
+			const f64 oversleep = STUPID_MAX(now - wake, 0.0);
+			pPacer->oversleep = STUPID_MAX(pPacer->oversleep * 0.99, oversleep);
+			pPacer->spin = STUPID_CLAMP(pPacer->oversleep * ST_PACER_SPIN_HEADROOM, ST_PACER_MIN_SPIN, ST_PACER_MAX_SPIN);
+		}
+
+		// spin for the rest (on the same clock clock_nanosleep() uses, since the TSC can drift away from it)
+		while ((now = stGetSystemTime()) < pPacer->deadline)
+			_mm_pause();
+	}
+
+	const f64 jitter = now - pPacer->deadline;
+	pPacer->frames++;
+	pPacer->jitter_min            = STUPID_MIN(pPacer->jitter_min, jitter);
+	pPacer->jitter_max            = STUPID_MAX(pPacer->jitter_max, jitter);
+	pPacer->jitter_total         += jitter;
+	pPacer->jitter_squared_total += jitter * jitter;
+
+	// advance from the deadline instead of the current time so lateness doesnt build up
+	pPacer->deadline += period;
+
+	return jitter;
+}
+
+StFramePacerStats stFramePacerGetStats(const StFramePacer *pPacer)
+{
+	STUPID_NC(pPacer);
+
+	StFramePacerStats stats = {0};
+	stats.frames  = pPacer->frames;
+	stats.missed  = pPacer->missed;
+	stats.resyncs = pPacer->resyncs;
+	stats.spin    = pPacer->spin;
+
+	if (pPacer->frames > 0) {
+		const f64 mean = pPacer->jitter_total / (f64)pPacer->frames;
+		stats.jitter_min    = pPacer->jitter_min;
+		stats.jitter_max    = pPacer->jitter_max;
+		stats.jitter_mean   = mean;
+		stats.jitter_stddev = stSqrt(STUPID_MAX(pPacer->jitter_squared_total / (f64)pPacer->frames - mean * mean, 0.0));
+	}
+
+	return stats;
+}
+
+void stFramePacerResetStats(StFramePacer *pPacer)
+{
+	STUPID_NC(pPacer);
+
+	pPacer->frames               = 0;
+	pPacer->missed               = 0;
+	pPacer->resyncs              = 0;
+	pPacer->jitter_min           = STUPID_INF;
+	pPacer->jitter_max           = 0.0;
+	pPacer->jitter_total         = 0.0;
+	pPacer->jitter_squared_total = 0.0;
+}
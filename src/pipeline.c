@@ -0,0 +1,242 @@
+/// @file pipeline.c
+/// @brief Pipelined rendering.
+/// @author nonexistant
+
+#define STUPID_LOG_MODULE ST_LOG_MODULE_RENDER
+
+#include "stupid/pipeline.h"
+#include "stupid/assert.h"
+#include "stupid/clock.h"
+#include "stupid/logger.h"
+#include "stupid/memory.h"
+
+/**
+ * Renders submitted snapshots until the pipeline is destroyed.
+ * @param pArg Pointer to the pipeline.
+ * @return NULL.
+ */
+static void *pipelineRenderThread(void *pArg)
+{
+	StFramePipeline *pPipeline = pArg;
+
+	pthread_mutex_lock(&pPipeline->lock);
+	while (true) {
+		while (pPipeline->running && !pPipeline->pending)
+			pthread_cond_wait(&pPipeline->cond, &pPipeline->lock);
+		if (!pPipeline->pending) break;
+
+		// the simulation only writes to the other snapshot until this one is finished
+		StFrameSnapshot *pSnapshot = pPipeline->pSnapshots[pPipeline->write ^ 1];
+		pthread_mutex_unlock(&pPipeline->lock);
+
+		const bool res = pPipeline->render(pPipeline->pUser, pSnapshot);
+
+		pthread_mutex_lock(&pPipeline->lock);
+		pPipeline->failed  = pPipeline->failed || !res;
+		pPipeline->pending = false;
+		pthread_cond_broadcast(&pPipeline->cond);
+	}
+	pthread_mutex_unlock(&pPipeline->lock);
+
+	return NULL;
+}
+
+StFramePipeline *stFramePipelineCreate(const bool threaded, StPFN_pipeline_render render, void *pUser, const StCamera camera)
+{
+	STUPID_NC(render);
+
+	StFramePipeline *pPipeline = stMemAlloc(StFramePipeline, 1);
+	pPipeline->pSnapshots[0] = stMemAlloc(StFrameSnapshot, 1);
+	pPipeline->pSnapshots[1] = stMemAlloc(StFrameSnapshot, 1);
+	pPipeline->pSnapshots[0]->camera = camera;
+	pPipeline->pSnapshots[1]->camera = camera;
+	pPipeline->render   = render;
+	pPipeline->pUser    = pUser;
+	pPipeline->threaded = threaded;
+
+	pthread_mutex_init(&pPipeline->lock, NULL);
+	pthread_cond_init(&pPipeline->cond, NULL);
+
+	if (threaded) {
+		pPipeline->running = true;
+		if (pthread_create(&pPipeline->thread, NULL, pipelineRenderThread, pPipeline) != 0) {
+			STUPID_LOG_ERROR("failed to create the render thread");
+			pthread_cond_destroy(&pPipeline->cond);
+			pthread_mutex_destroy(&pPipeline->lock);
+			stMemDealloc(pPipeline->pSnapshots[0]);
+			stMemDealloc(pPipeline->pSnapshots[1]);
+			stMemDealloc(pPipeline);
+			return NULL;
+		}
+		STUPID_LOG_SYSTEM("rendering on a separate thread");
+	}
+
+	return pPipeline;
+}
+
+void stFramePipelineDestroy(StFramePipeline *pPipeline)
+{
+	STUPID_NC(pPipeline);
+
+	if (pPipeline->threaded) {
+		// the render thread finishes the last snapshot before exiting
+		pthread_mutex_lock(&pPipeline->lock);
+		pPipeline->running = false;
+		pthread_cond_broadcast(&pPipeline->cond);
+		pthread_mutex_unlock(&pPipeline->lock);
+		pthread_join(pPipeline->thread, NULL);
+
+		if (pPipeline->submitted)
+			STUPID_LOG_DEBUG("render thread: %lu frames, simulation waited %lfs total (%lfs per frame)",
+			                 pPipeline->submitted, pPipeline->wait_time, pPipeline->wait_time / (f64)pPipeline->submitted);
+	}
+
+	pthread_cond_destroy(&pPipeline->cond);
+	pthread_mutex_destroy(&pPipeline->lock);
+	stMemDealloc(pPipeline->pSnapshots[0]);
+	stMemDealloc(pPipeline->pSnapshots[1]);
+	stMemDealloc(pPipeline);
+}
+
+bool stFramePipelineFlush(StFramePipeline *pPipeline)
+{
+	STUPID_NC(pPipeline);
+
+	if (!pPipeline->threaded) return !pPipeline->failed;
+
+	pthread_mutex_lock(&pPipeline->lock);
+	while (pPipeline->pending)
+		pthread_cond_wait(&pPipeline->cond, &pPipeline->lock);
+	const bool res = !pPipeline->failed;
+	pthread_mutex_unlock(&pPipeline->lock);
+
+	return res;
+}
+
+bool stFramePipelineSubmit(StFramePipeline *pPipeline)
+{
+	STUPID_NC(pPipeline);
+
+	StFrameSnapshot *pSnapshot = pPipeline->pSnapshots[pPipeline->write];
+	StFrameSnapshot *pNext     = pPipeline->pSnapshots[pPipeline->write ^ 1];
+	pPipeline->submitted++;
+
+	bool res = true;
+	if (pPipeline->threaded) {
+		// sync point (wait for the previous frame to finish so its snapshot can be reused)
+		const f64 start = stGetTime();
+		pthread_mutex_lock(&pPipeline->lock);
+		while (pPipeline->pending)
+			pthread_cond_wait(&pPipeline->cond, &pPipeline->lock);
+		pPipeline->wait_time += stGetTime() - start;
+
+		res = !pPipeline->failed;
+		pPipeline->write  ^= 1;
+		pPipeline->pending = true;
+		pthread_cond_broadcast(&pPipeline->cond);
+		pthread_mutex_unlock(&pPipeline->lock);
+	}
+	else {
+		res = pPipeline->render(pPipeline->pUser, pSnapshot);
+		pPipeline->failed = pPipeline->failed || !res;
+		pPipeline->write ^= 1;
+	}
+
+	// the camera is state, but transform changes and draws are only for one frame
+	pNext->camera       = pSnapshot->camera;
+	pNext->tick_alpha   = pSnapshot->tick_alpha;
+	pNext->tick         = pSnapshot->tick;
+	pNext->update_count = 0;
+	pNext->draw_count   = 0;
+
+	return res;
+}
+
+/**
+ * Adds a transform change to a snapshot.
+ * @param pSnapshot Pointer to a snapshot.
+ * @param pObject The object.
+ * @param slot Part of the transform to change.
+ * @return Pointer to the change (NULL if the snapshot is full).
+ */
+static StTransformUpdate *frameSnapshotAddUpdate(StFrameSnapshot *pSnapshot, const StObject *pObject, const st_transform_slot slot)
+{
+	STUPID_NC(pSnapshot);
+	STUPID_NC(pObject);
+
+	if (pSnapshot->update_count >= ST_PIPELINE_MAX_UPDATES) {
+		STUPID_LOG_ERROR("too many transform changes in one frame (max %d)", ST_PIPELINE_MAX_UPDATES);
+		return NULL;
+	}
+
+	StTransformUpdate *pUpdate = &pSnapshot->updates[pSnapshot->update_count++];
+	pUpdate->index = pObject->transformation_index;
+	pUpdate->slot  = slot;
+	return pUpdate;
+}
+
+bool stFrameSnapshotSetTranslation(StFrameSnapshot *pSnapshot, const StObject *pObject, const StVec3 translation)
+{
+	StTransformUpdate *pUpdate = frameSnapshotAddUpdate(pSnapshot, pObject, ST_TRANSFORM_SLOT_TRANSLATION);
+	if (pUpdate == NULL) return false;
+
+	pUpdate->vec = translation;
+	return true;
+}
+
+bool stFrameSnapshotSetRotation(StFrameSnapshot *pSnapshot, const StObject *pObject, const StQuat rotation)
+{
+	StTransformUpdate *pUpdate = frameSnapshotAddUpdate(pSnapshot, pObject, ST_TRANSFORM_SLOT_ROTATION);
+	if (pUpdate == NULL) return false;
+
+	pUpdate->quat = rotation;
+	return true;
+}
+
+bool stFrameSnapshotSetScale(StFrameSnapshot *pSnapshot, const StObject *pObject, const StVec3 scale)
+{
+	StTransformUpdate *pUpdate = frameSnapshotAddUpdate(pSnapshot, pObject, ST_TRANSFORM_SLOT_SCALE);
+	if (pUpdate == NULL) return false;
+
+	pUpdate->vec = scale;
+	return true;
+}
+
+bool stFrameSnapshotDraw(StFrameSnapshot *pSnapshot, const u32 count, const StObject *pObjects)
+{
+	STUPID_NC(pSnapshot);
+	STUPID_NC(pObjects);
+
+	const u32 room = ST_PIPELINE_MAX_DRAWS - pSnapshot->draw_count;
+	if (count > room) STUPID_LOG_ERROR("too many objects drawn in one frame (max %d)", ST_PIPELINE_MAX_DRAWS);
+
+	const u32 n = STUPID_MIN(count, room);
+	stMemcpy(pSnapshot->draws + pSnapshot->draw_count, pObjects, n * sizeof(StObject));
+	pSnapshot->draw_count += n;
+	return n == count;
+}
+
+void stFrameSnapshotApply(const StFrameSnapshot *pSnapshot, StRenderer *pRenderer)
+{
+	STUPID_NC(pSnapshot);
+	STUPID_NC(pRenderer);
+	STUPID_NC(pRenderer->transformations.map);
+
+	StTransform *map = pRenderer->transformations.map;
+	for (u32 i = 0; i < pSnapshot->update_count; i++) {
+		const StTransformUpdate *pUpdate = &pSnapshot->updates[i];
+		switch (pUpdate->slot) {
+		case ST_TRANSFORM_SLOT_TRANSLATION:
+			map[pUpdate->index].translation = pUpdate->vec;
+			break;
+		case ST_TRANSFORM_SLOT_ROTATION:
+			map[pUpdate->index].rotation = pUpdate->quat;
+			break;
+		case ST_TRANSFORM_SLOT_SCALE:
+			map[pUpdate->index].scale = pUpdate->vec;
+			break;
+		}
+	}
+
+	pRenderer->rvals->camera = pSnapshot->camera;
+}
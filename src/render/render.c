@@ -1,3 +1,5 @@
+#define STUPID_LOG_MODULE ST_LOG_MODULE_RENDER
+
 #include "stupid/common.h"
 #include "stupid/render.h"
 #include "stupid/clock.h"
@@ -29,22 +31,14 @@ static bool handleResize(const st_event_code code, void *sender, void *listener,
 	STUPID_NC(listener);
 	StRenderer *pRenderer = listener;
 
-	switch (pRenderer->type) {
-		default: {
-			StRendererVulkanContext *pContext = pRenderer->pRendererInstance;
-			if (pContext->pWindow != sender) return false;
-			break;
-		}
-	}
-
-	u32 timeout = 0;
-
-	// this waits until the renderer isnt in the middle of rendering a frame before it resizes (max wait time 200ms)
-	while (pRenderer->state != ST_RENDERER_STATE_IDLE) {
-		stSleep(1);
-		if (timeout++ >= 200) break;
-	}
-	return stRendererResize(listener, data.window.w, data.window.h);
+	// window events come from the simulation thread, and the frame might be rendering on another one right now,
+	// so the size is only stored here and the swapchain gets resized by the next stRendererPrepareFrame()
+	stMutexLock(&pRenderer->lock);
+	pRenderer->pending_width  = data.window.w;
+	pRenderer->pending_height = data.window.h;
+	pRenderer->resize_pending = true;
+	stMutexUnlock(&pRenderer->lock);
+	return false;
 }
 
 /// Container for a renderer backend (just so the type can be stored).
@@ -55,7 +49,7 @@ typedef struct RendererBackend {
 
 static bool vulkan_initialized = false;
 
-void *stRendererBackendInitialize(const st_renderer_backend backend)
+void *stRendererBackendInitialize(const st_renderer_backend backend, const bool headless)
 {
 	STUPID_ASSERT(backend >= ST_RENDERER_BACKEND_UNDEFINED && backend < ST_RENDERER_BACKEND_MAX,
 	              "invalid stStRenderer backend");
@@ -65,7 +59,7 @@ void *stRendererBackendInitialize(const st_renderer_backend backend)
 		case ST_RENDERER_BACKEND_VULKAN:
 			STUPID_ASSERT(!vulkan_initialized, "vulkan backend already initialized");
 			RendererBackend *pContainer = stMemAllocNL(RendererBackend, 1);
-			pContainer->pBackend = stRendererVulkanBackendInit();
+			pContainer->pBackend = stRendererVulkanBackendInit(headless);
 			pContainer->type = ST_RENDERER_BACKEND_VULKAN;
 			vulkan_initialized = true;
 			return pContainer;
@@ -101,7 +95,15 @@ void stRendererBackendShutdown(void *pBackend)
 	}
 }
 
-StRenderer *stRendererCreate(void *pBackend, StWindow *pWindow)
+/**
+ * Creates a renderer instance for a window, or offscreen images.
+ * @param pBackend A backend created with stRendererInitializeBackend()
+ * @param pWindow Pointer to a window (NULL to render offscreen).
+ * @param width Width of the offscreen images.
+ * @param height Height of the offscreen images.
+ * @return A new renderer instance.
+ */
+static StRenderer *rendererCreate(void *pBackend, StWindow *pWindow, const u32 width, const u32 height)
 {
 	STUPID_NC(pBackend);
 
@@ -127,30 +129,46 @@ StRenderer *stRendererCreate(void *pBackend, StWindow *pWindow)
 			pRenderer->PFNSetVsync = (StPFN_renderer_set_vsync)stRendererVulkanFrontendSetVsync;
 			pRenderer->PFNDrawObjects = (StPFN_renderer_draw_objects)stRendererVulkanFrontendDrawObjects;
 			pRenderer->PFNPrepareModelMatrices = (StPFN_renderer_prepare_model_matrices)stRendererVulkanFrontendPrepareModelMatrices;
+			pRenderer->PFNCullObjects = (StPFN_renderer_cull_objects)stRendererVulkanFrontendCullObjects;
 			break;
 		default:
 			break;
 	}
 
-	pRenderer->pRendererInstance = pRenderer->PFNInit(pContainer->pBackend, pWindow);
+	pRenderer->pRendererInstance = pRenderer->PFNInit(pContainer->pBackend, pWindow, width, height);
 	pRenderer->PFNSetClearColor(pRenderer->pRendererInstance, (StColor){0.0f, 0.0f, 0.0f, 1.0f});
 	pRenderer->rvals = getRvals(pRenderer);
-	stEventRegister(STUPID_EVENT_CODE_WINDOW_RESIZED, pRenderer, handleResize);
+	// (offscreen images only change size with stRendererResize())
+	if (pWindow) pRenderer->resize_event = stEventSubscribe(STUPID_EVENT_CODE_WINDOW_RESIZED, pWindow, pRenderer, handleResize);
 
 	stRendererAllocate(pRenderer, STUPID_RENDERER_OBJECT_POSITION_BUFFER_SIZE, ST_RENDERER_BUFFER_USAGE_GENERIC, &pRenderer->positions);
 	stRendererAllocate(pRenderer, STUPID_RENDERER_OBJECT_INDEX_BUFFER_SIZE, ST_RENDERER_BUFFER_USAGE_GENERIC, &pRenderer->indices);
 	stRendererAllocate(pRenderer, STUPID_RENDERER_MAX_OBJECTS * sizeof(StMat4) * 2, ST_RENDERER_BUFFER_USAGE_GENERIC, &pRenderer->models);
-	stRendererAllocate(pRenderer, STUPID_RENDERER_MAX_OBJECTS * sizeof(StVec3) * 3, ST_RENDERER_BUFFER_USAGE_GENERIC | ST_RENDERER_BUFFER_USAGE_CPU_ACCESS_FAST, &pRenderer->transformations);
+	stRendererAllocate(pRenderer, STUPID_RENDERER_MAX_OBJECTS * sizeof(StTransform), ST_RENDERER_BUFFER_USAGE_GENERIC | ST_RENDERER_BUFFER_USAGE_CPU_ACCESS_FAST, &pRenderer->transformations);
 
 	StRendererVulkanContext *pContext = pRenderer->pRendererInstance;
 	pContext->pObjectBuffer         = (StRendererBuffer **)&pRenderer->models;
 	pContext->pTransformationBuffer = (StRendererBuffer **)&pRenderer->transformations;
 
-	StVec3 *map = stRendererMap(pRenderer, &pRenderer->transformations);
+	// the culling pass fills these on the gpu
+	stRendererAllocate(pRenderer, STUPID_RENDERER_MAX_FRAMES_IN_FLIGHT * STUPID_RENDERER_MAX_OBJECTS * sizeof(StDrawCommand),
+	                   ST_RENDERER_BUFFER_USAGE_GENERIC | ST_RENDERER_BUFFER_USAGE_INDIRECT, &pRenderer->draw_commands);
+	stRendererAllocate(pRenderer, STUPID_RENDERER_MAX_FRAMES_IN_FLIGHT * STUPID_RENDERER_MAX_OBJECTS * sizeof(StDrawData),
+	                   ST_RENDERER_BUFFER_USAGE_GENERIC, &pRenderer->draw_data);
+
+	// the objects to cull (and the counters the culling pass starts from) are written every frame, so they stay mapped
+	stRendererAllocate(pRenderer, STUPID_RENDERER_MAX_FRAMES_IN_FLIGHT * STUPID_RENDERER_MAX_OBJECTS * sizeof(StCullObject),
+	                   ST_RENDERER_BUFFER_USAGE_GENERIC | ST_RENDERER_BUFFER_USAGE_CPU_ACCESS_FAST, &pRenderer->cull_objects);
+	stRendererAllocate(pRenderer, STUPID_RENDERER_MAX_FRAMES_IN_FLIGHT * (STUPID_RENDERER_MAX_DRAW_CALLS * sizeof(u32) + sizeof(StCullDispatch)),
+	                   ST_RENDERER_BUFFER_USAGE_GENERIC | ST_RENDERER_BUFFER_USAGE_INDIRECT | ST_RENDERER_BUFFER_USAGE_CPU_ACCESS_FAST, &pRenderer->draw_counts);
+	stRendererMap(pRenderer, &pRenderer->cull_objects);
+	stRendererMap(pRenderer, &pRenderer->draw_counts);
+
+	StTransform *map = stRendererMap(pRenderer, &pRenderer->transformations);
 	for (int i = 0; i < STUPID_RENDERER_MAX_OBJECTS; i++) {
-		map[i * 3] = STVEC3(0.0, 0.0, 0.0);
-		map[i * 3 + 1] = STVEC3(0.0, 0.0, 0.0);
-		map[i * 3 + 2] = STVEC3(1.0, 1.0, 1.0);
+		map[i].translation = STVEC3(0.0, 0.0, 0.0);
+		map[i].rotation    = stQuatIdent();
+		map[i].scale       = STVEC3(1.0, 1.0, 1.0);
 	}
 
 	pRenderer->rvals->camera = stRendererCameraCreate(STVEC3(0.0, 0.0, 0.0), STVEC3(0.0, 0.0, -1.0), 1.0, 0.01, 100.0);
@@ -158,15 +176,34 @@ StRenderer *stRendererCreate(void *pBackend, StWindow *pWindow)
 	return pRenderer;
 }
 
+StRenderer *stRendererCreate(void *pBackend, StWindow *pWindow)
+{
+	STUPID_NC(pWindow);
+	return rendererCreate(pBackend, pWindow, 0, 0);
+}
+
+StRenderer *stRendererCreateHeadless(void *pBackend, const u32 width, const u32 height)
+{
+	STUPID_ASSERT(width > 0 && height > 0, "invalid size");
+	return rendererCreate(pBackend, NULL, width, height);
+}
+
 void stRendererDestroy(StRenderer *pRenderer)
 {
 	STUPID_NC(pRenderer);
+	stRendererUnmap(pRenderer, &pRenderer->draw_counts);
+	stRendererUnmap(pRenderer, &pRenderer->cull_objects);
 	stRendererUnmap(pRenderer, &pRenderer->transformations);
+	stRendererDeallocate(pRenderer, &pRenderer->draw_counts);
+	stRendererDeallocate(pRenderer, &pRenderer->cull_objects);
+	stRendererDeallocate(pRenderer, &pRenderer->draw_data);
+	stRendererDeallocate(pRenderer, &pRenderer->draw_commands);
 	stRendererDeallocate(pRenderer, &pRenderer->transformations);
 	stRendererDeallocate(pRenderer, &pRenderer->models);
 	stRendererDeallocate(pRenderer, &pRenderer->indices);
 	stRendererDeallocate(pRenderer, &pRenderer->positions);
-	stEventUnregister(STUPID_EVENT_CODE_WINDOW_RESIZED, pRenderer, handleResize);
+	if (pRenderer->resize_event != STUPID_EVENT_HANDLE_INVALID)
+		stEventUnregisterHandle(pRenderer->resize_event);
 	pRenderer->PFNShutdown(pRenderer->pRendererInstance);
 	stMemDealloc(pRenderer);
 }
@@ -205,6 +242,9 @@ void (stRendererAllocate)(StRenderer *pRenderer, const usize size, const st_rend
 			if (flags & ST_RENDERER_BUFFER_USAGE_TRANSFER_SOURCE)
 				usage |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
 
+			if (flags & ST_RENDERER_BUFFER_USAGE_INDIRECT)
+				usage |= VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+
 			u32 location = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
 			if (flags & ST_RENDERER_BUFFER_USAGE_CPU_ACCESS_SLOW)
 				location = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
@@ -359,25 +399,65 @@ bool stRendererPrepareFrame(StRenderer *pRenderer, f32 delta_time)
 	STUPID_NC(pRenderer);
 	STUPID_NC(pRenderer->PFNPrepareFrame);
 
-	//stMutexLock(&pRenderer->lock);
+	stMutexLock(&pRenderer->lock);
 
 	if (pRenderer->state == ST_RENDERER_STATE_FRAME_PREPARE || pRenderer->state == ST_RENDERER_STATE_FRAME_START || pRenderer->state == ST_RENDERER_STATE_FRAME_END) {
 		STUPID_LOG_ERROR("called twice");
-		//stMutexUnlock(&pRenderer->lock);
+		stMutexUnlock(&pRenderer->lock);
 		return false;
 	}
 	else if (STUPID_UNLIKELY(STUPID_IS_NAN(delta_time))) {
 		STUPID_LOG_ERROR("called with NAN delta_time");
-		//stMutexUnlock(&pRenderer->lock);
+		stMutexUnlock(&pRenderer->lock);
 		return false;
 	}
 
+	// changes that came from other threads since the last frame (this is the only place the swapchain changes while rendering)
+	// (only taken under the lock, since applying them waits on the gpu and the simulation thread shouldnt wait for that)
+	const bool resize      = pRenderer->resize_pending;
+	const i32 width        = pRenderer->pending_width;
+	const i32 height       = pRenderer->pending_height;
+	const bool change_sync = pRenderer->vsync_pending;
+	const bool vsync       = pRenderer->pending_vsync;
+	const usize models     = pRenderer->transformations_end;
+	pRenderer->resize_pending = false;
+	pRenderer->vsync_pending  = false;
+	if (change_sync) getRvals(pRenderer)->vsync = vsync;
+
 	pRenderer->state = ST_RENDERER_STATE_FRAME_PREPARE;
+	stMutexUnlock(&pRenderer->lock);
+
+	if (resize && !pRenderer->PFNResize(pRenderer->pRendererInstance, width, height)) {
+		STUPID_LOG_ERROR("failed to resize to %dx%d", width, height);
+
+		// tried again next frame (unless the window has been resized again since)
+		stMutexLock(&pRenderer->lock);
+		if (!pRenderer->resize_pending) {
+			pRenderer->pending_width  = width;
+			pRenderer->pending_height = height;
+			pRenderer->resize_pending = true;
+		}
+		pRenderer->state = ST_RENDERER_STATE_IDLE;
+		stMutexUnlock(&pRenderer->lock);
+		return false;
+	}
+	if (change_sync) pRenderer->PFNSetVsync(pRenderer->pRendererInstance, vsync);
 
 	const bool res = pRenderer->PFNPrepareFrame(pRenderer->pRendererInstance, delta_time);
-	pRenderer->PFNPrepareModelMatrices(pRenderer->pRendererInstance, STUPID_RENDERER_MAX_OBJECTS, &pRenderer->models, &pRenderer->transformations);
 
-	//stMutexUnlock(&pRenderer->lock);
+	// made once (after any resize) so the culling pass and every draw this frame use the same matrix
+	pRenderer->view_projection = stRendererCameraMatrix(pRenderer->rvals->camera, (f32)pRenderer->rvals->width, (f32)pRenderer->rvals->height);
+
+	// only the transformations that have been handed out (not all STUPID_RENDERER_MAX_OBJECTS)
+	pRenderer->PFNPrepareModelMatrices(pRenderer->pRendererInstance, models, &pRenderer->models, &pRenderer->transformations);
+
+	// compute cant run while rendering, so every object drawn this frame is culled by one pass recorded here
+	// (the objects are written to the mapped buffers as theyre drawn, which is still before the frame is submitted)
+	if (res) {
+		pRenderer->PFNCullObjects(pRenderer->pRendererInstance, pRenderer->view_projection, &pRenderer->models, &pRenderer->draw_commands,
+		                          &pRenderer->draw_data, &pRenderer->cull_objects, &pRenderer->draw_counts);
+	}
+
 	return res;
 }
 
@@ -386,8 +466,6 @@ bool stRendererStartFrame(StRenderer *pRenderer, const f32 delta_time)
 	STUPID_NC(pRenderer);
 	STUPID_NC(pRenderer->PFNStartFrame);
 
-	pRenderer->view_projection = stRendererCameraMatrix(pRenderer->rvals->camera, (f32)pRenderer->rvals->width, (f32)pRenderer->rvals->height);
-
 	//stMutexLock(&pRenderer->lock);
 
 	if (pRenderer->state != ST_RENDERER_STATE_FRAME_PREPARE) {
@@ -547,12 +625,21 @@ void stRendererSetVsync(StRenderer *pRenderer, const bool state)
 	STUPID_NC(pRenderer);
 	STUPID_NC(pRenderer->pRendererInstance);
 
+	// applied by the next stRendererPrepareFrame(), so this can be called from any thread
 	stMutexLock(&pRenderer->lock);
+	pRenderer->pending_vsync = state;
+	pRenderer->vsync_pending = true;
+	stMutexUnlock(&pRenderer->lock);
+}
 
-	pRenderer->PFNSetVsync(pRenderer->pRendererInstance, state);
-	getRvals(pRenderer)->vsync = state;
+bool stRendererGetVsync(StRenderer *pRenderer)
+{
+	STUPID_NC(pRenderer);
 
+	stMutexLock(&pRenderer->lock);
+	const bool state = (pRenderer->vsync_pending) ? pRenderer->pending_vsync : getRvals(pRenderer)->vsync;
 	stMutexUnlock(&pRenderer->lock);
+	return state;
 }
 
 void stRendererCopyBufferToBuffer(StRenderer *pRenderer, const usize size, StRendererBuffer *pDestBuffer,
@@ -622,6 +709,12 @@ bool stRendererLoadObject(StRenderer *pRenderer, const char *path, StObject *pOb
 	pObject->index_offset = pRenderer->indices_end;
 	pObject->transformation_index = pRenderer->transformations_end;
 
+	// fast_obj puts a dummy position at index 0 (so 1 based obj indices work), which would pull the bounds toward the origin
+	if (mesh->position_count > 1)
+		pObject->bounds = stSphereFromAabb(stAabbFromPoints((StVec3 *)mesh->positions + 1, mesh->position_count - 1));
+	else
+		pObject->bounds = STSPHERE(0.0, 0.0, 0.0, 0.0);
+
 	pRenderer->positions_end += size;
 	pRenderer->indices_end += index_size;
 	pRenderer->transformations_end += 1;
@@ -631,6 +724,22 @@ bool stRendererLoadObject(StRenderer *pRenderer, const char *path, StObject *pOb
 	return pObject;
 }
 
+bool stRendererInstanceObject(StRenderer *pRenderer, const StObject *pObject, StObject *pInstance)
+{
+	STUPID_NC(pRenderer);
+	STUPID_NC(pObject);
+	STUPID_NC(pInstance);
+
+	if (pRenderer->transformations_end >= STUPID_RENDERER_MAX_OBJECTS) {
+		STUPID_LOG_ERROR("too many objects (max %d)", STUPID_RENDERER_MAX_OBJECTS);
+		return false;
+	}
+
+	*pInstance = *pObject;
+	pInstance->transformation_index = pRenderer->transformations_end++;
+	return true;
+}
+
 void stRendererUnloadObject(StRenderer *pRenderer, StObject *pObject)
 {
 	pRenderer->positions_end -= pObject->position_count;
@@ -646,22 +755,17 @@ bool stRendererDrawObjects(StRenderer *pRenderer, const usize count, StObject *p
 	STUPID_NC(pRenderer->positions.internal);
 	STUPID_NC(pRenderer->indices.internal);
 
-	STUPID_ASSERT(count < STUPID_RENDERER_MAX_OBJECTS, "object count out of bounds");
+	STUPID_ASSERT(count <= STUPID_RENDERER_MAX_OBJECTS, "object count out of bounds");
 
 	if (pRenderer->state != ST_RENDERER_STATE_FRAME_START) {
 		STUPID_LOG_ERROR("called before stRendererStartFrame()");
 		return false;
 	}
 
-	StRendererValues *rvals = getRvals(pRenderer);
-
-	StMat4 view = stMat4LookAt(rvals->camera.pos, rvals->camera.target, rvals->camera.up);
-	StMat4 proj = stMat4Perspective(rvals->camera.fov, (f32)rvals->width / (f32)rvals->height, rvals->camera.near, rvals->camera.far);
-
-	const StMat4 view_projection = stMat4Mul(proj, view);
-
-	pRenderer->PFNDrawObjects(pRenderer->pRendererInstance, view_projection, count, &pRenderer->positions,
-	                          &pRenderer->indices, &pRenderer->models, pObjects);
+	// the same matrix the objects were culled with
+	pRenderer->PFNDrawObjects(pRenderer->pRendererInstance, pRenderer->view_projection, count, &pRenderer->positions,
+	                          &pRenderer->indices, &pRenderer->models, &pRenderer->draw_commands, &pRenderer->draw_data,
+	                          &pRenderer->cull_objects, &pRenderer->draw_counts, pObjects);
 
 	return true;
 }
@@ -1,3 +1,5 @@
+#define STUPID_LOG_MODULE ST_LOG_MODULE_VULKAN
+
 #include "stupid/render/vulkan/vulkan_backend.h"
 #include "stupid/render/vulkan/vulkan_device.h"
 #include "stupid/render/vulkan/vulkan_utils.h"
@@ -135,7 +137,7 @@ void stRendererVulkanBackendCreateDebugMessenger(StRendererVulkanBackend *pBacke
 }
 #endif
 
-StRendererVulkanBackend *stRendererVulkanBackendInit(void)
+StRendererVulkanBackend *stRendererVulkanBackendInit(const bool headless)
 {
 	// keeps track of time taken to initialize stRendererVulkan
 	StClock c = {0};
@@ -143,9 +145,13 @@ StRendererVulkanBackend *stRendererVulkanBackendInit(void)
 
 	StRendererVulkanBackend *pBackend = stMemAlloc(StRendererVulkanBackend, 1);
 	pBackend->required_layers = stMemAlloc(const char *, 1);
-	pBackend->required_extensions = stWindowGetRequiredExtensions();
 	pBackend->required_device_extensions = stMemAlloc(const char *, 3);
 	pBackend->pAllocator = NULL;
+	pBackend->headless = headless;
+
+	// the window surface extensions need a display (which CI containers dont have)
+	if (headless) pBackend->required_extensions = stMemAlloc(const char *, 1);
+	else pBackend->required_extensions = stWindowGetRequiredExtensions();
 
 	// this is basically redundant but the specification requires this to be filled out
 	VkApplicationInfo application  = {0};
@@ -159,7 +165,7 @@ StRendererVulkanBackend *stRendererVulkanBackendInit(void)
 	// enable validation layers if in debug mode
 	STUPID_DBG(stMemAppend(pBackend->required_layers, &"VK_LAYER_KHRONOS_validation"));
 	STUPID_DBG(stMemAppend(pBackend->required_extensions, &"VK_EXT_debug_utils"));
-	stMemAppend(pBackend->required_device_extensions, &VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+	if (!headless) stMemAppend(pBackend->required_device_extensions, &VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 	stMemAppend(pBackend->required_device_extensions, &VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
 	stMemAppend(pBackend->required_device_extensions, &VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME);
 
@@ -255,7 +261,7 @@ StRendererVulkanBackend *stRendererVulkanBackendInit(void)
 
 	StRendererVulkanDeviceRequirements requirements = {0};
 	requirements.queue.graphics  = true;
-	requirements.queue.present   = true;
+	requirements.queue.present   = !headless;
 	requirements.queue.transfer  = true;
 	requirements.queue.compute   = true;
 	requirements.extension_count = stMemLength(pBackend->required_device_extensions);
@@ -282,7 +288,7 @@ StRendererVulkanBackend *stRendererVulkanBackendInit(void)
 		VK_API_VERSION_MINOR(pBackend->device.properties.apiVersion),
 		VK_API_VERSION_PATCH(pBackend->device.properties.apiVersion));
 
-	STUPID_LOG_SYSTEM("vulkan backend %p initialized in %f", pBackend, stGetClockElapsed(&c));
+	STUPID_LOG_SYSTEM("vulkan backend %p initialized in %f%s", pBackend, stGetClockElapsed(&c), (headless) ? " (headless)" : "");
 
 	return pBackend;
 }
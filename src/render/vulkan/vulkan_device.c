@@ -1,3 +1,5 @@
+#define STUPID_LOG_MODULE ST_LOG_MODULE_VULKAN
+
 #include "stupid/render/vulkan/vulkan_device.h"
 #include "stupid/render/vulkan/vulkan_utils.h"
 
@@ -77,10 +79,10 @@ bool stRendererVulkanCheckSwapchainRequirements(StRendererVulkanSwapchainSupport
 /**
  * Attempt to get the optimal vulkan queue family indices from a VkPhysicalDevice.
  * @param physical_device GPU to get queue family indices from.
- * @param surface If surface is not VK_NULL_HANDLE, then it will be used to query present support.
- * Otherwise, present support will not be checked.
+ * @param present Whether present support should be checked.
+ * Otherwise, the present queue is the same as the graphics queue.
  */
-static QueueFamilies getQueueFamilies(VkInstance instance, VkPhysicalDevice physical_device)
+static QueueFamilies getQueueFamilies(VkInstance instance, VkPhysicalDevice physical_device, const bool present)
 {
 	// output queue families
 	QueueFamilies queue_families = {0};
@@ -114,7 +116,7 @@ static QueueFamilies getQueueFamilies(VkInstance instance, VkPhysicalDevice phys
 			queue_families.pQueues[i].compute = true;
 			queue_families.pQueues[i].count++;
 		}
-		if (stWindowGetVulkanPresentationSupport(instance, physical_device, i)) {
+		if (present && stWindowGetVulkanPresentationSupport(instance, physical_device, i)) {
 			queue_families.pQueues[i].present = true;
 			queue_families.pQueues[i].count++;
 		}
@@ -135,6 +137,9 @@ static QueueFamilies getQueueFamilies(VkInstance instance, VkPhysicalDevice phys
 		STUPID_LOG_DEBUG("%d: %d %d %d %d", i, queue_families.pQueues[i].graphics, queue_families.pQueues[i].present, queue_families.pQueues[i].transfer, queue_families.pQueues[i].compute);
 	}
 
+	// nothing gets presented, so dont ask for another queue
+	if (!present) queue_families.present_index = queue_families.graphics_index;
+
 	i32 indices[4] = {
 		queue_families.graphics_index,
 		queue_families.present_index,
@@ -198,7 +203,7 @@ bool stRendererVulkanCreateDevice(VkInstance instance, VkAllocationCallbacks *pA
 
 	for (int i = 0; i < device_count; i++) {
 		physical_device = pDevices[i];
-		QueueFamilies tmp = getQueueFamilies(instance, physical_device);
+		QueueFamilies tmp = getQueueFamilies(instance, physical_device, pRequirements->queue.present);
 		if (pRequirements->queue.graphics && (!tmp.pQueues[0].graphics && !tmp.pQueues[1].graphics && !tmp.pQueues[2].graphics && !tmp.pQueues[3].graphics))
 			continue;
 		if (pRequirements->queue.present && (!tmp.pQueues[0].present && !tmp.pQueues[1].present && !tmp.pQueues[2].present && !tmp.pQueues[3].present))
@@ -230,6 +235,18 @@ bool stRendererVulkanCreateDevice(VkInstance instance, VkAllocationCallbacks *pA
 		}
 		stMemDeallocNL(pExtensions);
 
+		// all the objects get drawn with one indirect draw, with the count written by the culling pass
+		VkPhysicalDeviceVulkan12Features vulkan12_features = {0};
+		vulkan12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+		VkPhysicalDeviceFeatures2 features = {0};
+		features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features.pNext = &vulkan12_features;
+		vkGetPhysicalDeviceFeatures2(physical_device, &features);
+		if (!features.features.multiDrawIndirect || !vulkan12_features.drawIndirectCount) {
+			STUPID_LOG_DEBUG("gpu %d doesnt support multi draw indirect (or draw indirect count)", i);
+			continue;
+		}
 
 		// check the surface support
 		if (pRequirements->queue.present) {
@@ -254,14 +271,25 @@ bool stRendererVulkanCreateDevice(VkInstance instance, VkAllocationCallbacks *pA
 	if (!found)
 		return NULL;
 
-	VkPhysicalDeviceBufferDeviceAddressFeatures bda_features = {0};
-	bda_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES_KHR;
-	bda_features.bufferDeviceAddress = VK_TRUE;
+	// buffer device address is enabled here instead of with VkPhysicalDeviceBufferDeviceAddressFeatures (they cant both be in the chain)
+	VkPhysicalDeviceVulkan12Features vulkan12_features = {0};
+	vulkan12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	vulkan12_features.bufferDeviceAddress = VK_TRUE;
+	vulkan12_features.drawIndirectCount = VK_TRUE;
+
+	// for gl_DrawID (core in 1.1, but it still has to be enabled)
+	VkPhysicalDeviceShaderDrawParametersFeatures draw_parameters_features = {0};
+	draw_parameters_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_DRAW_PARAMETERS_FEATURES;
+	draw_parameters_features.shaderDrawParameters = VK_TRUE;
+	draw_parameters_features.pNext = &vulkan12_features;
 
 	VkPhysicalDeviceDynamicRenderingFeatures dynamic_rendering_features = {0};
 	dynamic_rendering_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
 	dynamic_rendering_features.dynamicRendering = VK_TRUE;
-	dynamic_rendering_features.pNext = &bda_features;
+	dynamic_rendering_features.pNext = &draw_parameters_features;
+
+	VkPhysicalDeviceFeatures enabled_features = {0};
+	enabled_features.multiDrawIndirect = VK_TRUE;
 
 	VkDeviceQueueCreateInfo pQueueInfo[4];
 	stMemset(pQueueInfo, 0, sizeof(VkDeviceQueueCreateInfo) * queue_families.queue_count);
@@ -282,6 +310,7 @@ bool stRendererVulkanCreateDevice(VkInstance instance, VkAllocationCallbacks *pA
 	device_info.ppEnabledLayerNames     = pRequirements->layers;
 	device_info.queueCreateInfoCount    = queue_families.queue_count;
 	device_info.pQueueCreateInfos	    = pQueueInfo;
+	device_info.pEnabledFeatures        = &enabled_features;
 
 	VK_CHECK(vkCreateDevice(physical_device, &device_info, pAllocator, &pDevice->logical_device));
 
@@ -1,3 +1,5 @@
+#define STUPID_LOG_MODULE ST_LOG_MODULE_VULKAN
+
 #include "stupid/render/vulkan/vulkan_fence.h"
 #include "stupid/render/vulkan/vulkan_utils.h"
 
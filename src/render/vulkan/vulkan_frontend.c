@@ -1,3 +1,5 @@
+#define STUPID_LOG_MODULE ST_LOG_MODULE_VULKAN
+
 #include "stupid/render/vulkan/vulkan_frontend.h"
 #include "stupid/render/vulkan/vulkan_utils.h"
 #include "stupid/render/vulkan/vulkan_command_buffer.h"
@@ -12,10 +14,10 @@
 
 #include "stupid/math/linear.h"
 
-StRendererVulkanContext *stRendererVulkanFrontendInit(StRendererVulkanBackend *pBackend, StWindow *pWindow)
+StRendererVulkanContext *stRendererVulkanFrontendInit(StRendererVulkanBackend *pBackend, StWindow *pWindow, const u32 offscreen_width, const u32 offscreen_height)
 {
 	STUPID_NC(pBackend);
-	STUPID_ASSERT(pWindow != NULL, "headless rendering not yet implemented");
+	STUPID_ASSERT(pWindow != NULL || pBackend->headless, "headless rendering needs a headless backend");
 
 	// allocate all the crap
 	StRendererVulkanContext *pContext = stMemAlloc(StRendererVulkanContext, 1);
@@ -33,18 +35,27 @@ StRendererVulkanContext *stRendererVulkanFrontendInit(StRendererVulkanBackend *p
 	pContext->clear_value.depthStencil.stencil = 0;
 
 	pContext->pWindow = pWindow;
-	VkSurfaceKHR surface = VK_NULL_HANDLE;
-	STUPID_ASSERT(stWindowCreateVulkanSurface(pWindow, pBackend->instance, &surface), "failed to create surface");
 
 	i32 width = 0, height = 0;
-	stWindowGetSize(pWindow, &width, &height);
+	if (pWindow) {
+		VkSurfaceKHR surface = VK_NULL_HANDLE;
+		STUPID_ASSERT(stWindowCreateVulkanSurface(pWindow, pBackend->instance, &surface), "failed to create surface");
+
+		stWindowGetSize(pWindow, &width, &height);
+
+		pWindow->resizing = true;
+		STUPID_ASSERT(stRendererVulkanSwapchainCreate(pContext->pBackend, surface, VK_PRESENT_MODE_MAILBOX_KHR, width, height, &pContext->swapchain), "failed to create swapchain");
+		pWindow->resizing = false;
+	}
+	else {
+		// headless (render to offscreen images instead)
+		width  = offscreen_width;
+		height = offscreen_height;
+		STUPID_ASSERT(stRendererVulkanSwapchainCreateOffscreen(pContext->pBackend, width, height, &pContext->swapchain), "failed to create offscreen images");
+	}
 	pContext->rvals.width = width;
 	pContext->rvals.height = height;
 
-	pWindow->resizing = true;
-	STUPID_ASSERT(stRendererVulkanSwapchainCreate(pContext->pBackend, surface, VK_PRESENT_MODE_MAILBOX_KHR, width, height, &pContext->swapchain), "failed to create swapchain");
-	pWindow->resizing = false;
-
 	pContext->pRenderingAttachments = stMemAlloc(VkRenderingAttachmentInfo, 8 + pContext->swapchain.image_count);
 	pContext->pRenderingAttachments[0].sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
 	pContext->pRenderingAttachments[0].clearValue = pContext->clear_value;
@@ -114,6 +125,11 @@ StRendererVulkanContext *stRendererVulkanFrontendInit(StRendererVulkanBackend *p
 	compute_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
 	stRendererVulkanPipelineCreateCompute(pContext->pBackend, "assets/shaders/shader.comp.spv", &compute_range, 1, &pContext->compute_pipeline);
 
+	VkPushConstantRange cull_range = {0};
+	cull_range.size = 112;
+	cull_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	stRendererVulkanPipelineCreateCompute(pContext->pBackend, "assets/shaders/cull.comp.spv", &cull_range, 1, &pContext->cull_pipeline);
+
 	stRendererVulkanImageCreateColor(pBackend,
 	                                 true,
 	                                 pContext->swapchain.swapchain_width,
@@ -149,6 +165,7 @@ void stRendererVulkanFrontendShutdown(StRendererVulkanContext *pContext)
 	vkDeviceWaitIdle(pContext->pBackend->device.logical_device);
 	stRendererVulkanPipelineDestroy(pContext->pBackend, &pContext->graphics_pipeline);
 	stRendererVulkanPipelineDestroy(pContext->pBackend, &pContext->compute_pipeline);
+	stRendererVulkanPipelineDestroy(pContext->pBackend, &pContext->cull_pipeline);
 
 	for (int i = 0; i < pContext->swapchain.image_count; i++)
 		if (pContext->pGraphicsCommandBuffers[i].handle != VK_NULL_HANDLE)
@@ -184,7 +201,8 @@ void stRendererVulkanFrontendShutdown(StRendererVulkanContext *pContext)
 	stMemDealloc(pContext->pRenderingAttachments);
 	stMemDealloc(pContext->pDepthAttachments);
 	stMemDealloc(pContext->pColorAttachments);
-	vkDestroySurfaceKHR(pContext->pBackend->instance, pContext->swapchain.surface, pContext->pBackend->pAllocator);
+	if (pContext->swapchain.surface != VK_NULL_HANDLE)
+		vkDestroySurfaceKHR(pContext->pBackend->instance, pContext->swapchain.surface, pContext->pBackend->pAllocator);
 	stMemDealloc(pContext);
 }
 
@@ -216,9 +234,8 @@ bool stRendererVulkanFrontendPrepareFrame(StRendererVulkanContext *pContext, con
 	STUPID_NC(pContext);
 	STUPID_NC(pContext->pBackend);
 	STUPID_NC(pContext->pBackend->device.logical_device);
-	STUPID_NC(pContext->pWindow);
 
-	if (pContext->pWindow->resizing || pContext->swapchain.is_recreating)
+	if ((pContext->pWindow && pContext->pWindow->resizing) || pContext->swapchain.is_recreating)
 		return false;
 
 	// recreate the vulkan swapchain if thats a thing that should happen
@@ -265,10 +282,11 @@ bool stRendererVulkanFrontendStartFrame(StRendererVulkanContext *pContext, const
 	STUPID_NC(pContext->pBackend);
 	STUPID_NC(pContext->pBackend->device.logical_device);
 	STUPID_NC(pContext->pCurrentGraphicsCommandBuffer);
-	STUPID_NC(pContext->pWindow);
 
 	pContext->clear_value.depthStencil.depth = 1.0f;
 	pContext->clear_value.depthStencil.stencil = 0;
+	pContext->draw_count = 0;
+	pContext->draw_call_count = 0;
 
 	pContext->pRenderingAttachments[0].clearValue = pContext->clear_value;
 	pContext->depth_attachment.clearValue = pContext->clear_value;
@@ -303,10 +321,12 @@ bool stRendererVulkanFrontendEndFrame(StRendererVulkanContext *pContext, const f
 	STUPID_NC(pContext->pBackend);
 	STUPID_NC(pContext->pBackend->device.logical_device);
 	STUPID_NC(pContext->pCurrentGraphicsCommandBuffer);
-	STUPID_NC(pContext->pWindow);
+
+	// offscreen images are left ready to be copied out instead of presented
+	const VkImageLayout final_layout = (pContext->swapchain.offscreen) ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
 	vkCmdEndRendering(pContext->pCurrentGraphicsCommandBuffer->handle);
-	stRendererVulkanImageConvert(pContext->pCurrentGraphicsCommandBuffer->handle, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, &pContext->swapchain.pImages[pContext->image_index]);
+	stRendererVulkanImageConvert(pContext->pCurrentGraphicsCommandBuffer->handle, final_layout, &pContext->swapchain.pImages[pContext->image_index]);
 	stRendererVulkanCommandBufferEnd(pContext->pCurrentGraphicsCommandBuffer);
 
 	VkSubmitInfo submit_info = {0};
@@ -321,6 +341,12 @@ bool stRendererVulkanFrontendEndFrame(StRendererVulkanContext *pContext, const f
 	const VkPipelineStageFlags flags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT; // VK_PIPELNE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT allows one frame to be presented at a time for some reason
 	submit_info.pWaitDstStageMask    = &flags;
 
+	// nothing acquires or presents offscreen images, so theres nothing to wait on or signal
+	if (pContext->swapchain.offscreen) {
+		submit_info.waitSemaphoreCount   = 0;
+		submit_info.signalSemaphoreCount = 0;
+	}
+
 	stRendererVulkanFenceReset(pContext->pBackend, &pContext->pInFlightFences[pContext->image_index]);
 	const VkResult result = vkQueueSubmit(pContext->pBackend->device.graphics_queue, 1, &submit_info, pContext->pInFlightFences[pContext->image_index]);
 
@@ -384,6 +410,9 @@ void stRendererVulkanFrontendSetVsync(StRendererVulkanContext *pContext, const b
 	STUPID_NC(pContext);
 	STUPID_NC(pContext->pBackend);
 
+	// theres no display to sync to
+	if (pContext->swapchain.offscreen) return;
+
 	if (state) {
 		if (pContext->swapchain.present_mode == VK_PRESENT_MODE_FIFO_KHR)
 			return;
@@ -408,6 +437,8 @@ void stRendererVulkanFrontendPrepareModelMatrices(StRendererVulkanContext *pCont
 	STUPID_NC(pModelBuffer);
 	STUPID_NC(pTransformationBuffer);
 
+	if (model_count == 0) return;
+
 	struct pc {
 		VkDeviceAddress models;
 		VkDeviceAddress transformations;
@@ -426,44 +457,173 @@ void stRendererVulkanFrontendPrepareModelMatrices(StRendererVulkanContext *pCont
 	u32 workgroup_size = 64;
 	u32 workgroup_count = (model_count + workgroup_size - 1) / workgroup_size;
 	vkCmdDispatch(pContext->pCurrentGraphicsCommandBuffer->handle, workgroup_count, 1, 1);
+
+	// the culling pass and the vertex shader both read the matrices
+	VkMemoryBarrier barrier = {0};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(pContext->pCurrentGraphicsCommandBuffer->handle, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+	                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+}
+
+// the draw commands are read by the gpu as they are
+STUPID_STATIC_ASSERT(sizeof(StDrawCommand) == sizeof(VkDrawIndirectCommand), "StDrawCommand doesnt match VkDrawIndirectCommand");
+
+/**
+ * Flushes writes to a mapped buffer so the gpu can see them.
+ * @param pContext Pointer to a vulkan renderer instance.
+ * @param pBuffer The buffer.
+ */
+static void flushBuffer(StRendererVulkanContext *pContext, StRendererVulkanBuffer *pBuffer)
+{
+	VkMappedMemoryRange range = {0};
+	range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+	range.memory = pBuffer->memory;
+	range.size = pBuffer->size;
+	vkFlushMappedMemoryRanges(pContext->pBackend->device.logical_device, 1, &range);
+}
+
+/**
+ * Gets the offset of the StCullDispatch of a frame in the draw count buffer.
+ * @param frame Which frame in flight.
+ * @return Offset in bytes (after the visible object counters of every frame).
+ */
+static STUPID_INLINE VkDeviceSize cullDispatchOffset(const usize frame)
+{
+	return STUPID_RENDERER_MAX_FRAMES_IN_FLIGHT * STUPID_RENDERER_MAX_DRAW_CALLS * sizeof(u32) + frame * sizeof(StCullDispatch);
+}
+
+void stRendererVulkanFrontendCullObjects(StRendererVulkanContext *pContext, const StMat4 view_projection, StRendererBuffer *pModelBuffer, StRendererBuffer *pDrawCommandBuffer, StRendererBuffer *pDrawDataBuffer, StRendererBuffer *pCullObjectBuffer, StRendererBuffer *pDrawCountBuffer)
+{
+	STUPID_NC(pContext);
+	STUPID_NC(pModelBuffer);
+	STUPID_NC(pDrawCommandBuffer);
+	STUPID_NC(pDrawDataBuffer);
+	STUPID_NC(pCullObjectBuffer);
+	STUPID_NC(pDrawCountBuffer);
+	STUPID_NC(pDrawCountBuffer->map);
+
+	struct pc {
+		StMat4 view_projection;
+		VkDeviceAddress objects;
+		VkDeviceAddress models;
+		VkDeviceAddress commands;
+		VkDeviceAddress draws;
+		VkDeviceAddress counts;
+		VkDeviceAddress dispatch;
+	} pc = {0};
+	STUPID_STATIC_ASSERT(sizeof(pc) == 112, "the culling push constants dont match the pipeline");
+
+	StRendererVulkanBuffer *models = pModelBuffer->internal;
+	StRendererVulkanBuffer *draw_commands = pDrawCommandBuffer->internal;
+	StRendererVulkanBuffer *draw_data = pDrawDataBuffer->internal;
+	StRendererVulkanBuffer *cull_objects = pCullObjectBuffer->internal;
+	StRendererVulkanBuffer *draw_counts = pDrawCountBuffer->internal;
+
+	// nothing has been drawn yet, stRendererVulkanFrontendDrawObjects() makes the dispatch bigger before the frame is submitted
+	const usize frame = pContext->image_index % STUPID_RENDERER_MAX_FRAMES_IN_FLIGHT;
+	const VkDeviceSize dispatch_offset = cullDispatchOffset(frame);
+	*(StCullDispatch *)((u8 *)pDrawCountBuffer->map + dispatch_offset) = (StCullDispatch){0, 1, 1, 0};
+	flushBuffer(pContext, draw_counts);
+
+	pc.view_projection = view_projection;
+	pc.objects = cull_objects->address + frame * STUPID_RENDERER_MAX_OBJECTS * sizeof(StCullObject);
+	pc.models = models->address;
+	pc.commands = draw_commands->address + frame * STUPID_RENDERER_MAX_OBJECTS * sizeof(StDrawCommand);
+	pc.draws = draw_data->address + frame * STUPID_RENDERER_MAX_OBJECTS * sizeof(StDrawData);
+	pc.counts = draw_counts->address + frame * STUPID_RENDERER_MAX_DRAW_CALLS * sizeof(u32);
+	pc.dispatch = draw_counts->address + dispatch_offset;
+
+	vkCmdBindPipeline(pContext->pCurrentGraphicsCommandBuffer->handle, VK_PIPELINE_BIND_POINT_COMPUTE, pContext->cull_pipeline.handle);
+	vkCmdPushConstants(pContext->pCurrentGraphicsCommandBuffer->handle, pContext->cull_pipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pc), &pc);
+	vkCmdDispatchIndirect(pContext->pCurrentGraphicsCommandBuffer->handle, draw_counts->handle, dispatch_offset);
+
+	VkMemoryBarrier barrier = {0};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(pContext->pCurrentGraphicsCommandBuffer->handle, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+	                     VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
 }
 
-void stRendererVulkanFrontendDrawObjects(StRendererVulkanContext *pContext, const StMat4 view_projection, const usize object_count, StRendererBuffer *pPositionBuffer, StRendererBuffer *pIndexBuffer, StRendererBuffer *pModelBuffer, StObject *pObjects)
+void stRendererVulkanFrontendDrawObjects(StRendererVulkanContext *pContext, const StMat4 view_projection, const usize object_count, StRendererBuffer *pPositionBuffer, StRendererBuffer *pIndexBuffer, StRendererBuffer *pModelBuffer, StRendererBuffer *pDrawCommandBuffer, StRendererBuffer *pDrawDataBuffer, StRendererBuffer *pCullObjectBuffer, StRendererBuffer *pDrawCountBuffer, StObject *pObjects)
 {
 	STUPID_NC(pContext);
 	STUPID_NC(pPositionBuffer);
 	STUPID_NC(pIndexBuffer);
 	STUPID_NC(pModelBuffer);
+	STUPID_NC(pDrawCommandBuffer);
+	STUPID_NC(pDrawDataBuffer);
+	STUPID_NC(pCullObjectBuffer);
+	STUPID_NC(pCullObjectBuffer->map);
+	STUPID_NC(pDrawCountBuffer);
+	STUPID_NC(pDrawCountBuffer->map);
 	STUPID_NC(pObjects);
-	
+
+	if (object_count == 0) return;
+	STUPID_ASSERT(pContext->draw_count + object_count <= STUPID_RENDERER_MAX_OBJECTS, "too many objects drawn this frame");
+	STUPID_ASSERT(pContext->draw_call_count < STUPID_RENDERER_MAX_DRAW_CALLS, "too many draw calls this frame");
+
 	struct pc {
 		StMat4 view_projection;
 		StVec4 pos;
 		StVec4 target;
-		VkDeviceAddress positions;
-		VkDeviceAddress indices;
+		VkDeviceAddress draws;
 		VkDeviceAddress models;
-		u32 id;
 	} pc = {0};
 
 	StRendererVulkanBuffer *positions = pPositionBuffer->internal;
 	StRendererVulkanBuffer *indices = pIndexBuffer->internal;
 	StRendererVulkanBuffer *models = pModelBuffer->internal;
+	StRendererVulkanBuffer *draw_commands = pDrawCommandBuffer->internal;
+	StRendererVulkanBuffer *draw_data = pDrawDataBuffer->internal;
+	StRendererVulkanBuffer *cull_objects = pCullObjectBuffer->internal;
+	StRendererVulkanBuffer *draw_counts = pDrawCountBuffer->internal;
+
+	// each frame gets its own part of the buffers (so the last frame can still be reading its draws),
+	// and each call this frame goes after the last one
+	const usize frame = pContext->image_index % STUPID_RENDERER_MAX_FRAMES_IN_FLIGHT;
+	const usize frame_first = pContext->draw_count;
+	const u32 draw_call = pContext->draw_call_count;
+	const usize first = frame * STUPID_RENDERER_MAX_OBJECTS + frame_first;
+	const usize counter = frame * STUPID_RENDERER_MAX_DRAW_CALLS + draw_call;
+	pContext->draw_count += object_count;
+	pContext->draw_call_count++;
+
+	// the culling pass was recorded before rendering started, but it only reads these once the frame is submitted
+	StCullObject *pCullObjects = (StCullObject *)pCullObjectBuffer->map + first;
+	for (usize i = 0; i < object_count; i++) {
+		pCullObjects[i] = (StCullObject){
+			.bounds = pObjects[i].bounds,
+			.positions = positions->address + pObjects[i].position_offset,
+			.indices = indices->address + pObjects[i].index_offset,
+			.model = pObjects[i].transformation_index,
+			.index_count = pObjects[i].index_count,
+			.draw_call = draw_call,
+			.first = (u32)frame_first,
+		};
+	}
+	((u32 *)pDrawCountBuffer->map)[counter] = 0;
+
+	// the culling shader has 64 invocations per workgroup
+	StCullDispatch *pDispatch = (StCullDispatch *)((u8 *)pDrawCountBuffer->map + cullDispatchOffset(frame));
+	pDispatch->object_count = pContext->draw_count;
+	pDispatch->x = (u32)((pContext->draw_count + 63) / 64);
+
+	flushBuffer(pContext, cull_objects);
+	flushBuffer(pContext, draw_counts);
 
 	pc.view_projection = view_projection;
 	pc.pos = STVEC4(pContext->rvals.camera.pos.x, pContext->rvals.camera.pos.y, pContext->rvals.camera.pos.z, 1.0);
 	pc.target = STVEC4(pContext->rvals.camera.target.x, pContext->rvals.camera.target.y, pContext->rvals.camera.target.z, 1.0);
+	pc.draws = draw_data->address + first * sizeof(StDrawData);
 	pc.models = models->address;
 
+	// the vertex shader finds its draw data with gl_DrawID, so all the visible objects go in one draw
 	vkCmdBindPipeline(pContext->pCurrentGraphicsCommandBuffer->handle, VK_PIPELINE_BIND_POINT_GRAPHICS, pContext->graphics_pipeline.handle);
-
-	for (usize i = 0; i < object_count; i++) {
-		pc.positions = positions->address + pObjects[i].position_offset;
-		pc.indices = indices->address + pObjects[i].index_offset;
-		pc.id = pObjects[i].transformation_index;
-
-		vkCmdPushConstants(pContext->pCurrentGraphicsCommandBuffer->handle, pContext->graphics_pipeline.layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pc), &pc);
-		vkCmdDraw(pContext->pCurrentGraphicsCommandBuffer->handle, pObjects[i].index_count, 1, 0, 0);
-	}
+	vkCmdPushConstants(pContext->pCurrentGraphicsCommandBuffer->handle, pContext->graphics_pipeline.layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pc), &pc);
+	vkCmdDrawIndirectCount(pContext->pCurrentGraphicsCommandBuffer->handle, draw_commands->handle, first * sizeof(StDrawCommand),
+	                       draw_counts->handle, counter * sizeof(u32), object_count, sizeof(StDrawCommand));
 }
 
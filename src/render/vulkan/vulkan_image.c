@@ -1,3 +1,5 @@
+#define STUPID_LOG_MODULE ST_LOG_MODULE_VULKAN
+
 #include "stupid/render/vulkan/vulkan_image.h"
 #include "stupid/render/vulkan/vulkan_types.h"
 #include "stupid/render/vulkan/vulkan_utils.h"
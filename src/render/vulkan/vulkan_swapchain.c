@@ -1,3 +1,5 @@
+#define STUPID_LOG_MODULE ST_LOG_MODULE_VULKAN
+
 #include "stupid/render/vulkan/vulkan_swapchain.h"
 #include "stupid/render/vulkan/vulkan_device.h"
 #include "stupid/render/vulkan/vulkan_image.h"
@@ -127,6 +129,48 @@ bool stRendererVulkanSwapchainCreate(StRendererVulkanBackend *pBackend, VkSurfac
 	return pSwapchain;
 }
 
+bool stRendererVulkanSwapchainCreateOffscreen(StRendererVulkanBackend *pBackend, const u32 width, const u32 height, StRendererVulkanSwapchain *pSwapchain)
+{
+	STUPID_NC(pBackend);
+	STUPID_NC(pBackend->device.logical_device);
+	STUPID_NC(pSwapchain);
+
+	STUPID_ASSERT(width <= STUPID_WINDOW_MAX_WIDTH, "width out of range");
+	STUPID_ASSERT(height <= STUPID_WINDOW_MAX_HEIGHT, "height out of range");
+
+	// try to get a valid vulkan depth format
+	if (!stRendererVulkanDeviceGetDepthFormat(&pBackend->device)) {
+		pBackend->device.depth_format = VK_FORMAT_UNDEFINED;
+		STUPID_LOG_FATAL("failed to find a supported depth format");
+		return false;
+	}
+
+	pSwapchain->handle               = VK_NULL_HANDLE;
+	pSwapchain->surface              = VK_NULL_HANDLE;
+	pSwapchain->offscreen            = true;
+	pSwapchain->swapchain_width      = width;
+	pSwapchain->swapchain_height     = height;
+	pSwapchain->image_count          = ST_RENDERER_VULKAN_OFFSCREEN_IMAGE_COUNT;
+	pSwapchain->max_frames_in_flight = pSwapchain->image_count - 1;
+	pSwapchain->current_frame        = 0;
+
+	// nothing waits on a display, so this is as fast as the gpu can go
+	pSwapchain->present_mode          = VK_PRESENT_MODE_IMMEDIATE_KHR;
+	pSwapchain->previous_present_mode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+
+	// same format stRendererVulkanImageCreateColor() uses
+	pSwapchain->image_format.format     = VK_FORMAT_R8G8B8A8_UNORM;
+	pSwapchain->image_format.colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+
+	for (int i = 0; i < pSwapchain->image_count; i++)
+		stRendererVulkanImageCreateColor(pBackend, true, width, height, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, &pSwapchain->pImages[i]);
+
+	stRendererVulkanImageCreateDepth(pBackend, true, width, height, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, &pSwapchain->depth_attachment);
+	STUPID_LOG_TRACE("created %u offscreen images %ux%u", pSwapchain->image_count, width, height);
+
+	return true;
+}
+
 void stRendererVulkanSwapchainDestroy(StRendererVulkanBackend *pBackend, StRendererVulkanSwapchain *pSwapchain)
 {
 	STUPID_NC(pSwapchain);
@@ -136,6 +180,14 @@ void stRendererVulkanSwapchainDestroy(StRendererVulkanBackend *pBackend, StRende
 
 	stRendererVulkanImageDestroy(pBackend, &pSwapchain->depth_attachment);
 
+	// offscreen images are owned by the renderer instead of the swapchain
+	if (pSwapchain->offscreen) {
+		for (int i = 0; i < pSwapchain->image_count; i++)
+			stRendererVulkanImageDestroy(pBackend, &pSwapchain->pImages[i]);
+		STUPID_LOG_TRACE("destroyed %u offscreen images", pSwapchain->image_count);
+		return;
+	}
+
 	// destroy all the swapchain image views
 	for (int i = 0; i < pSwapchain->image_count; i++)
 		vkDestroyImageView(pBackend->device.logical_device, pSwapchain->pImages[i].view, pBackend->pAllocator);
@@ -157,6 +209,18 @@ bool stRendererVulkanSwapchainRecreate(StRendererVulkanBackend *pBackend, const
 	// make sure there are no active gpu operations
 	vkDeviceWaitIdle(pBackend->device.logical_device);
 
+	if (pSwapchain->offscreen) {
+		pSwapchain->swapchain_width  = width;
+		pSwapchain->swapchain_height = height;
+		pSwapchain->current_frame    = 0;
+		for (int i = 0; i < pSwapchain->image_count; i++) {
+			stRendererVulkanImageResize(pBackend, width, height, &pSwapchain->pImages[i]);
+			pSwapchain->pImages[i].layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		}
+		stRendererVulkanImageResize(pBackend, width, height, &pSwapchain->depth_attachment);
+		return true;
+	}
+
 	// swapchain dimensions
 	VkExtent2D extent = { width, height };
 	pSwapchain->swapchain_width  = width;
@@ -242,6 +306,13 @@ bool stRendererVulkanSwapchainRecreate(StRendererVulkanBackend *pBackend, const
 
 bool stRendererVulkanSwapchainAcquireNextImageIndex(StRendererVulkanContext *pContext, const u64 timeout_ns, VkFence fence)
 {
+	// offscreen images are just used in order (stRendererVulkanFrontendPrepareFrame() already waited for the last frame)
+	if (pContext->swapchain.offscreen) {
+		pContext->image_index = (pContext->image_index + 1) % pContext->swapchain.image_count;
+		pContext->pRenderingAttachments[0].imageView = pContext->swapchain.pImages[pContext->image_index].view;
+		return true;
+	}
+
 	// attempt to acquire the next image from the swapchain
 	const VkResult result = vkAcquireNextImageKHR(pContext->pBackend->device.logical_device,
 						      pContext->swapchain.handle,
@@ -277,6 +348,9 @@ bool stRendererVulkanSwapchainPresent(StRendererVulkanContext *pContext, VkSemap
 
 	pContext->current_frame = (pContext->current_frame + 1) % pContext->swapchain.max_frames_in_flight;
 
+	// theres nowhere to present offscreen images to
+	if (pContext->swapchain.offscreen) return true;
+
 	const VkResult result = vkQueuePresentKHR(pContext->pBackend->device.present_queue, &present_info);
 
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
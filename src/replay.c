@@ -0,0 +1,254 @@
+/// @file replay.c
+/// @brief Input recording and playback.
+/// @author nonexistant
+
+#include "stupid/replay.h"
+#include "stupid/assert.h"
+#include "stupid/logger.h"
+#include "stupid/memory.h"
+
+/// Events that get recorded.
+static const st_event_code recorded_codes[] = {
+	STUPID_EVENT_CODE_KEY_PRESSED,
+	STUPID_EVENT_CODE_KEY_RELEASED,
+	STUPID_EVENT_CODE_BUTTON_PRESSED,
+	STUPID_EVENT_CODE_BUTTON_RELEASED,
+	STUPID_EVENT_CODE_MOUSE_MOVED,
+	STUPID_EVENT_CODE_MOUSE_WHEEL,
+	STUPID_EVENT_CODE_WINDOW_RESIZED,
+	STUPID_EVENT_CODE_WINDOW_MOVED,
+};
+
+STUPID_STATIC_ASSERT(sizeof(recorded_codes) / sizeof(recorded_codes[0]) == sizeof(((StReplay *)0)->handles) / sizeof(StEventHandle),
+                     "StReplay.handles is the wrong size");
+
+// records only store data.array.u32, so every field the recorded events use has to be 32 bits
+STUPID_STATIC_ASSERT(sizeof(st_key_id) == sizeof(u32) && sizeof(st_mouse_button_id) == sizeof(u32), "recorded event data isnt 32 bit");
+
+/**
+ * Writes a u16 in little endian.
+ * @param p Where to write it.
+ * @param value The value.
+ * @return p + 2.
+ */
+static u8 *replayPutU16(u8 *p, const u16 value)
+{
+	p[0] = (u8)value;
+	p[1] = (u8)(value >> 8);
+	return p + 2;
+}
+
+/**
+ * Writes a u32 in little endian.
+ * @param p Where to write it.
+ * @param value The value.
+ * @return p + 4.
+ */
+static u8 *replayPutU32(u8 *p, const u32 value)
+{
+	p[0] = (u8)value;
+	p[1] = (u8)(value >> 8);
+	p[2] = (u8)(value >> 16);
+	p[3] = (u8)(value >> 24);
+	return p + 4;
+}
+
+/**
+ * Reads a little endian u16.
+ * @param p Where to read it from.
+ * @return The value.
+ */
+static u16 replayGetU16(const u8 *p)
+{
+	return (u16)(p[0] | (p[1] << 8));
+}
+
+/**
+ * Reads a little endian u32.
+ * @param p Where to read it from.
+ * @return The value.
+ */
+static u32 replayGetU32(const u8 *p)
+{
+	return (u32)p[0] | ((u32)p[1] << 8) | ((u32)p[2] << 16) | ((u32)p[3] << 24);
+}
+
+/**
+ * Writes an event to the replay file.
+ * @param code Type of event.
+ * @param sender The window that fired the event.
+ * @param listener The replay.
+ * @param data The data being sent in the event.
+ * @return False so other listeners still get the event.
+ */
+static bool recordEvent(const st_event_code code, void *sender, void *listener, const StEventData data)
+{
+	StReplay *pReplay = listener;
+	STUPID_NC(pReplay);
+
+	const u32 tick = (u32)*pReplay->pTick;
+
+	u8 record[STUPID_REPLAY_RECORD_SIZE] = {0};
+	u8 *p = replayPutU32(record, tick);
+	p = replayPutU16(p, (u16)code);
+	p = replayPutU16(p, 0);
+	for (u32 i = 0; i < 4; i++)
+		p = replayPutU32(p, data.array.u32[i]);
+
+	if (fwrite(record, sizeof(record), 1, pReplay->file) != 1)
+		STUPID_LOG_ERROR("failed to write event %d on tick %u", code, tick);
+	else
+		pReplay->count++;
+
+	return false;
+}
+
+StReplay *stReplayRecord(StWindow *pWindow, const char *path, const u16 tps, const u64 *pTick)
+{
+	STUPID_NC(pWindow);
+	STUPID_NC(path);
+	STUPID_NC(pTick);
+
+	FILE *file = fopen(path, "wb");
+	if (file == NULL) {
+		STUPID_LOG_ERROR("failed to open %s", path);
+		return NULL;
+	}
+
+	u8 header[STUPID_REPLAY_HEADER_SIZE] = {0};
+	stMemcpy(header, STUPID_REPLAY_MAGIC, 4);
+	u8 *p = replayPutU16(header + 4, STUPID_REPLAY_VERSION);
+	p = replayPutU16(p, tps);
+	replayPutU32(p, STUPID_REPLAY_RECORD_SIZE);
+
+	if (fwrite(header, sizeof(header), 1, file) != 1) {
+		STUPID_LOG_ERROR("failed to write %s", path);
+		fclose(file);
+		return NULL;
+	}
+
+	StReplay *pReplay = stMemAlloc(StReplay, 1);
+	pReplay->file        = file;
+	pReplay->pWindow     = pWindow;
+	pReplay->pTick       = pTick;
+	pReplay->tps         = tps;
+	pReplay->mode        = ST_REPLAY_MODE_RECORD;
+	pReplay->record_size = STUPID_REPLAY_RECORD_SIZE;
+
+	for (usize i = 0; i < sizeof(recorded_codes) / sizeof(recorded_codes[0]); i++)
+		pReplay->handles[i] = stEventSubscribe(recorded_codes[i], pWindow, pReplay, recordEvent);
+
+	STUPID_LOG_SYSTEM("recording input to %s", path);
+
+	return pReplay;
+}
+
+/**
+ * Reads the next record from the replay file.
+ * @param pReplay Pointer to a replay.
+ * @return False if there are no more records.
+ */
+static bool readNext(StReplay *pReplay)
+{
+	u8 record[STUPID_REPLAY_RECORD_SIZE];
+	pReplay->has_next = fread(record, sizeof(record), 1, pReplay->file) == 1;
+
+	// skip whatever a newer version added to the end of each record
+	if (pReplay->has_next && pReplay->record_size > sizeof(record))
+		pReplay->has_next = fseek(pReplay->file, (long)(pReplay->record_size - sizeof(record)), SEEK_CUR) == 0;
+	if (!pReplay->has_next) return false;
+
+	pReplay->next.tick     = replayGetU32(record);
+	pReplay->next.code     = replayGetU16(record + 4);
+	pReplay->next.reserved = replayGetU16(record + 6);
+	for (u32 i = 0; i < 4; i++)
+		pReplay->next.data.array.u32[i] = replayGetU32(record + 8 + i * 4);
+
+	return true;
+}
+
+StReplay *stReplayPlay(StWindow *pWindow, const char *path, const u64 *pTick)
+{
+	STUPID_NC(pWindow);
+	STUPID_NC(path);
+	STUPID_NC(pTick);
+
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		STUPID_LOG_ERROR("failed to open %s", path);
+		return NULL;
+	}
+
+	u8 bytes[STUPID_REPLAY_HEADER_SIZE];
+	if (fread(bytes, sizeof(bytes), 1, file) != 1 || !stMemeq(bytes, STUPID_REPLAY_MAGIC, 4)) {
+		STUPID_LOG_ERROR("%s is not a valid replay file", path);
+		fclose(file);
+		return NULL;
+	}
+
+	StReplayHeader header = {0};
+	stMemcpy(header.magic, bytes, sizeof(header.magic));
+	header.version     = replayGetU16(bytes + 4);
+	header.tps         = replayGetU16(bytes + 6);
+	header.record_size = replayGetU32(bytes + 8);
+
+	if (header.version != STUPID_REPLAY_VERSION || header.record_size < STUPID_REPLAY_RECORD_SIZE) {
+		STUPID_LOG_ERROR("%s is a version %u replay with %u byte records (expected version %u with at least %u byte records)",
+		                 path, header.version, header.record_size, STUPID_REPLAY_VERSION, STUPID_REPLAY_RECORD_SIZE);
+		fclose(file);
+		return NULL;
+	}
+
+	StReplay *pReplay = stMemAlloc(StReplay, 1);
+	pReplay->file        = file;
+	pReplay->pWindow     = pWindow;
+	pReplay->pTick       = pTick;
+	pReplay->tps         = header.tps;
+	pReplay->mode        = ST_REPLAY_MODE_PLAY;
+	pReplay->record_size = header.record_size;
+
+	readNext(pReplay);
+
+	STUPID_LOG_SYSTEM("playing input from %s (%u ticks per second)", path, header.tps);
+
+	return pReplay;
+}
+
+bool stReplayUpdate(StReplay *pReplay)
+{
+	STUPID_NC(pReplay);
+	STUPID_ASSERT(pReplay->mode == ST_REPLAY_MODE_PLAY, "replay is not being played");
+
+	while (pReplay->has_next && pReplay->next.tick <= *pReplay->pTick) {
+		const StReplayRecord record = pReplay->next;
+
+		if (record.code == STUPID_EVENT_CODE_KEY_PRESSED)
+			stWindowSetKeyState(pReplay->pWindow, record.data.key, true);
+		else if (record.code == STUPID_EVENT_CODE_KEY_RELEASED)
+			stWindowSetKeyState(pReplay->pWindow, record.data.key, false);
+
+		stEventFire(record.code, pReplay->pWindow, record.data);
+		pReplay->count++;
+
+		readNext(pReplay);
+	}
+
+	return pReplay->has_next;
+}
+
+void stReplayStop(StReplay *pReplay)
+{
+	STUPID_NC(pReplay);
+
+	if (pReplay->mode == ST_REPLAY_MODE_RECORD) {
+		for (usize i = 0; i < sizeof(recorded_codes) / sizeof(recorded_codes[0]); i++)
+			stEventUnregisterHandle(pReplay->handles[i]);
+		STUPID_LOG_SYSTEM("recorded %lu events", pReplay->count);
+	}
+	else {
+		STUPID_LOG_SYSTEM("played back %lu events", pReplay->count);
+	}
+
+	fclose(pReplay->file);
+	stMemDealloc(pReplay);
+}
@@ -1,3 +1,5 @@
+#define STUPID_LOG_MODULE ST_LOG_MODULE_THREAD
+
 #include "stupid/thread.h"
 #include "stupid/clock.h"
 #include "stupid/memory.h"
@@ -3,6 +3,8 @@
 /// Provides the means for creating, destroying, and resizing a window.
 /// @author nonexistant
 
+#define STUPID_LOG_MODULE ST_LOG_MODULE_WINDOW
+
 #include "stupid/window.h"
 #include "stupid/assert.h"
 #include "stupid/clock.h"
@@ -22,6 +24,8 @@
 #include <X11/Xlib.h>
 #include <vulkan/vulkan_xlib.h>
 
+#include <poll.h>
+
 #define RGFW_ALLOC stMemAllocs
 #define RGFW_FREE stMemDealloc
 #define RGFW_ASSERT(x) STUPID_ASSERT(x, "RGFW internal assert")
@@ -61,7 +65,8 @@ static const u16 RGFW_TO_STUPID[] = {
 	[RGFW_pageUp] = ST_KEY_PAGEUP, [RGFW_pageDown] = ST_KEY_PAGEDOWN, [RGFW_delete] = ST_KEY_DELETE, [RGFW_end] = ST_KEY_END,
 };
 
-static const u16 STUPID_TO_RGFW[] = {
+/// Lookup table for converting keys back to RGFW keys.
+static STUPID_UNUSED const u16 STUPID_TO_RGFW[] = {
 	[ST_KEY_UNKNOWN] = RGFW_keyNULL,
 
 	[ST_KEY_A] = RGFW_a, [ST_KEY_B] = RGFW_b, [ST_KEY_C] = RGFW_c, [ST_KEY_D] = RGFW_d, [ST_KEY_E] = RGFW_e, [ST_KEY_F] = RGFW_f, [ST_KEY_G] = RGFW_g, [ST_KEY_H] = RGFW_h, [ST_KEY_I] = RGFW_i,
@@ -242,6 +247,7 @@ bool stWindowPoll(StWindow *pWindow)
 		case RGFW_keyPressed: {
 			StEventData data = {0};
 			data.key = RGFW_TO_STUPID[event->key];
+			pWindow->keys[data.key] = true;
 			stEventFire(STUPID_EVENT_CODE_KEY_PRESSED, pWindow, data);
 			break;
 		}
@@ -249,6 +255,7 @@ bool stWindowPoll(StWindow *pWindow)
 		case RGFW_keyReleased: {
 			StEventData data = {0};
 			data.key = RGFW_TO_STUPID[event->key];
+			pWindow->keys[data.key] = false;
 			stEventFire(STUPID_EVENT_CODE_KEY_RELEASED, pWindow, data);
 			break;
 		}
@@ -283,6 +290,15 @@ bool stWindowPoll(StWindow *pWindow)
 
 		case RGFW_focusOut:
 			RGFW_window_showMouse(pWindow->handle, RGFW_TRUE);
+
+			// release events wont arrive while the window is unfocused
+			for (int key = 0; key < ST_KEY_MAX; key++) {
+				if (!pWindow->keys[key]) continue;
+				StEventData data = {0};
+				data.key = key;
+				pWindow->keys[key] = false;
+				stEventFire(STUPID_EVENT_CODE_KEY_RELEASED, pWindow, data);
+			}
 			break;
 
 		default:
@@ -303,6 +319,25 @@ bool stWindowPoll(StWindow *pWindow)
 	return true;
 }
 
+bool stWindowWait(StWindow *pWindow, const f64 timeout)
+{
+	STUPID_NC(pWindow);
+	STUPID_NC(pWindow->handle);
+
+	Display *display = ((RGFW_window *)pWindow->handle)->src.display;
+
+	// events xlib already read off the connection wont show up on the fd (this also flushes requests)
+	if (XPending(display) > 0) return true;
+	if (timeout <= 0.0) return false;
+
+	// round up so the caller doesnt wake up just before whatever its waiting for and spin
+	struct pollfd fd = {0};
+	fd.fd     = ConnectionNumber(display);
+	fd.events = POLLIN;
+	const f64 ms = STUPID_MIN(STUPID_SEC_TO_MS(timeout) + 0.999, 1000000000.0);
+	return poll(&fd, 1, (int)ms) > 0;
+}
+
 bool stWindowIsFullscreen(StWindow *pWindow)
 {
 	STUPID_NC(pWindow);
@@ -388,7 +423,15 @@ bool stWindowIsKeyPressed(StWindow *pWindow, st_key_id key)
 	STUPID_NC(pWindow);
 	STUPID_ASSERT(key >= 0 && key < ST_KEY_MAX, "key index out of bounds (what key did you just press)");
 
-	return RGFW_isPressed(pWindow->handle, STUPID_TO_RGFW[key]);
+	return pWindow->keys[key];
+}
+
+void stWindowSetKeyState(StWindow *pWindow, st_key_id key, const bool state)
+{
+	STUPID_NC(pWindow);
+	STUPID_ASSERT(key >= 0 && key < ST_KEY_MAX, "key index out of bounds");
+
+	pWindow->keys[key] = state;
 }
 
 void stWindowCenterCursor(StWindow *pWindow)
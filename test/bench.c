@@ -0,0 +1,1462 @@
+/// @file bench.c
+/// @brief Microbenchmarks for engine subsystems.
+/// Run with no arguments for every benchmark, or pass the names of the ones to run.
+/// Exits with 1 if any result was wrong, less accurate than it should be, a vectorized math function was slower than the scalar one,
+/// or the suspended engine used too much CPU (so `make check` fails on regressions).
+/// @author nonexistant
+
+// for comparing against the lookup table trig functions
+#define STUPID_MATH_LOOKUP
+
+#include <stupid/common.h>
+#include <stupid/clock.h>
+#include <stupid/logger.h>
+#include <stupid/event.h>
+#include <stupid/window.h>
+#include <stupid/engine.h>
+#include <stupid/math/basic.h>
+#include <stupid/math/linear.h>
+#include <stupid/math/quat.h>
+#include <stupid/math/bounds.h>
+#include <stupid/math/batch.h>
+#include <stupid/memory.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+/// A benchmark.
+typedef struct StBench {
+	const char *name;
+	void (*run)(void);
+} StBench;
+
+/// Set when a benchmark finds a regression (makes the exit code 1).
+static bool bench_failed = false;
+
+/// @brief Set by --timing to fail the run on speed regressions too.
+/// Off by default, since timings on a shared machine are too noisy to fail a build on.
+static bool bench_timing = false;
+
+/// Number of senders used by the event benchmarks.
+#define BENCH_EVENT_SENDERS 64
+
+/// Number of listeners subscribed to each sender by the event benchmarks.
+#define BENCH_EVENT_LISTENERS_PER_SENDER 8
+
+/// Number of times each sender fires an event.
+#define BENCH_EVENT_ITERATIONS 20000
+
+static u64 bench_event_calls = 0;
+static u64 bench_event_wasted = 0;
+
+/// Listener that only cares about one sender (like the old engine/renderer handlers).
+static bool benchEventFilteredHandler(const st_event_code code, void *sender, void *listener, const StEventData data)
+{
+	if (sender != listener) {
+		bench_event_wasted++;
+		return false;
+	}
+	bench_event_calls++;
+	return true;
+}
+
+/// Listener subscribed directly to its sender.
+static bool benchEventHandler(const st_event_code code, void *sender, void *listener, const StEventData data)
+{
+	bench_event_calls++;
+	return true;
+}
+
+/**
+ * Fires an event from every sender BENCH_EVENT_ITERATIONS times.
+ * @param senders Array of senders.
+ * @return Nanoseconds per stEventFire() call.
+ */
+static f64 benchEventFireAll(u8 *senders)
+{
+	const f64 start = stGetTime();
+	for (u32 i = 0; i < BENCH_EVENT_ITERATIONS; i++)
+		for (u32 s = 0; s < BENCH_EVENT_SENDERS; s++)
+			stEventFire(STUPID_EVENT_CODE_MOUSE_MOVED, &senders[s], (StEventData){0});
+	const f64 elapsed = stGetTime() - start;
+	return STUPID_SEC_TO_NS(elapsed) / (f64)(BENCH_EVENT_ITERATIONS * BENCH_EVENT_SENDERS);
+}
+
+/// Number of one shot listeners used by benchEventOneShot().
+#define BENCH_EVENT_ONE_SHOTS 4
+
+static StEventHandle bench_event_one_shot_handles[BENCH_EVENT_ONE_SHOTS];
+static u32 bench_event_one_shot_calls[BENCH_EVENT_ONE_SHOTS];
+
+/// Listener that unregisters itself the first time its called (the listener is its index).
+static bool benchEventOneShotHandler(const st_event_code code, void *sender, void *listener, const StEventData data)
+{
+	const usize index = (usize)listener;
+	bench_event_one_shot_calls[index]++;
+	stEventUnregisterHandle(bench_event_one_shot_handles[index]);
+	return true;
+}
+
+/**
+ * Checks that listeners unregistering themselves while an event is fired dont make other listeners get skipped,
+ * and that the sender is forgotten once nothing is subscribed to it.
+ */
+static void benchEventOneShot(void)
+{
+	static u8 sender;
+
+	for (usize i = 0; i < BENCH_EVENT_ONE_SHOTS; i++) {
+		bench_event_one_shot_calls[i]   = 0;
+		bench_event_one_shot_handles[i] = stEventSubscribeNL(STUPID_EVENT_CODE_MOUSE_MOVED, &sender, (void *)i, benchEventOneShotHandler);
+	}
+
+	stEventFire(STUPID_EVENT_CODE_MOUSE_MOVED, &sender, (StEventData){0});
+	stEventFire(STUPID_EVENT_CODE_MOUSE_MOVED, &sender, (StEventData){0});
+
+	for (usize i = 0; i < BENCH_EVENT_ONE_SHOTS; i++) {
+		if (bench_event_one_shot_calls[i] != 1) {
+			STUPID_LOG_ERROR("one shot listener %lu was called %u times instead of once", i, bench_event_one_shot_calls[i]);
+			bench_failed = true;
+		}
+		if (stEventUnregisterHandle(bench_event_one_shot_handles[i])) {
+			STUPID_LOG_ERROR("one shot listener %lu was still registered after it unregistered itself", i);
+			bench_failed = true;
+		}
+	}
+
+	// the same handler twice in one fire still only gets it once (and the group is made again)
+	bench_event_one_shot_calls[0]   = 0;
+	bench_event_one_shot_handles[0] = stEventSubscribeNL(STUPID_EVENT_CODE_MOUSE_MOVED, &sender, (void *)0, benchEventOneShotHandler);
+	stEventFire(STUPID_EVENT_CODE_MOUSE_MOVED, &sender, (StEventData){0});
+	if (bench_event_one_shot_calls[0] != 1) {
+		STUPID_LOG_ERROR("resubscribed one shot listener was called %u times instead of once", bench_event_one_shot_calls[0]);
+		bench_failed = true;
+	}
+
+	stEventUnregisterCode(STUPID_EVENT_CODE_MOUSE_MOVED);
+}
+
+static u8 bench_event_move_senders[2];
+static u32 bench_event_move_calls[2];
+static StEventHandle bench_event_move_handle;
+
+/// Counts calls (the listener is the index into bench_event_move_calls).
+static bool benchEventMoveCounter(const st_event_code code, void *sender, void *listener, const StEventData data)
+{
+	bench_event_move_calls[(usize)listener]++;
+	return true;
+}
+
+/// Unregisters itself, then subscribes to a sender below the one that fired (which moves the group being fired).
+static bool benchEventMoveHandler(const st_event_code code, void *sender, void *listener, const StEventData data)
+{
+	stEventUnregisterHandle(bench_event_move_handle);
+	bench_event_move_handle = stEventSubscribeNL(code, &bench_event_move_senders[0], (void *)1, benchEventMoveCounter);
+	return true;
+}
+
+/**
+ * Checks that a callback subscribing to a new sender while an event is fired doesnt make the rest of the group
+ * get skipped, and doesnt get a handle that still points at the callback it replaced.
+ */
+static void benchEventMove(void)
+{
+	u8 *senders = bench_event_move_senders;
+	bench_event_move_calls[0] = bench_event_move_calls[1] = 0;
+
+	bench_event_move_handle = stEventSubscribeNL(STUPID_EVENT_CODE_MOUSE_MOVED, &senders[1], NULL, benchEventMoveHandler);
+	stEventSubscribeNL(STUPID_EVENT_CODE_MOUSE_MOVED, &senders[1], (void *)0, benchEventMoveCounter);
+
+	stEventFire(STUPID_EVENT_CODE_MOUSE_MOVED, &senders[1], (StEventData){0});
+	if (bench_event_move_calls[0] != 1 || bench_event_move_calls[1] != 0) {
+		STUPID_LOG_ERROR("group moved while firing: listener called %u times (expected 1), new sender called %u times (expected 0)",
+		                 bench_event_move_calls[0], bench_event_move_calls[1]);
+		bench_failed = true;
+	}
+
+	// the handle from inside the callback has to remove that callback and nothing else
+	if (!stEventUnregisterHandle(bench_event_move_handle)) {
+		STUPID_LOG_ERROR("handle subscribed while firing was invalid");
+		bench_failed = true;
+	}
+	stEventFire(STUPID_EVENT_CODE_MOUSE_MOVED, &senders[0], (StEventData){0});
+	stEventFire(STUPID_EVENT_CODE_MOUSE_MOVED, &senders[1], (StEventData){0});
+	if (bench_event_move_calls[0] != 2 || bench_event_move_calls[1] != 0) {
+		STUPID_LOG_ERROR("handle subscribed while firing removed the wrong callback");
+		bench_failed = true;
+	}
+
+	stEventUnregisterCode(STUPID_EVENT_CODE_MOUSE_MOVED);
+}
+
+/// Checks that a handle from before stEventDealloc() doesnt refer to whatever reuses its slot afterwards.
+static void benchEventStaleHandle(void)
+{
+	static u8 sender;
+
+	// so both callbacks get the first slot
+	stEventDealloc();
+
+	const StEventHandle stale = stEventSubscribeNL(STUPID_EVENT_CODE_MOUSE_MOVED, &sender, NULL, benchEventMoveCounter);
+	stEventDealloc();
+	const StEventHandle handle = stEventSubscribeNL(STUPID_EVENT_CODE_MOUSE_MOVED, &sender, NULL, benchEventMoveCounter);
+
+	if (stEventUnregisterHandle(stale)) {
+		STUPID_LOG_ERROR("handle from before stEventDealloc() unregistered a new callback");
+		bench_failed = true;
+	}
+	if (!stEventUnregisterHandle(handle)) {
+		STUPID_LOG_ERROR("callback registered after stEventDealloc() was removed by a stale handle");
+		bench_failed = true;
+	}
+
+	stEventDealloc();
+}
+
+static void benchEvents(void)
+{
+	benchEventOneShot();
+	benchEventMove();
+	benchEventStaleHandle();
+
+	static u8 senders[BENCH_EVENT_SENDERS];
+	const u32 listeners = BENCH_EVENT_SENDERS * BENCH_EVENT_LISTENERS_PER_SENDER;
+
+	// every listener registered for every sender, filtering in the callback
+	for (u32 s = 0; s < BENCH_EVENT_SENDERS; s++)
+		for (u32 l = 0; l < BENCH_EVENT_LISTENERS_PER_SENDER; l++)
+			stEventRegisterNL(STUPID_EVENT_CODE_MOUSE_MOVED, &senders[s], benchEventFilteredHandler);
+
+	bench_event_calls = bench_event_wasted = 0;
+	const f64 wildcard = benchEventFireAll(senders);
+	STUPID_LOG_INFO("%u wildcard listeners:  %8.1lfns/fire, %lu useful calls, %lu wasted calls",
+	                listeners, wildcard, bench_event_calls, bench_event_wasted);
+	stEventUnregisterCode(STUPID_EVENT_CODE_MOUSE_MOVED);
+
+	// every listener subscribed to its own sender
+	for (u32 s = 0; s < BENCH_EVENT_SENDERS; s++)
+		for (u32 l = 0; l < BENCH_EVENT_LISTENERS_PER_SENDER; l++)
+			stEventSubscribeNL(STUPID_EVENT_CODE_MOUSE_MOVED, &senders[s], &senders[s], benchEventHandler);
+
+	bench_event_calls = bench_event_wasted = 0;
+	const f64 subscribed = benchEventFireAll(senders);
+	STUPID_LOG_INFO("%u subscribed listeners: %8.1lfns/fire, %lu useful calls, %lu wasted calls",
+	                listeners, subscribed, bench_event_calls, bench_event_wasted);
+	stEventUnregisterCode(STUPID_EVENT_CODE_MOUSE_MOVED);
+
+	stEventDealloc();
+}
+
+/// Number of times each clock is read by the clock benchmark.
+#define BENCH_CLOCK_ITERATIONS 10000000
+
+/**
+ * Reads clock_gettime() BENCH_CLOCK_ITERATIONS times.
+ * @param id Clock to read.
+ * @return Nanoseconds per call.
+ */
+static f64 benchClockGettime(const clockid_t id)
+{
+	struct timespec ts = {0};
+	u64 sum = 0;
+	const f64 start = stGetTime();
+	for (u32 i = 0; i < BENCH_CLOCK_ITERATIONS; i++) {
+		clock_gettime(id, &ts);
+		sum += ts.tv_nsec;
+	}
+	const f64 elapsed = stGetTime() - start;
+
+	// keep the loop from being optimized out
+	__asm__ volatile("" :: "r"(sum));
+	return STUPID_SEC_TO_NS(elapsed) / (f64)BENCH_CLOCK_ITERATIONS;
+}
+
+static void benchClock(void)
+{
+	const f64 calibration_start = stGetSystemTime();
+	if (!stClockCalibrate()) {
+		STUPID_LOG_WARN("no invariant TSC, stGetTime() uses clock_gettime()");
+	}
+	else {
+		STUPID_LOG_INFO("TSC calibrated to %.6lfGHz in %.1lfms", st_tsc.frequency / 1000000000.0,
+		                STUPID_SEC_TO_MS(stGetSystemTime() - calibration_start));
+	}
+
+	f64 sum = 0.0;
+	f64 start = stGetTime();
+	for (u32 i = 0; i < BENCH_CLOCK_ITERATIONS; i++)
+		sum += stGetTime();
+	f64 elapsed = stGetTime() - start;
+	__asm__ volatile("" :: "x"(sum));
+	STUPID_LOG_INFO("stGetTime():                    %6.1lfns/call", STUPID_SEC_TO_NS(elapsed) / (f64)BENCH_CLOCK_ITERATIONS);
+
+	u64 ticks = 0;
+	start = stGetTime();
+	for (u32 i = 0; i < BENCH_CLOCK_ITERATIONS; i++)
+		ticks += stGetTicks();
+	elapsed = stGetTime() - start;
+	__asm__ volatile("" :: "r"(ticks));
+	STUPID_LOG_INFO("stGetTicks():                   %6.1lfns/call", STUPID_SEC_TO_NS(elapsed) / (f64)BENCH_CLOCK_ITERATIONS);
+
+	STUPID_LOG_INFO("clock_gettime(MONOTONIC):       %6.1lfns/call", benchClockGettime(CLOCK_MONOTONIC));
+	STUPID_LOG_INFO("clock_gettime(MONOTONIC_RAW):   %6.1lfns/call", benchClockGettime(CLOCK_MONOTONIC_RAW));
+
+	// how far the TSC has drifted from CLOCK_MONOTONIC since calibration
+	if (st_tsc.usable)
+		STUPID_LOG_INFO("drift from CLOCK_MONOTONIC:     %6.1lfus", STUPID_SEC_TO_US(stGetTime() - stGetSystemTime()));
+}
+
+/// How long the engine stays suspended in the idle benchmark in seconds.
+#define BENCH_IDLE_TIME 2.0
+
+/// Most CPU the engine can use while suspended (1.0 is one core).
+#define BENCH_IDLE_MAX_CPU 0.05
+
+/**
+ * Gets the CPU time used by the process.
+ * @return CPU time in seconds.
+ */
+static f64 benchCpuTime(void)
+{
+	struct timespec ts = {0};
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return (f64)ts.tv_sec + (f64)ts.tv_nsec / 1000000000.0;
+}
+
+/**
+ * Makes the engine quit after BENCH_IDLE_TIME seconds (none of the callbacks are called while its suspended).
+ * @param pArg Unused.
+ * @return NULL.
+ */
+static void *benchIdleTimer(void *pArg)
+{
+	stSleepu((u64)STUPID_SEC_TO_US(BENCH_IDLE_TIME));
+	stEventPost(STUPID_EVENT_CODE_EXIT, NULL, (StEventData){0});
+	return NULL;
+}
+
+/// Runs the real main loop suspended, and fails if it uses more than BENCH_IDLE_MAX_CPU (with --timing).
+static void benchIdle(void)
+{
+	// without a display the engine renders offscreen, so it sleeps between polls instead of blocking on the window
+	StEngine engine = {0};
+	engine.config.name          = "stupid bench";
+	engine.config.window.width  = 640;
+	engine.config.window.height = 480;
+	engine.config.window.flags  = STUPID_WINDOW_INVISIBLE;
+	engine.config.headless      = getenv("DISPLAY") == NULL;
+
+	if (stEngineInit(&engine) != STUPID_ENGINE_INIT_SUCCESS) {
+		STUPID_LOG_ERROR("failed to initialize the engine");
+		bench_failed = true;
+		return;
+	}
+	engine.pState->is_suspended = true;
+
+	pthread_t timer;
+	pthread_create(&timer, NULL, benchIdleTimer, NULL);
+
+	// the process CPU time includes every thread, so anything the renderer or logger does in the background counts too
+	const f64 cpu_start = benchCpuTime();
+	const f64 start     = stGetTime();
+	const st_engine_start_return_code res = stEngineStart(&engine);
+	const f64 cpu       = (benchCpuTime() - cpu_start) / (stGetTime() - start);
+
+	pthread_join(timer, NULL);
+	stEngineShutdown(&engine);
+
+	STUPID_LOG_INFO("suspended %s engine:  %6.2lf%% CPU (max %.2lf%%)", (engine.config.headless) ? "headless" : "windowed",
+	                cpu * 100.0, BENCH_IDLE_MAX_CPU * 100.0);
+	if (res != STUPID_ENGINE_START_SUCCESS) {
+		STUPID_LOG_ERROR("the main loop failed: %d", res);
+		bench_failed = true;
+	}
+	if (cpu > BENCH_IDLE_MAX_CPU) {
+		if (bench_timing) {
+			STUPID_LOG_ERROR("the suspended engine is using too much CPU");
+			bench_failed = true;
+		}
+		else STUPID_LOG_WARN("the suspended engine is using too much CPU (only fails with --timing)");
+	}
+}
+
+/// Number of matrices in the math benchmarks.
+#define BENCH_MATH_COUNT 1024
+
+/// Number of times the math benchmarks go over every matrix.
+#define BENCH_MATH_ITERATIONS 2000
+
+/// Largest difference allowed between the scalar and SIMD results (relative to the size of the scalar result).
+#define BENCH_MATH_TOLERANCE 0.0001f
+
+/// The scalar stMat4Det() (expansion by 3x3 minors).
+static f32 benchMat4DetScalar(const StMat4 mat)
+{
+	f32 det = 0.0f;
+	for (int c = 0; c < 4; c++) {
+		StMat3 minor;
+		for (int i = 1; i < 4; i++)
+			for (int j = 0, k = 0; j < 4; j++)
+				if (j != c) minor.m[i - 1][k++] = mat.m[i][j];
+		det += ((c & 1) ? -1.0f : 1.0f) * mat.m[0][c] * stMat3Det(minor);
+	}
+	return det;
+}
+
+/// The scalar inverse (adjugate over the determinant, by 3x3 minors like benchMat4DetScalar()).
+static StMat4 benchMat4InverseScalar(const StMat4 mat)
+{
+	const f32 inv = 1.0f / benchMat4DetScalar(mat);
+
+	StMat4 res;
+	for (int r = 0; r < 4; r++) {
+		for (int c = 0; c < 4; c++) {
+			StMat3 minor;
+			for (int i = 0, k = 0; i < 4; i++) {
+				if (i == r) continue;
+				for (int j = 0, l = 0; j < 4; j++)
+					if (j != c) minor.m[k][l++] = mat.m[i][j];
+				k++;
+			}
+			res.m[c][r] = (((r + c) & 1) ? -1.0f : 1.0f) * stMat3Det(minor) * inv;
+		}
+	}
+	return res;
+}
+
+/// The normal matrix the scalar way (the transpose of the scalar inverse, with the translation taken out).
+static StMat4 benchMat4InverseTranspose3x3Scalar(StMat4 mat)
+{
+	mat.m[0][3] = mat.m[1][3] = mat.m[2][3] = 0.0f;
+	mat.m[3][0] = mat.m[3][1] = mat.m[3][2] = 0.0f;
+	mat.m[3][3] = 1.0f;
+	return stMat4Transpose(benchMat4InverseScalar(mat));
+}
+
+/// The scalar stVec4MulMat().
+static StVec4 benchVec4MulMatScalar(const StVec4 vec, const StMat4 mat)
+{
+	StVec4 res = {0};
+	for (int i = 0; i < 4; i++)
+		for (int j = 0; j < 4; j++)
+			res.v[i] += mat.m[i][j] * vec.v[j];
+	return res;
+}
+
+/// The scalar stMat4LookAt().
+static StMat4 benchMat4LookAtScalar(StVec3 pos, const StVec3 target, const StVec3 up)
+{
+	const StVec3 f = stVec3Normalize(stVec3Sub(target, pos));
+	const StVec3 r = stVec3Normalize(stVec3Cross(up, f));
+	const StVec3 u = stVec3Normalize(stVec3Cross(f, r));
+
+	StMat4 mat = stMat4Ident();
+	mat.m[0][0] = r.x; mat.m[0][1] = r.y; mat.m[0][2] = r.z; mat.m[0][3] = -stVec3Dot(r, pos);
+	mat.m[1][0] = u.x; mat.m[1][1] = u.y; mat.m[1][2] = u.z; mat.m[1][3] = -stVec3Dot(u, pos);
+	mat.m[2][0] = f.x; mat.m[2][1] = f.y; mat.m[2][2] = f.z; mat.m[2][3] = -stVec3Dot(f, pos);
+	return mat;
+}
+
+/// The scalar stMat4Perspective().
+static StMat4 benchMat4PerspectiveScalar(const f32 fov, const f32 aspect_ratio, const f32 near, const f32 far)
+{
+	StMat4 mat = stMat4Zero();
+	const f32 scale = stTan(fov * 0.5f);
+	mat.m[0][0] = 1.0f / (aspect_ratio * scale);
+	mat.m[1][1] = -(1.0f / scale);
+	mat.m[2][2] = far / (far - near);
+	mat.m[2][3] = -((far * near) / (far - near));
+	mat.m[3][2] = 1.0f;
+	return mat;
+}
+
+/// Rotation matrix from euler angles the way objects used to be rotated (3 rotation matrices and 2 multiplies).
+static StMat4 benchEulerToMat4(const StVec3 angles)
+{
+	// the shader read these column major, hence the transpose
+	return stMat4Transpose(stMat4Mul(stMat4Mul(stMat4EulerX(angles.x), stMat4EulerY(angles.y)), stMat4EulerZ(angles.z)));
+}
+
+/**
+ * Gets a random number.
+ * @param pState Random state (xorshift).
+ * @return Number from -1.0 to 1.0.
+ */
+static f32 benchRandom(u32 *pState)
+{
+	*pState ^= *pState << 13;
+	*pState ^= *pState >> 17;
+	*pState ^= *pState << 5;
+	return (f32)*pState / (f32)UINT32_MAX * 2.0f - 1.0f;
+}
+
+/**
+ * Gets how far apart two sets of floats are.
+ * @param x Reference floats.
+ * @param y Floats to check.
+ * @param count Number of floats.
+ * @return Largest difference, relative to the largest reference value (or 1.0 if they're all small).
+ */
+static f32 benchMaxError(const f32 *x, const f32 *y, const u32 count)
+{
+	f32 error = 0.0f, scale = 1.0f;
+	for (u32 i = 0; i < count; i++) {
+		error = STUPID_MAX(error, stFabsf(x[i] - y[i]));
+		scale = STUPID_MAX(scale, stFabsf(x[i]));
+	}
+	return error / scale;
+}
+
+/**
+ * Logs a scalar vs SIMD comparison.
+ * @param name Name of the function.
+ * @param scalar Seconds the scalar version took.
+ * @param simd Seconds the SIMD version took.
+ * @param error Largest difference between their results.
+ * @param tolerance Largest difference allowed.
+ */
+static void benchMathReport(const char *name, const f64 scalar, const f64 simd, const f32 error, const f32 tolerance)
+{
+	const f64 calls = (f64)BENCH_MATH_COUNT * (f64)BENCH_MATH_ITERATIONS;
+	if (error > tolerance) {
+		STUPID_LOG_ERROR("%-28s results differ from the scalar version by %g", name, error);
+		bench_failed = true;
+	}
+	STUPID_LOG_INFO("%-28s scalar %6.2lfns/call, simd %6.2lfns/call (%.2lfx), error %g", name,
+	                STUPID_SEC_TO_NS(scalar) / calls, STUPID_SEC_TO_NS(simd) / calls, scalar / simd, error);
+}
+
+/// Times an expression over every input BENCH_MATH_ITERATIONS times, and stores the results in out.
+#define BENCH_MATH_TIME(elapsed, out, expr) do {\
+	const f64 start = stGetTime();\
+	for (u32 it = 0; it < BENCH_MATH_ITERATIONS; it++) {\
+		for (u32 i = 0; i < BENCH_MATH_COUNT; i++) (out)[i] = (expr);\
+		__asm__ volatile("" :: "r"(out) : "memory");\
+	}\
+	(elapsed) = stGetTime() - start;\
+} while (0)
+
+static void benchMat4(void)
+{
+	static StMat4 a[BENCH_MATH_COUNT], x[BENCH_MATH_COUNT], y[BENCH_MATH_COUNT];
+	static StVec4 v[BENCH_MATH_COUNT], vx[BENCH_MATH_COUNT], vy[BENCH_MATH_COUNT];
+	static StMat4 inv[BENCH_MATH_COUNT], affine[BENCH_MATH_COUNT];
+	static StVec3 p[BENCH_MATH_COUNT], angles[BENCH_MATH_COUNT];
+	static f32 dx[BENCH_MATH_COUNT], dy[BENCH_MATH_COUNT];
+
+	u32 seed = 0x12345678;
+	for (u32 i = 0; i < BENCH_MATH_COUNT; i++) {
+		for (u32 j = 0; j < 16; j++) a[i].m[j / 4][j % 4] = benchRandom(&seed);
+		for (u32 j = 0; j < 4; j++) v[i].v[j] = benchRandom(&seed);
+		p[i] = STVEC3(benchRandom(&seed) * 10.0f, benchRandom(&seed) * 10.0f, benchRandom(&seed) * 10.0f);
+		angles[i] = STVEC3(benchRandom(&seed) * 3.0f, benchRandom(&seed) * 3.0f, benchRandom(&seed) * 3.0f);
+	}
+
+	// random matrices can be close enough to singular that any f32 inverse is off by a lot,
+	// so the inverses get a big diagonal, and model matrices with a scale of at least 0.5
+	for (u32 i = 0; i < BENCH_MATH_COUNT; i++) {
+		inv[i] = a[i];
+		for (u32 j = 0; j < 4; j++) inv[i].m[j][j] += 3.0f;
+
+		affine[i] = stQuatToMat4(stQuatFromEuler(angles[i]));
+		for (u32 j = 0; j < 3; j++) {
+			for (u32 k = 0; k < 3; k++)
+				affine[i].m[j][k] *= 1.25f + v[i].v[k] * 0.75f;
+			affine[i].m[j][3] = p[i].v[j];
+		}
+	}
+
+	f64 scalar = 0.0, simd = 0.0;
+	const StVec3 up = STVEC3(0.0f, 1.0f, 0.0f);
+
+	// stMat4Mul() and stMat4Transpose() are the scalar loops, so theres nothing to compare them to
+	BENCH_MATH_TIME(scalar, dx, benchMat4DetScalar(a[i]));
+	BENCH_MATH_TIME(simd, dy, stMat4Det(a[i]));
+	benchMathReport("stMat4Det()", scalar, simd, benchMaxError(dx, dy, BENCH_MATH_COUNT), BENCH_MATH_TOLERANCE);
+
+	BENCH_MATH_TIME(scalar, x, benchMat4InverseScalar(inv[i]));
+	BENCH_MATH_TIME(simd, y, stMat4Inverse(inv[i]));
+	benchMathReport("stMat4Inverse()", scalar, simd, benchMaxError((f32 *)x, (f32 *)y, BENCH_MATH_COUNT * 16), BENCH_MATH_TOLERANCE);
+
+	// the affine inverse against the general one, since thats what it replaces for model and view matrices
+	BENCH_MATH_TIME(scalar, x, stMat4Inverse(affine[i]));
+	BENCH_MATH_TIME(simd, y, stMat4InverseAffine(affine[i]));
+	benchMathReport("stMat4InverseAffine()", scalar, simd, benchMaxError((f32 *)x, (f32 *)y, BENCH_MATH_COUNT * 16), BENCH_MATH_TOLERANCE);
+
+	BENCH_MATH_TIME(scalar, x, benchMat4InverseTranspose3x3Scalar(affine[i]));
+	BENCH_MATH_TIME(simd, y, stMat4InverseTranspose3x3(affine[i]));
+	benchMathReport("stMat4InverseTranspose3x3()", scalar, simd, benchMaxError((f32 *)x, (f32 *)y, BENCH_MATH_COUNT * 16), BENCH_MATH_TOLERANCE);
+
+	BENCH_MATH_TIME(scalar, vx, benchVec4MulMatScalar(v[i], a[i]));
+	BENCH_MATH_TIME(simd, vy, stVec4MulMat(v[i], a[i]));
+	benchMathReport("stVec4MulMat()", scalar, simd, benchMaxError((f32 *)vx, (f32 *)vy, BENCH_MATH_COUNT * 4), BENCH_MATH_TOLERANCE);
+
+	BENCH_MATH_TIME(scalar, x, benchMat4LookAtScalar(p[i], p[(i + 1) % BENCH_MATH_COUNT], up));
+	BENCH_MATH_TIME(simd, y, stMat4LookAt(p[i], p[(i + 1) % BENCH_MATH_COUNT], up));
+	benchMathReport("stMat4LookAt()", scalar, simd, benchMaxError((f32 *)x, (f32 *)y, BENCH_MATH_COUNT * 16), BENCH_MATH_TOLERANCE);
+
+	BENCH_MATH_TIME(scalar, x, benchMat4PerspectiveScalar(1.0f + v[i].x * 0.5f, 16.0f / 9.0f, 0.1f, 1000.0f));
+	BENCH_MATH_TIME(simd, y, stMat4Perspective(1.0f + v[i].x * 0.5f, 16.0f / 9.0f, 0.1f, 1000.0f));
+	benchMathReport("stMat4Perspective()", scalar, simd, benchMaxError((f32 *)x, (f32 *)y, BENCH_MATH_COUNT * 16), BENCH_MATH_TOLERANCE);
+
+	// what rotating every object used to cost vs what it costs now (the compute shader does the same math)
+	BENCH_MATH_TIME(scalar, x, benchEulerToMat4(angles[i]));
+	BENCH_MATH_TIME(simd, y, stQuatToMat4(stQuatFromEuler(angles[i])));
+	benchMathReport("stQuatToMat4()", scalar, simd, benchMaxError((f32 *)x, (f32 *)y, BENCH_MATH_COUNT * 16), BENCH_MATH_TOLERANCE);
+}
+
+/// Number of elements in the batch benchmarks (not a multiple of 8 so the tails get used).
+#define BENCH_BATCH_COUNT 10003
+
+/// Number of times the batch benchmarks go over every element.
+#define BENCH_BATCH_ITERATIONS 500
+
+/**
+ * Logs a per element vs batch comparison.
+ * @param name Name of the batch function.
+ * @param single Seconds the per element version took.
+ * @param batch Seconds the batch version took.
+ * @param error Largest difference between their results.
+ */
+static void benchBatchReport(const char *name, const f64 single, const f64 batch, const f32 error)
+{
+	const f64 elements = (f64)BENCH_BATCH_COUNT * (f64)BENCH_BATCH_ITERATIONS;
+	if (error > BENCH_MATH_TOLERANCE) {
+		STUPID_LOG_ERROR("%-32s results differ from the per element version by %g", name, error);
+		bench_failed = true;
+	}
+	STUPID_LOG_INFO("%-32s per element %7.1lfM/s, batch %7.1lfM/s (%.2lfx), error %g", name,
+	                elements / single / 1000000.0, elements / batch / 1000000.0, single / batch, error);
+}
+
+/// Number of samples the batch timings are split into (the median is used so one slow sample doesnt count).
+#define BENCH_TIMING_SAMPLES 5
+
+STUPID_STATIC_ASSERT(BENCH_BATCH_ITERATIONS % BENCH_TIMING_SAMPLES == 0, "BENCH_BATCH_ITERATIONS is not a multiple of BENCH_TIMING_SAMPLES");
+
+/**
+ * Gets the median of some timings.
+ * @param p The timings (sorted in place).
+ * @param count Number of timings.
+ * @return The median.
+ */
+static f64 benchMedian(f64 *p, const u32 count)
+{
+	for (u32 i = 1; i < count; i++) {
+		const f64 x = p[i];
+		u32 j = i;
+		for (; j > 0 && p[j - 1] > x; j--) p[j] = p[j - 1];
+		p[j] = x;
+	}
+	return (count & 1) ? p[count / 2] : (p[count / 2 - 1] + p[count / 2]) * 0.5;
+}
+
+/// @brief Times a statement BENCH_BATCH_ITERATIONS times (variadic so the statement can have commas in it).
+/// The iterations are split into BENCH_TIMING_SAMPLES samples, and elapsed is the median sample scaled back up.
+#define BENCH_BATCH_TIME(elapsed, ...) do {\
+	f64 samples[BENCH_TIMING_SAMPLES];\
+	for (u32 sample = 0; sample < BENCH_TIMING_SAMPLES; sample++) {\
+		const f64 start = stGetTime();\
+		for (u32 it = 0; it < BENCH_BATCH_ITERATIONS / BENCH_TIMING_SAMPLES; it++) {\
+			__VA_ARGS__;\
+			__asm__ volatile("" ::: "memory");\
+		}\
+		samples[sample] = stGetTime() - start;\
+	}\
+	(elapsed) = benchMedian(samples, BENCH_TIMING_SAMPLES) * BENCH_TIMING_SAMPLES;\
+} while (0)
+
+/**
+ * Creates a stream of vectors.
+ * @param count Number of vectors.
+ * @return The stream (free each array with stMemDealloc()).
+ */
+static StVec3Stream benchVec3StreamCreate(const usize count)
+{
+	StVec3Stream stream = {0};
+	stream.x = stMemAlloc(f32, count);
+	stream.y = stMemAlloc(f32, count);
+	stream.z = stMemAlloc(f32, count);
+	return stream;
+}
+
+/**
+ * Gets how far apart an array of vectors and a stream are.
+ * @param pVecs Reference vectors.
+ * @param stream Stream to check.
+ * @param count Number of vectors.
+ * @return Largest difference.
+ */
+static f32 benchVec3StreamError(const StVec3 *pVecs, const StVec3Stream stream, const usize count)
+{
+	f32 error = 0.0f;
+	for (usize i = 0; i < count; i++) {
+		const StVec3 v = stVec3StreamGet(stream, i);
+		error = STUPID_MAX(error, benchMaxError(pVecs[i].v, v.v, 3));
+	}
+	return error;
+}
+
+static void benchBatch(void)
+{
+	const usize count = BENCH_BATCH_COUNT;
+	u32 seed = 0x87654321;
+
+	StVec3 *pVecs = stMemAlloc(StVec3, count);
+	StVec3 *pOut  = stMemAlloc(StVec3, count);
+	StVec3Stream in  = benchVec3StreamCreate(count);
+	StVec3Stream out = benchVec3StreamCreate(count);
+	for (usize i = 0; i < count; i++) {
+		pVecs[i] = STVEC3(benchRandom(&seed) * 100.0f, benchRandom(&seed) * 100.0f, benchRandom(&seed) * 100.0f);
+		stVec3StreamSet(in, i, pVecs[i]);
+	}
+
+	f64 single = 0.0, batch = 0.0;
+	const StMat4 model = stMat4Rotate(0.7f, STVEC3(0.3f, 1.0f, 0.2f), STVEC3(5.0f, -2.0f, 1.0f));
+
+	BENCH_BATCH_TIME(single, for (usize i = 0; i < count; i++) {
+		const StVec4 v = stVec4MulMat(STVEC4(pVecs[i].x, pVecs[i].y, pVecs[i].z, 1.0f), model);
+		pOut[i] = STVEC3(v.x, v.y, v.z);
+	});
+	BENCH_BATCH_TIME(batch, stVec3BatchTransform(model, in, out, count));
+	benchBatchReport("stVec3BatchTransform()", single, batch, benchVec3StreamError(pOut, out, count));
+
+	BENCH_BATCH_TIME(single, for (usize i = 0; i < count; i++) pOut[i] = stVec3Normalize(pVecs[i]));
+	BENCH_BATCH_TIME(batch, stVec3BatchNormalize(in, out, count));
+	benchBatchReport("stVec3BatchNormalize()", single, batch, benchVec3StreamError(pOut, out, count));
+
+	stMemDealloc(in.x);
+	stMemDealloc(in.y);
+	stMemDealloc(in.z);
+	stMemDealloc(out.x);
+	stMemDealloc(out.y);
+	stMemDealloc(out.z);
+	stMemDealloc(pOut);
+	stMemDealloc(pVecs);
+
+	// quaternions
+	StQuat *pQx = stMemAlloc(StQuat, count);
+	StQuat *pQy = stMemAlloc(StQuat, count);
+	StQuat *pQr = stMemAlloc(StQuat, count);
+	StQuatStream qx = {stMemAlloc(f32, count), stMemAlloc(f32, count), stMemAlloc(f32, count), stMemAlloc(f32, count)};
+	StQuatStream qy = {stMemAlloc(f32, count), stMemAlloc(f32, count), stMemAlloc(f32, count), stMemAlloc(f32, count)};
+	StQuatStream qr = {stMemAlloc(f32, count), stMemAlloc(f32, count), stMemAlloc(f32, count), stMemAlloc(f32, count)};
+	for (usize i = 0; i < count; i++) {
+		pQx[i] = stQuatNormalize(STQUAT(benchRandom(&seed), benchRandom(&seed), benchRandom(&seed), benchRandom(&seed)));
+		pQy[i] = stQuatNormalize(STQUAT(benchRandom(&seed), benchRandom(&seed), benchRandom(&seed), benchRandom(&seed)));
+		stQuatStreamSet(qx, i, pQx[i]);
+		stQuatStreamSet(qy, i, pQy[i]);
+	}
+
+	BENCH_BATCH_TIME(single, for (usize i = 0; i < count; i++) pQr[i] = stQuatMul(pQx[i], pQy[i]));
+	BENCH_BATCH_TIME(batch, stQuatBatchMul(qx, qy, qr, count));
+
+	f32 error = 0.0f;
+	for (usize i = 0; i < count; i++)
+		error = STUPID_MAX(error, benchMaxError(pQr[i].q, stQuatStreamGet(qr, i).q, 4));
+	benchBatchReport("stQuatBatchMul()", single, batch, error);
+
+	BENCH_BATCH_TIME(single, for (usize i = 0; i < count; i++) pQr[i] = stQuatNlerp(pQx[i], pQy[i], 0.3f));
+	BENCH_BATCH_TIME(batch, stQuatBatchNlerp(qx, qy, 0.3f, qr, count));
+
+	error = 0.0f;
+	for (usize i = 0; i < count; i++)
+		error = STUPID_MAX(error, benchMaxError(pQr[i].q, stQuatStreamGet(qr, i).q, 4));
+	benchBatchReport("stQuatBatchNlerp()", single, batch, error);
+
+	StQuatStream streams[] = {qx, qy, qr};
+	for (u32 i = 0; i < sizeof(streams) / sizeof(streams[0]); i++) {
+		stMemDealloc(streams[i].w);
+		stMemDealloc(streams[i].x);
+		stMemDealloc(streams[i].y);
+		stMemDealloc(streams[i].z);
+	}
+	stMemDealloc(pQr);
+	stMemDealloc(pQy);
+	stMemDealloc(pQx);
+
+	// matrices
+	StMat4 *pX   = stMemAlloc(StMat4, count);
+	StMat4 *pY   = stMemAlloc(StMat4, count);
+	StMat4 *pRes = stMemAlloc(StMat4, count);
+	StMat4Stream x = {0}, y = {0}, res = {0};
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) {
+			x.m[i][j]   = stMemAlloc(f32, count);
+			y.m[i][j]   = stMemAlloc(f32, count);
+			res.m[i][j] = stMemAlloc(f32, count);
+		}
+	}
+	for (usize n = 0; n < count; n++) {
+		for (u32 j = 0; j < 16; j++) {
+			pX[n].m[j / 4][j % 4] = benchRandom(&seed);
+			pY[n].m[j / 4][j % 4] = benchRandom(&seed);
+		}
+		stMat4StreamSet(x, n, pX[n]);
+		stMat4StreamSet(y, n, pY[n]);
+	}
+
+	BENCH_BATCH_TIME(single, for (usize n = 0; n < count; n++) pRes[n] = stMat4Mul(pX[n], pY[n]));
+	BENCH_BATCH_TIME(batch, stMat4BatchMul(x, y, res, count));
+
+	error = 0.0f;
+	for (usize n = 0; n < count; n++) {
+		const StMat4 mat = stMat4StreamGet(res, n);
+		error = STUPID_MAX(error, benchMaxError((f32 *)pRes[n].m, (f32 *)mat.m, 16));
+	}
+	benchBatchReport("stMat4BatchMul()", single, batch, error);
+
+	// well conditioned matrices for the inverses (see benchMat4())
+	for (usize n = 0; n < count; n++) {
+		for (u32 j = 0; j < 4; j++) pX[n].m[j][j] += 3.0f;
+		stMat4StreamSet(x, n, pX[n]);
+
+		pY[n] = stQuatToMat4(stQuatNormalize(STQUAT(benchRandom(&seed), benchRandom(&seed), benchRandom(&seed), benchRandom(&seed))));
+		for (u32 j = 0; j < 3; j++) {
+			for (u32 k = 0; k < 3; k++)
+				pY[n].m[j][k] *= 1.25f + benchRandom(&seed) * 0.75f;
+			pY[n].m[j][3] = benchRandom(&seed) * 10.0f;
+		}
+		stMat4StreamSet(y, n, pY[n]);
+	}
+
+	BENCH_BATCH_TIME(single, for (usize n = 0; n < count; n++) pRes[n] = stMat4Inverse(pX[n]));
+	BENCH_BATCH_TIME(batch, stMat4BatchInverse(x, res, count));
+
+	error = 0.0f;
+	for (usize n = 0; n < count; n++) {
+		const StMat4 mat = stMat4StreamGet(res, n);
+		error = STUPID_MAX(error, benchMaxError((f32 *)pRes[n].m, (f32 *)mat.m, 16));
+	}
+	benchBatchReport("stMat4BatchInverse()", single, batch, error);
+
+	BENCH_BATCH_TIME(single, for (usize n = 0; n < count; n++) pRes[n] = stMat4InverseAffine(pY[n]));
+	BENCH_BATCH_TIME(batch, stMat4BatchInverseAffine(y, res, count));
+
+	error = 0.0f;
+	for (usize n = 0; n < count; n++) {
+		const StMat4 mat = stMat4StreamGet(res, n);
+		error = STUPID_MAX(error, benchMaxError((f32 *)pRes[n].m, (f32 *)mat.m, 16));
+	}
+	benchBatchReport("stMat4BatchInverseAffine()", single, batch, error);
+
+	BENCH_BATCH_TIME(single, for (usize n = 0; n < count; n++) pRes[n] = stMat4InverseTranspose3x3(pY[n]));
+	BENCH_BATCH_TIME(batch, stMat4BatchInverseTranspose3x3(y, res, count));
+
+	error = 0.0f;
+	for (usize n = 0; n < count; n++) {
+		const StMat4 mat = stMat4StreamGet(res, n);
+		error = STUPID_MAX(error, benchMaxError((f32 *)pRes[n].m, (f32 *)mat.m, 16));
+	}
+	benchBatchReport("stMat4BatchInverseTranspose3x3()", single, batch, error);
+
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) {
+			stMemDealloc(x.m[i][j]);
+			stMemDealloc(y.m[i][j]);
+			stMemDealloc(res.m[i][j]);
+		}
+	}
+	stMemDealloc(pRes);
+	stMemDealloc(pY);
+	stMemDealloc(pX);
+}
+
+/**
+ * Logs a lookup table vs polynomial vs 8 wide comparison.
+ * @param name Name of the function.
+ * @param lookup Seconds the lookup table version took (0 if there isnt one).
+ * @param poly Seconds the polynomial version took.
+ * @param wide Seconds the 8 wide version took.
+ * @param error Largest difference between the lookup table (or scalar polynomial if there isnt one) and 8 wide versions.
+ */
+static void benchTrigReport(const char *name, const f64 lookup, const f64 poly, const f64 wide, const f32 error)
+{
+	const f64 elements = (f64)BENCH_BATCH_COUNT * (f64)BENCH_BATCH_ITERATIONS / 1000000.0;
+	if (lookup <= 0.0)
+		STUPID_LOG_INFO("%-10s no lookup,        polynomial %7.1lfM/s, 8 wide %7.1lfM/s, difference %g", name, elements / poly, elements / wide, error);
+	else
+		STUPID_LOG_INFO("%-10s lookup %7.1lfM/s, polynomial %7.1lfM/s, 8 wide %7.1lfM/s, difference from lookup %g",
+		                name, elements / lookup, elements / poly, elements / wide, error);
+}
+
+static void benchTrig(void)
+{
+	const usize count = BENCH_BATCH_COUNT;
+	f32 *pX = stMemAlloc(f32, count);
+	f32 *pY = stMemAlloc(f32, count);
+	f32 *pA = stMemAlloc(f32, count);
+	f32 *pB = stMemAlloc(f32, count);
+
+	// angles a camera or animation would actually use
+	u32 seed = 0x24681357;
+	for (usize i = 0; i < count; i++) {
+		pX[i] = benchRandom(&seed) * (f32)STUPID_MATH_TAU;
+		pY[i] = benchRandom(&seed) * (f32)STUPID_MATH_TAU;
+	}
+
+	f64 lookup = 0.0, poly = 0.0, wide = 0.0;
+
+	BENCH_BATCH_TIME(lookup, for (usize i = 0; i < count; i++) pA[i] = stSinLookup(pX[i]) + stCosLookup(pX[i]));
+	BENCH_BATCH_TIME(poly, for (usize i = 0; i < count; i++) {
+		f32 s, c;
+		stSinCos(pX[i], &s, &c);
+		pB[i] = s + c;
+	});
+	BENCH_BATCH_TIME(wide, for (usize i = 0; i < count; i += ST_BATCH_WIDTH) {
+		__m256 s, c;
+		stSinCosV(stBatchLoad(pX + i, count - i), &s, &c);
+		stBatchStore(pB + i, _mm256_add_ps(s, c), count - i);
+	});
+	benchTrigReport("stSinCos()", lookup, poly, wide, benchMaxError(pA, pB, count));
+
+	// the lookup tables only go from -1 to 1
+	for (usize i = 0; i < count; i++) pX[i] /= (f32)STUPID_MATH_TAU;
+
+	BENCH_BATCH_TIME(lookup, for (usize i = 0; i < count; i++) pA[i] = stAcosLookup(pX[i]));
+	BENCH_BATCH_TIME(poly, for (usize i = 0; i < count; i++) pB[i] = stAcos(pX[i]));
+	BENCH_BATCH_TIME(wide, for (usize i = 0; i < count; i += ST_BATCH_WIDTH)
+		stBatchStore(pB + i, stAcosV(stBatchLoad(pX + i, count - i)), count - i));
+	benchTrigReport("stAcos()", lookup, poly, wide, benchMaxError(pA, pB, count));
+
+	// there was never a lookup table for atan2
+	BENCH_BATCH_TIME(poly, for (usize i = 0; i < count; i++) pA[i] = stAtan2(pY[i], pX[i]));
+	BENCH_BATCH_TIME(wide, for (usize i = 0; i < count; i += ST_BATCH_WIDTH)
+		stBatchStore(pB + i, stAtan2V(stBatchLoad(pY + i, count - i), stBatchLoad(pX + i, count - i)), count - i));
+	benchTrigReport("stAtan2()", 0.0, poly, wide, benchMaxError(pA, pB, count));
+
+	stMemDealloc(pB);
+	stMemDealloc(pA);
+	stMemDealloc(pY);
+	stMemDealloc(pX);
+}
+
+/// Number of objects in the culling benchmark.
+#define BENCH_CULL_COUNT 100000
+
+/**
+ * Logs a per object vs batch culling comparison, and fails the run if they disagree.
+ * @param name Name of the batch function.
+ * @param single Seconds the per object version took.
+ * @param batch Seconds the batch version took.
+ * @param visible Number of objects the batch version found inside.
+ * @param pSingle Bitmask from the per object version.
+ * @param pBatch Bitmask from the batch version.
+ */
+static void benchCullReport(const char *name, const f64 single, const f64 batch, const usize visible, const u8 *pSingle, const u8 *pBatch)
+{
+	usize mismatches = 0;
+	for (usize i = 0; i < (BENCH_CULL_COUNT + 7) / 8; i++)
+		mismatches += __builtin_popcount(pSingle[i] ^ pBatch[i]);
+
+	const f64 objects = (f64)BENCH_CULL_COUNT * (f64)BENCH_BATCH_ITERATIONS;
+	if (mismatches != 0) {
+		STUPID_LOG_ERROR("%-26s disagrees with the per object version on %lu objects", name, mismatches);
+		bench_failed = true;
+	}
+	STUPID_LOG_INFO("%-26s per object %7.1lfM/s, batch %7.1lfM/s (%.2lfx), %lu/%u visible", name,
+	                objects / single / 1000000.0, objects / batch / 1000000.0, single / batch, visible, BENCH_CULL_COUNT);
+}
+
+static void benchCull(void)
+{
+	const usize count = BENCH_CULL_COUNT;
+	u32 seed = 0x5eed1234;
+
+	StSphere *pSpheres = stMemAlloc(StSphere, count);
+	StAabb *pBoxes     = stMemAlloc(StAabb, count);
+	u8 *pSingle        = stMemAlloc(u8, (count + 7) / 8);
+	u8 *pBatch         = stMemAlloc(u8, (count + 7) / 8);
+	StSphereStream spheres = {stMemAlloc(f32, count), stMemAlloc(f32, count), stMemAlloc(f32, count), stMemAlloc(f32, count)};
+	StAabbStream boxes     = {benchVec3StreamCreate(count), benchVec3StreamCreate(count)};
+
+	// objects scattered all around the camera, so most of them are culled like in an actual scene
+	for (usize i = 0; i < count; i++) {
+		const StVec3 center = STVEC3(benchRandom(&seed) * 500.0f, benchRandom(&seed) * 500.0f, benchRandom(&seed) * 500.0f);
+		const StVec3 extents = STVEC3(benchRandom(&seed) * 2.0f + 3.0f, benchRandom(&seed) * 2.0f + 3.0f, benchRandom(&seed) * 2.0f + 3.0f);
+		pBoxes[i]   = (StAabb){stVec3Sub(center, extents), stVec3Add(center, extents)};
+		pSpheres[i] = stSphereFromAabb(pBoxes[i]);
+
+		spheres.x[i]      = pSpheres[i].center.x;
+		spheres.y[i]      = pSpheres[i].center.y;
+		spheres.z[i]      = pSpheres[i].center.z;
+		spheres.radius[i] = pSpheres[i].radius;
+		stVec3StreamSet(boxes.min, i, pBoxes[i].min);
+		stVec3StreamSet(boxes.max, i, pBoxes[i].max);
+	}
+
+	const StMat4 view = stMat4LookAt(STVEC3(10.0f, 5.0f, 20.0f), STVEC3(0.0f, 0.0f, -100.0f), STVEC3(0.0f, 1.0f, 0.0f));
+	const StMat4 proj = stMat4Perspective(1.2f, 16.0f / 9.0f, 0.1f, 400.0f);
+	const StFrustum frustum = stFrustumFromMat4(stMat4Mul(proj, view));
+
+	f64 single = 0.0, batch = 0.0;
+	usize visible = 0;
+
+	BENCH_BATCH_TIME(single, for (usize i = 0; i < count; i += 8) {
+		u8 mask = 0;
+		for (usize j = i; j < STUPID_MIN(i + 8, count); j++)
+			mask |= (u8)(stFrustumTestSphere(frustum, pSpheres[j]) << (j - i));
+		pSingle[i / 8] = mask;
+	});
+	BENCH_BATCH_TIME(batch, visible = stFrustumBatchTestSphere(frustum, spheres, pBatch, count));
+	benchCullReport("stFrustumBatchTestSphere()", single, batch, visible, pSingle, pBatch);
+
+	BENCH_BATCH_TIME(single, for (usize i = 0; i < count; i += 8) {
+		u8 mask = 0;
+		for (usize j = i; j < STUPID_MIN(i + 8, count); j++)
+			mask |= (u8)(stFrustumTestAabb(frustum, pBoxes[j]) << (j - i));
+		pSingle[i / 8] = mask;
+	});
+	BENCH_BATCH_TIME(batch, visible = stFrustumBatchTestAabb(frustum, boxes, pBatch, count));
+	benchCullReport("stFrustumBatchTestAabb()", single, batch, visible, pSingle, pBatch);
+
+	StVec3Stream streams[] = {boxes.min, boxes.max};
+	for (u32 i = 0; i < sizeof(streams) / sizeof(streams[0]); i++) {
+		stMemDealloc(streams[i].x);
+		stMemDealloc(streams[i].y);
+		stMemDealloc(streams[i].z);
+	}
+	stMemDealloc(spheres.x);
+	stMemDealloc(spheres.y);
+	stMemDealloc(spheres.z);
+	stMemDealloc(spheres.radius);
+	stMemDealloc(pBatch);
+	stMemDealloc(pSingle);
+	stMemDealloc(pBoxes);
+	stMemDealloc(pSpheres);
+}
+
+/// Number of inputs each function is checked at (spread evenly over its domain).
+#define BENCH_ACCURACY_COUNT (1 << 20)
+
+/// Largest error allowed for the matrix functions, in ULP of the size of the terms they add up.
+#define BENCH_ACCURACY_MAT_ULP 4.0
+
+/// Most the 8 wide and batch versions can be slower than the scalar ones before a --timing run fails (0.1 is 10% slower).
+#define BENCH_ACCURACY_MAX_SLOWDOWN 0.1
+
+/// Error of a function in units in the last place.
+typedef struct StBenchUlp {
+	/// Largest error.
+	f64 max;
+
+	/// Sum of every error (for the mean).
+	f64 total;
+
+	/// Number of errors recorded.
+	u64 count;
+
+	/// Input with the largest error (or index of it for functions with more than one input).
+	f64 worst;
+} StBenchUlp;
+
+/// A function checked against libm.
+typedef struct StBenchAccuracy {
+	const char *name;
+
+	/// The function.
+	f32 (*scalar)(f32);
+
+	/// 8 wide version (NULL if there isnt one).
+	__m256 (*batch)(__m256);
+
+	/// What it should return (in double precision).
+	f64 (*reference)(f64);
+
+	/// Domain to check.
+	f32 lo, hi;
+
+	/// If inputs are spread evenly over the exponent instead of the value (for functions like sqrt that go over many magnitudes).
+	bool logarithmic;
+
+	/// Largest error allowed in ULP.
+	f64 max_ulp;
+} StBenchAccuracy;
+
+/**
+ * Gets the error of a result in ULP.
+ * @param approx The result.
+ * @param ref What it should be.
+ * @param scale Magnitude the ULP is measured at (|ref| for plain functions, the size of the terms for sums like matrix multiplies).
+ * @return |approx - ref| in units of the f32 spacing at scale (infinity if approx is NaN).
+ */
+static f64 benchUlp(const f32 approx, const f64 ref, const f64 scale)
+{
+	if (isnan(approx) || isinf(approx)) return INFINITY;
+
+	// f32s from 2^(e - 1) to 2^e are 2^(e - 24) apart (and never closer than the smallest subnormal)
+	int exponent = 0;
+	frexp(scale, &exponent);
+	const f64 ulp = (scale == 0.0) ? ldexp(1.0, -149) : ldexp(1.0, STUPID_MAX(exponent - 24, -149));
+	return fabs((f64)approx - ref) / ulp;
+}
+
+/**
+ * Records an error.
+ * @param pUlp Where to record it.
+ * @param input Input the result was for (or index of it).
+ * @param ulp Error in ULP (see benchUlp()).
+ */
+static void benchUlpRecord(StBenchUlp *pUlp, const f64 input, const f64 ulp)
+{
+	if (ulp > pUlp->max || pUlp->count == 0) {
+		pUlp->max   = ulp;
+		pUlp->worst = input;
+	}
+	pUlp->total += ulp;
+	pUlp->count++;
+}
+
+/**
+ * Logs the error and speed of a function, and fails the run if the error is too big.
+ * @param name Name of the function.
+ * @param pUlp Error of the function.
+ * @param max_ulp Largest error allowed.
+ * @param elapsed Seconds BENCH_BATCH_ITERATIONS calls per element of BENCH_BATCH_COUNT took.
+ */
+static void benchAccuracyReport(const char *name, const StBenchUlp *pUlp, const f64 max_ulp, const f64 elapsed)
+{
+	const f64 calls = (f64)BENCH_BATCH_COUNT * (f64)BENCH_BATCH_ITERATIONS;
+	const bool failed = !(pUlp->max <= max_ulp);
+
+	STUPID_LOG_INFO("%-22s max %9.2lf ULP (at %-12g) mean %7.3lf ULP, %6.2lfns/call %8.1lfM/s%s", name, pUlp->max, pUlp->worst,
+	                pUlp->total / (f64)pUlp->count, STUPID_SEC_TO_NS(elapsed) / calls, calls / elapsed / 1000000.0,
+	                failed ? ", TOO INACCURATE" : "");
+	if (failed) {
+		STUPID_LOG_ERROR("%s is off by %g ULP at %g, which is more than the %g allowed", name, pUlp->max, pUlp->worst, max_ulp);
+		bench_failed = true;
+	}
+}
+
+/**
+ * Fails the run if a vectorized version is more than BENCH_ACCURACY_MAX_SLOWDOWN slower than the scalar one (with --timing).
+ * @param name Name of the vectorized version.
+ * @param scalar Seconds the scalar version took.
+ * @param vectorized Seconds the vectorized version took for the same number of elements.
+ */
+static void benchAccuracySpeed(const char *name, const f64 scalar, const f64 vectorized)
+{
+	const f64 max_slowdown = BENCH_ACCURACY_MAX_SLOWDOWN;
+	if (!bench_timing || vectorized <= scalar * (1.0 + max_slowdown)) return;
+
+	STUPID_LOG_ERROR("%s is %.2lfx the speed of the scalar version, which is slower than the %.0lf%% allowed", name,
+	                 scalar / vectorized, max_slowdown * 100.0);
+	bench_failed = true;
+}
+
+/**
+ * Spreads numbers over a range.
+ * @param p Where to put the numbers.
+ * @param count Number of numbers.
+ * @param lo Smallest number (has to be over 0 if logarithmic is set).
+ * @param hi Largest number.
+ * @param logarithmic If the numbers should be spread over the exponent instead of the value.
+ */
+static void benchSweep(f32 *p, const usize count, const f32 lo, const f32 hi, const bool logarithmic)
+{
+	for (usize i = 0; i < count; i++) {
+		const f64 t = (f64)i / (f64)(count - 1);
+		p[i] = logarithmic ? (f32)exp2(log2(lo) + (log2(hi) - log2(lo)) * t) : (f32)(lo + (hi - lo) * t);
+	}
+}
+
+/**
+ * Checks a function against libm, and times it.
+ * @param test The function (inlined so the calls through its pointers turn into direct calls, and get timed properly).
+ * @param pSweep Scratch space for BENCH_ACCURACY_COUNT inputs.
+ * @param pTimed Scratch space for BENCH_BATCH_COUNT inputs.
+ * @param pOut Scratch space for BENCH_ACCURACY_COUNT outputs.
+ */
+static STUPID_INLINE void benchAccuracy(const StBenchAccuracy test, f32 *pSweep, f32 *pTimed, f32 *pOut)
+{
+	const usize count = BENCH_ACCURACY_COUNT;
+	benchSweep(pSweep, count, test.lo, test.hi, test.logarithmic);
+
+	// the timed inputs are shuffled so branches dont predict any better than they would in real code
+	u32 seed = 0x13572468;
+	for (usize i = 0; i < BENCH_BATCH_COUNT; i++)
+		pTimed[i] = pSweep[(usize)((benchRandom(&seed) * 0.5f + 0.5f) * (f32)(count - 1))];
+
+	StBenchUlp ulp = {0};
+	for (usize i = 0; i < count; i++) pOut[i] = test.scalar(pSweep[i]);
+	for (usize i = 0; i < count; i++) {
+		const f64 ref = test.reference(pSweep[i]);
+		benchUlpRecord(&ulp, pSweep[i], benchUlp(pOut[i], ref, fabs(ref)));
+	}
+
+	f64 scalar = 0.0, elapsed = 0.0;
+	BENCH_BATCH_TIME(scalar, for (usize i = 0; i < BENCH_BATCH_COUNT; i++) pOut[i] = test.scalar(pTimed[i]));
+	benchAccuracyReport(test.name, &ulp, test.max_ulp, scalar);
+
+	if (test.batch == NULL) return;
+
+	ulp = (StBenchUlp){0};
+	for (usize i = 0; i < count; i += ST_BATCH_WIDTH)
+		stBatchStore(pOut + i, test.batch(stBatchLoad(pSweep + i, count - i)), count - i);
+	for (usize i = 0; i < count; i++) {
+		const f64 ref = test.reference(pSweep[i]);
+		benchUlpRecord(&ulp, pSweep[i], benchUlp(pOut[i], ref, fabs(ref)));
+	}
+
+	BENCH_BATCH_TIME(elapsed, for (usize i = 0; i < BENCH_BATCH_COUNT; i += ST_BATCH_WIDTH)
+		stBatchStore(pOut + i, test.batch(stBatchLoad(pTimed + i, BENCH_BATCH_COUNT - i)), BENCH_BATCH_COUNT - i));
+
+	char name[64];
+	snprintf(name, sizeof(name), "%s 8 wide", test.name);
+	benchAccuracyReport(name, &ulp, test.max_ulp, elapsed);
+	benchAccuracySpeed(name, scalar, elapsed);
+}
+
+// the math functions are all inline (and stSqrt() is a macro), so these give them addresses
+static f32 benchSin(const f32 x) { return stSin(x); }
+static f32 benchCos(const f32 x) { return stCos(x); }
+static f32 benchTan(const f32 x) { return stTan(x); }
+static f32 benchAtan(const f32 x) { return stAtan(x); }
+static f32 benchAsin(const f32 x) { return stAsin(x); }
+static f32 benchAcos(const f32 x) { return stAcos(x); }
+static f32 benchSqrt(const f32 x) { return stSqrtf(x); }
+static f32 benchISqrt(const f32 x) { return stISqrt(x); }
+static f32 benchLog2(const f32 x) { return stLog2(x); }
+static f64 benchRefISqrt(const f64 x) { return 1.0 / sqrt(x); }
+static __m256 benchSinV(const __m256 x) { __m256 s, c; stSinCosV(x, &s, &c); return s; }
+static __m256 benchCosV(const __m256 x) { __m256 s, c; stSinCosV(x, &s, &c); return c; }
+
+/**
+ * Checks a matrix function against the same math in double precision, and its batch version against the per matrix speed.
+ * @param name Name of the function.
+ * @param pUlp Error of the function.
+ * @param max_ulp Largest error allowed.
+ * @param single Seconds the per matrix version took for BENCH_BATCH_ITERATIONS passes over BENCH_BATCH_COUNT matrices.
+ * @param batch Seconds the batch version took (0 if there isnt one).
+ * @param pBatchUlp Error of the batch version.
+ */
+static void benchAccuracyMatReport(const char *name, const StBenchUlp *pUlp, const f64 max_ulp, const f64 single,
+                                   const f64 batch, const StBenchUlp *pBatchUlp)
+{
+	benchAccuracyReport(name, pUlp, max_ulp, single);
+	if (batch <= 0.0) return;
+
+	char batch_name[64];
+	snprintf(batch_name, sizeof(batch_name), "%s batch", name);
+	benchAccuracyReport(batch_name, pBatchUlp, max_ulp, batch);
+	benchAccuracySpeed(batch_name, single, batch);
+}
+
+static void benchAccuracyMat(void)
+{
+	const usize count = BENCH_BATCH_COUNT;
+	u32 seed = 0x9abcdef0;
+
+	StMat4 *pX   = stMemAlloc(StMat4, count);
+	StMat4 *pY   = stMemAlloc(StMat4, count);
+	StMat4 *pRes = stMemAlloc(StMat4, count);
+	StVec4 *pVec = stMemAlloc(StVec4, count);
+	StVec4 *pVecRes = stMemAlloc(StVec4, count);
+	StQuat *pQuat = stMemAlloc(StQuat, count);
+	f32 *pDet = stMemAlloc(f32, count);
+	StMat4Stream x = {0}, y = {0}, res = {0};
+	StVec3Stream in  = benchVec3StreamCreate(count);
+	StVec3Stream out = benchVec3StreamCreate(count);
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) {
+			x.m[i][j]   = stMemAlloc(f32, count);
+			y.m[i][j]   = stMemAlloc(f32, count);
+			res.m[i][j] = stMemAlloc(f32, count);
+		}
+	}
+
+	for (usize n = 0; n < count; n++) {
+		for (u32 j = 0; j < 16; j++) {
+			pX[n].m[j / 4][j % 4] = benchRandom(&seed);
+			pY[n].m[j / 4][j % 4] = benchRandom(&seed);
+		}
+		for (u32 j = 0; j < 4; j++) pVec[n].v[j] = benchRandom(&seed) * 100.0f;
+		pQuat[n] = stQuatNormalize(STQUAT(benchRandom(&seed), benchRandom(&seed), benchRandom(&seed), benchRandom(&seed)));
+		stMat4StreamSet(x, n, pX[n]);
+		stMat4StreamSet(y, n, pY[n]);
+		stVec3StreamSet(in, n, STVEC3(pVec[n].x, pVec[n].y, pVec[n].z));
+	}
+
+	// sums are measured at the size of their terms instead of their result, since cancellation makes
+	// any f32 math look bad relative to a result close to 0
+	f64 single = 0.0, batch = 0.0;
+	StBenchUlp ulp = {0}, batch_ulp = {0};
+
+	BENCH_BATCH_TIME(single, for (usize n = 0; n < count; n++) pRes[n] = stMat4Mul(pX[n], pY[n]));
+	BENCH_BATCH_TIME(batch, stMat4BatchMul(x, y, res, count));
+	for (usize n = 0; n < count; n++) {
+		const StMat4 mat = stMat4StreamGet(res, n);
+		for (int i = 0; i < 4; i++) {
+			for (int j = 0; j < 4; j++) {
+				f64 ref = 0.0, scale = 0.0;
+				for (int k = 0; k < 4; k++) {
+					ref   += (f64)pX[n].m[i][k] * (f64)pY[n].m[k][j];
+					scale += fabs((f64)pX[n].m[i][k] * (f64)pY[n].m[k][j]);
+				}
+				benchUlpRecord(&ulp, (f64)n, benchUlp(pRes[n].m[i][j], ref, scale));
+				benchUlpRecord(&batch_ulp, (f64)n, benchUlp(mat.m[i][j], ref, scale));
+			}
+		}
+	}
+	// stMat4BatchMul() isnt a fast path (see batch.h), so its speed is logged but not compared to stMat4Mul()
+	benchAccuracyMatReport("stMat4Mul()", &ulp, BENCH_ACCURACY_MAT_ULP, single, 0.0, NULL);
+	benchAccuracyReport("stMat4Mul() batch", &batch_ulp, BENCH_ACCURACY_MAT_ULP, batch);
+
+	ulp = batch_ulp = (StBenchUlp){0};
+	BENCH_BATCH_TIME(single, for (usize n = 0; n < count; n++) pVecRes[n] = stVec4MulMat(STVEC4(pVec[n].x, pVec[n].y, pVec[n].z, 1.0f), pX[n % 64]));
+	BENCH_BATCH_TIME(batch, stVec3BatchTransform(pX[0], in, out, count));
+	for (usize n = 0; n < count; n++) {
+		const StVec3 v = stVec3StreamGet(out, n);
+		for (int i = 0; i < 3; i++) {
+			f64 ref = pX[n % 64].m[i][3], scale = fabs(ref);
+			f64 batch_ref = pX[0].m[i][3], batch_scale = fabs(batch_ref);
+			for (int j = 0; j < 3; j++) {
+				ref         += (f64)pX[n % 64].m[i][j] * (f64)pVec[n].v[j];
+				scale       += fabs((f64)pX[n % 64].m[i][j] * (f64)pVec[n].v[j]);
+				batch_ref   += (f64)pX[0].m[i][j] * (f64)pVec[n].v[j];
+				batch_scale += fabs((f64)pX[0].m[i][j] * (f64)pVec[n].v[j]);
+			}
+			benchUlpRecord(&ulp, (f64)n, benchUlp(pVecRes[n].v[i], ref, scale));
+			benchUlpRecord(&batch_ulp, (f64)n, benchUlp(v.v[i], batch_ref, batch_scale));
+		}
+	}
+	benchAccuracyMatReport("stVec4MulMat()", &ulp, BENCH_ACCURACY_MAT_ULP, single, batch, &batch_ulp);
+
+	// the determinant is measured at the product of the row lengths (the biggest it could be)
+	ulp = (StBenchUlp){0};
+	BENCH_BATCH_TIME(single, for (usize n = 0; n < count; n++) pDet[n] = stMat4Det(pX[n]));
+	for (usize n = 0; n < count; n++) {
+		f64 m[4][4], scale = 1.0;
+		for (int i = 0; i < 4; i++) {
+			f64 length = 0.0;
+			for (int j = 0; j < 4; j++) {
+				m[i][j] = pX[n].m[i][j];
+				length += m[i][j] * m[i][j];
+			}
+			scale *= sqrt(length);
+		}
+
+		// gaussian elimination with partial pivoting
+		f64 det = 1.0;
+		for (int c = 0; c < 4; c++) {
+			int pivot = c;
+			for (int i = c + 1; i < 4; i++)
+				if (fabs(m[i][c]) > fabs(m[pivot][c])) pivot = i;
+			if (pivot != c) {
+				for (int j = 0; j < 4; j++) {
+					const f64 tmp = m[c][j];
+					m[c][j] = m[pivot][j];
+					m[pivot][j] = tmp;
+				}
+				det = -det;
+			}
+			det *= m[c][c];
+			if (m[c][c] == 0.0) break;
+			for (int i = c + 1; i < 4; i++) {
+				const f64 f = m[i][c] / m[c][c];
+				for (int j = c; j < 4; j++) m[i][j] -= f * m[c][j];
+			}
+		}
+		benchUlpRecord(&ulp, (f64)n, benchUlp(pDet[n], det, scale));
+	}
+	benchAccuracyMatReport("stMat4Det()", &ulp, BENCH_ACCURACY_MAT_ULP, single, 0.0, NULL);
+
+	// every element of a rotation matrix is at most 1, so thats the scale
+	ulp = (StBenchUlp){0};
+	BENCH_BATCH_TIME(single, for (usize n = 0; n < count; n++) pRes[n] = stQuatToMat4(pQuat[n]));
+	for (usize n = 0; n < count; n++) {
+		const f64 w = pQuat[n].w, qx = pQuat[n].x, qy = pQuat[n].y, qz = pQuat[n].z;
+		const f64 ref[3][3] = {
+			{1.0 - 2.0 * (qy * qy + qz * qz), 2.0 * (qx * qy - w * qz), 2.0 * (qx * qz + w * qy)},
+			{2.0 * (qx * qy + w * qz), 1.0 - 2.0 * (qx * qx + qz * qz), 2.0 * (qy * qz - w * qx)},
+			{2.0 * (qx * qz - w * qy), 2.0 * (qy * qz + w * qx), 1.0 - 2.0 * (qx * qx + qy * qy)},
+		};
+		for (int i = 0; i < 3; i++)
+			for (int j = 0; j < 3; j++)
+				benchUlpRecord(&ulp, (f64)n, benchUlp(pRes[n].m[i][j], ref[i][j], 1.0));
+	}
+	benchAccuracyMatReport("stQuatToMat4()", &ulp, BENCH_ACCURACY_MAT_ULP, single, 0.0, NULL);
+
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) {
+			stMemDealloc(x.m[i][j]);
+			stMemDealloc(y.m[i][j]);
+			stMemDealloc(res.m[i][j]);
+		}
+	}
+	stMemDealloc(in.x);
+	stMemDealloc(in.y);
+	stMemDealloc(in.z);
+	stMemDealloc(out.x);
+	stMemDealloc(out.y);
+	stMemDealloc(out.z);
+	stMemDealloc(pDet);
+	stMemDealloc(pQuat);
+	stMemDealloc(pVecRes);
+	stMemDealloc(pVec);
+	stMemDealloc(pRes);
+	stMemDealloc(pY);
+	stMemDealloc(pX);
+}
+
+static void benchAccuracyAll(void)
+{
+	f32 *pSweep = stMemAlloc(f32, BENCH_ACCURACY_COUNT);
+	f32 *pOut   = stMemAlloc(f32, BENCH_ACCURACY_COUNT);
+	f32 *pTimed = stMemAlloc(f32, BENCH_BATCH_COUNT);
+
+	// the thresholds are a bit over what each function does now, so they only trip on actual regressions
+	benchAccuracy((StBenchAccuracy){"stSin()", benchSin, benchSinV, sin, -STUPID_MATH_TAU, STUPID_MATH_TAU, false, 2.0}, pSweep, pTimed, pOut);
+	benchAccuracy((StBenchAccuracy){"stCos()", benchCos, benchCosV, cos, -STUPID_MATH_TAU, STUPID_MATH_TAU, false, 2.0}, pSweep, pTimed, pOut);
+	benchAccuracy((StBenchAccuracy){"stTan()", benchTan, NULL, tan, -STUPID_MATH_TAU, STUPID_MATH_TAU, false, 4.0}, pSweep, pTimed, pOut);
+	benchAccuracy((StBenchAccuracy){"stAtan()", benchAtan, NULL, atan, -100.0f, 100.0f, false, 3.0}, pSweep, pTimed, pOut);
+	benchAccuracy((StBenchAccuracy){"stAsin()", benchAsin, NULL, asin, -1.0f, 1.0f, false, 3.0}, pSweep, pTimed, pOut);
+	benchAccuracy((StBenchAccuracy){"stAcos()", benchAcos, stAcosV, acos, -1.0f, 1.0f, false, 2.0}, pSweep, pTimed, pOut);
+
+	// sqrtss is correctly rounded, rsqrtss is only good to 1.5 * 2^-12 (up to 6144 ULP), and fyl2x rounds once from 80 bits
+	benchAccuracy((StBenchAccuracy){"stSqrt()", benchSqrt, NULL, sqrt, 1e-30f, 1e30f, true, 0.5}, pSweep, pTimed, pOut);
+	benchAccuracy((StBenchAccuracy){"stISqrt()", benchISqrt, NULL, benchRefISqrt, 1e-30f, 1e30f, true, 6144.0}, pSweep, pTimed, pOut);
+	benchAccuracy((StBenchAccuracy){"stLog2()", benchLog2, NULL, log2, 1e-30f, 1e30f, true, 0.5}, pSweep, pTimed, pOut);
+
+	stMemDealloc(pTimed);
+	stMemDealloc(pOut);
+	stMemDealloc(pSweep);
+
+	benchAccuracyMat();
+}
+
+static const StBench benches[] = {
+	{"events", benchEvents},
+	{"clock", benchClock},
+	{"idle", benchIdle},
+	{"mat4", benchMat4},
+	{"batch", benchBatch},
+	{"trig", benchTrig},
+	{"cull", benchCull},
+	{"accuracy", benchAccuracyAll},
+};
+
+int main(int argc, char **argv)
+{
+	// every benchmark runs if none are named
+	bool named = false;
+	for (int a = 1; a < argc; a++) {
+		if (strcmp(argv[a], "--timing") == 0) bench_timing = true;
+		else named = true;
+	}
+
+	for (usize i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+		bool run = !named;
+		for (int a = 1; a < argc; a++)
+			if (strcmp(argv[a], benches[i].name) == 0) run = true;
+		if (!run) continue;
+
+		STUPID_LOG_SYSTEM("running %s benchmark", benches[i].name);
+		benches[i].run();
+	}
+
+	return bench_failed ? 1 : 0;
+}
@@ -14,25 +14,73 @@ static StObject cube = {0};
 static StObject monkey = {0};
 static StObject sponza = {0};
 
+// everything drawn each frame (monkey, cube, sponza, then the --objects grid)
+static StObject *pObjects = NULL;
+static u32 object_count = 3;
+
 bool handleInit(StEngine *pEngine)
 {
 	return true;
 }
 
-static int times_updated = 0;
-bool handleUpdate(StEngine *pEngine, f64 delta_time)
+bool handleUpdate(StEngine *pEngine, f32 delta_time)
 {
-	STUPID_LOG_INFO("update function called: %d", times_updated);
-	times_updated++;
+	// the camera is part of the frame snapshot (which is rendered on another thread if pipelined)
+	StFrameSnapshot *pSnapshot = stEngineGetSnapshot(pEngine);
+
+	// theres no input while headless (the engine moves the camera)
+	if (pEngine->pState->pWindow == NULL) return true;
+
+	if (stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_W)) {
+		pSnapshot->camera = stRendererCameraMoveRelative(pSnapshot->camera, STVEC3(0.0, 0.0, STUPID_TICKTIME(5.0, pEngine)));
+	}
+	if (stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_A)) {
+		pSnapshot->camera = stRendererCameraMoveRelative(pSnapshot->camera, STVEC3(STUPID_TICKTIME(5.0, pEngine), 0.0, 0.0));
+	}
+	if (stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_S)) {
+		pSnapshot->camera = stRendererCameraMoveRelative(pSnapshot->camera, STVEC3(0.0, 0.0, STUPID_TICKTIME(-5.0, pEngine)));
+	}
+	if (stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_D)) {
+		pSnapshot->camera = stRendererCameraMoveRelative(pSnapshot->camera, STVEC3(STUPID_TICKTIME(-5.0, pEngine), 0.0, 0.0));
+	}
+	if (stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_SPACE)) {
+		pSnapshot->camera = stRendererCameraMoveRelative(pSnapshot->camera, STVEC3(0.0, STUPID_TICKTIME(5.0, pEngine), 0.0));
+	}
+	if (stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_SHIFTR)) {
+		pSnapshot->camera = stRendererCameraMoveRelative(pSnapshot->camera, STVEC3(0.0, STUPID_TICKTIME(-5.0, pEngine), 0.0));
+	}
+	if (stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_UP)) {
+		pSnapshot->camera = stRendererCameraRotate(pSnapshot->camera, 0.0f, STUPID_TICKTIME(1.0, pEngine), 0.0f);
+	}
+	if (stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_DOWN)) {
+		pSnapshot->camera = stRendererCameraRotate(pSnapshot->camera, 0.0f, STUPID_TICKTIME(-1.0, pEngine), 0.0f);
+	}
+	if (stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_LEFT)) {
+		if (stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_SHIFTL) || stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_SHIFTR))
+			pSnapshot->camera = stRendererCameraRotate(pSnapshot->camera, 0.0f, 0.0f, STUPID_TICKTIME(0.5, pEngine));
+		else
+			pSnapshot->camera = stRendererCameraRotate(pSnapshot->camera, STUPID_TICKTIME(-1.0, pEngine), 0.0f, 0.0f);
+	}
+	if (stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_RIGHT)) {
+		if (stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_SHIFTL) || stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_SHIFTR))
+			pSnapshot->camera = stRendererCameraRotate(pSnapshot->camera, 0.0f, 0.0f, STUPID_TICKTIME(-0.5, pEngine));
+		else
+			pSnapshot->camera = stRendererCameraRotate(pSnapshot->camera, STUPID_TICKTIME(1.0, pEngine), 0.0f, 0.0f);
+	}
+
 	return true;
 }
 
-static int times_rendered = 0;
-bool handleRender(StEngine *pEngine, f64 delta_time)
+bool handleSnapshot(StEngine *pEngine, StFrameSnapshot *pSnapshot, f64 alpha)
 {
-	STUPID_LOG_INFO("render function called: %d", times_rendered);
-	times_rendered++;
-	return true;
+	// animate by tick while replaying so the scene is the same every run (interpolated between ticks so its still smooth)
+	const f64 time = (pEngine->pState->pReplay) ? STUPID_TICKTIME(pEngine->pState->total_ticks + alpha, pEngine) : stGetTime();
+
+	stFrameSnapshotSetRotation(pSnapshot, &cube, stQuatFromAxisAngle(STVEC3(1.0, 0.0, 0.0), time));
+	stFrameSnapshotSetTranslation(pSnapshot, &cube, STVEC3(stCos(time) * 2.0, stSin(time) * 2.0 + 3.0, 0.0));
+	stFrameSnapshotSetRotation(pSnapshot, &monkey, stQuatFromEuler(STVEC3(0.0, time * 0.6, 0.5)));
+
+	return stFrameSnapshotDraw(pSnapshot, object_count, pObjects);
 }
 
 void handleResize(StEngine *pEngine, const i32 old_width, const i32 old_height, const i32 width, const i32 height)
@@ -48,12 +96,15 @@ void handleKeyPress(StEngine *pEngine, const st_key_id key, const bool state)
 		STUPID_LOG_SPAM("key released: %d", key);
 
 	if (state) {
-		if (key == ST_KEY_F11)
+		if (key == ST_KEY_F11) {
+			// the render thread checks if the window is resizing, so the frame in flight has to finish first
+			stFramePipelineFlush(pEngine->pState->pPipeline);
 			stWindowSetFullscreen(pEngine->pState->pWindow, !stWindowIsFullscreen(pEngine->pState->pWindow));
+		}
 
 		else if (stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_CONTROLL) || stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_CONTROLR)) {
 			if (key == ST_KEY_F)
-				STUPID_LOG_INFO("average framerate: %f", pEngine->pState->average_fps);
+				stFrameStatsLog(pEngine->pState->pFrameStats);
 
 			else if (key == ST_KEY_M)
 				stMemUsage();
@@ -69,7 +120,7 @@ void handleKeyPress(StEngine *pEngine, const st_key_id key, const bool state)
 				stMemUsage();
 			}
 			else if (key == ST_KEY_V) {
-				const bool vsync_state = stRendererGetRendererValues(pEngine->pState->pRenderer)->vsync;
+				const bool vsync_state = stRendererGetVsync(pEngine->pState->pRenderer);
 				stRendererSetVsync(pEngine->pState->pRenderer, !vsync_state);
 				STUPID_LOG_INFO("%s", ((vsync_state) ? "vsync disabled" : "vsync enabled"));
 			}
@@ -87,10 +138,10 @@ void handleMouseMove(StEngine *pEngine, const i32 x, const i32 y)
 	STUPID_LOG_SPAM("mouse position: %dx%d", x, y);
 
 	if (pEngine->pState->pWindow->captured) {
-		StRendererValues *rvals = stRendererGetRendererValues(pEngine->pState->pRenderer);
+		StFrameSnapshot *pSnapshot = stEngineGetSnapshot(pEngine);
 		f32 yaw = x * 0.03 * pEngine->pState->tickrate;
 		f32 pitch = y * 0.03 * pEngine->pState->tickrate;
-		rvals->camera = stRendererCameraRotate(rvals->camera, yaw, -pitch, 0.0f);
+		pSnapshot->camera = stRendererCameraRotate(pSnapshot->camera, yaw, -pitch, 0.0f);
 	}
 }
 
@@ -114,17 +165,12 @@ bool handleFramePrepare(StEngine *pEngine, f32 delta_time)
 	return true;
 }
 
-bool handleFrameStart(StEngine *pEngine, f32 delta_time)
-{
-	StObject objects[] = {monkey, cube, sponza};
-	stRendererDrawObjects(pEngine->pState->pRenderer, 3, objects);
-
-	return true;
-}
-
 #include <stupid/thread.h>
 
-int main(void)
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char **argv)
 {
 	StEngine engine = {0};
 	StEngine *pEngine = &engine;
@@ -133,16 +179,43 @@ int main(void)
 	pEngine->config.window.flags  = STUPID_WINDOW_CENTER | STUPID_WINDOW_FLOATING;
 	pEngine->config.max_fps       = 255;
 	pEngine->config.name          = "stupid engine";
+	pEngine->config.async_logging = true;
 	pEngine->callbackInit         = NULL;
 	pEngine->callbackShutdown     = NULL;
-	pEngine->callbackUpdate       = NULL;
+	pEngine->callbackUpdate       = handleUpdate;
+	pEngine->callbackSnapshot     = handleSnapshot;
 	pEngine->callbackFramePrepare = handleFramePrepare;
-	pEngine->callbackFrameStart   = handleFrameStart;
 	pEngine->callbackResize       = handleResize;
 	pEngine->callbackKey          = handleKeyPress;
 	pEngine->callbackMouseMove    = handleMouseMove;
 	pEngine->callbackMouseButton  = handleButtonPress;
 
+	// --binlog <file> writes logs to a binary log instead of printing them (read it with stupid_logdump)
+	// --frame-stats <file> dumps frame time percentiles every second (JSON if the file ends in .json, otherwise CSV)
+	// --objects <count> adds a grid of that many cubes (to benchmark drawing lots of objects, like --headless --objects 4096)
+	u32 grid_count = 0;
+	for (int i = 1; i + 1 < argc; i++) {
+		if (strcmp(argv[i], "--binlog") == 0)
+			pEngine->config.binary_log = argv[++i];
+		else if (strcmp(argv[i], "--frame-stats") == 0)
+			pEngine->config.frame_stats = argv[++i];
+		else if (strcmp(argv[i], "--objects") == 0)
+			grid_count = (u32)strtoul(argv[++i], NULL, 10);
+	}
+	grid_count = STUPID_MIN(grid_count, STUPID_RENDERER_MAX_OBJECTS - 3);
+
+	// --pipelined renders each frame on a separate thread while the next one is simulated
+	// --headless [frames] renders offscreen along a camera path, and prints a timing report
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--pipelined") == 0)
+			pEngine->config.pipelined = true;
+		else if (strcmp(argv[i], "--headless") == 0) {
+			pEngine->config.headless = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-')
+				pEngine->config.headless_frames = (u32)strtoul(argv[++i], NULL, 10);
+		}
+	}
+
 	int res = 0;
 	if ((res = stEngineInit(pEngine)) != STUPID_ENGINE_INIT_SUCCESS) {
 		STUPID_LOG_FATAL("failed to initialize engine: %d", res);
@@ -159,70 +232,44 @@ int main(void)
 
         stRendererSetObjectTranslation(pEngine->pState->pRenderer, &monkey, STVEC3(0.0, 3.0, 0.0));
 
-	pEngine->pState->is_running = true;
-
-	while (stEngineIsRunning(pEngine)) {
-		if (!stWindowPoll(pEngine->pState->pWindow)) break;
-
-		if (stEngineNextTick(pEngine)) {
-			StRendererValues *rvals = stRendererGetRendererValues(pEngine->pState->pRenderer);
-			if (stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_W)) {
-				rvals->camera = stRendererCameraMoveRelative(rvals->camera, STVEC3(0.0, 0.0, STUPID_TICKTIME(5.0, pEngine)));
-			}
-			if (stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_A)) {
-				rvals->camera = stRendererCameraMoveRelative(rvals->camera, STVEC3(STUPID_TICKTIME(5.0, pEngine), 0.0, 0.0));
-			}
-			if (stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_S)) {
-				rvals->camera = stRendererCameraMoveRelative(rvals->camera, STVEC3(0.0, 0.0, STUPID_TICKTIME(-5.0, pEngine)));
-			}
-			if (stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_D)) {
-				rvals->camera = stRendererCameraMoveRelative(rvals->camera, STVEC3(STUPID_TICKTIME(-5.0, pEngine), 0.0, 0.0));
-			}
-			if (stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_SPACE)) {
-				rvals->camera = stRendererCameraMoveRelative(rvals->camera, STVEC3(0.0, STUPID_TICKTIME(5.0, pEngine), 0.0));
-			}
-			if (stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_SHIFTR)) {
-				rvals->camera = stRendererCameraMoveRelative(rvals->camera, STVEC3(0.0, STUPID_TICKTIME(-5.0, pEngine), 0.0));
-			}
-			if (stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_UP)) {
-				rvals->camera = stRendererCameraRotate(rvals->camera, 0.0f, STUPID_TICKTIME(1.0, pEngine), 0.0f);
-			}
-			if (stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_DOWN)) {
-				rvals->camera = stRendererCameraRotate(rvals->camera, 0.0f, STUPID_TICKTIME(-1.0, pEngine), 0.0f);
-			}
-			if (stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_LEFT)) {
-				if (stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_SHIFTL) || stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_SHIFTR))
-					rvals->camera = stRendererCameraRotate(rvals->camera, 0.0f, 0.0f, STUPID_TICKTIME(0.5, pEngine));
-				else
-					rvals->camera = stRendererCameraRotate(rvals->camera, STUPID_TICKTIME(-1.0, pEngine), 0.0f, 0.0f);
-			}
-			if (stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_RIGHT)) {
-				if (stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_SHIFTL) || stWindowIsKeyPressed(pEngine->pState->pWindow, ST_KEY_SHIFTR))
-					rvals->camera = stRendererCameraRotate(rvals->camera, 0.0f, 0.0f, STUPID_TICKTIME(-0.5, pEngine));
-				else
-					rvals->camera = stRendererCameraRotate(rvals->camera, STUPID_TICKTIME(1.0, pEngine), 0.0f, 0.0f);
-			}
-		}
-
-		STUPID_ASSERT(stEngineBeginFrame(pEngine), "failed to start frame");
-
-		StObject objects[] = {monkey, cube, sponza};
-		stRendererSetObjectRotation(pEngine->pState->pRenderer, &cube, STVEC3(stGetTime(), 0.0, 0.0));
-		stRendererSetObjectTranslation(pEngine->pState->pRenderer, &cube, STVEC3(stCos(stGetTime()) * 2.0, stSin(stGetTime()) * 2.0 + 3.0, 0.0));
-		stRendererSetObjectRotation(pEngine->pState->pRenderer, &monkey, STVEC3(0.0, stGetTime() * 0.6, 0.5));
-
-		stRendererDrawObjects(pEngine->pState->pRenderer, 3, objects);
+	pObjects    = stMemAlloc(StObject, 3 + grid_count);
+	pObjects[0] = monkey;
+	pObjects[1] = cube;
+	pObjects[2] = sponza;
+
+	// a square grid of cubes above the scene, all sharing the cubes geometry
+	const u32 grid_width = (u32)__builtin_ceil(__builtin_sqrt((f64)grid_count));
+	for (u32 i = 0; i < grid_count; i++) {
+		StObject *pInstance = &pObjects[object_count];
+		if (!stRendererInstanceObject(pEngine->pState->pRenderer, &cube, pInstance)) break;
+
+		const f32 x = ((f32)(i % grid_width) - (f32)grid_width * 0.5f) * 0.5f;
+		const f32 z = ((f32)(i / grid_width) - (f32)grid_width * 0.5f) * 0.5f;
+		stRendererSetObjectTranslation(pEngine->pState->pRenderer, pInstance, STVEC3(x, 8.0, z));
+		stRendererSetObjectScale(pEngine->pState->pRenderer, pInstance, STVEC3(0.1, 0.1, 0.1));
+		object_count++;
+	}
 
-		STUPID_ASSERT(stEngineEndFrame(pEngine), "failed to finish frame");
+	// --record <file> saves all input, --replay <file> plays it back with a fixed timestep
+	for (int i = 1; i + 1 < argc; i++) {
+		if (strcmp(argv[i], "--record") == 0)
+			STUPID_ASSERT(stEngineRecordInput(pEngine, argv[++i]), "failed to record input");
+		else if (strcmp(argv[i], "--replay") == 0)
+			STUPID_ASSERT(stEngineReplayInput(pEngine, argv[++i]), "failed to replay input");
 	}
 
+	const bool failed = (res = stEngineStart(pEngine)) != STUPID_ENGINE_START_SUCCESS;
+	if (failed) STUPID_LOG_ERROR("main loop failed: %d", res);
+
 	stRendererUnloadObject(pEngine->pState->pRenderer, &cube);
 	stRendererUnloadObject(pEngine->pState->pRenderer, &monkey);
 	stRendererUnloadObject(pEngine->pState->pRenderer, &sponza);
+	stMemDealloc(pObjects);
 
 	stEngineShutdown(pEngine);
 
 	stMemUsage();
 
-	return 0;
+	// so scripts (like make check-vulkan) can tell the run failed
+	return (failed) ? 1 : 0;
 }
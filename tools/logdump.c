@@ -0,0 +1,271 @@
+/// @file logdump.c
+/// @brief Turns a binary log written by stBinLogOpen() back into text.
+/// Usage: stupid_logdump <file> [level]
+/// Only prints logs at or below the specified level (defaults to printing everything).
+/// @author nonexistant
+
+#include "stupid/binlog.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Names of each log level (same order as st_log_level).
+static const char *level_names[] = {
+	"CRIT",
+	"FATAL",
+	"ERROR",
+	"WARN",
+	"SYSTEM",
+	"INFO",
+	"DEBUG",
+	"SPAM",
+	"TRACE",
+};
+
+/// A binary log loaded into memory.
+typedef struct StLogDump {
+	const StBinLogHeader *pHeader;
+	const char *strings;
+	const StBinLogRecord *records;
+} StLogDump;
+
+/**
+ * Gets a string from the string table.
+ * @param pDump The binary log.
+ * @param offset Offset of the string.
+ * @return The string (or a placeholder if the offset is invalid).
+ */
+static const char *getString(const StLogDump *pDump, const u32 offset)
+{
+	if (offset == 0 || offset >= pDump->pHeader->string_capacity) return "<missing>";
+	return pDump->strings + offset;
+}
+
+/// Reads the arguments of a record in order.
+typedef struct StArgReader {
+	const StBinLogRecord *pRecord;
+	u32 pos;
+} StArgReader;
+
+/// Reads the next 8 byte argument (false if there isnt one).
+static bool readArg(StArgReader *pReader, void *pValue)
+{
+	if (pReader->pos + 8 > pReader->pRecord->length) return false;
+	memcpy(pValue, pReader->pRecord->args + pReader->pos, 8);
+	pReader->pos += 8;
+	return true;
+}
+
+/// Reads the next string argument into buf (false if there isnt one).
+static bool readString(StArgReader *pReader, char *buf, const usize size)
+{
+	u32 length = 0;
+	if (pReader->pos + sizeof(length) > pReader->pRecord->length) return false;
+	memcpy(&length, pReader->pRecord->args + pReader->pos, sizeof(length));
+	pReader->pos += sizeof(length);
+
+	if (pReader->pos + length > pReader->pRecord->length || length >= size) return false;
+	memcpy(buf, pReader->pRecord->args + pReader->pos, length);
+	buf[length] = '\0';
+	pReader->pos += length;
+	return true;
+}
+
+/**
+ * Formats a record the same way stLog() would have.
+ * @param pDump The binary log.
+ * @param pRecord The record.
+ * @param out Where to put the text.
+ * @param size Size of out.
+ */
+static void formatRecord(const StLogDump *pDump, const StBinLogRecord *pRecord, char *out, const usize size)
+{
+	StArgReader reader = {pRecord, 0};
+	const char *format = getString(pDump, pRecord->format);
+	usize used = 0;
+	out[0] = '\0';
+
+// prints the current conversion with the stars read for it
+#define EMIT(value) do {\
+	int b = 0;\
+	if (spec.stars == 0)      b = snprintf(out + used, size - used, conversion, value);\
+	else if (spec.stars == 1) b = snprintf(out + used, size - used, conversion, stars[0], value);\
+	else                      b = snprintf(out + used, size - used, conversion, stars[0], stars[1], value);\
+	if (b > 0) used = STUPID_MIN(used + (usize)b, size - 1);\
+} while (0)
+
+	StBinLogSpec spec;
+	const char *p = format;
+	while (true) {
+		const char *literal = p;
+		const bool found = stBinLogNextSpec(&p, &spec);
+
+		// copy the text before the conversion
+		const usize literal_length = STUPID_MIN((usize)((found ? spec.start : p) - literal), size - 1 - used);
+		memcpy(out + used, literal, literal_length);
+		used += literal_length;
+		out[used] = '\0';
+		if (!found) break;
+
+		if (spec.type == ST_BINLOG_ARG_NONE) {
+			if (*spec.conversion == '%' && used < size - 1) {
+				out[used++] = '%';
+				out[used] = '\0';
+			}
+			continue;
+		}
+
+		// rebuild the conversion with the length modifier the stored argument needs
+		char conversion[64];
+		const usize prefix = STUPID_MIN((usize)(spec.length_start - spec.start), sizeof(conversion) - 4);
+		memcpy(conversion, spec.start, prefix);
+		usize c = prefix;
+		if ((spec.type == ST_BINLOG_ARG_INT || spec.type == ST_BINLOG_ARG_UINT) && *spec.conversion != 'c') {
+			conversion[c++] = 'l';
+			conversion[c++] = 'l';
+		}
+		conversion[c++] = *spec.conversion;
+		conversion[c] = '\0';
+
+		int stars[2] = {0};
+		bool ok = true;
+		for (u8 i = 0; i < spec.stars && ok; i++) {
+			i64 star = 0;
+			ok = readArg(&reader, &star);
+			if (i < 2) stars[i] = (int)star;
+		}
+
+		switch (spec.type) {
+		case ST_BINLOG_ARG_INT: {
+			i64 value = 0;
+			if (!(ok = ok && readArg(&reader, &value))) break;
+			if (spec.length == ST_BINLOG_LENGTH_HH) value = (signed char)value;
+			else if (spec.length == ST_BINLOG_LENGTH_H) value = (short)value;
+
+			if (*spec.conversion == 'c') EMIT((int)value);
+			else EMIT((long long)value);
+			break;
+		}
+
+		case ST_BINLOG_ARG_UINT: {
+			u64 value = 0;
+			if (!(ok = ok && readArg(&reader, &value))) break;
+			if (spec.length == ST_BINLOG_LENGTH_HH) value = (unsigned char)value;
+			else if (spec.length == ST_BINLOG_LENGTH_H) value = (unsigned short)value;
+			EMIT((unsigned long long)value);
+			break;
+		}
+
+		case ST_BINLOG_ARG_DOUBLE: {
+			f64 value = 0.0;
+			if (!(ok = ok && readArg(&reader, &value))) break;
+			EMIT(value);
+			break;
+		}
+
+		case ST_BINLOG_ARG_STRING: {
+			char str[ST_BINLOG_RECORD_SIZE];
+			if (!(ok = ok && readString(&reader, str, sizeof(str)))) break;
+			EMIT(str);
+			break;
+		}
+
+		case ST_BINLOG_ARG_POINTER: {
+			u64 value = 0;
+			if (!(ok = ok && readArg(&reader, &value))) break;
+			if (*spec.conversion == 'p') EMIT((void *)(uintptr_t)value);
+			break;
+		}
+
+		default:
+			break;
+		}
+
+		// the rest of the arguments didnt fit in the record
+		if (!ok) {
+			snprintf(out + used, size - used, "%s", " [truncated]");
+			return;
+		}
+	}
+#undef EMIT
+
+	if (pRecord->truncated)
+		snprintf(out + used, size - used, "%s", " [truncated]");
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <file> [level]\n", argv[0]);
+		return 1;
+	}
+
+	const u32 max_level = (argc > 2) ? (u32)atoi(argv[2]) : UINT32_MAX;
+
+	FILE *file = fopen(argv[1], "rb");
+	if (file == NULL) {
+		fprintf(stderr, "failed to open %s\n", argv[1]);
+		return 1;
+	}
+
+	fseek(file, 0, SEEK_END);
+	const long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	u8 *data = aligned_alloc(64, ((usize)size + 63) & ~(usize)63);
+	if (data == NULL || size < (long)sizeof(StBinLogHeader) || fread(data, 1, size, file) != (usize)size) {
+		fprintf(stderr, "failed to read %s\n", argv[1]);
+		fclose(file);
+		free(data);
+		return 1;
+	}
+	fclose(file);
+
+	StLogDump dump = {0};
+	dump.pHeader = (const StBinLogHeader *)data;
+	const StBinLogHeader *pHeader = dump.pHeader;
+	if (memcmp(pHeader->magic, STUPID_BINLOG_MAGIC, sizeof(pHeader->magic)) != 0 ||
+	    pHeader->version != STUPID_BINLOG_VERSION ||
+	    pHeader->record_size != sizeof(StBinLogRecord) ||
+	    pHeader->records_offset + (u64)pHeader->record_count * sizeof(StBinLogRecord) > (u64)size) {
+		fprintf(stderr, "%s is not a valid binary log\n", argv[1]);
+		free(data);
+		return 1;
+	}
+
+	dump.strings = (const char *)(data + pHeader->strings_offset);
+	dump.records = (const StBinLogRecord *)(data + pHeader->records_offset);
+
+	// only the newest record_count records are still in the ring
+	const u64 next  = pHeader->next;
+	const u64 first = (next > pHeader->record_count) ? next - pHeader->record_count : 0;
+
+	u64 printed = 0, skipped = 0;
+	char text[sizeof(StKb) * 4];
+	for (u64 sequence = first; sequence < next; sequence++) {
+		const StBinLogRecord *pRecord = &dump.records[sequence & (pHeader->record_count - 1)];
+
+		// unfinished when the program died, or overwritten while this file was being read
+		if (pRecord->sequence != sequence + 1) {
+			skipped++;
+			continue;
+		}
+		if (pRecord->level > max_level) continue;
+
+		formatRecord(&dump, pRecord, text, sizeof(text));
+
+		const char *level = (pRecord->level < sizeof(level_names) / sizeof(level_names[0])) ? level_names[pRecord->level] : "?";
+		const f64 time = pRecord->time - pHeader->start_time;
+		if (pRecord->function)
+			printf("[%12.6lf] [%s] %s(): %s %s:%u\n", time, level, getString(&dump, pRecord->function), text, getString(&dump, pRecord->file), pRecord->line);
+		else
+			printf("[%12.6lf] [%s] %s\n", time, level, text);
+		printed++;
+	}
+
+	fprintf(stderr, "%lu logs printed, %lu overwritten, %lu incomplete\n", printed, first, skipped);
+
+	free(data);
+	return 0;
+}